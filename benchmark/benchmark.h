@@ -0,0 +1,103 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "mesh_io/mesh_buffer.h"
+
+// Shared pieces of the benchmarks. The ones that compare against OpenMesh itself (read_mesh, add_face,
+// DecimaterT) need OpenMeshCore, so they are only built where HAS_OPENMESH_IO says it is linked.
+namespace Benchmark {
+
+    // wall time of one call in milliseconds
+    template <typename Func>
+    double Milliseconds(Func&& func) {
+
+        const auto start = std::chrono::steady_clock::now();
+        func();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    inline void Report(const char* name, double ms, double baselineMs = 0.0) {
+
+        if (baselineMs > 0.0) printf("  %-36s %10.1f ms  %6.2fx\n", name, ms, baselineMs / ms);
+        else printf("  %-36s %10.1f ms\n", name, ms);
+    }
+
+    // Closed wavy tube of about `triangleCount` triangles, rows x columns quads split in two. Every vertex
+    // is shared by six triangles, as in a scanned or tessellated surface.
+    inline MeshBuffer Tube(size_t triangleCount) {
+
+        const size_t columns = std::max<size_t>(8, static_cast<size_t>(std::sqrt(triangleCount / 2.0)));
+        const size_t rows = std::max<size_t>(2, triangleCount / 2 / columns);
+        const float pi = 3.14159265f;
+
+        MeshBuffer mesh;
+        mesh.positions.resize((rows + 1) * columns * 3);
+        for (size_t r = 0; r <= rows; ++r) {
+
+            for (size_t c = 0; c < columns; ++c) {
+
+                const float angle = 2.0f * pi * c / columns;
+                const float radius = 1.0f + 0.1f * std::sin(8.0f * angle) * std::cos(16.0f * pi * r / rows);
+                float* p = &mesh.positions[(r * columns + c) * 3];
+                p[0] = radius * std::cos(angle);
+                p[1] = radius * std::sin(angle);
+                p[2] = 4.0f * r / rows;
+            }
+        }
+
+        mesh.indices.reserve(rows * columns * 6);
+        for (size_t r = 0; r < rows; ++r) {
+
+            for (size_t c = 0; c < columns; ++c) {
+
+                const uint32_t a = static_cast<uint32_t>(r * columns + c);
+                const uint32_t b = static_cast<uint32_t>(r * columns + (c + 1) % columns);
+                const uint32_t d = static_cast<uint32_t>(a + columns), e = static_cast<uint32_t>(b + columns);
+                mesh.indices.insert(mesh.indices.end(), { a, b, e, a, e, d });
+            }
+        }
+        return mesh;
+    }
+
+    // the same surface as quads, for the polygon mesh paths
+    inline MeshBuffer QuadTube(size_t faceCount) {
+
+        MeshBuffer mesh = Tube(faceCount * 2);
+        const size_t quadCount = mesh.indices.size() / 6;
+        std::vector<uint32_t> indices(quadCount * 4);
+        mesh.faceOffsets.resize(quadCount + 1);
+        for (size_t q = 0; q < quadCount; ++q) {
+
+            const uint32_t* t = &mesh.indices[q * 6];
+            uint32_t* quad = &indices[q * 4];
+            quad[0] = t[0];
+            quad[1] = t[1];
+            quad[2] = t[2];
+            quad[3] = t[5];
+            mesh.faceOffsets[q] = static_cast<uint32_t>(q * 4);
+        }
+        mesh.faceOffsets[quadCount] = static_cast<uint32_t>(indices.size());
+        mesh.indices = std::move(indices);
+        return mesh;
+    }
+
+    // the benchmarks, run by name from mesh_benchmark; count is the triangle or face count
+    void StlReader(size_t count);
+    void HalfedgeBuilder(size_t count);
+    void ParallelDecimation(size_t count);
+    void QuadricDecimation(size_t count);
+
+    inline std::string TempPath(const char* name) { return (std::filesystem::temp_directory_path() / name).string(); }
+}
+
+#endif // !BENCHMARK_H
@@ -0,0 +1,144 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include <OpenMesh/Core/Mesh/TriMesh_ArrayKernelT.hh>
+#include <OpenMesh/Tools/Decimater/DecimaterT.hh>
+#include <OpenMesh/Tools/Decimater/ModQuadricT.hh>
+
+#include "benchmark.h"
+#include "mesh/mesh_builder.h"
+#include "mesh/parallel_decimater.h"
+#include "mesh/quadric_decimater.h"
+
+#ifdef HAS_OPENMESH_IO
+namespace {
+
+    using Benchmark::Milliseconds;
+    using Mesh = OpenMesh::TriMesh_ArrayKernelT<>;
+
+    struct Quality {
+
+        size_t faces = 0;
+        double meanError = 0.0;
+        double maxError = 0.0;
+    };
+
+    void Load(const MeshBuffer& buffer, Mesh& mesh) {
+
+        mesh.request_vertex_status();
+        mesh.request_edge_status();
+        mesh.request_face_status();
+        MeshTools::BuildMesh(mesh, buffer.positions.data(), buffer.VertexCount(), buffer.indices.data(), nullptr, buffer.FaceCount());
+    }
+
+    // Distance of every face centroid from the surface Benchmark::Tube samples. Collapses keep vertices
+    // on the surface, so the centroids show how far the faces between them cut through it.
+    Quality Measure(const Mesh& mesh) {
+
+        Quality quality;
+        for (auto fh : mesh.faces()) {
+
+            if (mesh.status(fh).deleted()) continue;
+
+            OpenMesh::Vec3f c(0.0f, 0.0f, 0.0f);
+            for (auto vh : mesh.fv_range(fh)) c += mesh.point(vh) / 3.0f;
+
+            const double angle = std::atan2(c[1], c[0]);
+            const double radius = 1.0 + 0.1 * std::sin(8.0 * angle) * std::cos(4.0 * 3.14159265358979 * c[2]);
+            const double error = std::abs(std::hypot(c[0], c[1]) - radius);
+
+            ++quality.faces;
+            quality.meanError += error;
+            quality.maxError = std::max(quality.maxError, error);
+        }
+        if (quality.faces) quality.meanError /= quality.faces;
+        return quality;
+    }
+
+    void Print(const char* name, double ms, double baselineMs, const Quality& quality) {
+
+        Benchmark::Report(name, ms, baselineMs);
+        printf("  %-36s %10zu faces, deviation mean %.2e max %.2e\n", "", quality.faces, quality.meanError, quality.maxError);
+    }
+}
+#endif
+
+void Benchmark::ParallelDecimation(size_t count) {
+
+#ifdef HAS_OPENMESH_IO
+    const MeshBuffer tube = Tube(count);
+    const size_t targetFaces = tube.FaceCount() / 10;
+    printf("  %zu triangles down to %zu\n", tube.FaceCount(), targetFaces);
+
+    Mesh serialMesh;
+    Load(tube, serialMesh);
+    const double serial = Milliseconds([&] {
+
+        OpenMesh::Decimater::DecimaterT<Mesh> decimater(serialMesh);
+        OpenMesh::Decimater::ModQuadricT<Mesh>::Handle quadric;
+        decimater.add(quadric);
+        decimater.initialize();
+        decimater.decimate_to_faces(0, targetFaces);
+    });
+    Print("DecimaterT + ModQuadricT", serial, 0.0, Measure(serialMesh));
+
+    for (const float fraction : { 0.25f, 0.05f }) {
+
+        Mesh mesh;
+        Load(tube, mesh);
+        const double ms = Milliseconds([&] {
+
+            MeshTools::ParallelDecimater<Mesh> decimater(mesh);
+            OpenMesh::Decimater::ModQuadricT<Mesh>::Handle quadric;
+            decimater.add(quadric);
+            decimater.set_round_fraction(fraction);
+            decimater.initialize();
+            decimater.decimate_to_faces(0, targetFaces);
+        });
+
+        char name[64];
+        snprintf(name, sizeof(name), "ParallelDecimater, fraction %.2f", fraction);
+        Print(name, ms, serial, Measure(mesh));
+    }
+#else
+    (void)count;
+    printf("  OpenMeshCore is not linked, DecimaterT and ParallelDecimater are not measured\n");
+#endif
+}
+
+void Benchmark::QuadricDecimation(size_t count) {
+
+#ifdef HAS_OPENMESH_IO
+    const MeshBuffer tube = Tube(count);
+    const size_t targetFaces = tube.FaceCount() / 10;
+    printf("  %zu triangles down to %zu\n", tube.FaceCount(), targetFaces);
+
+    Mesh reference;
+    Load(tube, reference);
+    const double serial = Milliseconds([&] {
+
+        OpenMesh::Decimater::DecimaterT<Mesh> decimater(reference);
+        OpenMesh::Decimater::ModQuadricT<Mesh>::Handle quadric;
+        decimater.add(quadric);
+        decimater.initialize();
+        decimater.decimate_to_faces(0, targetFaces);
+    });
+    Print("DecimaterT + ModQuadricT", serial, 0.0, Measure(reference));
+
+    Mesh mesh;
+    Load(tube, mesh);
+    const double fast = Milliseconds([&] {
+
+        MeshTools::HeapDecimater<Mesh> decimater(mesh);
+        MeshTools::ModFastQuadric<Mesh>::Handle quadric;
+        decimater.add(quadric);
+        decimater.initialize();
+        decimater.decimate_to_faces(0, targetFaces);
+    });
+    Print("HeapDecimater + ModFastQuadric", fast, serial, Measure(mesh));
+#else
+    (void)count;
+    printf("  OpenMeshCore is not linked, DecimaterT and HeapDecimater are not measured\n");
+#endif
+}
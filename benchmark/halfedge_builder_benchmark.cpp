@@ -0,0 +1,116 @@
+#include <cstdio>
+#include <vector>
+
+#include <OpenMesh/Core/Mesh/PolyMesh_ArrayKernelT.hh>
+#include <OpenMesh/Core/Mesh/TriMesh_ArrayKernelT.hh>
+
+#include "benchmark.h"
+#include "mesh/halfedge_builder.h"
+#include "mesh/mesh_builder.h"
+
+namespace {
+
+    using Benchmark::Milliseconds;
+    using Benchmark::Report;
+
+    // The halfedge lookup add_face does per corner: walk the outgoing halfedges of the start vertex for
+    // one that ends at the next vertex, and create the edge if there is none. Stands in for add_face
+    // where OpenMesh is not linked; it builds the same edges but skips the next/prev relinking.
+    size_t AddFacesSequential(size_t vertexCount, const uint32_t* indices, const uint32_t* faceOffsets, size_t faceCount) {
+
+        std::vector<std::vector<std::pair<uint32_t, int>>> outgoing(vertexCount);
+        std::vector<int> halfedgeFace;
+        for (size_t f = 0; f < faceCount; ++f) {
+
+            const uint32_t begin = faceOffsets ? faceOffsets[f] : static_cast<uint32_t>(f * 3);
+            const uint32_t end = faceOffsets ? faceOffsets[f + 1] : begin + 3;
+            for (uint32_t k = begin; k < end; ++k) {
+
+                const uint32_t from = indices[k], to = indices[k + 1 < end ? k + 1 : begin];
+                int halfedge = -1;
+                for (const auto& [target, h] : outgoing[from]) if (target == to) { halfedge = h; break; }
+                if (halfedge < 0) {
+
+                    halfedge = static_cast<int>(halfedgeFace.size());
+                    halfedgeFace.push_back(-1);
+                    halfedgeFace.push_back(-1);
+                    outgoing[from].emplace_back(to, halfedge);
+                    outgoing[to].emplace_back(from, halfedge + 1);
+                }
+                halfedgeFace[halfedge] = static_cast<int>(f);
+            }
+        }
+        return halfedgeFace.size() / 2;
+    }
+
+    void Run(const char* label, const MeshBuffer& mesh) {
+
+        const uint32_t* offsets = mesh.faceOffsets.empty() ? nullptr : mesh.faceOffsets.data();
+        const size_t faceCount = mesh.FaceCount();
+        printf("  %s: %zu faces, %zu vertices\n", label, faceCount, mesh.VertexCount());
+
+        size_t edgeCount = 0;
+        const double sequential = Milliseconds([&] { edgeCount = AddFacesSequential(mesh.VertexCount(), mesh.indices.data(), offsets, faceCount); });
+
+        MeshTools::HalfedgeTopology topology;
+        const double built = Milliseconds([&] { topology = MeshTools::BuildHalfedgeTopology(mesh.VertexCount(), mesh.indices.data(), offsets, faceCount); });
+        if (topology.EdgeCount() != edgeCount) printf("  edge counts differ: %zu and %zu\n", topology.EdgeCount(), edgeCount);
+
+        Report("per-face halfedge lookup", sequential);
+        Report("BuildHalfedgeTopology", built, sequential);
+    }
+
+#ifdef HAS_OPENMESH_IO
+    template <class Mesh>
+    void RunOpenMesh(const MeshBuffer& mesh) {
+
+        const uint32_t* offsets = mesh.faceOffsets.empty() ? nullptr : mesh.faceOffsets.data();
+        const size_t faceCount = mesh.FaceCount();
+
+        Mesh added;
+        const double addFace = Milliseconds([&] {
+
+            added.reserve(mesh.VertexCount(), mesh.VertexCount() * 3, faceCount);
+            for (size_t v = 0; v < mesh.VertexCount(); ++v)
+                added.add_vertex(typename Mesh::Point(mesh.positions[v * 3], mesh.positions[v * 3 + 1], mesh.positions[v * 3 + 2]));
+
+            std::vector<OpenMesh::VertexHandle> face;
+            for (size_t f = 0; f < faceCount; ++f) {
+
+                const uint32_t begin = offsets ? offsets[f] : static_cast<uint32_t>(f * 3);
+                const uint32_t end = offsets ? offsets[f + 1] : begin + 3;
+                face.clear();
+                for (uint32_t k = begin; k < end; ++k) face.emplace_back(static_cast<int>(mesh.indices[k]));
+                added.add_face(face);
+            }
+        });
+
+        Mesh built;
+        const double buildMesh = Milliseconds([&] {
+
+            MeshTools::BuildMesh(built, mesh.positions.data(), mesh.VertexCount(), mesh.indices.data(), offsets, faceCount);
+        });
+        if (built.n_edges() != added.n_edges()) printf("  edge counts differ: %zu and %zu\n", built.n_edges(), added.n_edges());
+
+        Report("OpenMesh add_face", addFace);
+        Report("BuildMesh", buildMesh, addFace);
+    }
+#endif
+}
+
+void Benchmark::HalfedgeBuilder(size_t count) {
+
+    const MeshBuffer triangles = Tube(count);
+    Run("triangles", triangles);
+#ifdef HAS_OPENMESH_IO
+    RunOpenMesh<OpenMesh::TriMesh_ArrayKernelT<>>(triangles);
+#endif
+
+    const MeshBuffer quads = QuadTube(count / 2);
+    Run("quads", quads);
+#ifdef HAS_OPENMESH_IO
+    RunOpenMesh<OpenMesh::PolyMesh_ArrayKernelT<>>(quads);
+#else
+    printf("  OpenMeshCore is not linked, add_face is not measured\n");
+#endif
+}
@@ -0,0 +1,47 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "benchmark.h"
+#include "utils/task_system.h"
+
+namespace {
+
+    struct Entry {
+
+        const char* name;
+        void (*run)(size_t count);
+        size_t defaultCount;
+    };
+
+    const Entry benchmarks[] = {
+        { "stl_reader", Benchmark::StlReader, size_t(10) << 20 },
+        { "halfedge_builder", Benchmark::HalfedgeBuilder, size_t(4) << 20 },
+        { "parallel_decimation", Benchmark::ParallelDecimation, size_t(1) << 20 },
+        { "quadric_decimation", Benchmark::QuadricDecimation, size_t(1) << 20 },
+    };
+}
+
+// mesh_benchmark [name|all] [count]
+int main(int argc, char** argv) {
+
+    const char* name = argc > 1 ? argv[1] : "all";
+    const size_t count = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 0;
+
+    bool found = false;
+    for (const Entry& entry : benchmarks) {
+
+        if (std::strcmp(name, "all") != 0 && std::strcmp(name, entry.name) != 0) continue;
+        found = true;
+        printf("%s (%zu workers)\n", entry.name, Tasks::WorkerCount());
+        entry.run(count ? count : entry.defaultCount);
+    }
+    if (!found) {
+
+        fprintf(stderr, "usage: %s [all", argv[0]);
+        for (const Entry& entry : benchmarks) fprintf(stderr, "|%s", entry.name);
+        fprintf(stderr, "] [count]\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,99 @@
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <map>
+
+#include <OpenMesh/Core/IO/MeshIO.hh>
+#include <OpenMesh/Core/Mesh/TriMesh_ArrayKernelT.hh>
+
+#include "benchmark.h"
+#include "mesh_io/mesh_import.h"
+#include "mesh_io/mesh_writer.h"
+#include "mesh_io/stl_reader.h"
+
+namespace {
+
+    // What _STLReader_::read_stlb does per triangle: read it from a stream and look every corner up in
+    // an ordered map of the positions seen so far. Stands in for read_mesh where OpenMesh is not linked.
+    bool ReadStlSequential(const std::string& path, MeshBuffer& mesh) {
+
+        FILE* file = fopen(path.c_str(), "rb");
+        if (!file) return false;
+
+        char header[84];
+        uint32_t triangleCount = 0;
+        if (fread(header, 1, sizeof(header), file) != sizeof(header)) {
+
+            fclose(file);
+            return false;
+        }
+        std::memcpy(&triangleCount, header + 80, sizeof(triangleCount));
+
+        mesh.Clear();
+        std::map<std::array<float, 3>, uint32_t> vertices;
+        for (uint32_t t = 0; t < triangleCount; ++t) {
+
+            char record[50];
+            if (fread(record, 1, sizeof(record), file) != sizeof(record)) break;
+            for (int k = 0; k < 3; ++k) {
+
+                std::array<float, 3> p;
+                std::memcpy(p.data(), record + 12 + k * 12, sizeof(p));
+                const auto [it, isNew] = vertices.emplace(p, static_cast<uint32_t>(vertices.size()));
+                if (isNew) mesh.positions.insert(mesh.positions.end(), p.begin(), p.end());
+                mesh.indices.push_back(it->second);
+            }
+        }
+        fclose(file);
+        return true;
+    }
+}
+
+void Benchmark::StlReader(size_t count) {
+
+    const std::string path = TempPath("benchmark_tube.stl");
+    {
+        const MeshBuffer tube = Tube(count);
+        MeshIO::MeshWriteView view;
+        view.positions = tube.positions.data();
+        view.vertexCount = tube.VertexCount();
+        view.indices = tube.indices.data();
+        view.faceCount = tube.FaceCount();
+        if (!MeshIO::WriteStl(path, view, true)) return;
+        printf("  %zu triangles, %zu vertices, %.0f MB\n", tube.FaceCount(), tube.VertexCount(), std::filesystem::file_size(path) / 1048576.0);
+    }
+
+    // the first read only brings the file into the page cache
+    MeshBuffer mesh;
+    MeshIO::ReadBinaryStl(path, mesh);
+
+    const double fast = Milliseconds([&] { MeshIO::ReadBinaryStl(path, mesh); });
+    const size_t vertexCount = mesh.VertexCount();
+
+    MeshBuffer reference;
+    const double sequential = Milliseconds([&] { ReadStlSequential(path, reference); });
+    if (reference.VertexCount() != vertexCount) printf("  vertex counts differ: %zu and %zu\n", vertexCount, reference.VertexCount());
+    reference = {};
+
+    Report("sequential map weld", sequential);
+    Report("ReadBinaryStl", fast, sequential);
+
+#ifdef HAS_OPENMESH_IO
+    OpenMesh::TriMesh_ArrayKernelT<> trimesh;
+    const double openMesh = Milliseconds([&] { OpenMesh::IO::read_mesh(trimesh, path); });
+    Report("OpenMesh read_mesh", openMesh);
+
+    const double imported = Milliseconds([&] {
+
+        OpenMesh::IO::Options opt;
+        MeshIO::ReadBinaryStl(path, mesh);
+        MeshIO::Import(mesh, trimesh, opt);
+    });
+    Report("ReadBinaryStl + Import", imported, openMesh);
+#else
+    printf("  OpenMeshCore is not linked, read_mesh is not measured\n");
+#endif
+
+    std::filesystem::remove(path);
+}
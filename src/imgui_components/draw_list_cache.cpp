@@ -0,0 +1,206 @@
+#include "draw_list_cache.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <ImGui/imgui_internal.h>
+
+#include "../utils/file_hash.h"
+
+namespace {
+
+    bool IsInWindow(const ImGuiWindow* window, const ImGuiWindow* root) { return window && window->RootWindow == root; }
+}
+
+void DrawListCache::NewFrame() {
+
+    IM_ASSERT(current == nullptr && "DrawListCache::Begin without End");
+    lastStats = stats;
+    stats = {};
+
+    const int previousFrame = ImGui::GetFrameCount() - 1;
+    std::erase_if(entries, [previousFrame](const auto& item) { return item.second.lastFrame < previousFrame; });
+}
+
+bool DrawListCache::Begin(const char* id, uint64_t inputHash) {
+
+    IM_ASSERT(current == nullptr && "DrawListCache regions cannot nest");
+    ImGuiWindow* window = ImGui::GetCurrentWindow();
+    Entry& entry = entries[window->GetID(id)];
+    entry.lastFrame = ImGui::GetFrameCount();
+    current = &entry;
+    isCapturing = false;
+    ++stats.regions;
+
+    // what the widgets draw now depends on more than the key, and the next calm frame starts over
+    if (window->SkipItems || window->Appearing || IsInteracting()) {
+
+        entry.key = 0;
+        entry.isValid = false;
+        return true;
+    }
+
+    const uint64_t key = Key(inputHash);
+    if (entry.isValid && entry.key == key) {
+
+        Replay(entry);
+        current = nullptr;
+        ++stats.replayed;
+        stats.replayedVertices += static_cast<int>(entry.vertices.size());
+        return false;
+    }
+
+    // only a region that looked the same last frame is recorded, one that changes every frame never pays for the copy
+    isCapturing = entry.key == key;
+    entry.key = key;
+    entry.isValid = false;
+    if (isCapturing) {
+
+        vertexStart = window->DrawList->VtxBuffer.Size;
+        indexStart = window->DrawList->IdxBuffer.Size;
+        vertexOffset = window->DrawList->_CmdHeader.VtxOffset;
+    }
+    return true;
+}
+
+void DrawListCache::End() {
+
+    IM_ASSERT(current != nullptr && "DrawListCache::End without Begin");
+    Entry& entry = *current;
+    current = nullptr;
+    if (!isCapturing) return;
+
+    isCapturing = false;
+    Capture(entry);
+}
+
+bool DrawListCache::IsInteracting() const {
+
+    const ImGuiContext& g = *GImGui;
+    const ImGuiWindow* root = g.CurrentWindow->RootWindow;
+    return IsInWindow(g.HoveredWindow, root) ||
+           (g.ActiveId != 0 && (!g.ActiveIdWindow || IsInWindow(g.ActiveIdWindow, root))) ||
+           IsInWindow(g.NavWindow, root) ||
+           g.OpenPopupStack.Size > 0 || g.DragDropActive;
+}
+
+uint64_t DrawListCache::Key(uint64_t inputHash) const {
+
+    const ImGuiContext& g = *GImGui;
+    const ImGuiWindow* window = g.CurrentWindow;
+    const ImVec4& clipRect = window->DrawList->_CmdHeader.ClipRect;
+
+    // everything the region's geometry depends on besides its inputs, including the glyphs and
+    // height of the font atlas, which grows and gains glyphs between frames
+    const float layout[] = {
+        window->Pos.x, window->Pos.y, window->Size.x, window->Size.y, window->Scroll.x, window->Scroll.y,
+        window->DC.CursorPos.x, window->DC.CursorPos.y, window->DC.ItemWidth, window->DC.TextWrapPos,
+        clipRect.x, clipRect.y, clipRect.z, clipRect.w, g.FontSize,
+    };
+    const uint64_t font[] = {
+        reinterpret_cast<uint64_t>(g.Font), reinterpret_cast<uint64_t>(g.IO.Fonts->TexID),
+        static_cast<uint64_t>(g.IO.Fonts->TexHeight), static_cast<uint64_t>(g.Font->Glyphs.Size),
+    };
+    uint64_t key = Hash::Bytes(layout, sizeof(layout), inputHash);
+    key = Hash::Bytes(font, sizeof(font), key);
+    return Hash::Bytes(&g.Style, sizeof(g.Style), key);
+}
+
+void DrawListCache::Capture(Entry& entry) {
+
+    ImGuiWindow* window = ImGui::GetCurrentWindow();
+    const ImDrawList* drawList = window->DrawList;
+    const int vertexCount = drawList->VtxBuffer.Size - vertexStart;
+    const int indexEnd = drawList->IdxBuffer.Size;
+    if (vertexCount < 0 || indexEnd < indexStart) return;
+
+    // the commands covering the region's indices, merged where the state does not change
+    entry.segments.clear();
+    int c = drawList->CmdBuffer.Size - 1;
+    while (c > 0 && static_cast<int>(drawList->CmdBuffer[c].IdxOffset) > indexStart) --c;
+    for (; c < drawList->CmdBuffer.Size; ++c) {
+
+        const ImDrawCmd& cmd = drawList->CmdBuffer[c];
+        const int begin = std::max(static_cast<int>(cmd.IdxOffset), indexStart);
+        const int end = std::min(static_cast<int>(cmd.IdxOffset + cmd.ElemCount), indexEnd);
+        if (end <= begin) continue;
+        if (cmd.UserCallback != nullptr || cmd.VtxOffset != vertexOffset) return;
+
+        const unsigned int count = static_cast<unsigned int>(end - begin);
+        if (!entry.segments.empty() && entry.segments.back().textureId == cmd.TextureId &&
+            std::memcmp(&entry.segments.back().clipRect, &cmd.ClipRect, sizeof(ImVec4)) == 0) entry.segments.back().count += count;
+        else entry.segments.push_back({ cmd.ClipRect, cmd.TextureId, count });
+    }
+
+    entry.indices.resize(indexEnd - indexStart);
+    for (int i = indexStart; i < indexEnd; ++i) {
+
+        const unsigned int vertex = vertexOffset + drawList->IdxBuffer[i] - vertexStart;
+        if (vertex >= static_cast<unsigned int>(vertexCount)) return;
+        entry.indices[i - indexStart] = static_cast<ImDrawIdx>(vertex);
+    }
+    entry.vertices.assign(drawList->VtxBuffer.Data + vertexStart, drawList->VtxBuffer.Data + vertexStart + vertexCount);
+
+    const ImGuiWindowTempData& dc = window->DC;
+    entry.cursorPos = dc.CursorPos;
+    entry.cursorPosPrevLine = dc.CursorPosPrevLine;
+    entry.cursorMaxPos = dc.CursorMaxPos;
+    entry.idealMaxPos = dc.IdealMaxPos;
+    entry.currLineSize = dc.CurrLineSize;
+    entry.prevLineSize = dc.PrevLineSize;
+    entry.currLineTextBaseOffset = dc.CurrLineTextBaseOffset;
+    entry.prevLineTextBaseOffset = dc.PrevLineTextBaseOffset;
+    entry.isSameLine = dc.IsSameLine;
+    entry.navLayersActiveMaskNext = dc.NavLayersActiveMaskNext;
+    entry.isValid = true;
+}
+
+void DrawListCache::Replay(const Entry& entry) {
+
+    ImGuiWindow* window = ImGui::GetCurrentWindow();
+    ImDrawList* drawList = window->DrawList;
+    const ImDrawCmdHeader header = drawList->_CmdHeader;
+
+    // the first reservation takes all vertices and may start a new vertex offset, the indices are rebased on it
+    const ImDrawIdx* indices = entry.indices.data();
+    const int vertexCount = static_cast<int>(entry.vertices.size());
+    unsigned int base = 0;
+    for (size_t s = 0; s < entry.segments.size(); ++s) {
+
+        const Segment& segment = entry.segments[s];
+        drawList->_CmdHeader.ClipRect = segment.clipRect;
+        drawList->_OnChangedClipRect();
+        drawList->_CmdHeader.TextureId = segment.textureId;
+        drawList->_OnChangedTextureID();
+
+        drawList->PrimReserve(static_cast<int>(segment.count), s == 0 ? vertexCount : 0);
+        if (s == 0) {
+
+            base = drawList->_VtxCurrentIdx;
+            std::memcpy(drawList->_VtxWritePtr, entry.vertices.data(), entry.vertices.size() * sizeof(ImDrawVert));
+            drawList->_VtxWritePtr += vertexCount;
+        }
+        for (unsigned int i = 0; i < segment.count; ++i) drawList->_IdxWritePtr[i] = static_cast<ImDrawIdx>(indices[i] + base);
+        drawList->_IdxWritePtr += segment.count;
+        indices += segment.count;
+    }
+    if (!entry.segments.empty()) drawList->_VtxCurrentIdx += vertexCount;
+
+    drawList->_CmdHeader.ClipRect = header.ClipRect;
+    drawList->_OnChangedClipRect();
+    drawList->_CmdHeader.TextureId = header.TextureId;
+    drawList->_OnChangedTextureID();
+
+    // the window is laid out as if the widgets had been submitted
+    ImGuiWindowTempData& dc = window->DC;
+    dc.CursorPos = entry.cursorPos;
+    dc.CursorPosPrevLine = entry.cursorPosPrevLine;
+    dc.CursorMaxPos = ImMax(dc.CursorMaxPos, entry.cursorMaxPos);
+    dc.IdealMaxPos = ImMax(dc.IdealMaxPos, entry.idealMaxPos);
+    dc.CurrLineSize = entry.currLineSize;
+    dc.PrevLineSize = entry.prevLineSize;
+    dc.CurrLineTextBaseOffset = entry.currLineTextBaseOffset;
+    dc.PrevLineTextBaseOffset = entry.prevLineTextBaseOffset;
+    dc.IsSameLine = entry.isSameLine;
+    dc.NavLayersActiveMaskNext |= entry.navLayersActiveMaskNext;
+}
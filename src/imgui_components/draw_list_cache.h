@@ -0,0 +1,99 @@
+#ifndef DRAW_LIST_CACHE_H
+#define DRAW_LIST_CACHE_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <ImGui/imgui.h>
+
+// regions of the last frame
+struct DrawListCacheStats {
+
+    int regions = 0;
+    int replayed = 0;
+    int replayedVertices = 0;
+
+    float SkipRatio() const { return regions ? float(replayed) / regions : 0.0f; }
+};
+
+// Retained geometry for static parts of ImGui windows.
+// A region between Begin and End is recorded from the window's draw list once it has looked the same
+// for two frames, and replayed with a copy of its vertices and indices instead of running the widgets
+// while its key stays the same. The key covers `inputHash` (the values the region shows), the window
+// position, size and scroll, the font atlas and the style; whenever the mouse, an active item, focus,
+// a popup or drag and drop could involve the window, the region is submitted normally. A replayed region
+// submits no items, so widgets in it have no IDs, nav targets or last item data on those frames; that
+// is only safe while the window can take no input, hence focus counts as interacting.
+// Regions cannot nest and have to start and end in the same draw list channel.
+class DrawListCache {
+
+    // constructor
+public:
+    DrawListCache() = default;
+
+    DrawListCache(const DrawListCache&) = delete;
+    DrawListCache& operator=(const DrawListCache&) = delete;
+
+    // main functions
+public:
+    // call after ImGui::NewFrame, drops the regions that were not used in the last frame
+    void NewFrame();
+
+    // False when the region was replayed. Otherwise the widgets have to be submitted, followed by End.
+    bool Begin(const char* id, uint64_t inputHash);
+    void End();
+
+    const DrawListCacheStats& Stats() const { return lastStats; }
+
+    // sub functions
+private:
+    struct Entry;
+
+    bool IsInteracting() const;
+    uint64_t Key(uint64_t inputHash) const;
+    void Capture(Entry& entry);
+    void Replay(const Entry& entry);
+
+    // variables
+private:
+    // a run of indices with the same clip rectangle and texture
+    struct Segment {
+
+        ImVec4 clipRect;
+        ImTextureID textureId;
+        unsigned int count;
+    };
+
+    struct Entry {
+
+        uint64_t key = 0;
+        bool isValid = false;
+        int lastFrame = -1;
+
+        std::vector<ImDrawVert> vertices;
+        std::vector<ImDrawIdx> indices;         // relative to the first vertex
+        std::vector<Segment> segments;
+
+        // window layout state after the region
+        ImVec2 cursorPos, cursorPosPrevLine, cursorMaxPos, idealMaxPos;
+        ImVec2 currLineSize, prevLineSize;
+        float currLineTextBaseOffset = 0.0f, prevLineTextBaseOffset = 0.0f;
+        bool isSameLine = false;
+        short navLayersActiveMaskNext = 0;
+    };
+
+    std::unordered_map<ImGuiID, Entry> entries;
+
+    // the region being submitted
+    Entry* current = nullptr;
+    bool isCapturing = false;
+    int vertexStart = 0;
+    int indexStart = 0;
+    unsigned int vertexOffset = 0;
+
+    DrawListCacheStats stats;
+    DrawListCacheStats lastStats;
+};
+
+#endif // !DRAW_LIST_CACHE_H
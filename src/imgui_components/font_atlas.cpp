@@ -0,0 +1,494 @@
+#include "font_atlas.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include <glad/glad.h>
+#include <ImGui/imgui_internal.h>
+
+#include "../utils/file_hash.h"
+
+namespace {
+
+    constexpr char FONT_CACHE_MAGIC[8] = { 'I', 'M', 'F', 'O', 'N', 'T', 'C', '\0' };
+    constexpr uint32_t FONT_CACHE_VERSION = 1;
+    constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+    constexpr int LINE_UV_COUNT = IM_DRAWLIST_TEX_LINES_WIDTH_MAX + 1;
+
+    struct FontCacheHeader {
+
+        char magic[8];
+        uint32_t version;
+        uint32_t byteOrder;
+        uint64_t key;
+        int32_t texWidth;
+        int32_t texHeight;
+        int32_t cursorX;
+        int32_t cursorY;
+        int32_t shelfHeight;
+        uint32_t glyphCount;
+        uint32_t usesColors;                // pixels are RGBA, otherwise alpha only
+        float ascent;
+        float descent;
+        float whitePixel[2];
+        float lines[LINE_UV_COUNT * 4];
+    };
+
+    struct FontCacheGlyph {
+
+        uint32_t codepoint;
+        uint32_t colored;
+        float advanceX;
+        float x0, y0, x1, y1;
+        float u0, v0, u1, v1;
+    };
+
+    // everything that changes the rasterized output
+    uint64_t CacheKey(uint64_t fontHash, const ImFontConfig& config, const ImFontAtlas* atlas, const ImWchar* lazyRanges) {
+
+        struct {
+            uint64_t fontHash;
+            float sizePixels;
+            int32_t fontNo;
+            uint32_t builderFlags;
+            int32_t padding;
+            int32_t version;
+        } key{ fontHash, config.SizePixels, config.FontNo, config.FontBuilderFlags | atlas->FontBuilderFlags, atlas->TexGlyphPadding, IMGUI_VERSION_NUM };
+
+        auto rangesLength = [](const ImWchar* ranges) { size_t n = 0; while (ranges[n]) n += 2; return n; };
+        const ImWchar* baseRanges = config.GlyphRanges;
+        uint64_t h = Hash::Bytes(&key, sizeof(key));
+        h = Hash::Bytes(baseRanges, rangesLength(baseRanges) * sizeof(ImWchar), h);
+        return Hash::Bytes(lazyRanges, rangesLength(lazyRanges) * sizeof(ImWchar), h);
+    }
+
+    // rows below the glyphs and custom rectangles of a freshly built atlas
+    int UsedHeight(const ImFontAtlas* atlas) {
+
+        int used = 0;
+        for (const ImFont* f : atlas->Fonts)
+            for (const ImFontGlyph& g : f->Glyphs)
+                if (g.Visible) used = std::max(used, static_cast<int>(std::ceil(g.V1 * atlas->TexHeight)));
+        for (const ImFontAtlasCustomRect& r : atlas->CustomRects)
+            if (r.IsPacked()) used = std::max(used, r.Y + r.Height);
+        return used;
+    }
+}
+
+bool FontAtlas::Init(ImFontAtlas* atlas, const std::string& fontPath, float sizePixels, const ImWchar* lazyRanges, const std::string& cachePath) {
+
+    if (!atlas->Fonts.empty()) {
+
+        fprintf(stderr, "FontAtlas::Init: the atlas already holds fonts\n");
+        return false;
+    }
+
+    uint64_t fontHash = 0;
+    if (!fontFile.Open(fontPath) || fontFile.Size() == 0 || !Hash::File(fontPath, fontHash)) {
+
+        fprintf(stderr, "FontAtlas::Init: cannot read %s\n", fontPath.c_str());
+        return false;
+    }
+
+    // the font data stays in the mapping, the atlas only points at it
+    ImFontConfig config;
+    config.FontData = const_cast<char*>(fontFile.Data());
+    config.FontDataSize = static_cast<int>(fontFile.Size());
+    config.FontDataOwnedByAtlas = false;
+    config.SizePixels = sizePixels;
+    config.GlyphRanges = atlas->GetGlyphRangesDefault();
+
+    atlas->Flags |= ImFontAtlasFlags_NoMouseCursors;
+    atlas->TexDesiredWidth = TEXTURE_WIDTH;
+    font = atlas->AddFont(&config);
+
+    this->atlas = atlas;
+    this->lazyRanges = lazyRanges;
+    this->cachePath = cachePath;
+    cacheKey = CacheKey(fontHash, config, atlas, lazyRanges);
+    known.Resize(size_t(IM_UNICODE_CODEPOINT_MAX) + 1);
+
+    if (!ReadCache()) {
+
+        if (!atlas->Build()) {
+
+            fprintf(stderr, "FontAtlas::Init: cannot build %s\n", fontPath.c_str());
+            atlas->Clear();
+            this->atlas = nullptr;
+            font = nullptr;
+            return false;
+        }
+
+        // the atlas is kept as RGBA only, that is what the renderer uploads and what grows
+        unsigned char* pixels;
+        int width, height;
+        atlas->GetTexDataAsRGBA32(&pixels, &width, &height);
+        IM_FREE(atlas->TexPixelsAlpha8);
+        atlas->TexPixelsAlpha8 = nullptr;
+
+        cursorY = UsedHeight(atlas) + atlas->TexGlyphPadding;
+        isCacheDirty = true;
+    }
+
+    MarkBuiltGlyphs();
+    return true;
+}
+
+void FontAtlas::Request(const char* text, const char* textEnd) {
+
+    if (!atlas) return;
+
+    for (const char* s = text; textEnd ? s < textEnd : *s != '\0';) {
+
+        if (static_cast<unsigned char>(*s) < 0x80) {
+
+            ++s;
+            continue;
+        }
+
+        unsigned int c;
+        s += ImTextCharFromUtf8(&c, s, textEnd);
+        if (c > IM_UNICODE_CODEPOINT_MAX || known.Test(c) || !InLazyRanges(c)) continue;
+
+        known.Set(c);
+        pending.push_back(static_cast<ImWchar>(c));
+    }
+}
+
+void FontAtlas::Update() {
+
+    if (!atlas) return;
+
+    // typed characters, e.g. from an input method, are queued before NewFrame consumes them
+    for (ImWchar c : ImGui::GetIO().InputQueueCharacters) {
+
+        if (c < 0x80 || known.Test(c) || !InLazyRanges(c)) continue;
+        known.Set(c);
+        pending.push_back(c);
+    }
+
+    if (!pending.empty()) Rasterize();
+    if (isResized || dirtyBegin < dirtyEnd) Upload();
+}
+
+bool FontAtlas::Save() {
+
+    if (!atlas || !isCacheDirty) return true;
+
+    const int usedRows = std::min(atlas->TexHeight, cursorY + shelfHeight);
+    const size_t pixelCount = size_t(atlas->TexWidth) * usedRows;
+
+    FontCacheHeader header{};
+    std::memcpy(header.magic, FONT_CACHE_MAGIC, sizeof(header.magic));
+    header.version = FONT_CACHE_VERSION;
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.key = cacheKey;
+    header.texWidth = atlas->TexWidth;
+    header.texHeight = atlas->TexHeight;
+    header.cursorX = cursorX;
+    header.cursorY = cursorY;
+    header.shelfHeight = shelfHeight;
+    header.glyphCount = static_cast<uint32_t>(font->Glyphs.Size);
+    header.usesColors = atlas->TexPixelsUseColors;
+    header.ascent = font->Ascent;
+    header.descent = font->Descent;
+    header.whitePixel[0] = atlas->TexUvWhitePixel.x;
+    header.whitePixel[1] = atlas->TexUvWhitePixel.y;
+    std::memcpy(header.lines, atlas->TexUvLines, sizeof(header.lines));
+
+    std::vector<FontCacheGlyph> glyphs(font->Glyphs.Size);
+    for (int i = 0; i < font->Glyphs.Size; ++i) {
+
+        const ImFontGlyph& g = font->Glyphs[i];
+        glyphs[i] = { g.Codepoint, g.Colored, g.AdvanceX, g.X0, g.Y0, g.X1, g.Y1, g.U0, g.V0, g.U1, g.V1 };
+    }
+
+    // without colored glyphs the texture is white and only the alpha is stored
+    std::vector<unsigned char> alpha;
+    const void* pixels = atlas->TexPixelsRGBA32;
+    size_t pixelBytes = pixelCount * 4;
+    if (!atlas->TexPixelsUseColors) {
+
+        alpha.resize(pixelCount);
+        for (size_t i = 0; i < pixelCount; ++i) alpha[i] = static_cast<unsigned char>(atlas->TexPixelsRGBA32[i] >> IM_COL32_A_SHIFT);
+        pixels = alpha.data();
+        pixelBytes = pixelCount;
+    }
+
+    FILE* file = fopen(cachePath.c_str(), "wb");
+    if (file == nullptr) {
+
+        fprintf(stderr, "FontAtlas::Save: cannot open %s\n", cachePath.c_str());
+        return false;
+    }
+
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    ok = ok && fwrite(glyphs.data(), sizeof(FontCacheGlyph), glyphs.size(), file) == glyphs.size();
+    ok = ok && fwrite(pixels, 1, pixelBytes, file) == pixelBytes;
+    ok = fclose(file) == 0 && ok;
+    if (!ok) {
+
+        fprintf(stderr, "FontAtlas::Save: failed to write %s\n", cachePath.c_str());
+        std::remove(cachePath.c_str());
+        return false;
+    }
+
+    isCacheDirty = false;
+    return true;
+}
+
+bool FontAtlas::InLazyRanges(unsigned int c) const {
+
+    for (const ImWchar* r = lazyRanges; r && r[0]; r += 2)
+        if (c >= r[0] && c <= r[1]) return true;
+    return false;
+}
+
+void FontAtlas::Rasterize() {
+
+    ImVector<ImWchar> ranges;
+    for (ImWchar c : pending) {
+
+        ranges.push_back(c);
+        ranges.push_back(c);
+    }
+    ranges.push_back(0);
+
+    // same font, size and builder as the main atlas, limited to the queued glyphs
+    ImFontConfig config = atlas->ConfigData[0];
+    config.GlyphRanges = ranges.Data;
+    config.FontDataOwnedByAtlas = false;
+    config.MergeMode = false;
+    config.DstFont = nullptr;
+
+    ImFontAtlas scratch;
+    scratch.Flags = ImFontAtlasFlags_NoMouseCursors | ImFontAtlasFlags_NoBakedLines | ImFontAtlasFlags_NoPowerOfTwoHeight;
+    scratch.TexDesiredWidth = atlas->TexWidth;
+    scratch.TexGlyphPadding = atlas->TexGlyphPadding;
+    scratch.FontBuilderIO = atlas->FontBuilderIO;
+    scratch.FontBuilderFlags = atlas->FontBuilderFlags;
+    const ImFont* source = scratch.AddFont(&config);
+
+    unsigned char* scratchPixels = nullptr;
+    int scratchWidth = 0, scratchHeight = 0;
+    if (scratch.Build()) scratch.GetTexDataAsRGBA32(&scratchPixels, &scratchWidth, &scratchHeight);
+    std::sort(pending.begin(), pending.end());
+
+    // glyph boxes are relative to the rounded ascent of the font they were built for
+    const float offsetY = IM_ROUND(font->Ascent) - IM_ROUND(source->Ascent);
+    const int glyphCount = font->Glyphs.Size;
+    std::vector<ImWchar> unplaced;
+    for (const ImFontGlyph& g : source->Glyphs) {
+
+        const ImWchar c = static_cast<ImWchar>(g.Codepoint);
+        if (!scratchPixels || !std::binary_search(pending.begin(), pending.end(), c)) continue;
+
+        if (!g.Visible) {
+
+            font->AddGlyph(nullptr, c, g.X0, g.Y0 + offsetY, g.X1, g.Y1 + offsetY, 0.0f, 0.0f, 0.0f, 0.0f, g.AdvanceX);
+            continue;
+        }
+
+        const int sx = static_cast<int>(std::lround(g.U0 * scratchWidth));
+        const int sy = static_cast<int>(std::lround(g.V0 * scratchHeight));
+        const int w = static_cast<int>(std::lround((g.U1 - g.U0) * scratchWidth));
+        const int h = static_cast<int>(std::lround((g.V1 - g.V0) * scratchHeight));
+        int x, y;
+        if (!Place(w, h, x, y)) {
+
+            unplaced.push_back(c);
+            continue;
+        }
+
+        const unsigned int* src = reinterpret_cast<const unsigned int*>(scratchPixels);
+        for (int row = 0; row < h; ++row)
+            std::memcpy(atlas->TexPixelsRGBA32 + size_t(y + row) * atlas->TexWidth + x, src + size_t(sy + row) * scratchWidth + sx, size_t(w) * 4);
+
+        const ImVec2 scale = atlas->TexUvScale;
+        font->AddGlyph(nullptr, c, g.X0, g.Y0 + offsetY, g.X1, g.Y1 + offsetY,
+                       x * scale.x, y * scale.y, (x + w) * scale.x, (y + h) * scale.y, g.AdvanceX);
+        font->Glyphs.back().Colored = g.Colored;
+        if (g.Colored) atlas->TexPixelsUseColors = true;
+
+        dirtyBegin = dirtyBegin < dirtyEnd ? std::min(dirtyBegin, y) : y;
+        dirtyEnd = std::max(dirtyEnd, y + h);
+    }
+
+    // codepoints the font does not have stay marked as known and keep showing the fallback, glyphs that
+    // found no room in the atlas can be requested again
+    for (ImWchar c : unplaced) known.Reset(c);
+    pending.clear();
+    if (font->Glyphs.Size != glyphCount) {
+
+        // BuildLookupTable appends a tab glyph unless the last glyph is one, drop the old copy first
+        for (int i = 0; i < glyphCount; ++i) {
+
+            if (font->Glyphs[i].Codepoint == '\t') {
+
+                font->Glyphs.erase(font->Glyphs.Data + i);
+                break;
+            }
+        }
+        font->BuildLookupTable();
+        isCacheDirty = true;
+    }
+}
+
+bool FontAtlas::Place(int width, int height, int& x, int& y) {
+
+    const int padding = atlas->TexGlyphPadding;
+    if (cursorX + width > atlas->TexWidth) {
+
+        cursorY += shelfHeight;
+        cursorX = 0;
+        shelfHeight = 0;
+    }
+    if (width > atlas->TexWidth || (cursorY + height > atlas->TexHeight && !Grow(cursorY + height))) return false;
+
+    x = cursorX;
+    y = cursorY;
+    cursorX += width + padding;
+    shelfHeight = std::max(shelfHeight, height + padding);
+    return true;
+}
+
+bool FontAtlas::Grow(int minHeight) {
+
+    int height = atlas->TexHeight;
+    while (height < minHeight) height *= 2;
+    if (height > MAX_TEXTURE_HEIGHT) {
+
+        if (!isFull) fprintf(stderr, "FontAtlas::Grow: the atlas is full at %d rows\n", atlas->TexHeight);
+        isFull = true;
+        return false;
+    }
+
+    const size_t oldPixels = size_t(atlas->TexWidth) * atlas->TexHeight;
+    const size_t newPixels = size_t(atlas->TexWidth) * height;
+    unsigned int* pixels = static_cast<unsigned int*>(IM_ALLOC(newPixels * 4));
+    std::memcpy(pixels, atlas->TexPixelsRGBA32, oldPixels * 4);
+    std::memset(pixels + oldPixels, 0, (newPixels - oldPixels) * 4);
+    IM_FREE(atlas->TexPixelsRGBA32);
+    atlas->TexPixelsRGBA32 = pixels;
+
+    // pixel positions stay, normalized v coordinates shrink with the taller texture
+    const float scale = float(atlas->TexHeight) / float(height);
+    for (ImFont* f : atlas->Fonts) {
+
+        for (ImFontGlyph& g : f->Glyphs) {
+
+            g.V0 *= scale;
+            g.V1 *= scale;
+        }
+    }
+    atlas->TexUvWhitePixel.y *= scale;
+    for (ImVec4& uv : atlas->TexUvLines) {
+
+        uv.y *= scale;
+        uv.w *= scale;
+    }
+    atlas->TexHeight = height;
+    atlas->TexUvScale.y = 1.0f / height;
+
+    isResized = true;
+    return true;
+}
+
+void FontAtlas::Upload() {
+
+    // before the renderer created the texture there is nothing to update, it uploads everything
+    const GLuint texture = static_cast<GLuint>(reinterpret_cast<intptr_t>(atlas->TexID));
+    if (texture) {
+
+        GLint previous = 0;
+        glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+        if (isResized)
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, atlas->TexWidth, atlas->TexHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, atlas->TexPixelsRGBA32);
+        else
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, dirtyBegin, atlas->TexWidth, dirtyEnd - dirtyBegin, GL_RGBA, GL_UNSIGNED_BYTE,
+                            atlas->TexPixelsRGBA32 + size_t(dirtyBegin) * atlas->TexWidth);
+        glBindTexture(GL_TEXTURE_2D, static_cast<GLuint>(previous));
+    }
+
+    dirtyBegin = dirtyEnd = 0;
+    isResized = false;
+}
+
+bool FontAtlas::ReadCache() {
+
+    MappedFile file;
+    if (!file.Open(cachePath) || file.Size() < sizeof(FontCacheHeader)) return false;
+
+    FontCacheHeader header;
+    std::memcpy(&header, file.Data(), sizeof(header));
+
+    const bool compatible = std::memcmp(header.magic, FONT_CACHE_MAGIC, sizeof(header.magic)) == 0 &&
+        header.version == FONT_CACHE_VERSION && header.byteOrder == BYTE_ORDER_MARK && header.key == cacheKey;
+    if (!compatible) return false;
+
+    const bool validSize = header.texWidth == TEXTURE_WIDTH && header.texHeight > 0 && header.texHeight <= MAX_TEXTURE_HEIGHT &&
+        header.cursorX >= 0 && header.cursorY >= 0 && header.shelfHeight >= 0 && header.glyphCount < 0xFFFF;
+    if (!validSize) return false;
+
+    const int usedRows = std::min(header.texHeight, header.cursorY + header.shelfHeight);
+    const size_t pixelCount = size_t(header.texWidth) * usedRows;
+    const size_t glyphBytes = size_t(header.glyphCount) * sizeof(FontCacheGlyph);
+    const size_t pixelBytes = pixelCount * (header.usesColors ? 4 : 1);
+    if (file.Size() != sizeof(FontCacheHeader) + glyphBytes + pixelBytes) {
+
+        fprintf(stderr, "FontAtlas::ReadCache: %s is corrupt\n", cachePath.c_str());
+        return false;
+    }
+
+    std::vector<FontCacheGlyph> glyphs(header.glyphCount);
+    std::memcpy(glyphs.data(), file.Data() + sizeof(FontCacheHeader), glyphBytes);
+    for (const FontCacheGlyph& g : glyphs) {
+
+        if (g.codepoint > IM_UNICODE_CODEPOINT_MAX) {
+
+            fprintf(stderr, "FontAtlas::ReadCache: %s is corrupt\n", cachePath.c_str());
+            return false;
+        }
+    }
+
+    // what Build would have left behind, without rasterizing
+    ImFontAtlasBuildSetupFont(atlas, font, &atlas->ConfigData[0], header.ascent, header.descent);
+    for (const FontCacheGlyph& g : glyphs) {
+
+        font->AddGlyph(nullptr, static_cast<ImWchar>(g.codepoint), g.x0, g.y0, g.x1, g.y1, g.u0, g.v0, g.u1, g.v1, g.advanceX);
+        font->Glyphs.back().Colored = g.colored != 0;
+    }
+    font->BuildLookupTable();
+
+    const size_t texturePixels = size_t(header.texWidth) * header.texHeight;
+    unsigned int* pixels = static_cast<unsigned int*>(IM_ALLOC(texturePixels * 4));
+    const unsigned char* src = reinterpret_cast<const unsigned char*>(file.Data()) + sizeof(FontCacheHeader) + glyphBytes;
+    if (header.usesColors) std::memcpy(pixels, src, pixelCount * 4);
+    else
+        for (size_t i = 0; i < pixelCount; ++i) pixels[i] = IM_COL32(255, 255, 255, src[i]);
+    std::memset(pixels + pixelCount, 0, (texturePixels - pixelCount) * 4);
+
+    atlas->ClearTexData();
+    atlas->TexPixelsRGBA32 = pixels;
+    atlas->TexPixelsUseColors = header.usesColors != 0;
+    atlas->TexWidth = header.texWidth;
+    atlas->TexHeight = header.texHeight;
+    atlas->TexUvScale = ImVec2(1.0f / header.texWidth, 1.0f / header.texHeight);
+    atlas->TexUvWhitePixel = ImVec2(header.whitePixel[0], header.whitePixel[1]);
+    std::memcpy(atlas->TexUvLines, header.lines, sizeof(header.lines));
+    atlas->TexReady = true;
+
+    cursorX = header.cursorX;
+    cursorY = header.cursorY;
+    shelfHeight = header.shelfHeight;
+    return true;
+}
+
+void FontAtlas::MarkBuiltGlyphs() {
+
+    for (const ImFontGlyph& g : font->Glyphs) known.Set(g.Codepoint);
+}
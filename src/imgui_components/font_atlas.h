@@ -0,0 +1,91 @@
+#ifndef FONT_ATLAS_H
+#define FONT_ATLAS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <ImGui/imgui.h>
+
+#include "../utils/bitset.h"
+#include "../utils/mapped_file.h"
+
+// Font atlas that rasterizes glyphs on first use.
+// Only the default (Latin) ranges are built up front; glyphs from `lazyRanges` are added when text
+// containing them is passed to Request, so a CJK font costs nothing at startup. New glyphs are
+// rasterized between frames by the atlas' own font builder (FreeType) in a scratch atlas, packed into
+// free rows of io.Fonts, and only those rows are uploaded; the texture doubles in height when full.
+// Everything rasterized is kept in a cache keyed by the font file hash, size and ranges, so a warm
+// start rebuilds the atlas without rasterizing anything.
+class FontAtlas {
+
+    // constructor
+public:
+    FontAtlas() = default;
+
+    FontAtlas(const FontAtlas&) = delete;
+    FontAtlas& operator=(const FontAtlas&) = delete;
+
+    // main functions
+public:
+    // Fills `atlas`, which has to be empty, with the font at `fontPath`. `lazyRanges` has to outlive
+    // the atlas like any ImGui glyph range. False leaves the atlas untouched.
+    bool Init(ImFontAtlas* atlas, const std::string& fontPath, float sizePixels, const ImWchar* lazyRanges, const std::string& cachePath);
+
+    // queue the glyphs of `text` that are missing, they show as the fallback until the next Update
+    void Request(const char* text, const char* textEnd = nullptr);
+
+    // Call before ImGui::NewFrame: takes the typed characters, rasterizes what was requested and
+    // uploads the changed rows to the texture once the renderer has created it.
+    void Update();
+
+    // writes the cache when glyphs were added since it was read
+    bool Save();
+
+    bool IsReady() const { return atlas != nullptr; }
+    int GlyphCount() const { return font ? font->Glyphs.Size : 0; }
+
+    // sub functions
+private:
+    bool InLazyRanges(unsigned int c) const;
+    void Rasterize();
+    bool Place(int width, int height, int& x, int& y);
+    bool Grow(int minHeight);
+    void Upload();
+
+    bool ReadCache();
+    void MarkBuiltGlyphs();
+
+    // constants
+private:
+    static constexpr int TEXTURE_WIDTH = 1024;
+    static constexpr int MAX_TEXTURE_HEIGHT = 8192;
+
+    // variables
+private:
+    ImFontAtlas* atlas = nullptr;
+    ImFont* font = nullptr;
+    const ImWchar* lazyRanges = nullptr;
+
+    MappedFile fontFile;
+    std::string cachePath;
+    uint64_t cacheKey = 0;
+    bool isCacheDirty = false;
+
+    // codepoints that are built, queued, or known to be missing from the font
+    Bitset known;
+    std::vector<ImWchar> pending;
+
+    // shelf packing below the rows used so far
+    int cursorX = 0;
+    int cursorY = 0;
+    int shelfHeight = 0;
+
+    // rows changed since the last upload, or the whole texture after growing
+    int dirtyBegin = 0;
+    int dirtyEnd = 0;
+    bool isResized = false;
+    bool isFull = false;
+};
+
+#endif // !FONT_ATLAS_H
@@ -0,0 +1,116 @@
+#include "gpu_mesh.h"
+
+#include <algorithm>
+
+void GpuMesh::Begin(const float* positions, const float* normals, size_t vertexCount, const uint32_t* indices, size_t indexCount, GLenum mode) {
+
+    Release();
+
+    this->positions = positions;
+    this->normals = normals;
+    this->indices = indices;
+    this->vertexCount = vertexCount;
+    this->indexCount = indices ? indexCount : 0;
+    this->mode = mode;
+    if (vertexCount == 0) return;
+
+    const GLsizeiptr vertexBytes = static_cast<GLsizeiptr>(vertexCount * 3 * sizeof(float));
+    glGenBuffers(1, &positionBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, positionBuffer);
+    glBufferData(GL_ARRAY_BUFFER, vertexBytes, nullptr, GL_STATIC_DRAW);
+    if (normals) {
+
+        glGenBuffers(1, &normalBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, normalBuffer);
+        glBufferData(GL_ARRAY_BUFFER, vertexBytes, nullptr, GL_STATIC_DRAW);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    if (this->indexCount) {
+
+        glGenBuffers(1, &indexBuffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(this->indexCount * sizeof(uint32_t)), nullptr, GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    }
+}
+
+bool GpuMesh::Upload(size_t budget) {
+
+    struct Block { GLenum target; GLuint buffer; const void* data; size_t bytes; };
+    const size_t vertexBytes = vertexCount * 3 * sizeof(float);
+    const Block blocks[] = {
+        { GL_ARRAY_BUFFER, positionBuffer, positions, vertexBytes },
+        { GL_ARRAY_BUFFER, normalBuffer, normals, normals ? vertexBytes : 0 },
+        { GL_ELEMENT_ARRAY_BUFFER, indexBuffer, indices, indexCount * sizeof(uint32_t) }
+    };
+
+    // the blocks are laid end to end, `uploaded` is an offset into that sequence
+    size_t start = 0;
+    for (const Block& block : blocks) {
+
+        if (budget == 0) break;
+
+        const size_t end = start + block.bytes;
+        if (uploaded < end) {
+
+            const size_t offset = uploaded - start;
+            const size_t bytes = std::min(budget, block.bytes - offset);
+            glBindBuffer(block.target, block.buffer);
+            glBufferSubData(block.target, static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(bytes), static_cast<const char*>(block.data) + offset);
+            glBindBuffer(block.target, 0);
+            uploaded += bytes;
+            budget -= bytes;
+        }
+        start = end;
+    }
+    return IsComplete();
+}
+
+void GpuMesh::Release() {
+
+    if (positionBuffer) glDeleteBuffers(1, &positionBuffer);
+    if (normalBuffer) glDeleteBuffers(1, &normalBuffer);
+    if (indexBuffer) glDeleteBuffers(1, &indexBuffer);
+    positionBuffer = normalBuffer = indexBuffer = 0;
+    positions = normals = nullptr;
+    indices = nullptr;
+    vertexCount = indexCount = 0;
+    uploaded = 0;
+}
+
+void GpuMesh::Draw() const {
+
+    if (IsEmpty() || !IsComplete()) return;
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glBindBuffer(GL_ARRAY_BUFFER, positionBuffer);
+    glVertexPointer(3, GL_FLOAT, 0, nullptr);
+    if (normalBuffer) {
+
+        glEnableClientState(GL_NORMAL_ARRAY);
+        glBindBuffer(GL_ARRAY_BUFFER, normalBuffer);
+        glNormalPointer(GL_FLOAT, 0, nullptr);
+    }
+
+    if (indexBuffer) {
+
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+        glDrawElements(mode, static_cast<GLsizei>(indexCount), GL_UNSIGNED_INT, nullptr);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    }
+    else {
+
+        glDrawArrays(mode, 0, static_cast<GLsizei>(vertexCount));
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+}
+
+size_t GpuMesh::TotalBytes() const {
+
+    const size_t vertexBytes = vertexCount * 3 * sizeof(float);
+    return vertexBytes + (normals ? vertexBytes : 0) + indexCount * sizeof(uint32_t);
+}
@@ -0,0 +1,57 @@
+#ifndef GPU_MESH_H
+#define GPU_MESH_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include <glad/glad.h>
+
+// Vertex and index buffers filled a slice per frame, so a large mesh reaches the GPU without stalling
+// the render loop. Begin only allocates; Upload copies the next `budget` bytes and is called once per
+// frame until it returns true. The source arrays are not copied and have to live until then.
+class GpuMesh {
+
+    // constructor
+public:
+    GpuMesh() = default;
+    ~GpuMesh() { Release(); }
+
+    GpuMesh(const GpuMesh&) = delete;
+    GpuMesh& operator=(const GpuMesh&) = delete;
+
+    // main functions
+public:
+    // normals and indices may be null: points drawn without lighting, or arrays drawn in order
+    void Begin(const float* positions, const float* normals, size_t vertexCount, const uint32_t* indices, size_t indexCount, GLenum mode);
+    bool Upload(size_t budget);
+    void Release();
+
+    // nothing is drawn before the upload is complete
+    void Draw() const;
+
+    bool IsEmpty() const { return vertexCount == 0; }
+    bool IsComplete() const { return uploaded == TotalBytes(); }
+    float Progress() const { return TotalBytes() ? float(double(uploaded) / double(TotalBytes())) : 1.0f; }
+
+    // sub functions
+private:
+    size_t TotalBytes() const;
+
+    // variables
+private:
+    GLuint positionBuffer = 0;
+    GLuint normalBuffer = 0;
+    GLuint indexBuffer = 0;
+    GLenum mode = GL_TRIANGLES;
+
+    const float* positions = nullptr;
+    const float* normals = nullptr;
+    const uint32_t* indices = nullptr;
+    size_t vertexCount = 0;
+    size_t indexCount = 0;
+
+    // bytes copied so far, positions then normals then indices
+    size_t uploaded = 0;
+};
+
+#endif // !GPU_MESH_H
@@ -0,0 +1,574 @@
+#include "imgui_renderer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+namespace {
+
+    // attribute locations, bound before linking
+    constexpr GLuint ATTRIBUTE_POSITION = 0;
+    constexpr GLuint ATTRIBUTE_UV = 1;
+    constexpr GLuint ATTRIBUTE_COLOR = 2;
+
+    constexpr GLuint64 FENCE_TIMEOUT = 1000000000;  // ns per wait, repeated until the fence signals
+
+    const char* VERTEX_SHADER =
+        "uniform mat4 ProjMtx;\n"
+        "in vec2 Position;\n"
+        "in vec2 UV;\n"
+        "in vec4 Color;\n"
+        "out vec2 Frag_UV;\n"
+        "out vec4 Frag_Color;\n"
+        "void main() {\n"
+        "    Frag_UV = UV;\n"
+        "    Frag_Color = Color;\n"
+        "    gl_Position = ProjMtx * vec4(Position.xy, 0, 1);\n"
+        "}\n";
+
+    const char* FRAGMENT_SHADER =
+        "uniform sampler2D Texture;\n"
+        "in vec2 Frag_UV;\n"
+        "in vec4 Frag_Color;\n"
+        "out vec4 Out_Color;\n"
+        "void main() {\n"
+        "    Out_Color = Frag_Color * texture(Texture, Frag_UV.st);\n"
+        "}\n";
+
+    size_t AlignUp(size_t value, size_t alignment) { return (value + alignment - 1) / alignment * alignment; }
+
+    GLuint CompileShader(GLenum type, const char* glslVersion, const char* source) {
+
+        const std::string header = std::string(glslVersion) + "\n";
+        const char* sources[] = { header.c_str(), source };
+        GLuint shader = glCreateShader(type);
+        glShaderSource(shader, 2, sources, nullptr);
+        glCompileShader(shader);
+
+        GLint status = 0;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+        if (!status) {
+
+            char log[1024];
+            glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+            fprintf(stderr, "ImGuiRenderer: failed to compile the %s shader\n%s\n", type == GL_VERTEX_SHADER ? "vertex" : "fragment", log);
+            glDeleteShader(shader);
+            return 0;
+        }
+        return shader;
+    }
+
+    void SetCapability(GLenum capability, bool current, bool wanted) {
+
+        if (current == wanted) return;
+        if (wanted) glEnable(capability);
+        else glDisable(capability);
+    }
+}
+
+// the state RenderDrawData changes, read once per call
+struct ImGuiRenderer::GlState {
+
+    GLint program;
+    GLint texture;
+    GLint activeTexture;
+    GLint arrayBuffer;
+    GLint vertexArray;
+    GLint polygonMode[2];
+    GLint viewport[4];
+    GLint scissorBox[4];
+    GLint blendSrcRgb, blendDstRgb, blendSrcAlpha, blendDstAlpha;
+    GLint blendEquationRgb, blendEquationAlpha;
+    bool blend, cullFace, depthTest, stencilTest, scissorTest, primitiveRestart;
+};
+
+bool ImGuiRenderer::Init(const char* glslVersion) {
+
+    ImGuiIO& io = ImGui::GetIO();
+    IM_ASSERT(io.BackendRendererUserData == nullptr && "Already initialized a renderer backend!");
+
+    hasBaseVertex = GLAD_GL_VERSION_3_2 && glDrawElementsBaseVertex;
+    isPersistent = GLAD_GL_VERSION_4_4 && glBufferStorage;
+    if (!GLAD_GL_VERSION_3_0) {
+
+        fprintf(stderr, "ImGuiRenderer: OpenGL 3.0 is required\n");
+        return false;
+    }
+    if (!CreateDeviceObjects(glslVersion)) {
+
+        DestroyDeviceObjects();
+        return false;
+    }
+
+    io.BackendRendererUserData = this;
+    io.BackendRendererName = "imgui_renderer_gl3";
+    io.BackendFlags |= ImGuiBackendFlags_RendererHasVtxOffset | ImGuiBackendFlags_RendererHasViewports;
+
+    ImGuiPlatformIO& platformIO = ImGui::GetPlatformIO();
+    platformIO.Renderer_RenderWindow = RenderWindow;
+    platformIO.Renderer_DestroyWindow = DestroyWindow;
+    return true;
+}
+
+void ImGuiRenderer::Shutdown() {
+
+    ImGuiIO& io = ImGui::GetIO();
+    if (io.BackendRendererUserData != this) return;
+
+    // the main viewport's vertex array belongs to the current context, the others die with theirs
+    ImGuiViewport* mainViewport = ImGui::GetMainViewport();
+    if (mainViewport->RendererUserData) {
+
+        const GLuint vertexArray = static_cast<GLuint>(reinterpret_cast<intptr_t>(mainViewport->RendererUserData));
+        glDeleteVertexArrays(1, &vertexArray);
+        mainViewport->RendererUserData = nullptr;
+    }
+    ImGui::DestroyPlatformWindows();
+    DestroyDeviceObjects();
+
+    ImGuiPlatformIO& platformIO = ImGui::GetPlatformIO();
+    platformIO.Renderer_RenderWindow = nullptr;
+    platformIO.Renderer_DestroyWindow = nullptr;
+    io.BackendRendererName = nullptr;
+    io.BackendRendererUserData = nullptr;
+    io.BackendFlags &= ~(ImGuiBackendFlags_RendererHasVtxOffset | ImGuiBackendFlags_RendererHasViewports);
+}
+
+void ImGuiRenderer::NewFrame() {
+
+    lastStats = stats;
+    stats = {};
+    if (!fontTexture) CreateFontsTexture();
+
+    // the segment written this frame was last drawn from RING_SEGMENTS frames ago
+    if (!isPersistent) return;
+    segment = (segment + 1) % RING_SEGMENTS;
+    segmentUsed = 0;
+    for (GLsync fence : fences[segment]) {
+
+        while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT) == GL_TIMEOUT_EXPIRED) {}
+        glDeleteSync(fence);
+    }
+    fences[segment].clear();
+}
+
+void ImGuiRenderer::RenderDrawData(ImDrawData* drawData) {
+
+    const int width = static_cast<int>(drawData->DisplaySize.x * drawData->FramebufferScale.x);
+    const int height = static_cast<int>(drawData->DisplaySize.y * drawData->FramebufferScale.y);
+    if (width <= 0 || height <= 0 || drawData->CmdListsCount == 0) return;
+
+    const auto start = std::chrono::steady_clock::now();
+
+    GlState saved;
+    ReadState(saved);
+
+    // all lists back to back: vertices, then indices
+    const size_t vertexBytes = size_t(drawData->TotalVtxCount) * sizeof(ImDrawVert);
+    const size_t indexStart = AlignUp(vertexBytes, REGION_ALIGNMENT);
+    const size_t bytes = indexStart + size_t(drawData->TotalIdxCount) * sizeof(ImDrawIdx);
+
+    size_t offset = 0;
+    char* destination = BeginUpload(bytes, offset);
+    if (!destination) {
+
+        RestoreState(saved);
+        return;
+    }
+    size_t vertexCursor = 0, indexCursor = indexStart;
+    for (int n = 0; n < drawData->CmdListsCount; ++n) {
+
+        const ImDrawList* list = drawData->CmdLists[n];
+        const size_t listVertexBytes = size_t(list->VtxBuffer.Size) * sizeof(ImDrawVert);
+        const size_t listIndexBytes = size_t(list->IdxBuffer.Size) * sizeof(ImDrawIdx);
+        std::memcpy(destination + vertexCursor, list->VtxBuffer.Data, listVertexBytes);
+        std::memcpy(destination + indexCursor, list->IdxBuffer.Data, listIndexBytes);
+        vertexCursor += listVertexBytes;
+        indexCursor += listIndexBytes;
+    }
+    if (!EndUpload(bytes)) {
+
+        RestoreState(saved);
+        return;
+    }
+
+    const GLuint vertexArray = ViewportVertexArray(drawData->OwnerViewport ? drawData->OwnerViewport : ImGui::GetMainViewport());
+    SetupRenderState(&saved, drawData, width, height, vertexArray, offset);
+
+    // clip rectangles are in display space, the scissor box in framebuffer pixels from the bottom
+    const ImVec2 clipOffset = drawData->DisplayPos;
+    const ImVec2 clipScale = drawData->FramebufferScale;
+    const GLenum indexType = sizeof(ImDrawIdx) == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+
+    GLuint boundTexture = static_cast<GLuint>(saved.texture);
+    GLint scissor[4] = { saved.scissorBox[0], saved.scissorBox[1], saved.scissorBox[2], saved.scissorBox[3] };
+    size_t pointedVertex = 0;
+    size_t listVertex = 0, listIndex = 0;
+    for (int n = 0; n < drawData->CmdListsCount; ++n) {
+
+        const ImDrawList* list = drawData->CmdLists[n];
+        for (const ImDrawCmd& cmd : list->CmdBuffer) {
+
+            if (cmd.UserCallback != nullptr) {
+
+                // Only the texture, scissor box and attribute pointers are set again after a callback, other
+                // state it changes stays for the following draws as in the reference backend.
+                // ImDrawCallback_ResetRenderState points the attributes at the first vertex again.
+                if (cmd.UserCallback == ImDrawCallback_ResetRenderState) {
+
+                    SetupRenderState(nullptr, drawData, width, height, vertexArray, offset);
+                    pointedVertex = 0;
+                }
+                else {
+
+                    cmd.UserCallback(list, &cmd);
+                    pointedVertex = SIZE_MAX;
+                }
+                boundTexture = 0;
+                scissor[2] = -1;
+                continue;
+            }
+
+            const ImVec2 clipMin((cmd.ClipRect.x - clipOffset.x) * clipScale.x, (cmd.ClipRect.y - clipOffset.y) * clipScale.y);
+            const ImVec2 clipMax((cmd.ClipRect.z - clipOffset.x) * clipScale.x, (cmd.ClipRect.w - clipOffset.y) * clipScale.y);
+            if (clipMax.x <= clipMin.x || clipMax.y <= clipMin.y || cmd.ElemCount == 0) continue;
+
+            const GLint box[4] = { static_cast<GLint>(clipMin.x), static_cast<GLint>(height - clipMax.y),
+                                   static_cast<GLint>(clipMax.x - clipMin.x), static_cast<GLint>(clipMax.y - clipMin.y) };
+            if (std::memcmp(box, scissor, sizeof(box)) != 0) {
+
+                glScissor(box[0], box[1], box[2], box[3]);
+                std::memcpy(scissor, box, sizeof(box));
+                ++stats.scissorChanges;
+            }
+
+            const GLuint texture = static_cast<GLuint>(reinterpret_cast<intptr_t>(cmd.GetTexID()));
+            if (texture != boundTexture) {
+
+                glBindTexture(GL_TEXTURE_2D, texture);
+                boundTexture = texture;
+                ++stats.textureBinds;
+            }
+
+            const size_t baseVertex = listVertex + cmd.VtxOffset;
+            const void* indices = reinterpret_cast<const void*>(offset + indexStart + (listIndex + cmd.IdxOffset) * sizeof(ImDrawIdx));
+            if (hasBaseVertex) glDrawElementsBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(cmd.ElemCount), indexType, indices, static_cast<GLint>(baseVertex));
+            else {
+
+                // without base vertex draws the attributes are moved to the first vertex instead
+                if (baseVertex != pointedVertex) {
+
+                    PointAttributes(offset + baseVertex * sizeof(ImDrawVert));
+                    pointedVertex = baseVertex;
+                }
+                glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(cmd.ElemCount), indexType, indices);
+            }
+            ++stats.drawCalls;
+        }
+        listVertex += list->VtxBuffer.Size;
+        listIndex += list->IdxBuffer.Size;
+    }
+
+    if (isPersistent) fences[segment].push_back(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+
+    // texture and scissor box were tracked above, the rest is compared against what SetupRenderState set
+    if (boundTexture != static_cast<GLuint>(saved.texture)) glBindTexture(GL_TEXTURE_2D, saved.texture);
+    if (std::memcmp(scissor, saved.scissorBox, sizeof(scissor)) != 0) glScissor(saved.scissorBox[0], saved.scissorBox[1], saved.scissorBox[2], saved.scissorBox[3]);
+    RestoreState(saved);
+
+    stats.drawLists += drawData->CmdListsCount;
+    stats.uploadBytes += bytes;
+    stats.milliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool ImGuiRenderer::CreateDeviceObjects(const char* glslVersion) {
+
+    const GLuint vertexShader = CompileShader(GL_VERTEX_SHADER, glslVersion, VERTEX_SHADER);
+    const GLuint fragmentShader = CompileShader(GL_FRAGMENT_SHADER, glslVersion, FRAGMENT_SHADER);
+    if (!vertexShader || !fragmentShader) {
+
+        if (vertexShader) glDeleteShader(vertexShader);
+        if (fragmentShader) glDeleteShader(fragmentShader);
+        return false;
+    }
+
+    program = glCreateProgram();
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    glBindAttribLocation(program, ATTRIBUTE_POSITION, "Position");
+    glBindAttribLocation(program, ATTRIBUTE_UV, "UV");
+    glBindAttribLocation(program, ATTRIBUTE_COLOR, "Color");
+    glBindFragDataLocation(program, 0, "Out_Color");
+    glLinkProgram(program);
+    glDetachShader(program, vertexShader);
+    glDetachShader(program, fragmentShader);
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+
+    GLint status = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (!status) {
+
+        char log[1024];
+        glGetProgramInfoLog(program, sizeof(log), nullptr, log);
+        fprintf(stderr, "ImGuiRenderer: failed to link the shader program\n%s\n", log);
+        return false;
+    }
+
+    // the sampler never changes, it is set once here
+    GLint previousProgram = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+    uniformTexture = glGetUniformLocation(program, "Texture");
+    uniformProjection = glGetUniformLocation(program, "ProjMtx");
+    glUseProgram(program);
+    glUniform1i(uniformTexture, 0);
+    glUseProgram(previousProgram);
+
+    if (!isPersistent) glGenBuffers(1, &buffer);
+    return true;
+}
+
+void ImGuiRenderer::DestroyDeviceObjects() {
+
+    ReleaseRing();
+    if (buffer) glDeleteBuffers(1, &buffer);
+    if (program) glDeleteProgram(program);
+    if (fontTexture) {
+
+        glDeleteTextures(1, &fontTexture);
+        ImGui::GetIO().Fonts->SetTexID(0);
+    }
+    buffer = program = fontTexture = 0;
+    bufferSize = 0;
+}
+
+bool ImGuiRenderer::CreateFontsTexture() {
+
+    ImGuiIO& io = ImGui::GetIO();
+    unsigned char* pixels;
+    int width, height;
+    io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+
+    GLint previous = 0;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous);
+    glGenTextures(1, &fontTexture);
+    glBindTexture(GL_TEXTURE_2D, fontTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    glBindTexture(GL_TEXTURE_2D, previous);
+
+    io.Fonts->SetTexID(reinterpret_cast<ImTextureID>(static_cast<intptr_t>(fontTexture)));
+    return true;
+}
+
+char* ImGuiRenderer::BeginUpload(size_t bytes, size_t& offset) {
+
+    if (isPersistent) {
+
+        if (!ReserveRing(bytes)) return nullptr;
+        offset = size_t(segment) * segmentSize + segmentUsed;
+        return mapped + offset;
+    }
+
+    // orphaning gives fresh storage, so the map never waits for the previous frame
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    if (bytes > bufferSize) bufferSize = AlignUp(bytes + bytes / 2, REGION_ALIGNMENT);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(bufferSize), nullptr, GL_STREAM_DRAW);
+    offset = 0;
+    return static_cast<char*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, static_cast<GLsizeiptr>(bytes), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+}
+
+bool ImGuiRenderer::EndUpload(size_t bytes) {
+
+    if (isPersistent) {
+
+        segmentUsed += AlignUp(bytes, REGION_ALIGNMENT);
+        return true;
+    }
+    return glUnmapBuffer(GL_ARRAY_BUFFER) == GL_TRUE;
+}
+
+bool ImGuiRenderer::ReserveRing(size_t bytes) {
+
+    if (mapped && segmentUsed + bytes <= segmentSize) return true;
+
+    // a larger ring replaces the old one, whose storage the driver keeps until the GPU is done with it
+    const size_t newSegmentSize = AlignUp(std::max({ MIN_SEGMENT_SIZE, segmentSize * 2, (segmentUsed + bytes) * 2 }), REGION_ALIGNMENT);
+    ReleaseRing();
+
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    const GLsizeiptr size = static_cast<GLsizeiptr>(newSegmentSize * RING_SEGMENTS);
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    glBufferStorage(GL_ARRAY_BUFFER, size, nullptr, flags);
+    mapped = static_cast<char*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags));
+    if (!mapped) {
+
+        fprintf(stderr, "ImGuiRenderer: cannot map %lld bytes\n", static_cast<long long>(size));
+        ReleaseRing();
+        return false;
+    }
+
+    segmentSize = newSegmentSize;
+    segmentUsed = 0;
+    return true;
+}
+
+void ImGuiRenderer::ReleaseRing() {
+
+    for (std::vector<GLsync>& list : fences) {
+
+        for (GLsync fence : list) glDeleteSync(fence);
+        list.clear();
+    }
+    if (!isPersistent || !buffer) return;
+
+    if (mapped) {
+
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+    }
+    glDeleteBuffers(1, &buffer);
+    buffer = 0;
+    mapped = nullptr;
+    segmentSize = segmentUsed = 0;
+}
+
+void ImGuiRenderer::ReadState(GlState& state) {
+
+    glGetIntegerv(GL_CURRENT_PROGRAM, &state.program);
+
+    // the texture is drawn from and restored on unit 0, so that is the binding to keep
+    glGetIntegerv(GL_ACTIVE_TEXTURE, &state.activeTexture);
+    if (state.activeTexture != GL_TEXTURE0) glActiveTexture(GL_TEXTURE0);
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &state.texture);
+    glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &state.arrayBuffer);
+    glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &state.vertexArray);
+    glGetIntegerv(GL_POLYGON_MODE, state.polygonMode);
+    glGetIntegerv(GL_VIEWPORT, state.viewport);
+    glGetIntegerv(GL_SCISSOR_BOX, state.scissorBox);
+    glGetIntegerv(GL_BLEND_SRC_RGB, &state.blendSrcRgb);
+    glGetIntegerv(GL_BLEND_DST_RGB, &state.blendDstRgb);
+    glGetIntegerv(GL_BLEND_SRC_ALPHA, &state.blendSrcAlpha);
+    glGetIntegerv(GL_BLEND_DST_ALPHA, &state.blendDstAlpha);
+    glGetIntegerv(GL_BLEND_EQUATION_RGB, &state.blendEquationRgb);
+    glGetIntegerv(GL_BLEND_EQUATION_ALPHA, &state.blendEquationAlpha);
+    state.blend = glIsEnabled(GL_BLEND);
+    state.cullFace = glIsEnabled(GL_CULL_FACE);
+    state.depthTest = glIsEnabled(GL_DEPTH_TEST);
+    state.stencilTest = glIsEnabled(GL_STENCIL_TEST);
+    state.scissorTest = glIsEnabled(GL_SCISSOR_TEST);
+    state.primitiveRestart = GLAD_GL_VERSION_3_1 && glIsEnabled(GL_PRIMITIVE_RESTART);
+}
+
+void ImGuiRenderer::SetupRenderState(const GlState* current, ImDrawData* drawData, int width, int height, GLuint vertexArray, size_t vertexOffset) {
+
+    // with a known current state only the differences are sent
+    SetCapability(GL_BLEND, current && current->blend, true);
+    SetCapability(GL_CULL_FACE, !current || current->cullFace, false);
+    SetCapability(GL_DEPTH_TEST, !current || current->depthTest, false);
+    SetCapability(GL_STENCIL_TEST, !current || current->stencilTest, false);
+    SetCapability(GL_SCISSOR_TEST, current && current->scissorTest, true);
+    if (GLAD_GL_VERSION_3_1) SetCapability(GL_PRIMITIVE_RESTART, !current || current->primitiveRestart, false);
+
+    if (!current || current->blendEquationRgb != GL_FUNC_ADD || current->blendEquationAlpha != GL_FUNC_ADD) glBlendEquation(GL_FUNC_ADD);
+    if (!current || current->blendSrcRgb != GL_SRC_ALPHA || current->blendDstRgb != GL_ONE_MINUS_SRC_ALPHA ||
+        current->blendSrcAlpha != GL_ONE || current->blendDstAlpha != GL_ONE_MINUS_SRC_ALPHA)
+        glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    if (!current || current->polygonMode[0] != GL_FILL || current->polygonMode[1] != GL_FILL) glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    if (!current || current->viewport[0] != 0 || current->viewport[1] != 0 || current->viewport[2] != width || current->viewport[3] != height)
+        glViewport(0, 0, width, height);
+    if (!current) glActiveTexture(GL_TEXTURE0);  // ReadState already switched to unit 0
+
+    // orthographic projection of the display rectangle, top left at DisplayPos
+    const float l = drawData->DisplayPos.x;
+    const float r = drawData->DisplayPos.x + drawData->DisplaySize.x;
+    const float t = drawData->DisplayPos.y;
+    const float b = drawData->DisplayPos.y + drawData->DisplaySize.y;
+    const float projection[16] = {
+        2.0f / (r - l),    0.0f,              0.0f,  0.0f,
+        0.0f,              2.0f / (t - b),    0.0f,  0.0f,
+        0.0f,              0.0f,              -1.0f, 0.0f,
+        (r + l) / (l - r), (t + b) / (b - t), 0.0f,  1.0f,
+    };
+    glUseProgram(program);
+    glUniformMatrix4fv(uniformProjection, 1, GL_FALSE, projection);
+
+    glBindVertexArray(vertexArray);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer);
+    PointAttributes(vertexOffset);
+}
+
+void ImGuiRenderer::RestoreState(const GlState& saved) const {
+
+    if (static_cast<GLuint>(saved.program) != program) glUseProgram(saved.program);
+    if (saved.activeTexture != GL_TEXTURE0) glActiveTexture(saved.activeTexture);
+    glBindVertexArray(saved.vertexArray);
+    if (static_cast<GLuint>(saved.arrayBuffer) != buffer) glBindBuffer(GL_ARRAY_BUFFER, saved.arrayBuffer);
+
+    if (saved.blendEquationRgb != GL_FUNC_ADD || saved.blendEquationAlpha != GL_FUNC_ADD) glBlendEquationSeparate(saved.blendEquationRgb, saved.blendEquationAlpha);
+    if (saved.blendSrcRgb != GL_SRC_ALPHA || saved.blendDstRgb != GL_ONE_MINUS_SRC_ALPHA || saved.blendSrcAlpha != GL_ONE || saved.blendDstAlpha != GL_ONE_MINUS_SRC_ALPHA)
+        glBlendFuncSeparate(saved.blendSrcRgb, saved.blendDstRgb, saved.blendSrcAlpha, saved.blendDstAlpha);
+    SetCapability(GL_BLEND, true, saved.blend);
+    SetCapability(GL_CULL_FACE, false, saved.cullFace);
+    SetCapability(GL_DEPTH_TEST, false, saved.depthTest);
+    SetCapability(GL_STENCIL_TEST, false, saved.stencilTest);
+    SetCapability(GL_SCISSOR_TEST, true, saved.scissorTest);
+    if (GLAD_GL_VERSION_3_1) SetCapability(GL_PRIMITIVE_RESTART, false, saved.primitiveRestart);
+
+    if (saved.polygonMode[0] != GL_FILL || saved.polygonMode[1] != GL_FILL) {
+
+        if (saved.polygonMode[0] == saved.polygonMode[1]) glPolygonMode(GL_FRONT_AND_BACK, saved.polygonMode[0]);
+        else {
+
+            glPolygonMode(GL_FRONT, saved.polygonMode[0]);
+            glPolygonMode(GL_BACK, saved.polygonMode[1]);
+        }
+    }
+    glViewport(saved.viewport[0], saved.viewport[1], saved.viewport[2], saved.viewport[3]);
+}
+
+void ImGuiRenderer::PointAttributes(size_t vertexOffset) {
+
+    const GLsizei stride = sizeof(ImDrawVert);
+    glVertexAttribPointer(ATTRIBUTE_POSITION, 2, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<const void*>(vertexOffset + offsetof(ImDrawVert, pos)));
+    glVertexAttribPointer(ATTRIBUTE_UV, 2, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<const void*>(vertexOffset + offsetof(ImDrawVert, uv)));
+    glVertexAttribPointer(ATTRIBUTE_COLOR, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, reinterpret_cast<const void*>(vertexOffset + offsetof(ImDrawVert, col)));
+}
+
+GLuint ImGuiRenderer::ViewportVertexArray(ImGuiViewport* viewport) {
+
+    // vertex arrays are not shared between contexts, every viewport window gets its own
+    if (viewport->RendererUserData) return static_cast<GLuint>(reinterpret_cast<intptr_t>(viewport->RendererUserData));
+
+    GLuint vertexArray = 0;
+    glGenVertexArrays(1, &vertexArray);
+    glBindVertexArray(vertexArray);
+    glEnableVertexAttribArray(ATTRIBUTE_POSITION);
+    glEnableVertexAttribArray(ATTRIBUTE_UV);
+    glEnableVertexAttribArray(ATTRIBUTE_COLOR);
+    viewport->RendererUserData = reinterpret_cast<void*>(static_cast<intptr_t>(vertexArray));
+    return vertexArray;
+}
+
+void ImGuiRenderer::RenderWindow(ImGuiViewport* viewport, void*) {
+
+    if (!(viewport->Flags & ImGuiViewportFlags_NoRendererClear)) {
+
+        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+    }
+    static_cast<ImGuiRenderer*>(ImGui::GetIO().BackendRendererUserData)->RenderDrawData(viewport->DrawData);
+}
+
+void ImGuiRenderer::DestroyWindow(ImGuiViewport* viewport) {
+
+    // the window's context is destroyed next and takes the vertex array with it
+    viewport->RendererUserData = nullptr;
+}
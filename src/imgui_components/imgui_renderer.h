@@ -0,0 +1,98 @@
+#ifndef IMGUI_RENDERER_H
+#define IMGUI_RENDERER_H
+
+#include <cstddef>
+#include <vector>
+
+#include <glad/glad.h>
+#include <ImGui/imgui.h>
+
+// counters of the last frame, over every viewport
+struct ImGuiRendererStats {
+
+    int drawLists = 0;
+    int drawCalls = 0;
+    int textureBinds = 0;
+    int scissorChanges = 0;
+    size_t uploadBytes = 0;
+    double milliseconds = 0.0;          // CPU time spent in RenderDrawData
+};
+
+// OpenGL 3 renderer backend for ImGui, used in place of ImGui_ImplOpenGL3 with the same calls.
+// Each RenderDrawData writes the vertices and indices of all its draw lists into one buffer region
+// and draws with base-vertex offsets, so a frame costs one upload per viewport instead of two per
+// draw list. On GL 4.4 the region comes from a persistently mapped ring guarded by fences, otherwise
+// the buffer is orphaned and mapped once. Texture and scissor are only set when they change, and of
+// the state it touches only what differed is restored.
+class ImGuiRenderer {
+
+    // constructor
+public:
+    ImGuiRenderer() = default;
+
+    ImGuiRenderer(const ImGuiRenderer&) = delete;
+    ImGuiRenderer& operator=(const ImGuiRenderer&) = delete;
+
+    // main functions
+public:
+    bool Init(const char* glslVersion = "#version 130");
+    void Shutdown();
+    void NewFrame();
+    void RenderDrawData(ImDrawData* drawData);
+
+    const ImGuiRendererStats& Stats() const { return lastStats; }
+
+    // sub functions
+private:
+    bool CreateDeviceObjects(const char* glslVersion);
+    void DestroyDeviceObjects();
+    bool CreateFontsTexture();
+
+    // where this frame's vertices and indices go, nullptr when the buffer could not be mapped
+    char* BeginUpload(size_t bytes, size_t& offset);
+    bool EndUpload(size_t bytes);
+    bool ReserveRing(size_t bytes);
+    void ReleaseRing();
+
+    struct GlState;
+    static void ReadState(GlState& state);
+    void SetupRenderState(const GlState* current, ImDrawData* drawData, int width, int height, GLuint vertexArray, size_t vertexOffset);
+    void RestoreState(const GlState& saved) const;
+    void PointAttributes(size_t vertexOffset);
+    GLuint ViewportVertexArray(ImGuiViewport* viewport);
+
+    static void RenderWindow(ImGuiViewport* viewport, void*);
+    static void DestroyWindow(ImGuiViewport* viewport);
+
+    // constants
+private:
+    static constexpr int RING_SEGMENTS = 3;                         // frames in flight
+    static constexpr size_t MIN_SEGMENT_SIZE = size_t(1) << 20;
+    static constexpr size_t REGION_ALIGNMENT = 64;
+
+    // variables
+private:
+    GLuint program = 0;
+    GLint uniformTexture = -1;
+    GLint uniformProjection = -1;
+    GLuint fontTexture = 0;
+    GLuint buffer = 0;
+
+    bool hasBaseVertex = false;
+    bool isPersistent = false;
+
+    // persistent ring: one segment per frame in flight, each with the fences of the contexts that drew from it
+    char* mapped = nullptr;
+    size_t segmentSize = 0;
+    size_t segmentUsed = 0;
+    int segment = 0;
+    std::vector<GLsync> fences[RING_SEGMENTS];
+
+    // orphaned buffer size
+    size_t bufferSize = 0;
+
+    ImGuiRendererStats stats;
+    ImGuiRendererStats lastStats;
+};
+
+#endif // !IMGUI_RENDERER_H
@@ -1,11 +1,18 @@
 #include "main_window.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <cstdio>
+#include <cstring>
+#include <filesystem>
 
 #include <ImGui/imgui_impl_glfw.h>
 #include <ImGui/imgui_impl_opengl3.h>
 
 #include "imgui_components/imgui_opengl.h"
+#include "utils/file_hash.h"
+#include "utils/task_system.h"
 
 MainWindow::MainWindow(bool isMultiViewport) {
 
@@ -18,11 +25,25 @@ MainWindow::~MainWindow() {
     if (isReady) Destroy();
 }
 
+// first one present is the UI font, otherwise ImGui's built-in font (ASCII only) is used
+static const char* const UI_FONT_PATHS[] = {
+    "C:/Windows/Fonts/msjh.ttc",
+    "/usr/share/fonts/opentype/noto/NotoSansCJK-Regular.ttc",
+    "/usr/share/fonts/noto-cjk/NotoSansCJK-Regular.ttc",
+    "/System/Library/Fonts/PingFang.ttc"
+};
+
 static void glfw_error_callback(int error, const char* description) {
 
     fprintf(stderr, "GLFW Error %d: %s\n", error, description);
 }
 
+static void glfw_drop_callback(GLFWwindow* window, int count, const char** paths) {
+
+    MainWindow* mainWindow = static_cast<MainWindow*>(glfwGetWindowUserPointer(window));
+    if (mainWindow && count > 0) mainWindow->StartLoad(paths[0]);
+}
+
 bool MainWindow::Init(bool isMultiViewport) {
 
     // glfw initialization
@@ -83,6 +104,13 @@ bool MainWindow::Init(bool isMultiViewport) {
         // Setup Dear ImGui style
         ImGui::StyleColorsLight();
 
+        // Only Latin glyphs are built here, Chinese ones on first use
+        for (const char* path : UI_FONT_PATHS) {
+
+            std::error_code error;
+            if (std::filesystem::exists(path, error) && fonts.Init(io.Fonts, path, FONT_SIZE, io.Fonts->GetGlyphRangesChineseFull(), FONT_CACHE_PATH)) break;
+        }
+
         // Setup Platform/Renderer backends
         if (!ImGui_ImplGlfw_InitForOpenGL(window, true)) {
 
@@ -91,7 +119,12 @@ bool MainWindow::Init(bool isMultiViewport) {
             glfwTerminate();
             return false;
         }
-        if (!ImGui_ImplOpenGL3_Init("#version 410")) {
+        if (!renderer.Init("#version 410")) {
+
+            fprintf(stderr, "Failed to init ImGuiRenderer, using ImGui_ImplOpenGL3\n");
+            useReferenceRenderer = isReferenceRenderer = true;
+        }
+        if (isReferenceRenderer && !ImGui_ImplOpenGL3_Init("#version 410")) {
 
             fprintf(stderr, "Failed to ImGui_ImplOpenGL3_Init\n");
             glfwDestroyWindow(window);
@@ -100,6 +133,10 @@ bool MainWindow::Init(bool isMultiViewport) {
         }
     }
 
+    // files dropped on the window are loaded
+    glfwSetWindowUserPointer(window, this);
+    glfwSetDropCallback(window, glfw_drop_callback);
+
     return true;
 }
 
@@ -109,12 +146,18 @@ void MainWindow::Run() {
     while (!glfwWindowShouldClose(window)) {
 
         glfwPollEvents();
+        Tasks::RunMainThreadTasks();
+        UpdateLoad();
         HandleUserInput();
+        SwitchRenderer();
+        fonts.Update();
 
         // Start the Dear ImGui frame
-        ImGui_ImplOpenGL3_NewFrame();
+        if (isReferenceRenderer) ImGui_ImplOpenGL3_NewFrame();
+        else renderer.NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
+        panelCache.NewFrame();
 
         // ImGui components
         CreateImGuiComponents();
@@ -123,7 +166,13 @@ void MainWindow::Run() {
         glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
         glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+
+        const auto renderStart = std::chrono::steady_clock::now();
+        if (isReferenceRenderer) ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        else renderer.RenderDrawData(ImGui::GetDrawData());
+        renderTimes[renderTimeIndex] = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - renderStart).count();
+        renderTimeIndex = (renderTimeIndex + 1) % RENDER_TIME_FRAMES;
+
         if (ImGui::GetIO().ConfigFlags & ImGuiConfigFlags_ViewportsEnable) {
 
             GLFWwindow* backup_current_context = glfwGetCurrentContext();
@@ -139,7 +188,12 @@ void MainWindow::Run() {
 void MainWindow::Destroy() {
 
     // OnDestroy
-    ImGui_ImplOpenGL3_Shutdown();
+    loader.Cancel();
+    previewGpu.Release();
+    meshGpu.Release();
+    fonts.Save();
+    if (isReferenceRenderer) ImGui_ImplOpenGL3_Shutdown();
+    else renderer.Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
     glfwDestroyWindow(window);
@@ -199,13 +253,21 @@ void MainWindow::CreateMainView() {
                     glUseProgram(0);
                     glColor3f(0.3f, 0.8f, 1.0f);
                     glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-                    glBegin(GL_TRIANGLES);
-                    {
-                        glVertex2f(-1, 1);
-                        glVertex2f(1, 1);
-                        glVertex2f(1, -1);
+                    if (!previewGpu.IsEmpty() || !meshGpu.IsEmpty()) {
+
+                        const ImVec2 size = ImGui::GetContentRegionAvail();
+                        DrawLoadedMesh(size.y > 0.0f ? size.x / size.y : 1.0f);
+                    }
+                    else {
+
+                        glBegin(GL_TRIANGLES);
+                        {
+                            glVertex2f(-1, 1);
+                            glVertex2f(1, 1);
+                            glVertex2f(1, -1);
+                        }
+                        glEnd();
                     }
-                    glEnd();
 
                     ImGui::EndOpenGL();
                 }
@@ -223,7 +285,20 @@ void MainWindow::CreateControlPanel() {
 
         ImGui::SetWindowPos({ window_pos.x + main_width, window_pos.y + menubar_offsetY });
         ImGui::SetWindowSize({ SCR_WIDTH - main_width, main_height });
-        {
+
+        // Everything the panel shows, it is replayed from the draw list cache while none of it changes.
+        // The load time is keyed as printed (tenths while parsing), the raw clock changes every frame.
+        const bool parsing = loader.Stage() == MeshIO::LoadStage::Parsing;
+        const double shownSeconds = std::round(loader.Seconds() * (parsing ? 10.0 : 100.0));
+        const double shown[] = {
+            double(sliderInt), double(static_cast<int>(loader.Stage())), shownSeconds, meshGpu.Progress(), double(meshGpu.IsEmpty()),
+            loadedMesh ? double(loadedMesh->buffer.VertexCount()) : -1.0, loadedMesh ? double(loadedMesh->buffer.FaceCount()) : -1.0,
+        };
+        uint64_t inputHash = Hash::Bytes(shown, sizeof(shown));
+        inputHash = Hash::Bytes(loadPath, strlen(loadPath), inputHash);
+        inputHash = Hash::Bytes(loader.Path().data(), loader.Path().size(), inputHash);
+        if (panelCache.Begin("controls", inputHash)) {
+
             ImGui::NewLine();
             const char* text = "Controls";
             ImGui::SetCursorPosX((ImGui::GetWindowSize().x - ImGui::CalcTextSize(text).x) * 0.5f);
@@ -245,6 +320,56 @@ void MainWindow::CreateControlPanel() {
             ImGui::Text(text2);
             ImGui::PushItemWidth(-1);
             ImGui::SliderInt("sliderInt", &sliderInt, 1, 20);
+
+            ImGui::NewLine();
+            const char* text3 = "Mesh";
+            ImGui::SetCursorPosX((ImGui::GetWindowSize().x - ImGui::CalcTextSize(text3).x) * 0.5f);
+            ImGui::Text(text3);
+            ImGui::InputTextWithHint("##path", "file path or drop a file", loadPath, sizeof(loadPath));
+            ImGui::PopItemWidth();
+
+            const bool isLoading = loader.Stage() == MeshIO::LoadStage::Parsing || (!meshGpu.IsEmpty() && !meshGpu.IsComplete());
+            if (isLoading) {
+
+                if (ImGui::Button("Cancel", { ImGui::GetContentRegionAvail().x, 0 })) {
+
+                    loader.Cancel();
+                    previewGpu.Release();
+                    meshGpu.Release();
+                    previewPoints.clear();
+                    loadedMesh.reset();
+#ifdef HAS_OPENMESH_IO
+                    editMesh.reset();
+#endif
+                }
+
+                // parsing has no progress of its own, the upload fills the rest of the bar
+                const bool isParsing = loader.Stage() == MeshIO::LoadStage::Parsing;
+                const float progress = isParsing ? 0.0f : meshGpu.Progress();
+                char overlay[64];
+                snprintf(overlay, sizeof(overlay), isParsing ? "parsing %.1f s" : "uploading %.0f%%", isParsing ? loader.Seconds() : progress * 100.0f);
+                ImGui::ProgressBar(progress, { ImGui::GetContentRegionAvail().x, 0 }, overlay);
+            }
+            else {
+
+                if (ImGui::Button("Load", { ImGui::GetContentRegionAvail().x, 0 }) && loadPath[0]) StartLoad(loadPath);
+
+                switch (loader.Stage()) {
+
+                case MeshIO::LoadStage::Ready:
+                    if (loadedMesh) ImGui::TextWrapped("%zu vertices, %zu faces in %.2f s", loadedMesh->buffer.VertexCount(), loadedMesh->buffer.FaceCount(), loader.Seconds());
+                    break;
+                case MeshIO::LoadStage::Failed:
+                    ImGui::TextWrapped("could not read %s", loader.Path().c_str());
+                    break;
+                case MeshIO::LoadStage::Cancelled:
+                    ImGui::TextWrapped("cancelled");
+                    break;
+                default:
+                    break;
+                }
+            }
+            panelCache.End();
         }
         ImGui::End();
     }
@@ -254,8 +379,157 @@ void MainWindow::CreateSettingPage() {
 
     if (isSettingPageOpened && ImGui::Begin("Settings Page", &isSettingPageOpened, ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_AlwaysAutoResize)) {
 
-        ImGui::SliderFloat("sliderFloat", &sliderFloat, 0.001f, 0.01f, "%.3f");
+        const float shown[] = { sliderFloat, float(useReferenceRenderer) };
+        if (panelCache.Begin("settings", Hash::Bytes(shown, sizeof(shown)))) {
+
+            ImGui::SliderFloat("sliderFloat", &sliderFloat, 0.001f, 0.01f, "%.3f");
+
+            ImGui::SeparatorText("Renderer");
+            ImGui::Checkbox("ImGui_ImplOpenGL3", &useReferenceRenderer);
+            panelCache.End();
+        }
+        float average = 0.0f;
+        for (float time : renderTimes) average += time;
+        average /= RENDER_TIME_FRAMES;
+        ImGui::Text("main viewport: %.3f ms CPU", average);
+        ImGui::PlotLines("##render times", renderTimes, RENDER_TIME_FRAMES, renderTimeIndex, nullptr, 0.0f, average * 2.0f, ImVec2(0, 40));
+        if (!isReferenceRenderer) {
+
+            const ImGuiRendererStats& stats = renderer.Stats();
+            ImGui::Text("%d lists, %d draws, %d texture binds, %d scissors", stats.drawLists, stats.drawCalls, stats.textureBinds, stats.scissorChanges);
+            ImGui::Text("%.1f KB uploaded, %.3f ms in all viewports", stats.uploadBytes / 1024.0, stats.milliseconds);
+        }
+        const DrawListCacheStats& cacheStats = panelCache.Stats();
+        ImGui::Text("draw list cache: %d of %d regions replayed (%.0f%%), %d vertices", cacheStats.replayed, cacheStats.regions, cacheStats.SkipRatio() * 100.0f, cacheStats.replayedVertices);
 
         ImGui::End();
     }
 }
+
+void MainWindow::SwitchRenderer() {
+
+    if (useReferenceRenderer == isReferenceRenderer) return;
+
+    // between frames, so neither backend has anything in flight that the other would see
+    if (isReferenceRenderer) ImGui_ImplOpenGL3_Shutdown();
+    else renderer.Shutdown();
+    if (useReferenceRenderer || !renderer.Init("#version 410")) {
+
+        ImGui_ImplOpenGL3_Init("#version 410");
+        useReferenceRenderer = true;
+    }
+    isReferenceRenderer = useReferenceRenderer;
+}
+
+void MainWindow::StartLoad(const std::string& path) {
+
+    snprintf(loadPath, sizeof(loadPath), "%s", path.c_str());
+    fonts.Request(loadPath);
+    previewGpu.Release();
+    meshGpu.Release();
+    previewPoints.clear();
+    loadedMesh.reset();
+#ifdef HAS_OPENMESH_IO
+    editMesh.reset();
+
+    // a cancelled read may still be writing into the last mesh, so each load gets a new one
+    loadingMesh = std::make_shared<EditMesh>();
+    auto options = std::make_shared<OpenMesh::IO::Options>();
+    loader.Start(path, [mesh = loadingMesh, options](const std::string& file, MeshBuffer& buffer) {
+
+        return MeshIO::OpenMeshReader(*mesh, *options)(file, buffer);
+    });
+#else
+    loader.Start(path);
+#endif
+}
+
+void MainWindow::UpdateLoad() {
+
+    // the preview is small enough to go up in one piece, and it frames the view until the mesh is in
+    if (loader.HasPreview()) {
+
+        previewPoints = loader.TakePreview();
+
+        float lo[3] = { INFINITY, INFINITY, INFINITY }, hi[3] = { -INFINITY, -INFINITY, -INFINITY };
+        for (size_t i = 0; i < previewPoints.size(); ++i) {
+
+            lo[i % 3] = std::min(lo[i % 3], previewPoints[i]);
+            hi[i % 3] = std::max(hi[i % 3], previewPoints[i]);
+        }
+        for (int k = 0; k < 3; ++k) viewCenter[k] = (lo[k] + hi[k]) * 0.5f;
+        viewRadius = 0.5f * std::sqrt((hi[0] - lo[0]) * (hi[0] - lo[0]) + (hi[1] - lo[1]) * (hi[1] - lo[1]) + (hi[2] - lo[2]) * (hi[2] - lo[2]));
+
+        previewGpu.Begin(previewPoints.data(), nullptr, previewPoints.size() / 3, nullptr, 0, GL_POINTS);
+        previewGpu.Upload(previewPoints.size() * sizeof(float));
+    }
+
+    if (auto mesh = loader.TakeMesh()) {
+
+        loadedMesh = std::move(mesh);
+#ifdef HAS_OPENMESH_IO
+        editMesh = std::move(loadingMesh);
+#endif
+        const MeshIO::LoadedMesh& m = *loadedMesh;
+        const bool hasFaces = !m.triangles.empty();
+        meshGpu.Begin(m.buffer.positions.data(), hasFaces ? m.normals.data() : nullptr, m.buffer.VertexCount(),
+                      hasFaces ? m.triangles.data() : nullptr, m.triangles.size(), hasFaces ? GL_TRIANGLES : GL_POINTS);
+
+        float extent = 0.0f;
+        for (int k = 0; k < 3; ++k) {
+
+            viewCenter[k] = (m.boundsMin[k] + m.boundsMax[k]) * 0.5f;
+            extent += (m.boundsMax[k] - m.boundsMin[k]) * (m.boundsMax[k] - m.boundsMin[k]);
+        }
+        viewRadius = 0.5f * std::sqrt(extent);
+    }
+
+    // a slice per frame, the preview stays up until the last one
+    if (!meshGpu.IsEmpty() && !meshGpu.IsComplete() && meshGpu.Upload(UPLOAD_BUDGET)) {
+
+        previewGpu.Release();
+        previewPoints.clear();
+    }
+}
+
+void MainWindow::DrawLoadedMesh(float aspect) {
+
+    const float r = viewRadius > 0.0f ? viewRadius : 1.0f;
+
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    glOrtho(-r * aspect, r * aspect, -r, r, -4.0f * r, 4.0f * r);
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+
+    // head light, set before the view rotation
+    const GLfloat lightDirection[4] = { 0.0f, 0.0f, 1.0f, 0.0f };
+    glLightfv(GL_LIGHT0, GL_POSITION, lightDirection);
+    glRotatef(20.0f, 1.0f, 0.0f, 0.0f);
+    glRotatef(-30.0f, 0.0f, 1.0f, 0.0f);
+    glTranslatef(-viewCenter[0], -viewCenter[1], -viewCenter[2]);
+
+    if (meshGpu.IsComplete() && !meshGpu.IsEmpty()) {
+
+        glEnable(GL_LIGHTING);
+        glEnable(GL_LIGHT0);
+        glEnable(GL_COLOR_MATERIAL);
+        glLightModeli(GL_LIGHT_MODEL_TWO_SIDE, GL_TRUE);
+        meshGpu.Draw();
+        glDisable(GL_COLOR_MATERIAL);
+        glDisable(GL_LIGHT0);
+        glDisable(GL_LIGHTING);
+    }
+    else {
+
+        glPointSize(2.0f);
+        previewGpu.Draw();
+    }
+
+    glPopMatrix();
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+}
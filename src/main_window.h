@@ -6,6 +6,19 @@
 #include <GLFW/glfw3.h>
 
 #include <ImGui/imgui.h>
+#ifdef HAS_OPENMESH_IO
+#include <OpenMesh/Core/Mesh/PolyMesh_ArrayKernelT.hh>
+#endif
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "imgui_components/draw_list_cache.h"
+#include "imgui_components/font_atlas.h"
+#include "imgui_components/gpu_mesh.h"
+#include "imgui_components/imgui_renderer.h"
+#include "mesh_io/async_loader.h"
 
 class MainWindow {
 
@@ -14,6 +27,9 @@ public:
     MainWindow(bool isMultiViewport = true);
     ~MainWindow();
 
+    // files dropped on the window end up here too
+    void StartLoad(const std::string& path);
+
     // main functions
 private:
     GLFWwindow* window = nullptr;
@@ -32,11 +48,25 @@ private:
     void CreateControlPanel();
     void CreateSettingPage();
 
+    void SwitchRenderer();
+    void UpdateLoad();
+    void DrawLoadedMesh(float aspect);
+
     // constants
 private:
     const unsigned int SCR_WIDTH = 1000;
     const unsigned int SCR_HEIGHT = 800;
 
+    // bytes sent to the GPU per frame while a mesh is uploading
+    const size_t UPLOAD_BUDGET = size_t(16) << 20;
+
+    // UI font, CJK glyphs are rasterized when first shown and kept in the cache (next to imgui.ini)
+    const float FONT_SIZE = 16.0f;
+    const char* FONT_CACHE_PATH = "font_atlas.cache";
+
+    // frames averaged for the renderer timing in the settings page
+    static constexpr int RENDER_TIME_FRAMES = 120;
+
     const ImGuiWindowFlags flag = ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoBringToFrontOnFocus;
     const ImGuiWindowFlags topFlag = ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoTitleBar;
 
@@ -51,9 +81,37 @@ private:
     // variables
 private:
     bool isSettingPageOpened = false;
+    FontAtlas fonts;
+    DrawListCache panelCache;
+
+    // ImGui_ImplOpenGL3 can be switched in to compare the CPU time of the main viewport
+    ImGuiRenderer renderer;
+    bool useReferenceRenderer = false;
+    bool isReferenceRenderer = false;
+    float renderTimes[RENDER_TIME_FRAMES] = {};
+    int renderTimeIndex = 0;
 
     float sliderFloat = 0;
     int sliderInt = 0;
+
+    // variables for loading
+private:
+    char loadPath[512] = "";
+    MeshIO::AsyncMeshLoader loader;
+
+#ifdef HAS_OPENMESH_IO
+    // every load reads into a mesh of its own, the shown one moves to editMesh
+    using EditMesh = OpenMesh::PolyMesh_ArrayKernelT<>;
+    std::shared_ptr<EditMesh> loadingMesh;
+    std::shared_ptr<EditMesh> editMesh;
+#endif
+
+    std::vector<float> previewPoints;
+    std::shared_ptr<MeshIO::LoadedMesh> loadedMesh;
+    GpuMesh previewGpu;
+    GpuMesh meshGpu;
+    float viewCenter[3] = { 0.0f, 0.0f, 0.0f };
+    float viewRadius = 1.0f;
 };
 
 #endif // !MAIN_WINDOW_H
@@ -0,0 +1,148 @@
+#ifndef ADJACENCY_SNAPSHOT_H
+#define ADJACENCY_SNAPSHOT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <OpenMesh/Core/Mesh/Handles.hh>
+
+#include "topology_version.h"
+#include "../utils/parallel.h"
+
+namespace MeshTools {
+
+    // contiguous run of element indices
+    class IndexRange {
+
+    public:
+        IndexRange(const uint32_t* first, const uint32_t* last) : first(first), last(last) {}
+
+        const uint32_t* begin() const { return first; }
+        const uint32_t* end() const { return last; }
+        size_t size() const { return static_cast<size_t>(last - first); }
+        bool empty() const { return first == last; }
+        uint32_t operator[](size_t i) const { return first[i]; }
+
+    private:
+        const uint32_t* first;
+        const uint32_t* last;
+    };
+
+    // Immutable vertex-vertex, vertex-face and face-vertex adjacency in CSR arrays with 32-bit indices.
+    // Neighbours are stored in circulator order, so loops over a snapshot visit the same elements as
+    // vv_range/vf_range/fv_range but read consecutive memory. Deleted elements have empty ranges.
+    class AdjacencySnapshot {
+
+    public:
+        template <class Mesh>
+        void Build(const Mesh& mesh) {
+
+            const size_t vertexCount = mesh.n_vertices();
+            const size_t faceCount = mesh.n_faces();
+            auto vertex = [](size_t v) { return OpenMesh::VertexHandle(static_cast<int>(v)); };
+            auto face = [](size_t f) { return OpenMesh::FaceHandle(static_cast<int>(f)); };
+            auto deletedVertex = [&](size_t v) { return mesh.has_vertex_status() && mesh.status(vertex(v)).deleted(); };
+            auto deletedFace = [&](size_t f) { return mesh.has_face_status() && mesh.status(face(f)).deleted(); };
+
+            // sizes first, then offsets, then every range is filled by the worker owning its element
+            vertexVertexOffsets.assign(vertexCount + 1, 0);
+            vertexFaceOffsets.assign(vertexCount + 1, 0);
+            faceVertexOffsets.assign(faceCount + 1, 0);
+            vertexBoundary.assign(vertexCount, 0);
+
+            Parallel::For(0, vertexCount, [&](size_t begin, size_t end) {
+
+                for (size_t v = begin; v < end; ++v) {
+
+                    if (deletedVertex(v)) continue;
+
+                    uint32_t neighbours = 0, faces = 0;
+                    for (auto vh : mesh.vv_range(vertex(v))) { (void)vh; ++neighbours; }
+                    for (auto fh : mesh.vf_range(vertex(v))) { (void)fh; ++faces; }
+                    vertexVertexOffsets[v] = neighbours;
+                    vertexFaceOffsets[v] = faces;
+                    vertexBoundary[v] = mesh.is_boundary(vertex(v));
+                }
+            });
+            Parallel::For(0, faceCount, [&](size_t begin, size_t end) {
+
+                for (size_t f = begin; f < end; ++f)
+                    faceVertexOffsets[f] = deletedFace(f) ? 0 : mesh.valence(face(f));
+            });
+
+            vertexVertices.resize(Parallel::ExclusiveScan(vertexVertexOffsets));
+            vertexFaces.resize(Parallel::ExclusiveScan(vertexFaceOffsets));
+            faceVertices.resize(Parallel::ExclusiveScan(faceVertexOffsets));
+
+            Parallel::For(0, vertexCount, [&](size_t begin, size_t end) {
+
+                for (size_t v = begin; v < end; ++v) {
+
+                    if (deletedVertex(v)) continue;
+
+                    uint32_t* neighbour = vertexVertices.data() + vertexVertexOffsets[v];
+                    for (auto vh : mesh.vv_range(vertex(v))) *neighbour++ = static_cast<uint32_t>(vh.idx());
+                    uint32_t* incident = vertexFaces.data() + vertexFaceOffsets[v];
+                    for (auto fh : mesh.vf_range(vertex(v))) *incident++ = static_cast<uint32_t>(fh.idx());
+                }
+            });
+            Parallel::For(0, faceCount, [&](size_t begin, size_t end) {
+
+                for (size_t f = begin; f < end; ++f) {
+
+                    if (deletedFace(f)) continue;
+
+                    uint32_t* corner = faceVertices.data() + faceVertexOffsets[f];
+                    for (auto vh : mesh.fv_range(face(f))) *corner++ = static_cast<uint32_t>(vh.idx());
+                }
+            });
+
+            version = TopologyVersion(mesh);
+            edgeCount = mesh.n_edges();
+        }
+
+        // false once the mesh connectivity changed after Build
+        template <class Mesh>
+        bool IsCurrent(const Mesh& mesh) const {
+
+            return version == TopologyVersion(mesh) && VertexCount() == mesh.n_vertices() &&
+                   FaceCount() == mesh.n_faces() && edgeCount == mesh.n_edges();
+        }
+
+        size_t VertexCount() const { return vertexBoundary.size(); }
+        size_t FaceCount() const { return faceVertexOffsets.empty() ? 0 : faceVertexOffsets.size() - 1; }
+        uint64_t Version() const { return version; }
+
+        IndexRange VertexVertices(uint32_t v) const { return Range(vertexVertices, vertexVertexOffsets, v); }
+        IndexRange VertexFaces(uint32_t v) const { return Range(vertexFaces, vertexFaceOffsets, v); }
+        IndexRange FaceVertices(uint32_t f) const { return Range(faceVertices, faceVertexOffsets, f); }
+
+        uint32_t Valence(uint32_t v) const { return vertexVertexOffsets[v + 1] - vertexVertexOffsets[v]; }
+        bool IsBoundary(uint32_t v) const { return vertexBoundary[v] != 0; }
+
+        // raw arrays for kernels that want to index them directly
+        const std::vector<uint32_t>& VertexVertexOffsets() const { return vertexVertexOffsets; }
+        const std::vector<uint32_t>& VertexVertexIndices() const { return vertexVertices; }
+        const std::vector<uint32_t>& VertexFaceOffsets() const { return vertexFaceOffsets; }
+        const std::vector<uint32_t>& VertexFaceIndices() const { return vertexFaces; }
+        const std::vector<uint32_t>& FaceVertexOffsets() const { return faceVertexOffsets; }
+        const std::vector<uint32_t>& FaceVertexIndices() const { return faceVertices; }
+
+    private:
+        static IndexRange Range(const std::vector<uint32_t>& indices, const std::vector<uint32_t>& offsets, uint32_t i) {
+
+            return IndexRange(indices.data() + offsets[i], indices.data() + offsets[i + 1]);
+        }
+
+        std::vector<uint32_t> vertexVertexOffsets, vertexVertices;
+        std::vector<uint32_t> vertexFaceOffsets, vertexFaces;
+        std::vector<uint32_t> faceVertexOffsets, faceVertices;
+        std::vector<char> vertexBoundary;
+
+        uint64_t version = 0;
+        size_t edgeCount = 0;
+    };
+}
+
+#endif // !ADJACENCY_SNAPSHOT_H
@@ -0,0 +1,114 @@
+#ifndef BIT_TAGS_H
+#define BIT_TAGS_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <OpenMesh/Core/Mesh/Handles.hh>
+#include <OpenMesh/Core/Mesh/Status.hh>
+
+#include "../utils/bitset.h"
+#include "../utils/parallel.h"
+
+namespace MeshTools {
+
+    // Copy one status bit (OpenMesh::Attributes::SELECTED, FEATURE, DELETED, ...) of every element into a
+    // bitset. Workers own whole words, so no two of them touch the same word.
+    template <class Handle, class Mesh>
+    Bitset GatherStatus(const Mesh& mesh, unsigned int statusBit) {
+
+        const size_t count = mesh.template n_elements<Handle>();
+        Bitset bits(count);
+        if (!mesh.status_pph(Handle()).is_valid()) return bits;
+
+        const std::vector<OpenMesh::Attributes::StatusInfo>& status = mesh.property(mesh.status_pph(Handle())).data_vector();
+        uint64_t* words = bits.Words();
+        Parallel::For(0, bits.WordCount(), [&](size_t begin, size_t end) {
+
+            for (size_t w = begin; w < end; ++w) {
+
+                const size_t first = w * 64, last = std::min(count, first + 64);
+                uint64_t word = 0;
+                for (size_t i = first; i < last; ++i) word |= uint64_t((status[i].bits() & statusBit) != 0) << (i - first);
+                words[w] = word;
+            }
+        }, 1024);
+        return bits;
+    }
+
+    // write a bitset back into one status bit, the mesh must have status for this element type
+    template <class Handle, class Mesh>
+    void ScatterStatus(Mesh& mesh, const Bitset& bits, unsigned int statusBit) {
+
+        std::vector<OpenMesh::Attributes::StatusInfo>& status = mesh.property(mesh.status_pph(Handle())).data_vector();
+        Parallel::For(0, std::min(bits.Size(), status.size()), [&](size_t begin, size_t end) {
+
+            for (size_t i = begin; i < end; ++i) {
+
+                const unsigned int old = status[i].bits();
+                status[i].set_bits(bits.Test(i) ? old | statusBit : old & ~statusBit);
+            }
+        });
+    }
+
+    // number of elements with a status bit set, without building a bitset
+    template <class Handle, class Mesh>
+    size_t CountStatus(const Mesh& mesh, unsigned int statusBit) {
+
+        if (!mesh.status_pph(Handle()).is_valid()) return 0;
+
+        const std::vector<OpenMesh::Attributes::StatusInfo>& status = mesh.property(mesh.status_pph(Handle())).data_vector();
+        std::vector<size_t> counts(std::min<size_t>(Parallel::Concurrency(), status.size() / 65536 + 1), 0);
+        Parallel::ForChunks(status.size(), counts.size(), [&](size_t chunk, size_t begin, size_t end) {
+
+            size_t n = 0;
+            for (size_t i = begin; i < end; ++i) n += (status[i].bits() & statusBit) != 0;
+            counts[chunk] = n;
+        });
+
+        size_t total = 0;
+        for (size_t n : counts) total += n;
+        return total;
+    }
+
+    // Drop-in for SmartTaggerT with binary tags: same set_tag/is_tagged/untag_all interface. SmartTaggerT
+    // already untags in amortized O(1) by bumping its current tag; this one keeps one bit per element
+    // instead of an unsigned int property on the mesh, and can count or walk the tagged elements word by
+    // word, which SmartTaggerT can only do by testing every element.
+    template <class Mesh, class Handle>
+    class BitTagger {
+
+    public:
+        explicit BitTagger(const Mesh& mesh) : mesh(mesh), bits(mesh.template n_elements<Handle>()) {}
+
+        void untag_all() {
+
+            if (bits.Size() != mesh.template n_elements<Handle>()) bits = Bitset(mesh.template n_elements<Handle>());
+            else bits.ResetAll();
+        }
+
+        void set_tag(Handle h, bool tag = true) { bits.Assign(static_cast<size_t>(h.idx()), tag); }
+        bool is_tagged(Handle h) const { return bits.Test(static_cast<size_t>(h.idx())); }
+
+        size_t CountTagged() const { return bits.Count(); }
+
+        template <typename Func>
+        void ForEachTagged(Func&& func) const { bits.ForEach([&](size_t i) { func(Handle(static_cast<int>(i))); }); }
+
+        Bitset& Bits() { return bits; }
+        const Bitset& Bits() const { return bits; }
+
+    private:
+        const Mesh& mesh;
+        Bitset bits;
+    };
+
+    template <class Mesh> using BitTaggerV = BitTagger<Mesh, OpenMesh::VertexHandle>;
+    template <class Mesh> using BitTaggerE = BitTagger<Mesh, OpenMesh::EdgeHandle>;
+    template <class Mesh> using BitTaggerF = BitTagger<Mesh, OpenMesh::FaceHandle>;
+    template <class Mesh> using BitTaggerH = BitTagger<Mesh, OpenMesh::HalfedgeHandle>;
+}
+
+#endif // !BIT_TAGS_H
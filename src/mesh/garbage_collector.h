@@ -0,0 +1,343 @@
+#ifndef GARBAGE_COLLECTOR_H
+#define GARBAGE_COLLECTOR_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+#include <OpenMesh/Core/Mesh/Handles.hh>
+#include <OpenMesh/Core/Utils/BaseProperty.hh>
+
+#include "topology_version.h"
+#include "../utils/parallel.h"
+
+namespace MeshTools {
+
+    // Parallel replacement for ArrayKernel::garbage_collection. The new index of every element is a prefix
+    // sum over the deleted flags, so surviving elements keep their order (the serial version fills holes
+    // from the back). Connectivity is remapped in parallel passes and every property is compacted by its
+    // own worker. Step() does the work in time slices so a large collection can be spread over frames:
+    // every pass, the index maps and the connectivity gather included, walks its index range one slice at
+    // a time, so a call overruns its budget by at most one slice. The mesh must not be used until it
+    // returns true.
+    template <class Mesh>
+    class GarbageCollector {
+
+    public:
+        GarbageCollector(Mesh& mesh, bool vertices = true, bool edges = true, bool faces = true)
+            : mesh(mesh), collectVertices(vertices && mesh.has_vertex_status()),
+              collectEdges(edges && mesh.has_edge_status()), collectFaces(faces && mesh.has_face_status()) {}
+
+        // external handles to remap like the handle vectors of garbage_collection, set before the first Step
+        void TrackHandles(std::vector<OpenMesh::VertexHandle*>* vertexHandles,
+                          std::vector<OpenMesh::HalfedgeHandle*>* halfedgeHandles,
+                          std::vector<OpenMesh::FaceHandle*>* faceHandles) {
+
+            trackedVertices = vertexHandles;
+            trackedHalfedges = halfedgeHandles;
+            trackedFaces = faceHandles;
+        }
+
+        // work for about budgetMs milliseconds, returns true once the collection is complete
+        bool Step(double budgetMs) {
+
+            const auto start = std::chrono::steady_clock::now();
+            auto elapsed = [&]() { return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count(); };
+
+            while (phase != Phase::Done) {
+
+                switch (phase) {
+
+                case Phase::Count: if (CountKept()) phase = Phase::Map; break;
+                case Phase::Map: if (FillMap()) phase = ++kind < 3 ? Phase::Count : Phase::Halfedges; break;
+                case Phase::Halfedges: if (MapHalfedges()) phase = Phase::GatherVertices; break;
+                case Phase::GatherVertices: if (GatherVertices()) phase = Phase::GatherHalfedges; break;
+                case Phase::GatherHalfedges: if (GatherHalfedges()) phase = Phase::GatherFaces; break;
+                case Phase::GatherFaces: if (GatherFaces()) phase = Phase::Properties; break;
+                case Phase::Properties: if (CompactProperties()) phase = Phase::Finish; break;
+                case Phase::Finish: Finish(); phase = Phase::Done; break;
+                case Phase::Done: break;
+                }
+                if (phase != Phase::Done && elapsed() >= budgetMs) return false;
+            }
+            return true;
+        }
+
+        void Run() { Step(std::numeric_limits<double>::infinity()); }
+        bool Done() const { return phase == Phase::Done; }
+
+    private:
+        enum class Phase { Count, Map, Halfedges, GatherVertices, GatherHalfedges, GatherFaces, Properties, Finish, Done };
+
+        // elements per property or worker and slice, the unit of work between budget checks
+        static constexpr size_t SLICE = size_t(1) << 16;
+
+        struct PropertyJob {
+
+            OpenMesh::BaseProperty* property;
+            const std::vector<int>* map;
+            size_t cursor;
+        };
+
+        static int Remap(const std::vector<int>& map, int idx) { return idx < 0 ? idx : map[idx]; }
+
+        int RemapHalfedge(int h) const { return h < 0 || edgeMap[h / 2] < 0 ? -1 : edgeMap[h / 2] * 2 + (h & 1); }
+
+        // elements of the current pass, kind 0, 1 and 2 are vertices, edges and faces
+        size_t OldCount(int k) const { return k == 0 ? oldVertexCount : k == 1 ? oldEdgeCount : oldFaceCount; }
+        size_t& NewCount(int k) { return k == 0 ? newVertexCount : k == 1 ? newEdgeCount : newFaceCount; }
+        std::vector<int>& Map(int k) { return k == 0 ? vertexMap : k == 1 ? edgeMap : faceMap; }
+
+        bool Deleted(int k, size_t i) const {
+
+            const int idx = static_cast<int>(i);
+            if (k == 0) return collectVertices && mesh.status(OpenMesh::VertexHandle(idx)).deleted();
+            if (k == 1) return collectEdges && mesh.status(OpenMesh::EdgeHandle(idx)).deleted();
+            return collectFaces && mesh.status(OpenMesh::FaceHandle(idx)).deleted();
+        }
+
+        // run func over the next slice of [0, count), returns true and rewinds once all of it is done
+        template <typename Func>
+        bool Advance(size_t count, size_t slice, size_t grain, Func&& func) {
+
+            const size_t end = std::min(count, cursor + slice);
+            Parallel::For(cursor, end, func, grain);
+            cursor = end;
+            if (cursor < count) return false;
+
+            cursor = 0;
+            return true;
+        }
+
+        // Old index -> new index, -1 for deleted elements: count the kept elements of every block of SLICE,
+        // then number them from the block's prefix sum.
+        bool CountKept() {
+
+            if (cursor == 0) {
+
+                if (kind == 0) {
+
+                    oldVertexCount = mesh.n_vertices();
+                    oldEdgeCount = mesh.n_edges();
+                    oldFaceCount = mesh.n_faces();
+                }
+                kept.assign((OldCount(kind) + SLICE - 1) / SLICE, 0);
+            }
+
+            const size_t count = OldCount(kind);
+            return Advance(kept.size(), Parallel::Concurrency(), 1, [&](size_t begin, size_t end) {
+
+                for (size_t b = begin; b < end; ++b) {
+
+                    const size_t last = std::min(count, (b + 1) * SLICE);
+                    int n = 0;
+                    for (size_t i = b * SLICE; i < last; ++i) n += !Deleted(kind, i);
+                    kept[b] = n;
+                }
+            });
+        }
+
+        bool FillMap() {
+
+            std::vector<int>& map = Map(kind);
+            const size_t count = OldCount(kind);
+            if (cursor == 0) {
+
+                NewCount(kind) = Parallel::ExclusiveScan(kept);
+                map.resize(count);
+            }
+
+            return Advance(kept.size(), Parallel::Concurrency(), 1, [&](size_t begin, size_t end) {
+
+                for (size_t b = begin; b < end; ++b) {
+
+                    const size_t last = std::min(count, (b + 1) * SLICE);
+                    int next = kept[b];
+                    for (size_t i = b * SLICE; i < last; ++i) map[i] = Deleted(kind, i) ? -1 : next++;
+                }
+            });
+        }
+
+        bool MapHalfedges() {
+
+            if (cursor == 0) halfedgeMap.resize(oldEdgeCount * 2);
+            return Advance(halfedgeMap.size(), SLICE * Parallel::Concurrency(), 4096, [&](size_t begin, size_t end) {
+
+                for (size_t h = begin; h < end; ++h) halfedgeMap[h] = RemapHalfedge(static_cast<int>(h));
+            });
+        }
+
+        // remapped connectivity of the surviving elements, written back after the kernel is resized
+        bool GatherVertices() {
+
+            if (cursor == 0) vertexHalfedge.assign(newVertexCount, -1);
+            return Advance(oldVertexCount, SLICE * Parallel::Concurrency(), 4096, [&](size_t begin, size_t end) {
+
+                for (size_t v = begin; v < end; ++v) {
+
+                    if (vertexMap[v] >= 0)
+                        vertexHalfedge[vertexMap[v]] = RemapHalfedge(mesh.halfedge_handle(OpenMesh::VertexHandle(static_cast<int>(v))).idx());
+                }
+            });
+        }
+
+        bool GatherHalfedges() {
+
+            if (cursor == 0) {
+
+                halfedgeVertex.assign(newEdgeCount * 2, -1);
+                halfedgeFace.assign(newEdgeCount * 2, -1);
+                halfedgeNext.assign(newEdgeCount * 2, -1);
+            }
+            return Advance(oldEdgeCount * 2, SLICE * Parallel::Concurrency(), 4096, [&](size_t begin, size_t end) {
+
+                for (size_t h = begin; h < end; ++h) {
+
+                    const int target = halfedgeMap[h];
+                    if (target < 0) continue;
+
+                    const OpenMesh::HalfedgeHandle heh(static_cast<int>(h));
+                    halfedgeVertex[target] = Remap(vertexMap, mesh.to_vertex_handle(heh).idx());
+                    halfedgeFace[target] = Remap(faceMap, mesh.face_handle(heh).idx());
+                    halfedgeNext[target] = RemapHalfedge(mesh.next_halfedge_handle(heh).idx());
+                }
+            });
+        }
+
+        bool GatherFaces() {
+
+            if (cursor == 0) faceHalfedge.assign(newFaceCount, -1);
+            const bool done = Advance(oldFaceCount, SLICE * Parallel::Concurrency(), 4096, [&](size_t begin, size_t end) {
+
+                for (size_t f = begin; f < end; ++f) {
+
+                    if (faceMap[f] >= 0)
+                        faceHalfedge[faceMap[f]] = RemapHalfedge(mesh.halfedge_handle(OpenMesh::FaceHandle(static_cast<int>(f))).idx());
+                }
+            });
+            if (!done) return false;
+
+            auto add = [&](auto begin, auto end, const std::vector<int>& map) {
+
+                for (auto it = begin; it != end; ++it)
+                    if (*it) jobs.push_back({ *it, &map, 0 });
+            };
+            add(mesh.vprops_begin(), mesh.vprops_end(), vertexMap);
+            add(mesh.hprops_begin(), mesh.hprops_end(), halfedgeMap);
+            add(mesh.eprops_begin(), mesh.eprops_end(), edgeMap);
+            add(mesh.fprops_begin(), mesh.fprops_end(), faceMap);
+            return true;
+        }
+
+        // Move every property value to its new index, all properties advance one slice per call. New
+        // indices never exceed old ones, so compacting in place front to back is safe and resumable.
+        bool CompactProperties() {
+
+            Parallel::ForChunks(jobs.size(), Parallel::Concurrency(), [&](size_t, size_t begin, size_t end) {
+
+                for (size_t j = begin; j < end; ++j) {
+
+                    PropertyJob& job = jobs[j];
+                    const std::vector<int>& map = *job.map;
+                    const size_t last = std::min(map.size(), job.cursor + SLICE);
+                    for (size_t i = job.cursor; i < last; ++i) {
+
+                        if (map[i] >= 0 && static_cast<size_t>(map[i]) != i) job.property->copy(i, static_cast<size_t>(map[i]));
+                    }
+                    job.cursor = last;
+                }
+            });
+
+            return std::all_of(jobs.begin(), jobs.end(), [](const PropertyJob& job) { return job.cursor >= job.map->size(); });
+        }
+
+        void Finish() {
+
+            mesh.resize(newVertexCount, newEdgeCount, newFaceCount);
+
+            Parallel::For(0, newVertexCount, [&](size_t begin, size_t end) {
+
+                for (size_t v = begin; v < end; ++v)
+                    mesh.set_halfedge_handle(OpenMesh::VertexHandle(static_cast<int>(v)), OpenMesh::HalfedgeHandle(vertexHalfedge[v]));
+            });
+            Parallel::For(0, newEdgeCount * 2, [&](size_t begin, size_t end) {
+
+                for (size_t h = begin; h < end; ++h) {
+
+                    const OpenMesh::HalfedgeHandle heh(static_cast<int>(h));
+                    mesh.set_vertex_handle(heh, OpenMesh::VertexHandle(halfedgeVertex[h]));
+                    mesh.set_face_handle(heh, OpenMesh::FaceHandle(halfedgeFace[h]));
+                    mesh.set_next_halfedge_handle(heh, OpenMesh::HalfedgeHandle(halfedgeNext[h]));
+                }
+            });
+            Parallel::For(0, newFaceCount, [&](size_t begin, size_t end) {
+
+                for (size_t f = begin; f < end; ++f)
+                    mesh.set_halfedge_handle(OpenMesh::FaceHandle(static_cast<int>(f)), OpenMesh::HalfedgeHandle(faceHalfedge[f]));
+            });
+
+            if (trackedVertices) {
+
+                for (OpenMesh::VertexHandle* vh : *trackedVertices)
+                    *vh = OpenMesh::VertexHandle(vh->idx() < static_cast<int>(oldVertexCount) ? Remap(vertexMap, vh->idx()) : -1);
+            }
+            if (trackedHalfedges) {
+
+                for (OpenMesh::HalfedgeHandle* hh : *trackedHalfedges)
+                    *hh = OpenMesh::HalfedgeHandle(hh->idx() < static_cast<int>(oldEdgeCount * 2) ? RemapHalfedge(hh->idx()) : -1);
+            }
+            if (trackedFaces) {
+
+                for (OpenMesh::FaceHandle* fh : *trackedFaces)
+                    *fh = OpenMesh::FaceHandle(fh->idx() < static_cast<int>(oldFaceCount) ? Remap(faceMap, fh->idx()) : -1);
+            }
+
+            TouchTopology(mesh);
+
+            // release the scratch arrays
+            vertexMap = edgeMap = halfedgeMap = faceMap = std::vector<int>();
+            vertexHalfedge = halfedgeVertex = halfedgeFace = halfedgeNext = faceHalfedge = std::vector<int>();
+            kept = std::vector<int>();
+            jobs.clear();
+        }
+
+        Mesh& mesh;
+        const bool collectVertices, collectEdges, collectFaces;
+        Phase phase = Phase::Count;
+        int kind = 0;           // element kind of the Count and Map passes
+        size_t cursor = 0;      // progress of the current pass
+
+        std::vector<OpenMesh::VertexHandle*>* trackedVertices = nullptr;
+        std::vector<OpenMesh::HalfedgeHandle*>* trackedHalfedges = nullptr;
+        std::vector<OpenMesh::FaceHandle*>* trackedFaces = nullptr;
+
+        size_t oldVertexCount = 0, oldEdgeCount = 0, oldFaceCount = 0;
+        size_t newVertexCount = 0, newEdgeCount = 0, newFaceCount = 0;
+        std::vector<int> vertexMap, edgeMap, halfedgeMap, faceMap;
+        std::vector<int> kept;  // kept elements per block before the scan, first new index of the block after
+
+        std::vector<int> vertexHalfedge, halfedgeVertex, halfedgeFace, halfedgeNext, faceHalfedge;
+        std::vector<PropertyJob> jobs;
+    };
+
+    template <class Mesh>
+    void GarbageCollection(Mesh& mesh, bool vertices = true, bool edges = true, bool faces = true) {
+
+        GarbageCollector<Mesh>(mesh, vertices, edges, faces).Run();
+    }
+
+    template <class Mesh>
+    void GarbageCollection(Mesh& mesh, std::vector<OpenMesh::VertexHandle*>& vertexHandles,
+                           std::vector<OpenMesh::HalfedgeHandle*>& halfedgeHandles,
+                           std::vector<OpenMesh::FaceHandle*>& faceHandles,
+                           bool vertices = true, bool edges = true, bool faces = true) {
+
+        GarbageCollector<Mesh> collector(mesh, vertices, edges, faces);
+        collector.TrackHandles(&vertexHandles, &halfedgeHandles, &faceHandles);
+        collector.Run();
+    }
+}
+
+#endif // !GARBAGE_COLLECTOR_H
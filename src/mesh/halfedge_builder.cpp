@@ -0,0 +1,349 @@
+#include "halfedge_builder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <limits>
+
+#include "../utils/parallel.h"
+
+namespace {
+
+    constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+    constexpr int NOT_OWNER = -2;
+    constexpr char INVALID = 2;
+
+    // undirected edge key of a corner's halfedge, ties broken by corner so the first face owns the edge
+    struct EdgeRecord {
+
+        uint64_t key;
+        uint32_t corner;
+
+        bool operator<(const EdgeRecord& o) const { return key != o.key ? key < o.key : corner < o.corner; }
+    };
+
+    // Counting sort of items into per-vertex buckets, bucket(i) is the vertex of item i or NONE to skip it
+    // and emit(i) the value stored. Returns the bucket offsets, the order inside a bucket is arbitrary.
+    template <typename T, typename Bucket, typename Emit>
+    std::vector<uint32_t> BucketByVertex(size_t vertexCount, size_t itemCount, std::vector<T>& out, Bucket&& bucket, Emit&& emit) {
+
+        std::vector<std::atomic<uint32_t>> cursor(vertexCount + 1);
+        Parallel::For(0, itemCount, [&](size_t begin, size_t end) {
+
+            for (size_t i = begin; i < end; ++i) {
+
+                const uint32_t v = bucket(i);
+                if (v != NONE) cursor[v + 1].fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+
+        std::vector<uint32_t> offsets(vertexCount + 1, 0);
+        for (size_t v = 0; v < vertexCount; ++v) {
+
+            offsets[v + 1] = offsets[v] + cursor[v + 1].load(std::memory_order_relaxed);
+            cursor[v].store(offsets[v], std::memory_order_relaxed);
+        }
+
+        out.resize(offsets[vertexCount]);
+        Parallel::For(0, itemCount, [&](size_t begin, size_t end) {
+
+            for (size_t i = begin; i < end; ++i) {
+
+                const uint32_t v = bucket(i);
+                if (v != NONE) out[cursor[v].fetch_add(1, std::memory_order_relaxed)] = emit(i);
+            }
+        });
+        return offsets;
+    }
+
+    // collect per-chunk results without sharing writes between workers
+    template <typename T>
+    std::vector<T> Concat(std::vector<std::vector<T>>& parts) {
+
+        std::vector<T> all;
+        for (std::vector<T>& part : parts) all.insert(all.end(), part.begin(), part.end());
+        return all;
+    }
+}
+
+namespace MeshTools {
+
+    HalfedgeTopology BuildHalfedgeTopology(size_t vertexCount, const uint32_t* indices, const uint32_t* faceOffsets, size_t faceCount) {
+
+        HalfedgeTopology topology;
+        topology.vertexCount = vertexCount;
+
+        auto faceBegin = [&](size_t f) -> uint32_t { return faceOffsets ? faceOffsets[f] : static_cast<uint32_t>(f * 3); };
+        auto faceEnd = [&](size_t f) -> uint32_t { return faceOffsets ? faceOffsets[f + 1] : static_cast<uint32_t>(f * 3 + 3); };
+
+        const size_t cornerCount = faceCount ? faceEnd(faceCount - 1) : 0;
+        const size_t chunks = static_cast<size_t>(Parallel::Concurrency()) * 4;
+
+        // faces add_face would refuse right away: too small, invalid or repeated vertices
+        std::vector<uint32_t> cornerFace(cornerCount, NONE);
+        std::vector<char> rejected(faceCount, 0);
+        Parallel::For(0, faceCount, [&](size_t begin, size_t end) {
+
+            for (size_t f = begin; f < end; ++f) {
+
+                const uint32_t b = faceBegin(f), e = faceEnd(f);
+                bool valid = e >= b + 3;
+                for (uint32_t c = b; c < e && valid; ++c) {
+
+                    valid = indices[c] < vertexCount;
+                    for (uint32_t d = b; d < c && valid; ++d) valid = indices[d] != indices[c];
+                }
+                rejected[f] = valid ? 0 : INVALID;
+                for (uint32_t c = b; c < e; ++c) cornerFace[c] = static_cast<uint32_t>(f);
+            }
+        });
+
+        auto nextCorner = [&](uint32_t c) { const uint32_t f = cornerFace[c]; return c + 1 == faceEnd(f) ? faceBegin(f) : c + 1; };
+        auto kept = [&](uint32_t c) { return cornerFace[c] != NONE && !rejected[cornerFace[c]]; };
+
+        auto reject = [&](std::vector<std::vector<uint32_t>>& faces) {
+
+            std::vector<uint32_t> all = Concat(faces);
+            for (uint32_t f : all) rejected[f] = 1;
+            return !all.empty();
+        };
+
+        // rejecting faces can resolve or expose other conflicts, repeat until the remaining faces are consistent
+        for (;;) {
+
+            // edge records of all kept corners, bucketed by their lower vertex and sorted per bucket
+            std::vector<EdgeRecord> records;
+            const std::vector<uint32_t> recordBegin = BucketByVertex(vertexCount, cornerCount, records,
+                [&](size_t c) { return kept(static_cast<uint32_t>(c)) ? std::min(indices[c], indices[nextCorner(static_cast<uint32_t>(c))]) : NONE; },
+                [&](size_t c) {
+
+                    const uint32_t corner = static_cast<uint32_t>(c);
+                    const uint64_t a = indices[corner], b = indices[nextCorner(corner)];
+                    return EdgeRecord{ std::min(a, b) << 32 | std::max(a, b), corner };
+                });
+            Parallel::For(0, vertexCount, [&](size_t begin, size_t end) {
+
+                for (size_t v = begin; v < end; ++v) std::sort(records.begin() + recordBegin[v], records.begin() + recordBegin[v + 1]);
+            }, 1024);
+
+            // every run of equal keys is one edge: the first halfedge owns it, the first opposite one
+            // pairs with it, any further face on the edge is a complex edge like in add_face
+            std::vector<int> cornerPartner(cornerCount, NOT_OWNER);
+            std::vector<std::vector<uint32_t>> edgeRejects(chunks);
+            std::vector<size_t> complexEdges(chunks, 0);
+            Parallel::ForChunks(records.size(), chunks, [&](size_t chunk, size_t begin, size_t end) {
+
+                size_t s = begin;
+                while (s > 0 && s < records.size() && records[s].key == records[s - 1].key) ++s;
+
+                while (s < end) {
+
+                    size_t e = s + 1;
+                    while (e < records.size() && records[e].key == records[s].key) ++e;
+
+                    const uint32_t owner = records[s].corner;
+                    const uint32_t from = indices[owner], to = indices[nextCorner(owner)];
+                    int partner = -1;
+                    bool complex = false;
+                    for (size_t j = s + 1; j < e; ++j) {
+
+                        const uint32_t c = records[j].corner;
+                        if (partner == -1 && indices[c] == to && indices[nextCorner(c)] == from) {
+
+                            partner = static_cast<int>(c);
+                            continue;
+                        }
+                        edgeRejects[chunk].push_back(cornerFace[c]);
+                        complex = true;
+                    }
+                    cornerPartner[owner] = partner;
+                    complexEdges[chunk] += complex;
+                    s = e;
+                }
+            });
+            for (size_t n : complexEdges) topology.complexEdges += n;
+            if (reject(edgeRejects)) continue;
+
+            // number edges in order of their owner corner and faces in input order
+            std::vector<int> edgeId(chunks, 0);
+            Parallel::ForChunks(cornerCount, chunks, [&](size_t chunk, size_t begin, size_t end) {
+
+                int n = 0;
+                for (size_t c = begin; c < end; ++c) n += cornerPartner[c] != NOT_OWNER;
+                edgeId[chunk] = n;
+            });
+            const size_t edgeCount = Parallel::ExclusiveScan(edgeId);
+
+            std::vector<int> faceId(faceCount, -1);
+            size_t builtFaces = 0;
+            for (size_t f = 0; f < faceCount; ++f)
+                if (!rejected[f]) faceId[f] = static_cast<int>(builtFaces++);
+
+            const size_t halfedgeCount = edgeCount * 2;
+            topology.halfedgeVertex.assign(halfedgeCount, -1);
+            topology.halfedgeFace.assign(halfedgeCount, -1);
+            topology.halfedgeNext.assign(halfedgeCount, -1);
+            topology.halfedgePrev.assign(halfedgeCount, -1);
+            topology.cornerHalfedge.assign(cornerCount, -1);
+            topology.faceHalfedge.assign(builtFaces, -1);
+
+            Parallel::ForChunks(cornerCount, chunks, [&](size_t chunk, size_t begin, size_t end) {
+
+                int e = edgeId[chunk];
+                for (size_t c = begin; c < end; ++c) {
+
+                    const int partner = cornerPartner[c];
+                    if (partner == NOT_OWNER) continue;
+
+                    const uint32_t owner = static_cast<uint32_t>(c);
+                    const int h = 2 * e++;
+                    topology.halfedgeVertex[h] = static_cast<int>(indices[nextCorner(owner)]);
+                    topology.halfedgeFace[h] = faceId[cornerFace[owner]];
+                    topology.halfedgeVertex[h + 1] = static_cast<int>(indices[owner]);
+                    topology.cornerHalfedge[owner] = h;
+                    if (partner >= 0) {
+
+                        topology.halfedgeFace[h + 1] = faceId[cornerFace[partner]];
+                        topology.cornerHalfedge[partner] = h + 1;
+                    }
+                }
+            });
+
+            // face cycles
+            Parallel::For(0, cornerCount, [&](size_t begin, size_t end) {
+
+                for (size_t c = begin; c < end; ++c) {
+
+                    const uint32_t corner = static_cast<uint32_t>(c);
+                    if (!kept(corner)) continue;
+
+                    const int h = topology.cornerHalfedge[corner];
+                    const int next = topology.cornerHalfedge[nextCorner(corner)];
+                    topology.halfedgeNext[h] = next;
+                    topology.halfedgePrev[next] = h;
+                    if (corner == faceBegin(cornerFace[corner])) topology.faceHalfedge[faceId[cornerFace[corner]]] = h;
+                }
+            });
+
+            // outgoing halfedges around every vertex
+            std::vector<int> vertexOut;
+            const std::vector<uint32_t> vertexBegin = BucketByVertex(vertexCount, cornerCount, vertexOut,
+                [&](size_t c) { return kept(static_cast<uint32_t>(c)) ? indices[c] : NONE; },
+                [&](size_t c) { return topology.cornerHalfedge[c]; });
+
+            // Walk the fans of every vertex. Open fans are bounded by boundary halfedges, whose next
+            // pointers are found by rotating from the incoming boundary halfedge to the outgoing one.
+            // A closed fan cannot share its vertex with any other fan: like add_face, the fan holding
+            // the first face wins and the faces of the others are rejected.
+            topology.vertexHalfedge.assign(vertexCount, -1);
+            std::vector<std::vector<uint32_t>> vertexRejects(chunks);
+            std::vector<size_t> complexVertices(chunks, 0);
+            Parallel::ForChunks(vertexCount, chunks, [&](size_t chunk, size_t begin, size_t end) {
+
+                std::vector<int> out, visited, closed;
+                std::vector<std::vector<int>> closedFans;
+                for (size_t v = begin; v < end; ++v) {
+
+                    out.assign(vertexOut.begin() + vertexBegin[v], vertexOut.begin() + vertexBegin[v + 1]);
+                    if (out.empty()) continue;
+                    std::sort(out.begin(), out.end());
+
+                    visited.clear();
+                    int boundaryOut = -1;
+                    int openFace = std::numeric_limits<int>::max();
+                    for (int h : out) {
+
+                        // incoming boundary halfedge: the opposite of an outgoing halfedge without a face on the other side
+                        const int incoming = h ^ 1;
+                        if (topology.halfedgeFace[incoming] != -1) continue;
+
+                        int g = h;
+                        for (;;) {
+
+                            visited.push_back(g);
+                            openFace = std::min(openFace, topology.halfedgeFace[g]);
+                            const int next = topology.halfedgePrev[g] ^ 1;
+                            if (topology.halfedgeFace[next] == -1) {
+
+                                topology.halfedgeNext[incoming] = next;
+                                topology.halfedgePrev[next] = incoming;
+                                if (boundaryOut == -1 || next < boundaryOut) boundaryOut = next;
+                                break;
+                            }
+                            g = next;
+                        }
+                    }
+                    topology.vertexHalfedge[v] = boundaryOut != -1 ? boundaryOut : out.front();
+                    if (visited.size() == out.size()) continue;
+
+                    // split the remaining halfedges into closed fans
+                    std::sort(visited.begin(), visited.end());
+                    closed.clear();
+                    std::set_difference(out.begin(), out.end(), visited.begin(), visited.end(), std::back_inserter(closed));
+
+                    closedFans.clear();
+                    std::vector<char> done(closed.size(), 0);
+                    int keep = -1, keepFace = openFace;
+                    for (size_t i = 0; i < closed.size(); ++i) {
+
+                        if (done[i]) continue;
+
+                        std::vector<int> fan;
+                        int g = closed[i];
+                        do {
+
+                            done[std::lower_bound(closed.begin(), closed.end(), g) - closed.begin()] = 1;
+                            fan.push_back(g);
+                            g = topology.halfedgePrev[g] ^ 1;
+                        } while (g != closed[i]);
+
+                        int fanFace = std::numeric_limits<int>::max();
+                        for (int h : fan) fanFace = std::min(fanFace, topology.halfedgeFace[h]);
+                        if (fanFace < keepFace) {
+
+                            keep = static_cast<int>(closedFans.size());
+                            keepFace = fanFace;
+                        }
+                        closedFans.push_back(std::move(fan));
+                    }
+
+                    if (visited.empty() && closedFans.size() == 1) continue;
+
+                    for (size_t i = 0; i < closedFans.size(); ++i) {
+
+                        if (static_cast<int>(i) == keep) continue;
+                        for (int h : closedFans[i]) vertexRejects[chunk].push_back(static_cast<uint32_t>(topology.halfedgeFace[h]));
+                    }
+                    if (keep != -1) {
+
+                        for (int h : visited) vertexRejects[chunk].push_back(static_cast<uint32_t>(topology.halfedgeFace[h]));
+                    }
+                    ++complexVertices[chunk];
+                }
+            });
+
+            if (!Concat(vertexRejects).empty()) {
+
+                // rejections are reported in input face numbering
+                std::vector<uint32_t> faceOf(builtFaces);
+                for (size_t f = 0; f < faceCount; ++f)
+                    if (faceId[f] >= 0) faceOf[faceId[f]] = static_cast<uint32_t>(f);
+                for (std::vector<uint32_t>& part : vertexRejects)
+                    for (uint32_t& f : part) f = faceOf[f];
+
+                for (size_t n : complexVertices) topology.complexVertices += n;
+                reject(vertexRejects);
+                continue;
+            }
+
+            topology.faceSource.resize(builtFaces);
+            for (size_t f = 0; f < faceCount; ++f) {
+
+                if (rejected[f] == INVALID) topology.invalidFaces.push_back(static_cast<uint32_t>(f));
+                else if (rejected[f]) topology.rejectedFaces.push_back(static_cast<uint32_t>(f));
+                else topology.faceSource[faceId[f]] = static_cast<uint32_t>(f);
+            }
+            return topology;
+        }
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef HALFEDGE_BUILDER_H
+#define HALFEDGE_BUILDER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace MeshTools {
+
+    // Halfedge connectivity in ArrayKernel layout: halfedges 2e and 2e+1 form edge e, -1 is an invalid handle.
+    struct HalfedgeTopology {
+
+        size_t vertexCount = 0;
+
+        std::vector<int> halfedgeVertex;    // to-vertex
+        std::vector<int> halfedgeFace;      // -1 on the boundary
+        std::vector<int> halfedgeNext;
+        std::vector<int> halfedgePrev;
+        std::vector<int> vertexHalfedge;    // outgoing, a boundary one for boundary vertices, -1 if isolated
+        std::vector<int> faceHalfedge;
+
+        std::vector<uint32_t> faceSource;   // input face of every built face
+        std::vector<int> cornerHalfedge;    // halfedge leaving the vertex of every input corner, -1 for rejected faces
+
+        // faces left out, in input order
+        std::vector<uint32_t> invalidFaces;     // fewer than three, out of range or repeated vertices
+        std::vector<uint32_t> rejectedFaces;    // would make an edge or vertex non-manifold
+        size_t complexEdges = 0;            // edges shared by more than two faces or with inconsistent orientation
+        size_t complexVertices = 0;         // vertices whose faces do not form a single fan
+
+        size_t EdgeCount() const { return halfedgeVertex.size() / 2; }
+        size_t FaceCount() const { return faceHalfedge.size(); }
+    };
+
+    // Build halfedge connectivity for a polygon soup in one pass instead of face-by-face add_face calls.
+    // Halfedges are matched by sorting undirected edge keys in parallel; edges and faces are numbered in
+    // the order add_face would create them. Faces that would make an edge or vertex non-manifold are
+    // rejected and reported, the rest is built. faceOffsets may be null when all faces are triangles.
+    HalfedgeTopology BuildHalfedgeTopology(size_t vertexCount, const uint32_t* indices, const uint32_t* faceOffsets, size_t faceCount);
+}
+
+#endif // !HALFEDGE_BUILDER_H
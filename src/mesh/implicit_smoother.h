@@ -0,0 +1,309 @@
+#ifndef IMPLICIT_SMOOTHER_H
+#define IMPLICIT_SMOOTHER_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <utility>
+#include <vector>
+
+#include <Eigen/SparseCholesky>
+#include <Eigen/SparseCore>
+
+#include <OpenMesh/Core/Mesh/Handles.hh>
+
+#include "topology_version.h"
+#include "../utils/parallel.h"
+
+namespace MeshTools {
+
+    enum class FairingOperator {
+
+        Laplacian,      // membrane, one implicit step of (I - step L)
+        BiLaplacian     // thin plate, one implicit step of (I + step L^2)
+    };
+
+    enum class LaplaceWeighting {
+
+        Uniform,        // LaplaceSmootherT UniformWeighting
+        Cotangent       // LaplaceSmootherT CotWeighting, uniform on meshes that are not TriMeshes
+    };
+
+    struct ImplicitSmoothOptions {
+
+        FairingOperator fairing = FairingOperator::Laplacian;
+        LaplaceWeighting weighting = LaplaceWeighting::Cotangent;
+        double step = 1.0;      // time step, a JacobiLaplaceSmootherT iteration is an explicit step of 0.5
+    };
+
+    // Implicit fairing instead of explicit Jacobi sweeps: one step solves (M - step C) x' = M x, or
+    // (M + step C M^-1 C) x' = M x for the bi-Laplacian, where C holds the edge weights of
+    // LaplaceSmootherT and M their sums, so a large step smooths as far as many Jacobi iterations in a
+    // single solve. Vertices SmootherT keeps fixed (boundary, locked, unselected when there is a
+    // selection) are boundary conditions. The matrix is assembled in parallel and factored once with
+    // SimplicialLDLT; further Smooth calls on the same connectivity reuse the factor, only Build
+    // refreshes the weights from the current points. Normals are not touched, UpdateNormals
+    // refreshes them.
+    class ImplicitSmoother {
+
+        // main functions
+    public:
+        template <class Mesh>
+        bool Build(const Mesh& mesh, const ImplicitSmoothOptions& options = {});
+
+        // false once the mesh connectivity changed after Build
+        template <class Mesh>
+        bool IsCurrent(const Mesh& mesh) const {
+
+            return factored && version == TopologyVersion(mesh) && vertexCount == mesh.n_vertices() &&
+                   faceCount == mesh.n_faces() && edgeCount == mesh.n_edges();
+        }
+
+        // `steps` implicit steps with the cached factor, built first with the last options when stale
+        template <class Mesh>
+        bool Smooth(Mesh& mesh, size_t steps = 1);
+
+        size_t UnknownCount() const { return freeVertices.size(); }
+        const ImplicitSmoothOptions& Options() const { return options; }
+
+        // variables
+    private:
+        using Matrix = Eigen::SparseMatrix<double, Eigen::ColMajor, int>;
+
+        template <class Mesh>
+        Matrix AssembleLaplacian(const Mesh& mesh, bool cotangent, std::vector<double>& mass) const;
+
+        ImplicitSmoothOptions options;
+        Eigen::SimplicialLDLT<Matrix> solver;
+        bool factored = false;
+
+        std::vector<double> mass;               // M, per vertex
+        std::vector<int> unknown;               // unknown of every vertex, -1 if it stays
+        std::vector<uint32_t> freeVertices;
+        std::vector<uint32_t> fixedVertices;
+        Matrix coupling;                        // free rows, fixed columns of the system matrix
+
+        uint64_t version = 0;
+        size_t vertexCount = 0, faceCount = 0, edgeCount = 0;
+    };
+
+    // C as a symmetric CSR: edge weights off the diagonal, minus their sum on it. Cotangent weights
+    // are clamped at zero so the system stays positive definite on obtuse triangles.
+    template <class Mesh>
+    ImplicitSmoother::Matrix ImplicitSmoother::AssembleLaplacian(const Mesh& mesh, bool cotangent, std::vector<double>& vertexMass) const {
+
+        using Entry = std::pair<int, double>;
+
+        const size_t n = mesh.n_vertices();
+        auto vertex = [](size_t v) { return OpenMesh::VertexHandle(static_cast<int>(v)); };
+        auto deleted = [&](size_t v) { return mesh.has_vertex_status() && mesh.status(vertex(v)).deleted(); };
+
+        // cot of the angle at the vertex after h in its face, (a . b) / |a x b|
+        auto cot = [&](OpenMesh::HalfedgeHandle h) {
+
+            if (!mesh.face_handle(h).is_valid()) return 0.0;
+            const auto& p0 = mesh.point(mesh.from_vertex_handle(h));
+            const auto& p1 = mesh.point(mesh.to_vertex_handle(h));
+            const auto& p2 = mesh.point(mesh.to_vertex_handle(mesh.next_halfedge_handle(h)));
+            const double a[3] = { double(p0[0]) - p2[0], double(p0[1]) - p2[1], double(p0[2]) - p2[2] };
+            const double b[3] = { double(p1[0]) - p2[0], double(p1[1]) - p2[1], double(p1[2]) - p2[2] };
+            const double cross[3] = { a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0] };
+            const double sine = std::sqrt(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]);
+            return sine > 0.0 ? (a[0] * b[0] + a[1] * b[1] + a[2] * b[2]) / sine : 0.0;
+        };
+
+        auto row = [&](size_t v, std::vector<Entry>& entries) {
+
+            entries.clear();
+            if (deleted(v)) return;
+
+            double sum = 0.0;
+            for (auto heh : mesh.voh_range(vertex(v))) {
+
+                const double weight = cotangent ? std::max(0.0, cot(heh) + cot(mesh.opposite_halfedge_handle(heh))) : 1.0;
+                entries.push_back({ mesh.to_vertex_handle(heh).idx(), weight });
+                sum += weight;
+            }
+            entries.push_back({ static_cast<int>(v), -sum });
+            std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.first < b.first; });
+        };
+
+        // sizes first, then every column filled by the worker owning its vertex, C is symmetric
+        std::vector<int> offsets(n + 1, 0);
+        vertexMass.assign(n, 0.0);
+        Parallel::For(0, n, [&](size_t begin, size_t end) {
+
+            std::vector<Entry> entries;
+            for (size_t v = begin; v < end; ++v) {
+
+                row(v, entries);
+                offsets[v] = static_cast<int>(entries.size());
+            }
+        }, 1024);
+        const int nonZeros = Parallel::ExclusiveScan(offsets);
+
+        Matrix laplacian(static_cast<Eigen::Index>(n), static_cast<Eigen::Index>(n));
+        laplacian.resizeNonZeros(nonZeros);
+        std::copy(offsets.begin(), offsets.end(), laplacian.outerIndexPtr());
+        int* inner = laplacian.innerIndexPtr();
+        double* values = laplacian.valuePtr();
+        Parallel::For(0, n, [&](size_t begin, size_t end) {
+
+            std::vector<Entry> entries;
+            for (size_t v = begin; v < end; ++v) {
+
+                row(v, entries);
+                for (size_t i = 0; i < entries.size(); ++i) {
+
+                    inner[offsets[v] + i] = entries[i].first;
+                    values[offsets[v] + i] = entries[i].second;
+                    if (entries[i].first == static_cast<int>(v)) vertexMass[v] = -entries[i].second;
+                }
+            }
+        }, 1024);
+        return laplacian;
+    }
+
+    template <class Mesh>
+    bool ImplicitSmoother::Build(const Mesh& mesh, const ImplicitSmoothOptions& smoothOptions) {
+
+        options = smoothOptions;
+        factored = false;
+
+        const size_t n = mesh.n_vertices();
+        const bool cotangent = options.weighting == LaplaceWeighting::Cotangent && Mesh::IsTriMesh;
+        const Matrix laplacian = AssembleLaplacian(mesh, cotangent, mass);
+
+        // active vertices as SmootherT::set_active_vertices picks them
+        bool selection = false;
+        if (mesh.has_vertex_status()) {
+
+            for (size_t v = 0; v < n && !selection; ++v) selection = mesh.status(OpenMesh::VertexHandle(static_cast<int>(v))).selected();
+        }
+        unknown.assign(n, -1);
+        freeVertices.clear();
+        fixedVertices.clear();
+        std::vector<int> fixedIndex(n, -1);
+        for (size_t v = 0; v < n; ++v) {
+
+            const OpenMesh::VertexHandle vh(static_cast<int>(v));
+            bool active = mass[v] > 0.0 && !mesh.is_boundary(vh);
+            if (active && mesh.has_vertex_status()) {
+
+                const auto& status = mesh.status(vh);
+                active = !status.deleted() && !status.locked() && (!selection || status.selected());
+            }
+            if (active) {
+
+                unknown[v] = static_cast<int>(freeVertices.size());
+                freeVertices.push_back(static_cast<uint32_t>(v));
+            }
+            else {
+
+                fixedIndex[v] = static_cast<int>(fixedVertices.size());
+                fixedVertices.push_back(static_cast<uint32_t>(v));
+            }
+        }
+
+        Matrix system;
+        if (options.fairing == FairingOperator::Laplacian) {
+
+            system = -options.step * laplacian;
+        }
+        else {
+
+            Eigen::VectorXd inverseMass(n);
+            for (size_t v = 0; v < n; ++v) inverseMass[v] = mass[v] > 0.0 ? 1.0 / mass[v] : 0.0;
+            system = options.step * (laplacian * inverseMass.asDiagonal() * laplacian);
+        }
+        for (size_t v = 0; v < n; ++v) system.coeffRef(static_cast<Eigen::Index>(v), static_cast<Eigen::Index>(v)) += mass[v];
+
+        // split into the free block and its coupling to the fixed vertices
+        std::vector<Eigen::Triplet<double>> freeEntries, fixedEntries;
+        for (Eigen::Index column = 0; column < system.outerSize(); ++column) {
+
+            for (Matrix::InnerIterator it(system, column); it; ++it) {
+
+                const int i = unknown[it.row()];
+                if (i < 0) continue;
+                if (unknown[column] >= 0) freeEntries.emplace_back(i, unknown[column], it.value());
+                else fixedEntries.emplace_back(i, fixedIndex[column], it.value());
+            }
+        }
+        Matrix freeBlock(static_cast<Eigen::Index>(freeVertices.size()), static_cast<Eigen::Index>(freeVertices.size()));
+        freeBlock.setFromTriplets(freeEntries.begin(), freeEntries.end());
+        coupling.resize(static_cast<Eigen::Index>(freeVertices.size()), static_cast<Eigen::Index>(fixedVertices.size()));
+        coupling.setFromTriplets(fixedEntries.begin(), fixedEntries.end());
+
+        solver.compute(freeBlock);
+        if (solver.info() != Eigen::Success) {
+
+            fprintf(stderr, "ImplicitSmoother::Build: factorization failed\n");
+            return false;
+        }
+
+        version = TopologyVersion(mesh);
+        vertexCount = n;
+        faceCount = mesh.n_faces();
+        edgeCount = mesh.n_edges();
+        factored = true;
+        return true;
+    }
+
+    template <class Mesh>
+    bool ImplicitSmoother::Smooth(Mesh& mesh, size_t steps) {
+
+        using Point = typename Mesh::Point;
+        using Scalar = typename Point::value_type;
+
+        if (!IsCurrent(mesh) && !Build(mesh, options)) return false;
+        if (freeVertices.empty()) return true;
+
+        Eigen::MatrixX3d fixedPoints(fixedVertices.size(), 3), points(freeVertices.size(), 3);
+        Parallel::For(0, fixedVertices.size(), [&](size_t begin, size_t end) {
+
+            for (size_t i = begin; i < end; ++i) {
+
+                const Point& p = mesh.point(OpenMesh::VertexHandle(static_cast<int>(fixedVertices[i])));
+                fixedPoints.row(i) << p[0], p[1], p[2];
+            }
+        });
+        Parallel::For(0, freeVertices.size(), [&](size_t begin, size_t end) {
+
+            for (size_t i = begin; i < end; ++i) {
+
+                const Point& p = mesh.point(OpenMesh::VertexHandle(static_cast<int>(freeVertices[i])));
+                points.row(i) << p[0], p[1], p[2];
+            }
+        });
+
+        // the fixed vertices do not move, their share of the right-hand side is the same every step
+        const Eigen::MatrixX3d boundary = coupling * fixedPoints;
+        Eigen::VectorXd freeMass(freeVertices.size());
+        for (size_t i = 0; i < freeVertices.size(); ++i) freeMass[i] = mass[freeVertices[i]];
+
+        for (size_t step = 0; step < steps; ++step) {
+
+            const Eigen::MatrixX3d rhs = freeMass.asDiagonal() * points - boundary;
+            points = solver.solve(rhs);
+            if (solver.info() != Eigen::Success) {
+
+                fprintf(stderr, "ImplicitSmoother::Smooth: solve failed\n");
+                return false;
+            }
+        }
+
+        Parallel::For(0, freeVertices.size(), [&](size_t begin, size_t end) {
+
+            for (size_t i = begin; i < end; ++i) {
+
+                mesh.set_point(OpenMesh::VertexHandle(static_cast<int>(freeVertices[i])),
+                               Point(static_cast<Scalar>(points(i, 0)), static_cast<Scalar>(points(i, 1)), static_cast<Scalar>(points(i, 2))));
+            }
+        });
+        return true;
+    }
+}
+
+#endif // !IMPLICIT_SMOOTHER_H
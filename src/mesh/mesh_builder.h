@@ -0,0 +1,120 @@
+#ifndef MESH_BUILDER_H
+#define MESH_BUILDER_H
+
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#include <OpenMesh/Core/Geometry/VectorT.hh>
+#include <OpenMesh/Core/Mesh/Handles.hh>
+
+#include "halfedge_builder.h"
+#include "topology_version.h"
+#include "../mesh_io/mesh_buffer.h"
+#include "../utils/parallel.h"
+
+namespace MeshTools {
+
+    struct MeshBuildResult {
+
+        std::vector<int> faceHandle;        // mesh face of every input face, -1 if it was dropped
+        size_t invalidFaces = 0;            // dropped like ImporterT does
+        size_t rejectedFaces = 0;           // non-manifold, added on duplicated vertices
+        size_t complexEdges = 0;            // what made them non-manifold, see HalfedgeTopology
+        size_t complexVertices = 0;
+    };
+
+    // Replace the contents of a mesh with a polygon soup, writing the kernel arrays directly instead of
+    // calling add_face per face. The result matches what ImporterT produces for the same input: vertex
+    // i is the i-th position, non-manifold faces are detached onto copies of their vertices and marked
+    // fixed non-manifold when status attributes are present, invalid faces are dropped. How many of each
+    // comes back in the result, nothing is printed.
+    template <class Mesh>
+    MeshBuildResult BuildMesh(Mesh& mesh, const float* positions, size_t vertexCount,
+                              const uint32_t* indices, const uint32_t* faceOffsets, size_t faceCount) {
+
+        using Point = typename Mesh::Point;
+
+        const HalfedgeTopology topology = BuildHalfedgeTopology(vertexCount, indices, faceOffsets, faceCount);
+
+        mesh.clear();
+        mesh.resize(vertexCount, topology.EdgeCount(), topology.FaceCount());
+
+        std::vector<Point>& points = mesh.property(mesh.points_pph()).data_vector();
+        Parallel::For(0, vertexCount, [&](size_t begin, size_t end) {
+
+            if constexpr (std::is_same_v<Point, OpenMesh::Vec3f>) {
+
+                std::memcpy(points[begin].data(), positions + begin * 3, (end - begin) * sizeof(Point));
+            }
+            else {
+
+                for (size_t v = begin; v < end; ++v) points[v] = Point(positions[v * 3], positions[v * 3 + 1], positions[v * 3 + 2]);
+            }
+
+            for (size_t v = begin; v < end; ++v)
+                mesh.set_halfedge_handle(OpenMesh::VertexHandle(static_cast<int>(v)), OpenMesh::HalfedgeHandle(topology.vertexHalfedge[v]));
+        });
+
+        Parallel::For(0, topology.halfedgeVertex.size(), [&](size_t begin, size_t end) {
+
+            for (size_t h = begin; h < end; ++h) {
+
+                const OpenMesh::HalfedgeHandle heh(static_cast<int>(h));
+                mesh.set_vertex_handle(heh, OpenMesh::VertexHandle(topology.halfedgeVertex[h]));
+                mesh.set_face_handle(heh, OpenMesh::FaceHandle(topology.halfedgeFace[h]));
+                mesh.set_next_halfedge_handle(heh, OpenMesh::HalfedgeHandle(topology.halfedgeNext[h]));
+            }
+        });
+
+        Parallel::For(0, topology.FaceCount(), [&](size_t begin, size_t end) {
+
+            for (size_t f = begin; f < end; ++f)
+                mesh.set_halfedge_handle(OpenMesh::FaceHandle(static_cast<int>(f)), OpenMesh::HalfedgeHandle(topology.faceHalfedge[f]));
+        });
+
+        MeshBuildResult result;
+        result.faceHandle.assign(faceCount, -1);
+        for (size_t f = 0; f < topology.FaceCount(); ++f) result.faceHandle[topology.faceSource[f]] = static_cast<int>(f);
+        result.invalidFaces = topology.invalidFaces.size();
+        result.rejectedFaces = topology.rejectedFaces.size();
+        result.complexEdges = topology.complexEdges;
+        result.complexVertices = topology.complexVertices;
+
+        // same fallback as ImporterT: give each rejected face its own vertices
+        std::vector<OpenMesh::VertexHandle> face;
+        for (uint32_t f : topology.rejectedFaces) {
+
+            const uint32_t begin = faceOffsets ? faceOffsets[f] : f * 3;
+            const uint32_t end = faceOffsets ? faceOffsets[f + 1] : f * 3 + 3;
+
+            face.clear();
+            for (uint32_t c = begin; c < end; ++c) {
+
+                const Point p = mesh.point(OpenMesh::VertexHandle(static_cast<int>(indices[c])));
+                face.push_back(mesh.add_vertex(p));
+                if (mesh.has_vertex_status()) mesh.status(face.back()).set_fixed_nonmanifold(true);
+            }
+
+            const OpenMesh::FaceHandle fh = mesh.add_face(face);
+            result.faceHandle[f] = fh.idx();
+            if (mesh.has_face_status()) mesh.status(fh).set_fixed_nonmanifold(true);
+            if (mesh.has_edge_status()) {
+
+                for (auto eh : mesh.fe_range(fh)) mesh.status(eh).set_fixed_nonmanifold(true);
+            }
+        }
+
+        TouchTopology(mesh);
+        return result;
+    }
+
+    template <class Mesh>
+    MeshBuildResult BuildMesh(Mesh& mesh, const MeshBuffer& buffer) {
+
+        return BuildMesh(mesh, buffer.positions.data(), buffer.VertexCount(), buffer.indices.data(),
+                         buffer.faceOffsets.empty() ? nullptr : buffer.faceOffsets.data(), buffer.FaceCount());
+    }
+}
+
+#endif // !MESH_BUILDER_H
@@ -0,0 +1,220 @@
+#include "mesh_normals.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <Eigen/Core>
+
+namespace {
+
+    // triangles per SIMD batch, Eigen splits the lanes into native packets
+    constexpr size_t LANES = 8;
+
+    // (p2 - p1) x (p0 - p1) like calc_face_normal, returns the length before normalizing
+    template <typename Scalar>
+    Scalar TriangleNormal(const Scalar* p0, const Scalar* p1, const Scalar* p2, Scalar* n) {
+
+        const Scalar ux = p2[0] - p1[0], uy = p2[1] - p1[1], uz = p2[2] - p1[2];
+        const Scalar vx = p0[0] - p1[0], vy = p0[1] - p1[1], vz = p0[2] - p1[2];
+
+        n[0] = uy * vz - uz * vy;
+        n[1] = uz * vx - ux * vz;
+        n[2] = ux * vy - uy * vx;
+
+        const Scalar length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        const Scalar inv = length != Scalar(0) ? Scalar(1) / length : Scalar(0);
+        n[0] *= inv;
+        n[1] *= inv;
+        n[2] *= inv;
+        return length;
+    }
+
+    template <typename Scalar>
+    void TriangleNormals(const uint32_t* corners, const Scalar* points, size_t begin, size_t end, Scalar* normals, Scalar* areas) {
+
+        using Lane = Eigen::Array<Scalar, LANES, 1>;
+
+        size_t f = begin;
+        for (; f + LANES <= end; f += LANES) {
+
+            // gather to structure of arrays: p[corner][axis]
+            Lane p[3][3];
+            for (size_t i = 0; i < LANES; ++i) {
+
+                for (size_t k = 0; k < 3; ++k) {
+
+                    const Scalar* q = points + size_t(corners[(f + i) * 3 + k]) * 3;
+                    p[k][0](i) = q[0];
+                    p[k][1](i) = q[1];
+                    p[k][2](i) = q[2];
+                }
+            }
+
+            const Lane ux = p[2][0] - p[1][0], uy = p[2][1] - p[1][1], uz = p[2][2] - p[1][2];
+            const Lane vx = p[0][0] - p[1][0], vy = p[0][1] - p[1][1], vz = p[0][2] - p[1][2];
+            const Lane nx = uy * vz - uz * vy;
+            const Lane ny = uz * vx - ux * vz;
+            const Lane nz = ux * vy - uy * vx;
+
+            const Lane length = (nx * nx + ny * ny + nz * nz).sqrt();
+            const Lane inv = (length != Scalar(0)).select(length.inverse(), Lane::Zero());
+
+            for (size_t i = 0; i < LANES; ++i) {
+
+                Scalar* n = normals + (f + i) * 3;
+                n[0] = nx(i) * inv(i);
+                n[1] = ny(i) * inv(i);
+                n[2] = nz(i) * inv(i);
+            }
+            if (areas) Eigen::Map<Lane>(areas + f) = length * Scalar(0.5);
+        }
+
+        for (; f < end; ++f) {
+
+            const uint32_t* c = corners + f * 3;
+            const Scalar length = TriangleNormal(points + size_t(c[0]) * 3, points + size_t(c[1]) * 3, points + size_t(c[2]) * 3, normals + f * 3);
+            if (areas) areas[f] = length * Scalar(0.5);
+        }
+    }
+
+    // Newell's method like calc_face_normal for polygons, faces with less than three corners get a zero normal
+    template <typename Scalar>
+    void PolygonNormals(const MeshTools::NormalTopology& topology, const Scalar* points, size_t begin, size_t end, Scalar* normals, Scalar* areas) {
+
+        for (size_t f = begin; f < end; ++f) {
+
+            const uint32_t first = topology.faceOffsets[f], last = topology.faceOffsets[f + 1];
+            Scalar* n = normals + f * 3;
+            n[0] = n[1] = n[2] = Scalar(0);
+
+            if (last - first >= 3) {
+
+                for (uint32_t c = first; c < last; ++c) {
+
+                    const Scalar* p = points + size_t(topology.cornerVertex[c]) * 3;
+                    const Scalar* q = points + size_t(topology.cornerVertex[c + 1 == last ? first : c + 1]) * 3;
+                    const Scalar ax = p[0] - q[0], ay = p[1] - q[1], az = p[2] - q[2];
+                    const Scalar bx = p[0] + q[0], by = p[1] + q[1], bz = p[2] + q[2];
+                    n[0] += ay * bz;
+                    n[1] += az * bx;
+                    n[2] += ax * by;
+                }
+            }
+
+            const Scalar length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            if (length != Scalar(0)) {
+
+                n[0] /= length;
+                n[1] /= length;
+                n[2] /= length;
+            }
+            if (areas) areas[f] = length * Scalar(0.5);
+        }
+    }
+
+    // interior angle of a face at corner c
+    template <typename Scalar>
+    Scalar CornerAngle(const Scalar* points, uint32_t prev, uint32_t at, uint32_t next) {
+
+        const Scalar* p = points + size_t(at) * 3;
+        const Scalar* a = points + size_t(prev) * 3;
+        const Scalar* b = points + size_t(next) * 3;
+        const Scalar ax = a[0] - p[0], ay = a[1] - p[1], az = a[2] - p[2];
+        const Scalar bx = b[0] - p[0], by = b[1] - p[1], bz = b[2] - p[2];
+
+        const Scalar lengths = std::sqrt((ax * ax + ay * ay + az * az) * (bx * bx + by * by + bz * bz));
+        if (lengths == Scalar(0)) return Scalar(0);
+        return std::acos(std::clamp((ax * bx + ay * by + az * bz) / lengths, Scalar(-1), Scalar(1)));
+    }
+}
+
+namespace MeshTools {
+
+    void NormalTopology::IndexCorners() {
+
+        const size_t cornerCount = cornerVertex.size();
+        if (!faceOffsets.empty()) {
+
+            cornerFace.resize(cornerCount);
+            Parallel::For(0, FaceCount(), [&](size_t begin, size_t end) {
+
+                for (size_t f = begin; f < end; ++f)
+                    std::fill(cornerFace.begin() + faceOffsets[f], cornerFace.begin() + faceOffsets[f + 1], static_cast<uint32_t>(f));
+            }, 1024);
+        }
+
+        // counting sort keeps the corners of a vertex in face order
+        vertexOffsets.assign(vertexCount + 1, 0);
+        for (uint32_t v : cornerVertex) ++vertexOffsets[v + 1];
+        for (size_t v = 0; v < vertexCount; ++v) vertexOffsets[v + 1] += vertexOffsets[v];
+
+        std::vector<uint32_t> fill(vertexOffsets.begin(), vertexOffsets.end() - 1);
+        vertexCorners.resize(cornerCount);
+        for (size_t c = 0; c < cornerCount; ++c) vertexCorners[fill[cornerVertex[c]]++] = static_cast<uint32_t>(c);
+    }
+
+    template <typename Scalar>
+    void ComputeFaceNormals(const NormalTopology& topology, const Scalar* points, Scalar* faceNormals, Scalar* areas) {
+
+        const bool triangles = topology.faceOffsets.empty();
+        Parallel::For(0, topology.FaceCount(), [&](size_t begin, size_t end) {
+
+            if (triangles) TriangleNormals(topology.cornerVertex.data(), points, begin, end, faceNormals, areas);
+            else PolygonNormals(topology, points, begin, end, faceNormals, areas);
+        });
+    }
+
+    template <typename Scalar>
+    void ComputeVertexNormals(const NormalTopology& topology, const Scalar* points, const Scalar* faceNormals,
+                              const Scalar* areas, NormalWeighting weighting, Scalar* vertexNormals) {
+
+        const bool triangles = topology.faceOffsets.empty();
+        auto faceOf = [&](uint32_t c) -> uint32_t { return triangles ? c / 3 : topology.cornerFace[c]; };
+        auto faceBegin = [&](uint32_t f) -> uint32_t { return triangles ? f * 3 : topology.faceOffsets[f]; };
+        auto faceEnd = [&](uint32_t f) -> uint32_t { return triangles ? f * 3 + 3 : topology.faceOffsets[f + 1]; };
+
+        // every vertex only reads its own corners, no accumulation races
+        Parallel::For(0, topology.vertexCount, [&](size_t begin, size_t end) {
+
+            for (size_t v = begin; v < end; ++v) {
+
+                Scalar n[3] = { 0, 0, 0 };
+                for (uint32_t i = topology.vertexOffsets[v]; i < topology.vertexOffsets[v + 1]; ++i) {
+
+                    const uint32_t c = topology.vertexCorners[i];
+                    const uint32_t f = faceOf(c);
+
+                    Scalar w = 1;
+                    if (weighting == NormalWeighting::Area) {
+
+                        w = areas[f];
+                    }
+                    else if (weighting == NormalWeighting::Angle) {
+
+                        const uint32_t first = faceBegin(f), last = faceEnd(f);
+                        const uint32_t prev = c == first ? last - 1 : c - 1;
+                        const uint32_t next = c + 1 == last ? first : c + 1;
+                        w = CornerAngle(points, topology.cornerVertex[prev], topology.cornerVertex[c], topology.cornerVertex[next]);
+                    }
+
+                    const Scalar* fn = faceNormals + size_t(f) * 3;
+                    n[0] += w * fn[0];
+                    n[1] += w * fn[1];
+                    n[2] += w * fn[2];
+                }
+
+                const Scalar length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+                const Scalar inv = length != Scalar(0) ? Scalar(1) / length : Scalar(1);
+                Scalar* out = vertexNormals + v * 3;
+                out[0] = n[0] * inv;
+                out[1] = n[1] * inv;
+                out[2] = n[2] * inv;
+            }
+        });
+    }
+
+    template void ComputeFaceNormals<float>(const NormalTopology&, const float*, float*, float*);
+    template void ComputeFaceNormals<double>(const NormalTopology&, const double*, double*, double*);
+    template void ComputeVertexNormals<float>(const NormalTopology&, const float*, const float*, const float*, NormalWeighting, float*);
+    template void ComputeVertexNormals<double>(const NormalTopology&, const double*, const double*, const double*, NormalWeighting, double*);
+}
@@ -0,0 +1,170 @@
+#ifndef MESH_NORMALS_H
+#define MESH_NORMALS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include <OpenMesh/Core/Geometry/VectorT.hh>
+#include <OpenMesh/Core/Mesh/Handles.hh>
+
+#include "topology_version.h"
+#include "../utils/parallel.h"
+
+namespace MeshTools {
+
+    enum class NormalWeighting {
+
+        Uniform,    // sum of unit face normals, same as calc_vertex_normal
+        Area,
+        Angle
+    };
+
+    // Face corners of a mesh and the corners around every vertex. Valid until the connectivity changes,
+    // so it can be kept across deformation steps. It records the topology version and sizes it was built
+    // from, like AdjacencySnapshot, so a stale one is noticed.
+    struct NormalTopology {
+
+        size_t vertexCount = 0;
+        size_t edgeCount = 0;
+        uint64_t version = 0;
+
+        std::vector<uint32_t> cornerVertex;
+        std::vector<uint32_t> faceOffsets;      // first corner of every face plus the end, empty if all faces are triangles
+        std::vector<uint32_t> cornerFace;       // only for polygon meshes
+
+        // corners around vertex v are vertexCorners[vertexOffsets[v] .. vertexOffsets[v + 1])
+        std::vector<uint32_t> vertexOffsets;
+        std::vector<uint32_t> vertexCorners;
+
+        size_t FaceCount() const { return faceOffsets.empty() ? cornerVertex.size() / 3 : faceOffsets.size() - 1; }
+
+        // false once the mesh connectivity changed after BuildNormalTopology
+        template <class Mesh>
+        bool IsCurrent(const Mesh& mesh) const {
+
+            return version == TopologyVersion(mesh) && vertexCount == mesh.n_vertices() &&
+                   FaceCount() == mesh.n_faces() && edgeCount == mesh.n_edges();
+        }
+
+        // fill cornerFace and the vertex-corner table from cornerVertex and faceOffsets
+        void IndexCorners();
+    };
+
+    // Unit face normals with the same formulas as calc_face_normal, triangles are done several at a time
+    // in SIMD lanes. areas is optional and receives the face areas used for area weighting.
+    template <typename Scalar>
+    void ComputeFaceNormals(const NormalTopology& topology, const Scalar* points, Scalar* faceNormals, Scalar* areas = nullptr);
+
+    // Unit vertex normals gathered from the incident faces, areas is required for NormalWeighting::Area.
+    template <typename Scalar>
+    void ComputeVertexNormals(const NormalTopology& topology, const Scalar* points, const Scalar* faceNormals,
+                              const Scalar* areas, NormalWeighting weighting, Scalar* vertexNormals);
+
+    template <class Mesh>
+    NormalTopology BuildNormalTopology(const Mesh& mesh) {
+
+        NormalTopology topology;
+        topology.vertexCount = mesh.n_vertices();
+        topology.edgeCount = mesh.n_edges();
+        topology.version = TopologyVersion(mesh);
+
+        const size_t faceCount = mesh.n_faces();
+        auto skip = [&](size_t f) { return mesh.has_face_status() && mesh.status(OpenMesh::FaceHandle(static_cast<int>(f))).deleted(); };
+
+        // deleted faces are kept as empty polygons so face indices stay the mesh's
+        bool triangles = Mesh::IsTriMesh;
+        if (triangles) {
+
+            for (size_t f = 0; f < faceCount && triangles; ++f) triangles = !skip(f);
+        }
+
+        if (!triangles) {
+
+            topology.faceOffsets.resize(faceCount + 1, 0);
+            Parallel::For(0, faceCount, [&](size_t begin, size_t end) {
+
+                for (size_t f = begin; f < end; ++f)
+                    topology.faceOffsets[f + 1] = skip(f) ? 0 : mesh.valence(OpenMesh::FaceHandle(static_cast<int>(f)));
+            });
+            for (size_t f = 0; f < faceCount; ++f) topology.faceOffsets[f + 1] += topology.faceOffsets[f];
+        }
+
+        topology.cornerVertex.resize(triangles ? faceCount * 3 : topology.faceOffsets.back());
+        Parallel::For(0, faceCount, [&](size_t begin, size_t end) {
+
+            for (size_t f = begin; f < end; ++f) {
+
+                if (skip(f)) continue;
+
+                size_t c = triangles ? f * 3 : topology.faceOffsets[f];
+                for (OpenMesh::VertexHandle vh : mesh.fv_range(OpenMesh::FaceHandle(static_cast<int>(f))))
+                    topology.cornerVertex[c++] = static_cast<uint32_t>(vh.idx());
+            }
+        });
+
+        topology.IndexCorners();
+        return topology;
+    }
+
+    // Parallel replacement for update_normals: face normals, then vertex normals with the chosen weighting,
+    // then halfedge normals, each only if the mesh has them. Meshes whose points and normals are not both
+    // 3D vectors of the same scalar fall back to the serial update_normals. A topology that is no longer
+    // current is rebuilt for this call, so rebuild the kept one after changing connectivity.
+    template <class Mesh>
+    void UpdateNormals(Mesh& mesh, const NormalTopology& topology, NormalWeighting weighting = NormalWeighting::Uniform,
+                       double featureAngle = 0.8) {
+
+        using Point = typename Mesh::Point;
+        using Normal = typename Mesh::Normal;
+        using Scalar = typename Point::value_type;
+
+        if constexpr (Point::size_ == 3 && std::is_same_v<Point, Normal> && std::is_floating_point_v<Scalar>) {
+
+            if (!mesh.has_face_normals()) return;
+            if (!topology.IsCurrent(mesh)) {
+
+                UpdateNormals(mesh, BuildNormalTopology(mesh), weighting, featureAngle);
+                return;
+            }
+
+            const Scalar* points = reinterpret_cast<const Scalar*>(mesh.points());
+            Scalar* faceNormals = reinterpret_cast<Scalar*>(mesh.property(mesh.face_normals_pph()).data_vector().data());
+
+            std::vector<Scalar> areas;
+            if (mesh.has_vertex_normals() && weighting == NormalWeighting::Area) areas.resize(topology.FaceCount());
+            ComputeFaceNormals(topology, points, faceNormals, areas.empty() ? nullptr : areas.data());
+
+            if (mesh.has_vertex_normals()) {
+
+                Scalar* vertexNormals = reinterpret_cast<Scalar*>(mesh.property(mesh.vertex_normals_pph()).data_vector().data());
+                ComputeVertexNormals(topology, points, faceNormals, areas.empty() ? nullptr : areas.data(), weighting, vertexNormals);
+            }
+
+            if (mesh.has_halfedge_normals()) {
+
+                Parallel::For(0, mesh.n_halfedges(), [&](size_t begin, size_t end) {
+
+                    for (size_t h = begin; h < end; ++h) {
+
+                        const OpenMesh::HalfedgeHandle heh(static_cast<int>(h));
+                        mesh.set_normal(heh, mesh.calc_halfedge_normal(heh, featureAngle));
+                    }
+                });
+            }
+        }
+        else {
+
+            mesh.update_normals();
+        }
+    }
+
+    template <class Mesh>
+    void UpdateNormals(Mesh& mesh, NormalWeighting weighting = NormalWeighting::Uniform) {
+
+        UpdateNormals(mesh, BuildNormalTopology(mesh), weighting);
+    }
+}
+
+#endif // !MESH_NORMALS_H
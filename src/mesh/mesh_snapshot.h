@@ -0,0 +1,168 @@
+#ifndef MESH_SNAPSHOT_H
+#define MESH_SNAPSHOT_H
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <OpenMesh/Core/Mesh/Handles.hh>
+
+#include "topology_version.h"
+#include "../mesh_io/mesh_cache.h"
+#include "../utils/cow_buffer.h"
+
+namespace MeshTools {
+
+    using MeshIO::MeshCacheBlock;
+
+    // Immutable copy of a mesh: the ArrayKernel vertex/edge/face arrays and the standard property
+    // arrays, each one a CowBuffer sharing unchanged chunks with the snapshot before it.
+    class MeshSnapshot {
+
+    public:
+        uint64_t Version() const { return version; }
+        uint64_t TopologyVersion() const { return topologyVersion; }
+
+        size_t VertexCount() const { return vertexCount; }
+        size_t EdgeCount() const { return edgeCount; }
+        size_t FaceCount() const { return faceCount; }
+
+        // nullptr when the mesh did not have the array
+        const CowBuffer* Block(MeshCacheBlock id) const {
+
+            for (const auto& [blockId, buffer] : blocks)
+                if (blockId == id) return &buffer;
+            return nullptr;
+        }
+
+        // bytes copied for this snapshot, everything else is shared with the previous one
+        size_t CopiedBytes() const {
+
+            size_t bytes = 0;
+            for (const auto& block : blocks) bytes += block.second.CopiedBytes();
+            return bytes;
+        }
+
+    private:
+        template <class Mesh> friend class MeshSnapshotter;
+
+        std::vector<std::pair<MeshCacheBlock, CowBuffer>> blocks;
+        uint64_t version = 0;
+        uint64_t topologyVersion = 0;
+        size_t vertexCount = 0;
+        size_t edgeCount = 0;
+        size_t faceCount = 0;
+    };
+
+    // Versioned snapshots of one mesh for readers on other threads. The editing thread calls Capture
+    // after a batch of changes; readers call Latest and keep the returned snapshot as long as they
+    // need it, while edits and newer captures go on. Only chunks that changed are duplicated, but
+    // changes are not tracked: Capture finds them by comparing every chunk of every array with the
+    // previous snapshot, so each capture reads the whole mesh once (in parallel) however small the
+    // edit. Memory grows with the edit, time with the mesh; capture per batch of edits, not per edit.
+    template <class Mesh>
+    class MeshSnapshotter {
+
+    public:
+        // editing thread only, the mesh must not change during the call
+        std::shared_ptr<const MeshSnapshot> Capture(Mesh& mesh) {
+
+            const std::shared_ptr<const MeshSnapshot> previous = Latest();
+            static const MeshSnapshot empty;
+            const MeshSnapshot& base = previous ? *previous : empty;
+
+            auto snapshot = std::make_shared<MeshSnapshot>();
+            snapshot->version = base.version + 1;
+            snapshot->topologyVersion = MeshTools::TopologyVersion(mesh);
+            snapshot->vertexCount = mesh.n_vertices();
+            snapshot->edgeCount = mesh.n_edges();
+            snapshot->faceCount = mesh.n_faces();
+
+            auto add = [&](MeshCacheBlock id, const void* data, size_t elementSize, size_t count) {
+
+                const CowBuffer* old = base.Block(id);
+                snapshot->blocks.emplace_back(id, CowBuffer::Update(old ? *old : CowBuffer(), data, elementSize, count));
+            };
+
+            const size_t nv = snapshot->vertexCount, ne = snapshot->edgeCount, nf = snapshot->faceCount;
+            add(MeshCacheBlock::Vertices, nv ? &mesh.vertex(OpenMesh::VertexHandle(0)) : nullptr, sizeof(typename Mesh::Vertex), nv);
+            add(MeshCacheBlock::Edges, ne ? &mesh.edge(OpenMesh::EdgeHandle(0)) : nullptr, sizeof(typename Mesh::Edge), ne);
+            add(MeshCacheBlock::Faces, nf ? &mesh.face(OpenMesh::FaceHandle(0)) : nullptr, sizeof(typename Mesh::Face), nf);
+
+            MeshIO::Detail::ForEachCacheProperty(mesh, [&](MeshCacheBlock id, auto pph, auto has, auto) {
+
+                if (!has()) return;
+
+                const auto& values = mesh.property(pph).data_vector();
+                using T = typename std::decay_t<decltype(values)>::value_type;
+                add(id, values.data(), sizeof(T), values.size());
+            });
+
+            std::lock_guard<std::mutex> lock(mutex);
+            latest = snapshot;
+            return latest;
+        }
+
+        // any thread, nullptr before the first capture
+        std::shared_ptr<const MeshSnapshot> Latest() const {
+
+            std::lock_guard<std::mutex> lock(mutex);
+            return latest;
+        }
+
+    private:
+        mutable std::mutex mutex;
+        std::shared_ptr<const MeshSnapshot> latest;
+    };
+
+    // Rebuild a mesh of the captured type from a snapshot, e.g. a reader that needs circulators.
+    template <class Mesh>
+    bool RestoreSnapshot(const MeshSnapshot& snapshot, Mesh& mesh) {
+
+        mesh.clear();
+        mesh.resize(snapshot.VertexCount(), snapshot.EdgeCount(), snapshot.FaceCount());
+
+        bool ok = true;
+        auto copyBlock = [&](MeshCacheBlock id, void* dst, size_t elementSize, size_t count) {
+
+            const CowBuffer* buffer = snapshot.Block(id);
+            if (!buffer || buffer->ElementSize() != elementSize || buffer->Size() != count) {
+
+                ok = false;
+                return;
+            }
+            if (count) buffer->CopyTo(dst);
+        };
+
+        const size_t nv = snapshot.VertexCount(), ne = snapshot.EdgeCount(), nf = snapshot.FaceCount();
+        copyBlock(MeshCacheBlock::Vertices, nv ? &mesh.vertex(OpenMesh::VertexHandle(0)) : nullptr, sizeof(typename Mesh::Vertex), nv);
+        copyBlock(MeshCacheBlock::Edges, ne ? &mesh.edge(OpenMesh::EdgeHandle(0)) : nullptr, sizeof(typename Mesh::Edge), ne);
+        copyBlock(MeshCacheBlock::Faces, nf ? &mesh.face(OpenMesh::FaceHandle(0)) : nullptr, sizeof(typename Mesh::Face), nf);
+
+        MeshIO::Detail::ForEachCacheProperty(mesh, [&](MeshCacheBlock id, auto pph, auto has, auto request) {
+
+            if (!snapshot.Block(id)) return;
+            if (!has()) request();
+
+            auto& values = mesh.property(pph).data_vector();
+            using T = typename std::decay_t<decltype(values)>::value_type;
+            copyBlock(id, values.data(), sizeof(T), values.size());
+        });
+
+        if (!ok) {
+
+            fprintf(stderr, "RestoreSnapshot: snapshot does not match the mesh type\n");
+            mesh.clear();
+        }
+
+        // restored or cleared, the old connectivity is gone either way
+        TouchTopology(mesh);
+        return ok;
+    }
+}
+
+#endif // !MESH_SNAPSHOT_H
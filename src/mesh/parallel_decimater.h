@@ -0,0 +1,326 @@
+#ifndef PARALLEL_DECIMATER_H
+#define PARALLEL_DECIMATER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <vector>
+
+#include <OpenMesh/Tools/Decimater/BaseDecimaterT.hh>
+
+#include "topology_version.h"
+#include "../utils/parallel.h"
+#include "../utils/property_arena.h"
+
+namespace MeshTools {
+
+    // Edge collapse decimater running in rounds instead of one collapse at a time. Each round
+    //  1. re-evaluates the cheapest legal collapse of every vertex touched by the last round,
+    //  2. takes the cheapest share of all candidates and keeps those that are the cheapest within
+    //     their neighbourhood (one-rings of both collapse ends), an independent set of collapses,
+    //  3. applies them concurrently, since no two of them touch the same vertices, edges or faces.
+    // Modules are added, configured and initialized exactly as for DecimaterT, and the priority and
+    // legality tests are the same, so results follow the serial decimater closely; a smaller round
+    // fraction keeps the order closer to the serial one at the cost of more rounds.
+    template <class Mesh>
+    class ParallelDecimater : public OpenMesh::Decimater::BaseDecimaterT<Mesh> {
+
+    public:
+        using Base = OpenMesh::Decimater::BaseDecimaterT<Mesh>;
+        using CollapseInfo = typename Base::CollapseInfo;
+        using ModuleBase = OpenMesh::Decimater::ModBaseT<Mesh>;
+
+        explicit ParallelDecimater(Mesh& mesh) : Base(mesh), mesh(mesh), targets(arena), priorities(arena), owner(arena), dirty(arena) {}
+
+        // Modules are called from several threads only while every added module only reads the mesh in
+        // collapse_priority and keeps its state per element: Quadric (ModQuadricT and ModFastQuadric),
+        // EdgeLength, AspectRatio and Roundness. Any other module makes all module calls serial, e.g.
+        // NormalFlipping and NormalDeviation, which move v0 to p1 to test a collapse and move it back,
+        // ModHausdorffT with its scratch points, or ModProgMeshT appending to a shared list.
+        // set_concurrent_modules(false) makes module calls serial in any case.
+        void set_concurrent_modules(bool concurrent) { concurrentModules = concurrent; }
+
+        // same as BaseDecimaterT::add and remove, the modules are kept to decide on concurrent calls
+        template <typename Module>
+        bool add(OpenMesh::Decimater::ModHandleT<Module>& handle) {
+
+            if (!Base::add(handle)) return false;
+            modules.push_back(&this->module(handle));
+            return true;
+        }
+
+        template <typename Module>
+        bool remove(OpenMesh::Decimater::ModHandleT<Module>& handle) {
+
+            if (!handle.is_valid()) return false;
+            const auto* module = &this->module(handle);
+            if (!Base::remove(handle)) return false;
+            modules.erase(std::remove(modules.begin(), modules.end(), module), modules.end());
+            return true;
+        }
+
+        // share of the cheapest candidates a round may pick from, in (0, 1]
+        void set_round_fraction(float fraction) { roundFraction = std::clamp(fraction, 1e-4f, 1.0f); }
+
+        // same contracts as DecimaterT::decimate and DecimaterT::decimate_to_faces
+        size_t decimate(size_t collapses = 0, bool onlySelected = false) {
+
+            if (!this->is_initialized()) return 0;
+            return Run(collapses ? collapses : mesh.n_vertices(), 0, 0, onlySelected);
+        }
+
+        size_t decimate_to_faces(size_t vertices = 0, size_t faces = 0, bool onlySelected = false) {
+
+            if (!this->is_initialized()) return 0;
+            if (vertices >= mesh.n_vertices() || faces >= mesh.n_faces()) return 0;
+            return Run(std::numeric_limits<size_t>::max(), vertices, faces, onlySelected);
+        }
+
+    private:
+        using VertexHandle = OpenMesh::VertexHandle;
+        using HalfedgeHandle = OpenMesh::HalfedgeHandle;
+
+        static constexpr uint64_t UNCLAIMED = std::numeric_limits<uint64_t>::max();
+
+        template <typename Func>
+        void ForVertices(const std::vector<uint32_t>& list, bool concurrent, Func&& func) {
+
+            if (!concurrent) {
+
+                for (uint32_t v : list) func(v);
+                return;
+            }
+            Parallel::For(0, list.size(), [&](size_t begin, size_t end) {
+
+                for (size_t i = begin; i < end; ++i) func(list[i]);
+            }, 256);
+        }
+
+        bool ModulesAreConcurrent() const {
+
+            static const char* const CONCURRENT_MODULES[] = { "Quadric", "EdgeLength", "AspectRatio", "Roundness" };
+            return std::all_of(modules.begin(), modules.end(), [](const ModuleBase* module) {
+
+                return std::any_of(std::begin(CONCURRENT_MODULES), std::end(CONCURRENT_MODULES),
+                    [&](const char* name) { return module->name() == name; });
+            });
+        }
+
+        // cheapest legal collapse out of v, same rule as DecimaterT::heap_vertex
+        void Evaluate(uint32_t v) {
+
+            float best = FLT_MAX;
+            HalfedgeHandle target;
+            for (HalfedgeHandle heh : mesh.voh_range(VertexHandle(static_cast<int>(v)))) {
+
+                CollapseInfo ci(mesh, heh);
+                if (!this->is_collapse_legal(ci)) continue;
+
+                const float priority = this->collapse_priority(ci);
+                if (priority >= 0.0f && priority < best) {
+
+                    best = priority;
+                    target = heh;
+                }
+            }
+            targets[v] = target;
+            priorities[v] = target.is_valid() ? best : -1.0f;
+        }
+
+        // func(vertex) for the vertices a collapse out of v reads or writes: both ends and their one-rings
+        template <typename Func>
+        void ForRegion(uint32_t v, Func&& func) {
+
+            const VertexHandle v0(static_cast<int>(v));
+            const VertexHandle v1 = mesh.to_vertex_handle(targets[v]);
+            func(static_cast<uint32_t>(v0.idx()));
+            for (VertexHandle vh : mesh.vv_range(v0)) func(static_cast<uint32_t>(vh.idx()));
+            for (VertexHandle vh : mesh.vv_range(v1)) func(static_cast<uint32_t>(vh.idx()));
+        }
+
+        // priorities are non-negative, so their bits order like the floats; ties go to the lower index
+        uint64_t Key(uint32_t v) const {
+
+            uint32_t bits;
+            std::memcpy(&bits, &priorities[v], sizeof(bits));
+            return uint64_t(bits) << 32 | v;
+        }
+
+        size_t Run(size_t maxCollapses, size_t targetVertices, size_t targetFaces, bool onlySelected) {
+
+            const size_t vertexCount = mesh.n_vertices();
+            const bool concurrent = concurrentModules && ModulesAreConcurrent();
+            const bool updateNormals = mesh.has_face_normals();
+            size_t nv = vertexCount, nf = mesh.n_faces();
+
+            // the per-vertex scratch stays in the arena between calls, only growing meshes allocate
+            arena.Resize(vertexCount);
+            std::fill_n(targets.Data(), vertexCount, HalfedgeHandle());
+            std::fill_n(priorities.Data(), vertexCount, -1.0f);
+            std::fill_n(owner.Data(), vertexCount, UNCLAIMED);
+            std::fill_n(dirty.Data(), vertexCount, char(0));
+
+            auto eligible = [&](uint32_t v) {
+
+                const auto& status = mesh.status(VertexHandle(static_cast<int>(v)));
+                return !status.deleted() && (!onlySelected || status.selected());
+            };
+
+            std::vector<uint32_t> evaluate;
+            for (uint32_t v = 0; v < vertexCount; ++v)
+                if (eligible(v)) evaluate.push_back(v);
+
+            size_t collapses = 0;
+            std::vector<uint32_t> candidates, winners;
+            std::vector<std::vector<uint32_t>> chunkLists(Parallel::Concurrency());
+            std::vector<char> removedFaces;
+
+            while (collapses < maxCollapses && nv > targetVertices && nf > targetFaces) {
+
+                // 1. fresh priorities for everything the last round touched
+                ForVertices(evaluate, concurrent, [&](uint32_t v) { Evaluate(v); });
+
+                candidates.clear();
+                Parallel::ForChunks(vertexCount, chunkLists.size(), [&](size_t chunk, size_t begin, size_t end) {
+
+                    chunkLists[chunk].clear();
+                    for (size_t v = begin; v < end; ++v)
+                        if (priorities[v] >= 0.0f) chunkLists[chunk].push_back(static_cast<uint32_t>(v));
+                });
+                for (const auto& list : chunkLists) candidates.insert(candidates.end(), list.begin(), list.end());
+                if (candidates.empty()) break;
+
+                // 2. the cheapest share competes, each vertex goes to the cheapest collapse reaching it
+                const size_t share = std::max<size_t>(1, static_cast<size_t>(candidates.size() * roundFraction));
+                if (share < candidates.size()) {
+
+                    std::nth_element(candidates.begin(), candidates.begin() + (share - 1), candidates.end(),
+                        [&](uint32_t a, uint32_t b) { return Key(a) < Key(b); });
+                    candidates.resize(share);
+                }
+
+                ForVertices(candidates, true, [&](uint32_t v) {
+
+                    const uint64_t key = Key(v);
+                    ForRegion(v, [&](uint32_t w) {
+
+                        std::atomic_ref<uint64_t> slot(owner[w]);
+                        uint64_t current = slot.load(std::memory_order_relaxed);
+                        while (key < current && !slot.compare_exchange_weak(current, key, std::memory_order_relaxed)) {}
+                    });
+                });
+
+                std::vector<char> won(candidates.size(), 0);
+                Parallel::For(0, candidates.size(), [&](size_t begin, size_t end) {
+
+                    for (size_t i = begin; i < end; ++i) {
+
+                        const uint64_t key = Key(candidates[i]);
+                        bool all = true;
+                        ForRegion(candidates[i], [&](uint32_t w) { all = all && std::atomic_ref<uint64_t>(owner[w]).load(std::memory_order_relaxed) == key; });
+                        won[i] = all;
+                    }
+                }, 256);
+                ForVertices(candidates, true, [&](uint32_t v) {
+
+                    ForRegion(v, [&](uint32_t w) { std::atomic_ref<uint64_t>(owner[w]).store(UNCLAIMED, std::memory_order_relaxed); });
+                });
+
+                winners.clear();
+                for (size_t i = 0; i < candidates.size(); ++i)
+                    if (won[i]) winners.push_back(candidates[i]);
+
+                // never collapse past the requested counts, an interior collapse removes two faces; when not
+                // even one more fits, decimation stops here instead of overshooting
+                const size_t allowed = std::min({ maxCollapses - collapses, nv - targetVertices, (nf - targetFaces) / 2 });
+                if (allowed == 0) break;
+                if (winners.size() > allowed) {
+
+                    std::nth_element(winners.begin(), winners.begin() + (allowed - 1), winners.end(),
+                        [&](uint32_t a, uint32_t b) { return Key(a) < Key(b); });
+                    winners.resize(allowed);
+                }
+
+                // 3. collapse the independent set, regions are disjoint so workers never meet
+                removedFaces.assign(winners.size(), 0);
+                auto collapse = [&](size_t i) {
+
+                    const uint32_t v = winners[i];
+                    CollapseInfo ci(mesh, targets[v]);
+                    if (!this->is_collapse_legal(ci)) {
+
+                        priorities[v] = -1.0f;
+                        return;
+                    }
+
+                    for (VertexHandle vh : mesh.vv_range(ci.v0)) dirty[vh.idx()] = 1;
+                    removedFaces[i] = mesh.is_boundary(ci.v0v1) || mesh.is_boundary(ci.v1v0) ? 1 : 2;
+
+                    this->preprocess_collapse(ci);
+                    mesh.collapse(ci.v0v1);
+                    if (updateNormals) {
+
+                        for (auto fh : mesh.vf_range(ci.v1))
+                            if (!mesh.status(fh).deleted()) mesh.set_normal(fh, mesh.calc_face_normal(fh));
+                    }
+                    this->postprocess_collapse(ci);
+
+                    priorities[v] = -1.0f;
+                    targets[v] = HalfedgeHandle();
+                };
+                if (concurrent) {
+
+                    Parallel::For(0, winners.size(), [&](size_t begin, size_t end) {
+
+                        for (size_t i = begin; i < end; ++i) collapse(i);
+                    }, 64);
+                }
+                else {
+
+                    for (size_t i = 0; i < winners.size(); ++i) collapse(i);
+                }
+
+                size_t applied = 0;
+                for (char removed : removedFaces) {
+
+                    if (!removed) continue;
+                    ++applied;
+                    nf -= std::min<size_t>(nf, static_cast<size_t>(removed));
+                }
+                collapses += applied;
+                nv -= applied;
+
+                evaluate.clear();
+                for (uint32_t v = 0; v < vertexCount; ++v) {
+
+                    if (!dirty[v]) continue;
+                    dirty[v] = 0;
+                    if (eligible(v)) evaluate.push_back(v);
+                }
+
+                if (!this->notify_observer(collapses)) break;
+            }
+
+            if (collapses) TouchTopology(mesh);
+            return collapses;
+        }
+
+        Mesh& mesh;
+        std::vector<const ModuleBase*> modules;
+        bool concurrentModules = true;
+        float roundFraction = 0.25f;
+
+        // per-vertex scratch of Run in one arena, owner is claimed through atomic_ref
+        PropertyArena arena;
+        ArenaProperty<HalfedgeHandle> targets;
+        ArenaProperty<float> priorities;
+        ArenaProperty<uint64_t> owner;
+        ArenaProperty<char> dirty;
+    };
+}
+
+#endif // !PARALLEL_DECIMATER_H
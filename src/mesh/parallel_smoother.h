@@ -0,0 +1,367 @@
+#ifndef PARALLEL_SMOOTHER_H
+#define PARALLEL_SMOOTHER_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <Eigen/Core>
+#include <Eigen/StdVector>
+
+#include <OpenMesh/Core/Utils/vector_cast.hh>
+#include <OpenMesh/Tools/Smoother/SmootherT.hh>
+
+#include "adjacency_snapshot.h"
+#include "../utils/parallel.h"
+
+namespace MeshTools {
+
+    // JacobiLaplaceSmootherT with the one-rings and weights of LaplaceSmootherT precomputed into the CSR
+    // arrays of an AdjacencySnapshot, and every pass of an iteration (umbrellas, updates, tangent
+    // projection or local error check, moving the points) run over all vertices in parallel. Points are
+    // kept padded to four lanes during smooth, so each neighbour is one vector load and multiply-add.
+    // Component, Continuity, skip_features and the local error work as in SmootherT and the points come
+    // out the same to the bit; C2, which has no update rule there either, leaves the points alone.
+    template <class Mesh>
+    class ParallelLaplaceSmoother {
+
+    public:
+        using Smoother = OpenMesh::Smoother::SmootherT<Mesh>;
+        using Component = typename Smoother::Component;
+        using Continuity = typename Smoother::Continuity;
+        using Scalar = typename Mesh::Scalar;
+
+        explicit ParallelLaplaceSmoother(Mesh& mesh) : mesh(mesh) {
+
+            mesh.request_vertex_status();
+            mesh.request_face_normals();
+            mesh.request_vertex_normals();
+        }
+
+        ~ParallelLaplaceSmoother() {
+
+            mesh.release_vertex_status();
+            mesh.release_face_normals();
+            mesh.release_vertex_normals();
+        }
+
+        ParallelLaplaceSmoother(const ParallelLaplaceSmoother&) = delete;
+        ParallelLaplaceSmoother& operator=(const ParallelLaplaceSmoother&) = delete;
+
+        // same contracts as SmootherT
+        void initialize(Component component, Continuity continuity) {
+
+            this->component = component;
+            this->continuity = continuity;
+
+            // update_face_normals and update_vertex_normals of SmootherT::initialize, split over the workers
+            Parallel::For(0, mesh.n_faces(), [&](size_t begin, size_t end) {
+
+                for (size_t f = begin; f < end; ++f) {
+
+                    const OpenMesh::FaceHandle fh(static_cast<int>(f));
+                    mesh.set_normal(fh, mesh.calc_face_normal(fh));
+                }
+            });
+            Parallel::For(0, mesh.n_vertices(), [&](size_t begin, size_t end) {
+
+                for (size_t v = begin; v < end; ++v) {
+
+                    const OpenMesh::VertexHandle vh(static_cast<int>(v));
+                    mesh.set_normal(vh, mesh.calc_vertex_normal(vh));
+                }
+            });
+            adjacency.Build(mesh);
+            ComputeWeights(component == Smoother::Normal);
+
+            const size_t n = mesh.n_vertices();
+            original.resize(n);
+            originalNormals.resize(n);
+            Parallel::For(0, n, [&](size_t begin, size_t end) {
+
+                for (size_t v = begin; v < end; ++v) {
+
+                    const OpenMesh::VertexHandle vh(static_cast<int>(v));
+                    original[v] = Load(mesh.point(vh));
+                    originalNormals[v] = Load(mesh.normal(vh));
+                }
+            });
+            initialized = true;
+        }
+
+        void smooth(unsigned int iterations) {
+
+            if (!initialized || !adjacency.IsCurrent(mesh)) initialize(component, continuity);
+            SetActiveVertices();
+            if (continuity == Smoother::C2) return;
+
+            const size_t n = mesh.n_vertices();
+            points.resize(n);
+            Parallel::For(0, n, [&](size_t begin, size_t end) {
+
+                for (size_t v = begin; v < end; ++v) points[v] = Load(mesh.point(OpenMesh::VertexHandle(static_cast<int>(v))));
+            });
+            newPoints = points;
+            if (continuity == Smoother::C1) umbrellas.resize(n);
+
+            // inactive vertices are never written, so both buffers keep their positions and can be swapped
+            while (iterations--) {
+
+                if (continuity == Smoother::C0) ComputeNewPositionsC0();
+                else ComputeNewPositionsC1();
+
+                if (component == Smoother::Tangential) ProjectToTangentPlane();
+                else if (tolerance >= 0.0) LocalErrorCheck();
+
+                points.swap(newPoints);
+            }
+
+            Parallel::For(0, activeVertices.size(), [&](size_t begin, size_t end) {
+
+                for (size_t i = begin; i < end; ++i) {
+
+                    const uint32_t v = activeVertices[i];
+                    mesh.set_point(OpenMesh::VertexHandle(static_cast<int>(v)),
+                                   typename Mesh::Point(points[v][0], points[v][1], points[v][2]));
+                }
+            });
+        }
+
+        void set_relative_local_error(Scalar error) {
+
+            // vertices() skips deleted ones, the box starts at the first live vertex
+            auto vertices = mesh.vertices();
+            if (vertices.begin() == vertices.end()) return;
+
+            typename Mesh::Point bbMin = mesh.point(*vertices.begin()), bbMax = bbMin;
+            for (auto vh : vertices) {
+
+                bbMin.minimize(mesh.point(vh));
+                bbMax.maximize(mesh.point(vh));
+            }
+            set_absolute_local_error((error * (bbMax - bbMin)).norm());
+        }
+
+        void set_absolute_local_error(Scalar error) { tolerance = error; }
+        void disable_local_error_check() { tolerance = -1.0; }
+        void skip_features(bool state) { skipFeatures = state; }
+
+    private:
+        using Lane = Eigen::Array<Scalar, 4, 1>;
+        using Lanes = std::vector<Lane, Eigen::aligned_allocator<Lane>>;
+
+        template <class Vector>
+        static Lane Load(const Vector& p) { return Lane(p[0], p[1], p[2], Scalar(0)); }
+
+        // in the order of VectorT::dot, a horizontal sum would round differently
+        static Scalar Dot(const Lane& a, const Lane& b) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; }
+
+        // LaplaceSmootherT::compute_weights, per CSR entry and per vertex (one over the sum)
+        void ComputeWeights(bool cotangent) {
+
+            const size_t n = mesh.n_vertices();
+            const std::vector<uint32_t>& offsets = adjacency.VertexVertexOffsets();
+            edgeWeights.assign(adjacency.VertexVertexIndices().size(), Scalar(1));
+            vertexWeights.assign(n, Scalar(0));
+
+            const Scalar lb(-1.0), ub(1.0);
+            auto cot = [&](OpenMesh::HalfedgeHandle heh, const typename Mesh::Point& p0, const typename Mesh::Point& p1) {
+
+                const typename Mesh::Point& p2 = mesh.point(mesh.to_vertex_handle(mesh.next_halfedge_handle(heh)));
+                typename Mesh::Normal d0 = OpenMesh::vector_cast<typename Mesh::Normal>(p0 - p2);
+                typename Mesh::Normal d1 = OpenMesh::vector_cast<typename Mesh::Normal>(p1 - p2);
+                d0.normalize();
+                d1.normalize();
+                // in double as the unqualified tan and acos there, the sum rounds to Scalar
+                return static_cast<Scalar>(1.0) / std::tan(std::acos(double(std::max(lb, std::min(ub, Scalar(dot(d0, d1)))))));
+            };
+
+            Parallel::For(0, n, [&](size_t begin, size_t end) {
+
+                std::vector<std::pair<int, Scalar>> incident;
+                for (size_t v = begin; v < end; ++v) {
+
+                    uint32_t entry = offsets[v];
+                    incident.clear();
+                    for (auto heh : mesh.voh_range(OpenMesh::VertexHandle(static_cast<int>(v)))) {
+
+                        const OpenMesh::EdgeHandle eh = mesh.edge_handle(heh);
+                        if (cotangent) {
+
+                            // the edge's own orientation, so both ends get the same weight
+                            const OpenMesh::HalfedgeHandle heh0 = mesh.halfedge_handle(eh, 0), heh1 = mesh.halfedge_handle(eh, 1);
+                            const typename Mesh::Point& p0 = mesh.point(mesh.to_vertex_handle(heh0));
+                            const typename Mesh::Point& p1 = mesh.point(mesh.to_vertex_handle(heh1));
+                            Scalar weight(0);
+                            weight += cot(heh0, p0, p1);
+                            weight += cot(heh1, p0, p1);
+                            edgeWeights[entry] = weight;
+                        }
+                        incident.push_back({ eh.idx(), edgeWeights[entry++] });
+                    }
+
+                    // summed in edge order like the edge loop of compute_weights
+                    std::sort(incident.begin(), incident.end());
+                    Scalar sum(0);
+                    for (const auto& [edge, weight] : incident) sum += weight;
+                    if (sum) vertexWeights[v] = static_cast<Scalar>(1.0) / sum;
+                }
+            }, 1024);
+        }
+
+        // SmootherT::set_active_vertices, C1 also drops the one-ring of the boundary
+        void SetActiveVertices() {
+
+            const size_t n = mesh.n_vertices();
+            auto vertex = [](size_t v) { return OpenMesh::VertexHandle(static_cast<int>(v)); };
+
+            std::vector<char> selected(Parallel::Concurrency(), 0);
+            Parallel::ForChunks(n, selected.size(), [&](size_t chunk, size_t begin, size_t end) {
+
+                for (size_t v = begin; v < end && !selected[chunk]; ++v) selected[chunk] = mesh.status(vertex(v)).selected();
+            });
+            const bool nothingSelected = std::find(selected.begin(), selected.end(), 1) == selected.end();
+
+            active.assign(n, 0);
+            Parallel::For(0, n, [&](size_t begin, size_t end) {
+
+                for (size_t v = begin; v < end; ++v) {
+
+                    const auto& status = mesh.status(vertex(v));
+                    bool isActive = !status.deleted() && (nothingSelected || status.selected()) && !adjacency.IsBoundary(static_cast<uint32_t>(v)) &&
+                                    !status.locked();
+                    if (isActive && skipFeatures) {
+
+                        isActive = !status.feature();
+                        for (auto heh : mesh.voh_range(vertex(v))) {
+
+                            const auto fh0 = mesh.face_handle(heh), fh1 = mesh.opposite_face_handle(heh);
+                            if (mesh.has_edge_status() && mesh.status(mesh.edge_handle(heh)).feature()) isActive = false;
+                            if (mesh.has_face_status() && fh0.is_valid() && mesh.status(fh0).feature()) isActive = false;
+                            if (mesh.has_face_status() && fh1.is_valid() && mesh.status(fh1).feature()) isActive = false;
+                        }
+                    }
+                    active[v] = isActive;
+                }
+            }, 1024);
+
+            if (continuity == Smoother::C1) {
+
+                Parallel::For(0, n, [&](size_t begin, size_t end) {
+
+                    for (size_t v = begin; v < end; ++v) {
+
+                        if (!active[v]) continue;
+                        for (uint32_t w : adjacency.VertexVertices(static_cast<uint32_t>(v)))
+                            if (adjacency.IsBoundary(w)) active[v] = 0;
+                    }
+                }, 1024);
+            }
+
+            activeVertices.clear();
+            for (uint32_t v = 0; v < n; ++v)
+                if (active[v]) activeVertices.push_back(v);
+        }
+
+        template <typename Func>
+        void ForActive(Func&& func) {
+
+            Parallel::For(0, activeVertices.size(), [&](size_t begin, size_t end) {
+
+                for (size_t i = begin; i < end; ++i) func(activeVertices[i]);
+            }, 1024);
+        }
+
+        // weighted sum of a field over the one-ring of v
+        Lane RingSum(const Lanes& field, uint32_t v) const {
+
+            const uint32_t* neighbour = adjacency.VertexVertexIndices().data();
+            const uint32_t* offsets = adjacency.VertexVertexOffsets().data();
+            Lane sum = Lane::Zero();
+            for (uint32_t i = offsets[v]; i < offsets[v + 1]; ++i) sum += field[neighbour[i]] * edgeWeights[i];
+            return sum;
+        }
+
+        void ComputeNewPositionsC0() {
+
+            ForActive([&](uint32_t v) {
+
+                Lane u = RingSum(points, v) * vertexWeights[v] - points[v];
+                u *= static_cast<Scalar>(0.5);
+                newPoints[v] = points[v] + u;
+            });
+        }
+
+        void ComputeNewPositionsC1() {
+
+            const uint32_t* neighbour = adjacency.VertexVertexIndices().data();
+            const uint32_t* offsets = adjacency.VertexVertexOffsets().data();
+
+            // umbrellas of every vertex first, the update reads them across the one-ring
+            Parallel::For(0, points.size(), [&](size_t begin, size_t end) {
+
+                for (size_t v = begin; v < end; ++v) umbrellas[v] = points[v] - RingSum(points, static_cast<uint32_t>(v)) * vertexWeights[v];
+            }, 1024);
+
+            ForActive([&](uint32_t v) {
+
+                // unweighted umbrella sum, as JacobiLaplaceSmootherT
+                Lane uu = Lane::Zero();
+                Scalar diag(0.0);
+                for (uint32_t i = offsets[v]; i < offsets[v + 1]; ++i) {
+
+                    const Scalar w = edgeWeights[i];
+                    uu -= umbrellas[neighbour[i]];
+                    diag += (w * vertexWeights[neighbour[i]] + static_cast<Scalar>(1.0)) * w;
+                }
+                uu *= vertexWeights[v];
+                diag *= vertexWeights[v];
+                uu += umbrellas[v];
+                if (diag) uu *= static_cast<Scalar>(1.0) / diag;
+
+                uu *= static_cast<Scalar>(0.25);
+                newPoints[v] = points[v] - uu;
+            });
+        }
+
+        void ProjectToTangentPlane() {
+
+            ForActive([&](uint32_t v) {
+
+                Lane translation = newPoints[v] - original[v];
+                translation -= originalNormals[v] * Dot(translation, originalNormals[v]);
+                newPoints[v] = translation + original[v];
+            });
+        }
+
+        void LocalErrorCheck() {
+
+            ForActive([&](uint32_t v) {
+
+                const Lane translation = newPoints[v] - original[v];
+                const Scalar s = std::fabs(Dot(translation, originalNormals[v]));
+                if (s > tolerance) newPoints[v] = translation * (tolerance / s) + original[v];
+            });
+        }
+
+        Mesh& mesh;
+        Component component = Smoother::Tangential_and_Normal;
+        Continuity continuity = Smoother::C0;
+        Scalar tolerance = -1.0;
+        bool skipFeatures = false;
+        bool initialized = false;
+
+        AdjacencySnapshot adjacency;
+        std::vector<Scalar> edgeWeights;        // per CSR entry
+        std::vector<Scalar> vertexWeights;      // one over the sum of the edge weights
+        std::vector<char> active;
+        std::vector<uint32_t> activeVertices;
+
+        Lanes original, originalNormals;
+        Lanes points, newPoints, umbrellas;
+    };
+}
+
+#endif // !PARALLEL_SMOOTHER_H
@@ -0,0 +1,57 @@
+#ifndef QUADRIC_H
+#define QUADRIC_H
+
+#include <Eigen/Core>
+
+namespace MeshTools {
+
+    // Symmetric 4x4 error quadric with the ten upper-triangle coefficients
+    //   a00 a01 a02 a03 a11 a12 a13 a22 a23 a33
+    // padded to twelve doubles, so sums and evaluation run in full SIMD packets. Values match
+    // OpenMesh::Geometry::QuadricT<double> for the same planes.
+    class Quadric {
+
+    public:
+        using Coefficients = Eigen::Array<double, 12, 1>;
+
+        Quadric() : c(Coefficients::Zero()) {}
+
+        // plane a*x + b*y + c*z + d = 0 scaled by weight
+        static Quadric FromPlane(double a, double b, double c, double d, double weight = 1.0) {
+
+            Quadric q;
+            q.c << a * a, a * b, a * c, a * d, b * b, b * c, b * d, c * c, c * d, d * d, 0.0, 0.0;
+            q.c *= weight;
+            return q;
+        }
+
+        void Clear() { c.setZero(); }
+
+        Quadric& operator+=(const Quadric& o) { c += o.c; return *this; }
+        Quadric operator+(const Quadric& o) const { Quadric q; q.c = c + o.c; return q; }
+        Quadric& operator*=(double s) { c *= s; return *this; }
+
+        // v^T Q v for v = (x, y, z, 1)
+        double operator()(double x, double y, double z) const {
+
+            Coefficients m;
+            m << x * x, 2.0 * x * y, 2.0 * x * z, 2.0 * x, y * y, 2.0 * y * z, 2.0 * y, z * z, 2.0 * z, 1.0, 0.0, 0.0;
+            return (c * m).sum();
+        }
+
+        // error of the sum of two quadrics without forming it
+        static double SumError(const Quadric& a, const Quadric& b, double x, double y, double z) {
+
+            Coefficients m;
+            m << x * x, 2.0 * x * y, 2.0 * x * z, 2.0 * x, y * y, 2.0 * y * z, 2.0 * y, z * z, 2.0 * z, 1.0, 0.0, 0.0;
+            return ((a.c + b.c) * m).sum();
+        }
+
+        const Coefficients& Values() const { return c; }
+
+    private:
+        Coefficients c;
+    };
+}
+
+#endif // !QUADRIC_H
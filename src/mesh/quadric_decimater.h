@@ -0,0 +1,231 @@
+#ifndef QUADRIC_DECIMATER_H
+#define QUADRIC_DECIMATER_H
+
+#include <cfloat>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include <OpenMesh/Tools/Decimater/BaseDecimaterT.hh>
+#include <OpenMesh/Tools/Decimater/ModBaseT.hh>
+
+#include "quadric.h"
+#include "topology_version.h"
+#include "../utils/indexed_heap.h"
+#include "../utils/parallel.h"
+
+namespace MeshTools {
+
+    // Drop-in for ModQuadricT (same name, options and errors) keeping the quadrics in a flat array of
+    // SIMD quadrics instead of a vertex property of QuadricT<double>. Initialization runs in parallel,
+    // every vertex sums the quadrics of its own faces. Like ModQuadricT, a polygon's quadric only goes to
+    // its first three corners.
+    template <class MeshT>
+    class ModFastQuadric : public OpenMesh::Decimater::ModBaseT<MeshT> {
+
+    public:
+        DECIMATING_MODULE(ModFastQuadric, MeshT, Quadric);
+
+        explicit ModFastQuadric(MeshT& mesh) : Base(mesh, false) { unset_max_err(); }
+
+        void initialize() override {
+
+            const MeshT& mesh = Base::mesh();
+            std::vector<Quadric> faceQuadrics(mesh.n_faces());
+            Parallel::For(0, mesh.n_faces(), [&](size_t begin, size_t end) {
+
+                for (size_t f = begin; f < end; ++f) {
+
+                    // set_error_tolerance_factor initializes again mid-decimation, collapsed faces are skipped
+                    const OpenMesh::FaceHandle fh(static_cast<int>(f));
+                    if (mesh.status(fh).deleted()) continue;
+
+                    // plane of the first three corners weighted by area, as ModQuadricT does
+                    auto fv = mesh.cfv_iter(fh);
+                    const OpenMesh::Vec3d p0 = OpenMesh::vector_cast<OpenMesh::Vec3d>(mesh.point(*fv)); ++fv;
+                    const OpenMesh::Vec3d p1 = OpenMesh::vector_cast<OpenMesh::Vec3d>(mesh.point(*fv)); ++fv;
+                    const OpenMesh::Vec3d p2 = OpenMesh::vector_cast<OpenMesh::Vec3d>(mesh.point(*fv));
+
+                    OpenMesh::Vec3d n = (p1 - p0) % (p2 - p0);
+                    double area = n.norm();
+                    if (area > FLT_MIN) {
+
+                        n /= area;
+                        area *= 0.5;
+                    }
+                    faceQuadrics[f] = Quadric::FromPlane(n[0], n[1], n[2], -(p0 | n), area);
+                }
+            }, 1024);
+
+            // ModQuadricT adds the quadric to the corners it took the plane from
+            auto planeCorner = [&](OpenMesh::FaceHandle fh, OpenMesh::VertexHandle vh) {
+
+                if constexpr (MeshT::IsTriMesh) return true;
+                else {
+
+                    auto fv = mesh.cfv_iter(fh);
+                    for (int k = 0; k < 3; ++k, ++fv)
+                        if (*fv == vh) return true;
+                    return false;
+                }
+            };
+
+            quadrics.assign(mesh.n_vertices(), Quadric());
+            Parallel::For(0, mesh.n_vertices(), [&](size_t begin, size_t end) {
+
+                for (size_t v = begin; v < end; ++v) {
+
+                    const OpenMesh::VertexHandle vh(static_cast<int>(v));
+                    if (mesh.status(vh).deleted()) continue;
+                    for (auto fh : mesh.vf_range(vh))
+                        if (planeCorner(fh, vh)) quadrics[v] += faceQuadrics[fh.idx()];
+                }
+            }, 1024);
+        }
+
+        float collapse_priority(const CollapseInfo& ci) override {
+
+            const double err = Quadric::SumError(quadrics[ci.v0.idx()], quadrics[ci.v1.idx()], ci.p1[0], ci.p1[1], ci.p1[2]);
+            return float(err < maxErr ? err : float(Base::ILLEGAL_COLLAPSE));
+        }
+
+        void postprocess_collapse(const CollapseInfo& ci) override { quadrics[ci.v1.idx()] += quadrics[ci.v0.idx()]; }
+
+        void set_error_tolerance_factor(double factor) override {
+
+            if (this->is_binary() && factor >= 0.0 && factor <= 1.0) {
+
+                set_max_err(maxErr * factor / this->error_tolerance_factor_);
+                this->error_tolerance_factor_ = factor;
+                initialize();
+            }
+        }
+
+        // same meaning as in ModQuadricT
+        void set_max_err(double err, bool binary = true) {
+
+            maxErr = err;
+            Base::set_binary(binary);
+        }
+
+        void unset_max_err() {
+
+            maxErr = DBL_MAX;
+            Base::set_binary(false);
+        }
+
+        double max_err() const { return maxErr; }
+
+        const Quadric& VertexQuadric(OpenMesh::VertexHandle vh) const { return quadrics[vh.idx()]; }
+
+    private:
+        double maxErr = DBL_MAX;
+        std::vector<Quadric> quadrics;
+    };
+
+    // DecimaterT with the HeapT over vertex properties replaced by a 4-ary IndexedHeap holding the
+    // priorities itself. Collapse order, legality and module calls are the same as DecimaterT.
+    template <class Mesh>
+    class HeapDecimater : public OpenMesh::Decimater::BaseDecimaterT<Mesh> {
+
+    public:
+        using Base = OpenMesh::Decimater::BaseDecimaterT<Mesh>;
+        using CollapseInfo = typename Base::CollapseInfo;
+
+        explicit HeapDecimater(Mesh& mesh) : Base(mesh), mesh(mesh) {}
+
+        size_t decimate(size_t collapses = 0, bool onlySelected = false) {
+
+            if (!this->is_initialized()) return 0;
+            return Run(collapses ? collapses : mesh.n_vertices(), 0, 0, onlySelected);
+        }
+
+        size_t decimate_to_faces(size_t vertices = 0, size_t faces = 0, bool onlySelected = false) {
+
+            if (!this->is_initialized()) return 0;
+            if (vertices >= mesh.n_vertices() || faces >= mesh.n_faces()) return 0;
+            return Run(std::numeric_limits<size_t>::max(), vertices, faces, onlySelected);
+        }
+
+    private:
+        using VertexHandle = OpenMesh::VertexHandle;
+        using HalfedgeHandle = OpenMesh::HalfedgeHandle;
+
+        // same rule as DecimaterT::heap_vertex
+        void HeapVertex(VertexHandle vh) {
+
+            float best = FLT_MAX;
+            HalfedgeHandle target;
+            for (HalfedgeHandle heh : mesh.voh_range(vh)) {
+
+                CollapseInfo ci(mesh, heh);
+                if (!this->is_collapse_legal(ci)) continue;
+
+                const float priority = this->collapse_priority(ci);
+                if (priority >= 0.0f && priority < best) {
+
+                    best = priority;
+                    target = heh;
+                }
+            }
+
+            const uint32_t v = static_cast<uint32_t>(vh.idx());
+            targets[v] = target;
+            if (target.is_valid()) heap.Push(v, best);
+            else heap.Remove(v);
+        }
+
+        size_t Run(size_t maxCollapses, size_t targetVertices, size_t targetFaces, bool onlySelected) {
+
+            const bool updateNormals = mesh.has_face_normals();
+            size_t nv = mesh.n_vertices(), nf = mesh.n_faces(), collapses = 0;
+
+            heap.Reset(mesh.n_vertices());
+            targets.assign(mesh.n_vertices(), HalfedgeHandle());
+            for (VertexHandle vh : mesh.vertices())
+                if (!onlySelected || mesh.status(vh).selected()) HeapVertex(vh);
+
+            std::vector<VertexHandle> support;
+            while (!heap.Empty() && collapses < maxCollapses && nv > targetVertices && nf > targetFaces) {
+
+                const uint32_t v = heap.Top();
+                heap.Pop();
+
+                CollapseInfo ci(mesh, targets[v]);
+                if (!this->is_collapse_legal(ci)) continue;
+
+                support.clear();
+                for (VertexHandle vh : mesh.vv_range(ci.v0)) support.push_back(vh);
+
+                ++collapses;
+                --nv;
+                nf -= mesh.is_boundary(ci.v0v1) || mesh.is_boundary(ci.v1v0) ? 1 : 2;
+
+                this->preprocess_collapse(ci);
+                mesh.collapse(ci.v0v1);
+                if (updateNormals) {
+
+                    for (auto fh : mesh.vf_range(ci.v1))
+                        if (!mesh.status(fh).deleted()) mesh.set_normal(fh, mesh.calc_face_normal(fh));
+                }
+                this->postprocess_collapse(ci);
+
+                for (VertexHandle vh : support)
+                    if (!onlySelected || mesh.status(vh).selected()) HeapVertex(vh);
+
+                if (!this->notify_observer(collapses)) break;
+            }
+
+            heap.Reset(0);
+            targets.clear();
+            if (collapses) TouchTopology(mesh);
+            return collapses;
+        }
+
+        Mesh& mesh;
+        IndexedHeap heap;
+        std::vector<HalfedgeHandle> targets;
+    };
+}
+
+#endif // !QUADRIC_DECIMATER_H
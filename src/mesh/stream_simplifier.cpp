@@ -0,0 +1,467 @@
+#include "stream_simplifier.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <vector>
+
+#include "triangle_simplifier.h"
+#include "../mesh_io/stl_reader.h"
+#include "../mesh_io/vertex_weld.h"
+#include "../utils/mapped_file.h"
+#include "../utils/parallel.h"
+
+namespace {
+
+    using MeshTools::StreamSimplifyOptions;
+
+    constexpr size_t STL_HEADER_SIZE = 84;
+    constexpr size_t STL_TRIANGLE_SIZE = 50;
+    constexpr size_t SOUP_TRIANGLE_SIZE = 9 * sizeof(float);   // scratch file record, three corners
+    constexpr size_t IN_CORE_TRIANGLE_BYTES = 320;              // soup, welding, adjacency and quadrics of one triangle
+    constexpr size_t MIN_CELL_TRIANGLES = 4096;
+    constexpr size_t MAX_GRID = 16;                             // cells per axis
+    constexpr size_t MAX_BUFFER_TRIANGLES = 4096;
+    constexpr int MAX_SPLIT_DEPTH = 3;
+    constexpr int MAX_PASSES = 4;
+
+    // triangles of a binary STL or of a scratch soup file, read in place from the mapping
+    class SoupFile {
+
+    public:
+        bool Open(const std::string& path, bool stl) {
+
+            if (!file.Open(path)) return false;
+
+            if (stl) {
+
+                if (!MeshIO::IsBinaryStl(file.Data(), file.Size())) {
+
+                    fprintf(stderr, "StreamSimplify: %s is not a binary STL file\n", path.c_str());
+                    return false;
+                }
+                first = file.Data() + STL_HEADER_SIZE + 3 * sizeof(float);
+                stride = STL_TRIANGLE_SIZE;
+                count = (file.Size() - STL_HEADER_SIZE) / STL_TRIANGLE_SIZE;
+                return true;
+            }
+            first = file.Data();
+            stride = SOUP_TRIANGLE_SIZE;
+            count = file.Size() / SOUP_TRIANGLE_SIZE;
+            return true;
+        }
+
+        size_t Count() const { return count; }
+        void Read(size_t t, float* corners) const { std::memcpy(corners, first + t * stride, SOUP_TRIANGLE_SIZE); }
+        void Close() { file.Close(); }
+
+    private:
+        MappedFile file;
+        const char* first = nullptr;
+        size_t stride = 0;
+        size_t count = 0;
+    };
+
+    // appends triangles to one scratch soup, shared by the workers
+    class SoupWriter {
+
+    public:
+        ~SoupWriter() { Close(); }
+
+        bool Open(const std::string& path) {
+
+            file = fopen(path.c_str(), "wb");
+            if (!file) fprintf(stderr, "StreamSimplify: cannot open %s\n", path.c_str());
+            return file != nullptr;
+        }
+
+        bool Write(const float* corners, size_t triangles) {
+
+            std::lock_guard<std::mutex> lock(mutex);
+            count += triangles;
+            ok = ok && fwrite(corners, SOUP_TRIANGLE_SIZE, triangles, file) == triangles;
+            return ok;
+        }
+
+        bool Close() {
+
+            if (file) ok = fclose(file) == 0 && ok;
+            file = nullptr;
+            return ok;
+        }
+
+        size_t Count() const { return count; }
+
+    private:
+        FILE* file = nullptr;
+        std::mutex mutex;
+        size_t count = 0;
+        bool ok = true;
+    };
+
+    struct Bounds {
+
+        float min[3] = { INFINITY, INFINITY, INFINITY };
+        float max[3] = { -INFINITY, -INFINITY, -INFINITY };
+
+        void Add(const float* p) {
+
+            for (int k = 0; k < 3; ++k) {
+
+                min[k] = std::min(min[k], p[k]);
+                max[k] = std::max(max[k], p[k]);
+            }
+        }
+
+        void Add(const Bounds& o) {
+
+            Add(o.min);
+            Add(o.max);
+        }
+    };
+
+    // bounding box of the triangle centroids, the points cells are assigned by
+    Bounds CentroidBounds(const SoupFile& soup) {
+
+        std::vector<Bounds> chunkBounds(std::min<size_t>(Parallel::Concurrency(), soup.Count() / 65536 + 1));
+        Parallel::ForChunks(soup.Count(), chunkBounds.size(), [&](size_t chunk, size_t begin, size_t end) {
+
+            float p[9];
+            for (size_t t = begin; t < end; ++t) {
+
+                soup.Read(t, p);
+                const float c[3] = { (p[0] + p[3] + p[6]) / 3.0f, (p[1] + p[4] + p[7]) / 3.0f, (p[2] + p[5] + p[8]) / 3.0f };
+                chunkBounds[chunk].Add(c);
+            }
+        });
+
+        Bounds bounds;
+        for (const Bounds& b : chunkBounds) bounds.Add(b);
+        return bounds;
+    }
+
+    // regular grid over a box, optionally shifted by half a cell so the borders of the unshifted grid
+    // fall inside cells
+    struct Grid {
+
+        float origin[3];
+        float cellSize[3];
+        size_t dims[3];
+
+        Grid(const Bounds& bounds, size_t cellsPerAxis, bool shifted) {
+
+            for (int k = 0; k < 3; ++k) {
+
+                const float extent = bounds.max[k] - bounds.min[k];
+                cellSize[k] = extent > 0.0f ? extent / static_cast<float>(cellsPerAxis) : 1.0f;
+                origin[k] = bounds.min[k] - (shifted ? cellSize[k] * 0.5f : 0.0f);
+                dims[k] = extent > 0.0f ? cellsPerAxis + (shifted ? 1 : 0) : 1;
+            }
+        }
+
+        size_t CellCount() const { return dims[0] * dims[1] * dims[2]; }
+
+        size_t Cell(const float* p) const {
+
+            size_t index[3];
+            for (int k = 0; k < 3; ++k) {
+
+                const float c = (p[k] + p[k + 3] + p[k + 6]) / 3.0f;
+                const float x = std::floor((c - origin[k]) / cellSize[k]);
+                index[k] = static_cast<size_t>(std::clamp(x, 0.0f, static_cast<float>(dims[k] - 1)));
+            }
+            return (index[2] * dims[1] + index[1]) * dims[0] + index[0];
+        }
+    };
+
+    class StreamSimplifier {
+
+    public:
+        StreamSimplifier(const StreamSimplifyOptions& options, const std::string& prefix) : options(options), prefix(prefix) {
+
+            workers = Parallel::Concurrency();
+            cellTriangles = std::max(MIN_CELL_TRIANGLES, options.memoryBudget / (IN_CORE_TRIANGLE_BYTES * workers));
+        }
+
+        // simplify input (binary STL) into a scratch soup, returns its path or an empty string
+        std::string Run(const std::string& input) {
+
+            SoupFile source;
+            if (!source.Open(input, true)) return {};
+
+            const size_t inputCount = source.Count();
+            const size_t target = std::max<size_t>(1, static_cast<size_t>(std::llround(static_cast<double>(inputCount) * options.ratio)));
+            source.Close();
+
+            std::string current = input;
+            bool currentIsStl = true;
+            size_t count = inputCount;
+            for (int pass = 0; pass < MAX_PASSES; ++pass) {
+
+                const std::string next = prefix + "_pass" + std::to_string(pass) + ".soup";
+                const bool inCore = count * IN_CORE_TRIANGLE_BYTES <= options.memoryBudget;
+
+                SoupFile soup;
+                SoupWriter out;
+                if (!soup.Open(current, currentIsStl) || !out.Open(next)) return {};
+
+                const double ratio = std::min(1.0, static_cast<double>(target) / static_cast<double>(std::max<size_t>(count, 1)));
+                const bool ok = inCore ? Simplify(soup, target, out) : SimplifyCells(soup, ratio, pass % 2 == 1, out);
+                soup.Close();
+                if (!out.Close() || !ok) {
+
+                    std::remove(next.c_str());
+                    return {};
+                }
+
+                if (!currentIsStl) std::remove(current.c_str());
+                current = next;
+                currentIsStl = false;
+
+                count = out.Count();
+                if (inCore || count <= target + target / 100) break;
+            }
+            return current;
+        }
+
+    private:
+        // bucket by a grid sized to the budget, then simplify the cells on all workers
+        bool SimplifyCells(const SoupFile& soup, double ratio, bool shifted, SoupWriter& out) {
+
+            const double cells = 2.0 * static_cast<double>(soup.Count()) / static_cast<double>(cellTriangles);
+            const size_t cellsPerAxis = std::clamp<size_t>(static_cast<size_t>(std::ceil(std::cbrt(cells))), 1, MAX_GRID);
+            const Grid grid(CentroidBounds(soup), cellsPerAxis, shifted);
+
+            std::vector<std::string> paths;
+            if (!Bucket(soup, grid, prefix + "_cell", paths)) return false;
+
+            std::atomic<size_t> nextCell(0);
+            std::atomic<bool> ok(true);
+            Parallel::ForChunks(workers, workers, [&](size_t, size_t, size_t) {
+
+                for (size_t c = nextCell++; c < paths.size(); c = nextCell++)
+                    if (!SimplifyCell(paths[c], ratio, 0, out)) ok = false;
+            });
+            return ok;
+        }
+
+        // write every triangle to the scratch file of its cell, paths of the non-empty cells are returned
+        bool Bucket(const SoupFile& soup, const Grid& grid, const std::string& cellPrefix, std::vector<std::string>& paths) {
+
+            const size_t cellCount = grid.CellCount();
+            const size_t bufferTriangles = std::clamp<size_t>(options.memoryBudget / 4 / (cellCount * SOUP_TRIANGLE_SIZE), 64, MAX_BUFFER_TRIANGLES);
+
+            std::vector<std::vector<float>> buffers(cellCount);
+            std::vector<size_t> counts(cellCount, 0);
+            auto path = [&](size_t cell) { return cellPrefix + "_" + std::to_string(cell) + ".soup"; };
+
+            bool ok = true;
+            auto flush = [&](size_t cell) {
+
+                std::vector<float>& buffer = buffers[cell];
+                if (buffer.empty()) return;
+
+                FILE* file = fopen(path(cell).c_str(), counts[cell] == buffer.size() / 9 ? "wb" : "ab");
+                if (!file) {
+
+                    fprintf(stderr, "StreamSimplify: cannot write %s\n", path(cell).c_str());
+                    ok = false;
+                }
+                else {
+
+                    ok = fwrite(buffer.data(), SOUP_TRIANGLE_SIZE, buffer.size() / 9, file) == buffer.size() / 9 && ok;
+                    ok = fclose(file) == 0 && ok;
+                }
+                buffer.clear();
+            };
+
+            float p[9];
+            for (size_t t = 0; t < soup.Count() && ok; ++t) {
+
+                soup.Read(t, p);
+                const size_t cell = grid.Cell(p);
+                buffers[cell].insert(buffers[cell].end(), p, p + 9);
+                ++counts[cell];
+                if (buffers[cell].size() >= bufferTriangles * 9) flush(cell);
+            }
+            for (size_t cell = 0; cell < cellCount; ++cell) {
+
+                flush(cell);
+                if (counts[cell]) paths.push_back(path(cell));
+            }
+            if (!ok) {
+
+                for (const std::string& p : paths) std::remove(p.c_str());
+                paths.clear();
+            }
+            return ok;
+        }
+
+        // one cell file, split into octants while it is over the budget
+        bool SimplifyCell(const std::string& path, double ratio, int depth, SoupWriter& out) {
+
+            SoupFile cell;
+            if (!cell.Open(path, false)) return false;
+
+            bool ok;
+            if (cell.Count() > cellTriangles && depth < MAX_SPLIT_DEPTH) {
+
+                std::vector<std::string> parts;
+                ok = Bucket(cell, Grid(CentroidBounds(cell), 2, false), path.substr(0, path.size() - 5), parts);
+                cell.Close();
+                std::remove(path.c_str());
+                for (const std::string& part : parts) ok = SimplifyCell(part, ratio, depth + 1, out) && ok;
+                return ok;
+            }
+
+            const size_t target = std::max<size_t>(1, static_cast<size_t>(std::llround(static_cast<double>(cell.Count()) * ratio)));
+            ok = Simplify(cell, target, out);
+            cell.Close();
+            std::remove(path.c_str());
+            return ok;
+        }
+
+        // weld, simplify with open edges locked, write back as soup
+        bool Simplify(const SoupFile& soup, size_t target, SoupWriter& out) {
+
+            const size_t cornerCount = soup.Count() * 3;
+            if (cornerCount > UINT32_MAX) {
+
+                fprintf(stderr, "StreamSimplify: cell of %zu triangles is too large\n", soup.Count());
+                return false;
+            }
+
+            std::vector<uint32_t> corners;
+            std::vector<float> positions;
+            MeshIO::WeldCorners(cornerCount, [&](size_t corner, float* p) {
+
+                float t[9];
+                soup.Read(corner / 3, t);
+                std::memcpy(p, t + (corner % 3) * 3, 3 * sizeof(float));
+            }, corners, positions);
+
+            std::vector<uint32_t> indices;
+            indices.reserve(corners.size());
+            for (size_t t = 0; t < corners.size(); t += 3) {
+
+                const uint32_t* c = &corners[t];
+                if (c[0] != c[1] && c[1] != c[2] && c[2] != c[0]) indices.insert(indices.end(), c, c + 3);
+            }
+            std::vector<uint32_t>().swap(corners);
+
+            MeshTools::SimplifyTriangles(positions, indices, target);
+
+            std::vector<float> triangles(indices.size() * 3);
+            for (size_t i = 0; i < indices.size(); ++i) std::memcpy(&triangles[i * 3], &positions[size_t(indices[i]) * 3], 3 * sizeof(float));
+            return out.Write(triangles.data(), indices.size() / 3);
+        }
+
+        const StreamSimplifyOptions& options;
+        std::string prefix;
+        size_t workers = 1;
+        size_t cellTriangles = MIN_CELL_TRIANGLES;
+    };
+
+    std::string ScratchPrefix(const StreamSimplifyOptions& options) {
+
+        std::error_code error;
+        const std::filesystem::path directory = options.tempDirectory.empty() ? std::filesystem::temp_directory_path(error) : std::filesystem::path(options.tempDirectory);
+        const auto stamp = std::chrono::steady_clock::now().time_since_epoch().count();
+        return (directory / ("stream_simplify_" + std::to_string(stamp))).string();
+    }
+}
+
+namespace MeshTools {
+
+    bool StreamSimplify(const std::string& input, const std::string& output, const StreamSimplifyOptions& options) {
+
+        StreamSimplifier simplifier(options, ScratchPrefix(options));
+        const std::string result = simplifier.Run(input);
+        if (result.empty()) return false;
+
+        SoupFile soup;
+        FILE* file = soup.Open(result, false) ? fopen(output.c_str(), "wb") : nullptr;
+        if (!file) {
+
+            fprintf(stderr, "StreamSimplify: cannot write %s\n", output.c_str());
+            soup.Close();
+            std::remove(result.c_str());
+            return false;
+        }
+
+        char header[STL_HEADER_SIZE] = {};
+        const uint32_t count = static_cast<uint32_t>(soup.Count());
+        std::memcpy(header + 80, &count, sizeof(count));
+        bool ok = fwrite(header, sizeof(header), 1, file) == 1;
+
+        // records with facet normals, written in blocks
+        std::vector<char> block;
+        float p[9];
+        for (size_t t = 0; t < soup.Count() && ok; ++t) {
+
+            soup.Read(t, p);
+            const float e1[3] = { p[3] - p[0], p[4] - p[1], p[5] - p[2] };
+            const float e2[3] = { p[6] - p[0], p[7] - p[1], p[8] - p[2] };
+            float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+            const float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            if (length > 0.0f) for (float& x : n) x /= length;
+
+            char record[STL_TRIANGLE_SIZE] = {};
+            std::memcpy(record, n, sizeof(n));
+            std::memcpy(record + sizeof(n), p, sizeof(p));
+            block.insert(block.end(), record, record + STL_TRIANGLE_SIZE);
+            if (block.size() >= (size_t(1) << 20) || t + 1 == soup.Count()) {
+
+                ok = fwrite(block.data(), 1, block.size(), file) == block.size();
+                block.clear();
+            }
+        }
+
+        ok = fclose(file) == 0 && ok;
+        soup.Close();
+        std::remove(result.c_str());
+        if (!ok) {
+
+            fprintf(stderr, "StreamSimplify: failed to write %s\n", output.c_str());
+            std::remove(output.c_str());
+        }
+        return ok;
+    }
+
+    bool StreamSimplify(const std::string& input, MeshBuffer& result, const StreamSimplifyOptions& options) {
+
+        result.Clear();
+
+        StreamSimplifier simplifier(options, ScratchPrefix(options));
+        const std::string path = simplifier.Run(input);
+        if (path.empty()) return false;
+
+        SoupFile soup;
+        if (!soup.Open(path, false)) return false;
+
+        std::vector<uint32_t> corners;
+        MeshIO::WeldCorners(soup.Count() * 3, [&](size_t corner, float* p) {
+
+            float t[9];
+            soup.Read(corner / 3, t);
+            std::memcpy(p, t + (corner % 3) * 3, 3 * sizeof(float));
+        }, corners, result.positions);
+
+        result.indices.reserve(corners.size());
+        for (size_t t = 0; t < corners.size(); t += 3) {
+
+            const uint32_t* c = &corners[t];
+            if (c[0] != c[1] && c[1] != c[2] && c[2] != c[0]) result.indices.insert(result.indices.end(), c, c + 3);
+        }
+
+        soup.Close();
+        std::remove(path.c_str());
+        return true;
+    }
+}
@@ -0,0 +1,31 @@
+#ifndef STREAM_SIMPLIFIER_H
+#define STREAM_SIMPLIFIER_H
+
+#include <cstddef>
+#include <string>
+
+#include "../mesh_io/mesh_buffer.h"
+
+namespace MeshTools {
+
+    struct StreamSimplifyOptions {
+
+        double ratio = 0.1;                         // output triangles per input triangle
+        size_t memoryBudget = size_t(1) << 30;      // bytes for the cells in core at once, shared by all workers
+        std::string tempDirectory;                  // scratch cell files, the system temp directory when empty
+    };
+
+    // Out-of-core simplification of a binary STL triangle soup that does not fit into memory.
+    // The input is read through a mapping and bucketed into a grid of cells sized to the memory
+    // budget (cells that still come out too large are split again). Every cell is welded and simplified
+    // with SimplifyTriangles by the workers, cell borders locked so neighbouring cells still meet
+    // exactly. Further passes run on a grid shifted by half a cell, so the old borders are simplified
+    // too; once the remaining soup fits the budget it is simplified in one piece to the exact target.
+    // The result is written as binary STL.
+    bool StreamSimplify(const std::string& input, const std::string& output, const StreamSimplifyOptions& options = {});
+
+    // same, the result welded into a mesh buffer for import into a normal mesh
+    bool StreamSimplify(const std::string& input, MeshBuffer& result, const StreamSimplifyOptions& options = {});
+}
+
+#endif // !STREAM_SIMPLIFIER_H
@@ -0,0 +1,367 @@
+#include "subdivision.h"
+
+#include <atomic>
+
+#include "../utils/parallel.h"
+
+namespace {
+
+    using MeshTools::HalfedgeTopology;
+
+    // Pieces of parent halfedges after every edge e was split at vertex V + e the way LoopT and
+    // CatmullClarkT do it: halfedge 2e keeps the first half, the new edge E + e takes the second and
+    // its odd halfedge the first half of 2e + 1.
+    struct EdgeSplit {
+
+        size_t V, E;
+
+        int First(int h) const { return h & 1 ? 2 * (static_cast<int>(E) + (h >> 1)) + 1 : h; }
+        int Second(int h) const { return h & 1 ? h : 2 * (static_cast<int>(E) + (h >> 1)); }
+        int Midpoint(int h) const { return static_cast<int>(V) + (h >> 1); }
+    };
+
+    // halfedge of a face on its highest numbered edge, the last split of the face resets its halfedge to that one
+    int LastSplitHalfedge(const HalfedgeTopology& parent, size_t f) {
+
+        const int start = parent.faceHalfedge[f];
+        int best = start, h = start;
+        do {
+
+            if ((h >> 1) > (best >> 1)) best = h;
+            h = parent.halfedgeNext[h];
+        } while (h != start);
+        return best;
+    }
+
+    void AllocateChild(HalfedgeTopology& child, size_t vertexCount, size_t edgeCount, size_t faceCount) {
+
+        child.vertexCount = vertexCount;
+        child.halfedgeVertex.resize(edgeCount * 2);
+        child.halfedgeFace.resize(edgeCount * 2);
+        child.halfedgeNext.resize(edgeCount * 2);
+        child.halfedgePrev.resize(edgeCount * 2);
+        child.vertexHalfedge.resize(vertexCount);
+        child.faceHalfedge.resize(faceCount);
+    }
+
+    void LinkPrev(HalfedgeTopology& child) {
+
+        Parallel::For(0, child.halfedgeNext.size(), [&](size_t begin, size_t end) {
+
+            for (size_t h = begin; h < end; ++h) child.halfedgePrev[child.halfedgeNext[h]] = static_cast<int>(h);
+        });
+    }
+
+    // Connectivity after all edges are split, faces not yet: every parent halfedge becomes two pieces
+    // with the parent face. Boundary pieces are linked here, face pieces by the face pass. Vertex
+    // halfedges are what the splits leave after their adjust_outgoing_halfedge calls.
+    void SplitEdges(const HalfedgeTopology& parent, const EdgeSplit& split, HalfedgeTopology& child) {
+
+        const size_t edgeCount = parent.EdgeCount();
+        Parallel::For(0, edgeCount, [&](size_t begin, size_t end) {
+
+            for (size_t e = begin; e < end; ++e) {
+
+                const int h = static_cast<int>(e) * 2;
+                const int mid = split.Midpoint(h);
+
+                child.halfedgeVertex[h] = mid;
+                child.halfedgeVertex[h + 1] = parent.halfedgeVertex[h + 1];
+                child.halfedgeVertex[split.Second(h)] = parent.halfedgeVertex[h];
+                child.halfedgeVertex[split.First(h + 1)] = mid;
+
+                for (int side = h; side <= h + 1; ++side) {
+
+                    const int face = parent.halfedgeFace[side];
+                    child.halfedgeFace[split.First(side)] = face;
+                    child.halfedgeFace[split.Second(side)] = face;
+                    if (face >= 0) continue;
+
+                    child.halfedgeNext[split.First(side)] = split.Second(side);
+                    child.halfedgeNext[split.Second(side)] = split.First(parent.halfedgeNext[side]);
+                }
+
+                // the new vertex keeps its first outgoing halfedge unless the other one is on the boundary
+                const bool oppositeOpen = parent.halfedgeFace[h] >= 0 && parent.halfedgeFace[h + 1] < 0;
+                child.vertexHalfedge[mid] = oppositeOpen ? h + 1 : split.Second(h);
+            }
+        }, 1024);
+
+        // a parent vertex was last touched by the highest numbered split of an edge pointing to it
+        std::vector<std::atomic<int>> lastSplit(parent.vertexCount);
+        Parallel::For(0, parent.vertexCount, [&](size_t begin, size_t end) {
+
+            for (size_t v = begin; v < end; ++v) lastSplit[v].store(-1, std::memory_order_relaxed);
+        });
+        Parallel::For(0, edgeCount, [&](size_t begin, size_t end) {
+
+            for (size_t e = begin; e < end; ++e) {
+
+                std::atomic<int>& last = lastSplit[parent.halfedgeVertex[e * 2]];
+                int current = last.load(std::memory_order_relaxed);
+                while (current < static_cast<int>(e) && !last.compare_exchange_weak(current, static_cast<int>(e), std::memory_order_relaxed)) {}
+            }
+        }, 1024);
+
+        Parallel::For(0, parent.vertexCount, [&](size_t begin, size_t end) {
+
+            for (size_t v = begin; v < end; ++v) {
+
+                const int last = lastSplit[v].load(std::memory_order_relaxed);
+                if (last < 0) {
+
+                    child.vertexHalfedge[v] = parent.vertexHalfedge[v];
+                    continue;
+                }
+
+                // adjust_outgoing_halfedge: the first boundary halfedge clockwise from the new one
+                const int start = last * 2 + 1;
+                int h = start, outgoing = start;
+                do {
+
+                    if (parent.halfedgeFace[h] < 0) {
+
+                        outgoing = h;
+                        break;
+                    }
+                    h = parent.halfedgeNext[h ^ 1];
+                } while (h != start);
+                child.vertexHalfedge[v] = split.First(outgoing);
+            }
+        }, 1024);
+    }
+
+    // LoopT::split_face: three corner triangles appended per face, the face itself becomes the middle one
+    void SplitLoopFaces(const HalfedgeTopology& parent, const EdgeSplit& split, HalfedgeTopology& child) {
+
+        const int edgeBase = static_cast<int>(parent.EdgeCount() * 2);
+        const int faceCount = static_cast<int>(parent.FaceCount());
+        Parallel::For(0, parent.FaceCount(), [&](size_t begin, size_t end) {
+
+            for (size_t f = begin; f < end; ++f) {
+
+                int h[3];
+                h[0] = LastSplitHalfedge(parent, f);
+                h[1] = parent.halfedgeNext[h[0]];
+                h[2] = parent.halfedgeNext[h[1]];
+
+                const int face = static_cast<int>(f);
+                const int firstEdge = edgeBase + 3 * face;
+                for (int k = 0; k < 3; ++k) {
+
+                    const int before = h[(k + 2) % 3];
+                    const int corner = faceCount + 3 * face + k;
+                    const int cut = 2 * (firstEdge + k);            // from the midpoint of h[k] to the one of h[k - 1]
+
+                    child.halfedgeVertex[cut] = split.Midpoint(before);
+                    child.halfedgeVertex[cut + 1] = split.Midpoint(h[k]);
+
+                    child.halfedgeFace[split.First(h[k])] = corner;
+                    child.halfedgeFace[cut] = corner;
+                    child.halfedgeFace[split.Second(before)] = corner;
+                    child.halfedgeNext[split.First(h[k])] = cut;
+                    child.halfedgeNext[cut] = split.Second(before);
+                    child.halfedgeNext[split.Second(before)] = split.First(h[k]);
+                    child.faceHalfedge[corner] = split.First(h[k]);
+
+                    child.halfedgeFace[cut + 1] = face;
+                    child.halfedgeNext[cut + 1] = 2 * (firstEdge + (k + 1) % 3) + 1;
+                }
+                child.faceHalfedge[f] = 2 * (firstEdge + 2) + 1;
+            }
+        }, 1024);
+    }
+
+    // first corner of every face plus the end, as faceOffsets of a mesh buffer
+    std::vector<uint32_t> FaceValenceOffsets(const HalfedgeTopology& topology) {
+
+        std::vector<uint32_t> offsets(topology.FaceCount() + 1, 0);
+        Parallel::For(0, topology.FaceCount(), [&](size_t begin, size_t end) {
+
+            for (size_t f = begin; f < end; ++f) {
+
+                const int start = topology.faceHalfedge[f];
+                uint32_t n = 0;
+                int h = start;
+                do {
+
+                    ++n;
+                    h = topology.halfedgeNext[h];
+                } while (h != start);
+                offsets[f] = n;
+            }
+        }, 1024);
+        Parallel::ExclusiveScan(offsets);
+        return offsets;
+    }
+
+    // CatmullClarkT::split_face: a quad per corner around the face point, the face keeps the one at the
+    // start of its halfedge and the others are appended
+    void SplitCatmullClarkFaces(const HalfedgeTopology& parent, const EdgeSplit& split, const std::vector<uint32_t>& faceOffsets,
+                                HalfedgeTopology& child) {
+
+        const int edgeBase = static_cast<int>(parent.EdgeCount() * 2);
+        const int faceCount = static_cast<int>(parent.FaceCount());
+        const int pointBase = static_cast<int>(parent.vertexCount + parent.EdgeCount());
+        Parallel::For(0, parent.FaceCount(), [&](size_t begin, size_t end) {
+
+            std::vector<int> h;
+            for (size_t f = begin; f < end; ++f) {
+
+                const int face = static_cast<int>(f);
+                const int n = static_cast<int>(faceOffsets[f + 1] - faceOffsets[f]);
+                const int firstEdge = edgeBase + static_cast<int>(faceOffsets[f]);
+                const int firstFace = faceCount + static_cast<int>(faceOffsets[f]) - face;
+                const int point = pointBase + face;
+
+                h.resize(n);
+                h[0] = LastSplitHalfedge(parent, f);
+                for (int i = 1; i < n; ++i) h[i] = parent.halfedgeNext[h[i - 1]];
+
+                // spoke i runs from the midpoint of h[i] to the face point
+                for (int i = 0; i < n; ++i) {
+
+                    child.halfedgeVertex[2 * (firstEdge + i)] = point;
+                    child.halfedgeVertex[2 * (firstEdge + i) + 1] = split.Midpoint(h[i]);
+                }
+
+                const int in0 = 2 * firstEdge, outLast = 2 * (firstEdge + n - 1) + 1;
+                const int quad[4] = { split.First(h[0]), in0, outLast, split.Second(h[n - 1]) };
+                for (int k = 0; k < 4; ++k) {
+
+                    child.halfedgeFace[quad[k]] = face;
+                    child.halfedgeNext[quad[k]] = quad[(k + 1) % 4];
+                }
+                child.faceHalfedge[f] = quad[0];
+
+                for (int i = 1; i < n; ++i) {
+
+                    const int q = firstFace + i - 1;
+                    const int loop[4] = { 2 * (firstEdge + i - 1) + 1, split.Second(h[i - 1]), split.First(h[i]), 2 * (firstEdge + i) };
+                    for (int k = 0; k < 4; ++k) {
+
+                        child.halfedgeFace[loop[k]] = q;
+                        child.halfedgeNext[loop[k]] = loop[(k + 1) % 4];
+                    }
+                    child.faceHalfedge[q] = loop[1];
+                }
+                child.vertexHalfedge[point] = outLast;
+            }
+        }, 1024);
+    }
+
+    // Sqrt3T: every face split at its centroid V + f with PolyConnectivity::split, then every old edge
+    // between two faces flipped so it joins the centroids.
+    void RefineSqrt3(const HalfedgeTopology& parent, HalfedgeTopology& child) {
+
+        const size_t V = parent.vertexCount, E = parent.EdgeCount(), F = parent.FaceCount();
+        AllocateChild(child, V + F, E + 3 * F, 3 * F);
+
+        // position of every face halfedge in its face, counted from the face halfedge
+        std::vector<int> corner(parent.halfedgeVertex.size(), -1);
+        Parallel::For(0, F, [&](size_t begin, size_t end) {
+
+            for (size_t f = begin; f < end; ++f) {
+
+                int h = parent.faceHalfedge[f];
+                for (int k = 0; k < 3; ++k, h = parent.halfedgeNext[h]) corner[h] = k;
+            }
+        }, 1024);
+
+        const int edgeCount = static_cast<int>(E), faceCount = static_cast<int>(F);
+        auto subFace = [&](int h) { const int f = parent.halfedgeFace[h]; return corner[h] == 0 ? f : faceCount + 2 * f + corner[h] - 1; };
+        auto inSpoke = [&](int h) { return 2 * (edgeCount + 3 * parent.halfedgeFace[h] + corner[h]); };          // to(h) -> centroid
+        auto outSpoke = [&](int h) { return 2 * (edgeCount + 3 * parent.halfedgeFace[h] + (corner[h] + 2) % 3) + 1; };  // centroid -> from(h)
+        auto flipped = [&](int h) { return parent.halfedgeFace[h] >= 0 && parent.halfedgeFace[h ^ 1] >= 0; };
+
+        Parallel::For(0, parent.halfedgeVertex.size(), [&](size_t begin, size_t end) {
+
+            for (size_t i = begin; i < end; ++i) {
+
+                const int h = static_cast<int>(i);
+                if (parent.halfedgeFace[h] < 0) {
+
+                    child.halfedgeVertex[h] = parent.halfedgeVertex[h];
+                    child.halfedgeFace[h] = -1;
+                    child.halfedgeNext[h] = parent.halfedgeNext[h];
+                    continue;
+                }
+
+                const int centroid = static_cast<int>(V) + parent.halfedgeFace[h];
+                const int in = inSpoke(h), out = outSpoke(h);
+                child.halfedgeVertex[in] = centroid;
+                child.halfedgeVertex[in ^ 1] = parent.halfedgeVertex[h];
+                child.halfedgeFace[h] = subFace(h);
+                child.halfedgeFace[out] = subFace(h);
+                child.faceHalfedge[subFace(h)] = h;
+
+                if (flipped(h)) {
+
+                    // TriConnectivity::flip: h now ends at this centroid, its triangle is closed by the
+                    // spoke into the other centroid and the in-spoke moved to the other side
+                    const int other = h ^ 1;
+                    child.halfedgeVertex[h] = centroid;
+                    child.halfedgeNext[h] = out;
+                    child.halfedgeNext[out] = inSpoke(other);
+                    child.halfedgeFace[in] = subFace(other);
+                    child.halfedgeNext[in] = other;
+                }
+                else {
+
+                    child.halfedgeVertex[h] = parent.halfedgeVertex[h];
+                    child.halfedgeNext[h] = in;
+                    child.halfedgeFace[in] = subFace(h);
+                    child.halfedgeNext[in] = out;
+                    child.halfedgeNext[out] = h;
+                }
+            }
+        }, 1024);
+
+        Parallel::For(0, V, [&](size_t begin, size_t end) {
+
+            for (size_t v = begin; v < end; ++v) {
+
+                // a flip replaces the outgoing halfedge by the in-spoke of the opposite side
+                const int h = parent.vertexHalfedge[v];
+                child.vertexHalfedge[v] = h >= 0 && flipped(h) ? inSpoke(h ^ 1) : h;
+            }
+        }, 1024);
+        Parallel::For(0, F, [&](size_t begin, size_t end) {
+
+            for (size_t f = begin; f < end; ++f) child.vertexHalfedge[V + f] = 2 * (edgeCount + 3 * static_cast<int>(f) + 2) + 1;
+        }, 1024);
+
+        LinkPrev(child);
+    }
+}
+
+namespace MeshTools {
+
+    HalfedgeTopology RefineTopology(const HalfedgeTopology& parent, SubdivisionScheme scheme) {
+
+        HalfedgeTopology child;
+        if (scheme == SubdivisionScheme::Sqrt3) {
+
+            RefineSqrt3(parent, child);
+            return child;
+        }
+
+        const size_t V = parent.vertexCount, E = parent.EdgeCount(), F = parent.FaceCount();
+        const EdgeSplit split{ V, E };
+        if (scheme == SubdivisionScheme::Loop) {
+
+            AllocateChild(child, V + E, 2 * E + 3 * F, 4 * F);
+            SplitEdges(parent, split, child);
+            SplitLoopFaces(parent, split, child);
+        }
+        else {
+
+            const std::vector<uint32_t> offsets = FaceValenceOffsets(parent);
+            AllocateChild(child, V + E + F, 2 * E + offsets.back(), offsets.back());
+            SplitEdges(parent, split, child);
+            SplitCatmullClarkFaces(parent, split, offsets, child);
+        }
+        LinkPrev(child);
+        return child;
+    }
+}
@@ -0,0 +1,538 @@
+#ifndef SUBDIVISION_H
+#define SUBDIVISION_H
+
+#include <cmath>
+#include <cstdio>
+#include <numbers>
+#include <utility>
+#include <vector>
+
+#include <OpenMesh/Core/Geometry/VectorT.hh>
+#include <OpenMesh/Core/Mesh/Handles.hh>
+#include <OpenMesh/Core/Utils/Property.hh>
+#include <OpenMesh/Core/Utils/vector_cast.hh>
+#include <OpenMesh/Tools/Subdivider/Uniform/CatmullClarkT.hh>
+#include <OpenMesh/Tools/Subdivider/Uniform/LoopT.hh>
+#include <OpenMesh/Tools/Subdivider/Uniform/Sqrt3T.hh>
+
+#include "halfedge_builder.h"
+#include "mesh_normals.h"
+#include "topology_version.h"
+#include "../utils/parallel.h"
+
+namespace MeshTools {
+
+    enum class SubdivisionScheme {
+
+        Loop,           // LoopT, triangles
+        CatmullClark,   // CatmullClarkT, any polygons, quads out
+        Sqrt3           // Sqrt3T, triangles
+    };
+
+    // One level of uniform refinement of a halfedge kernel with every vertex, edge, face and halfedge
+    // numbered exactly as the OpenMesh subdivider leaves them, so levels can be chained and the result
+    // written back into a mesh. Counts are known up front (Loop V+E vertices and 4F faces, Catmull-Clark
+    // V+E+F vertices and one quad per face corner, Sqrt3 V+F vertices and 3F faces) and every element is
+    // generated from its parent in parallel. The kernel must not contain deleted elements. Sqrt3 is the
+    // even generation rule, boundary edges are kept and not split.
+    HalfedgeTopology RefineTopology(const HalfedgeTopology& parent, SubdivisionScheme scheme);
+
+    namespace Detail {
+
+        // outgoing halfedges of v clockwise from its halfedge, the voh_iter order
+        template <typename Func>
+        void ForOutgoing(const HalfedgeTopology& topology, size_t v, Func&& func) {
+
+            const int start = topology.vertexHalfedge[v];
+            if (start < 0) return;
+
+            int h = start;
+            do {
+
+                func(h);
+                h = topology.halfedgeNext[h ^ 1];
+            } while (h != start);
+        }
+
+        inline bool IsBoundaryVertex(const HalfedgeTopology& topology, size_t v) {
+
+            const int h = topology.vertexHalfedge[v];
+            return h < 0 || topology.halfedgeFace[h] < 0;
+        }
+
+        inline bool IsBoundaryEdge(const HalfedgeTopology& topology, int h) {
+
+            return topology.halfedgeFace[h] < 0 || topology.halfedgeFace[h ^ 1] < 0;
+        }
+
+        // (1 - alpha, alpha / n) per valence, LoopT and Sqrt3T keep a table for valences below 50
+        template <typename Real, typename Weight>
+        std::vector<std::pair<Real, Real>> ValenceWeights(size_t count, Weight&& weight) {
+
+            std::vector<std::pair<Real, Real>> weights(count, { Real(0), Real(0) });
+            for (size_t n = 1; n < count; ++n) weights[n] = weight(n);
+            return weights;
+        }
+
+        template <typename Real>
+        std::pair<Real, Real> LoopWeight(size_t valence) {
+
+            const double inv = 1.0 / double(valence);
+            const double t = 3.0 + 2.0 * std::cos(2.0 * std::numbers::pi * inv);
+            const double alpha = (40.0 - t * t) / 64.0;
+            return { static_cast<Real>(1.0 - alpha), static_cast<Real>(inv * alpha) };
+        }
+
+        template <typename Real>
+        std::pair<Real, Real> Sqrt3Weight(size_t valence) {
+
+            const Real alpha = Real((4.0 - 2.0 * std::cos(2.0 * std::numbers::pi / Real(valence))) / 9.0);
+            return { Real(1) - alpha, alpha / Real(valence) };
+        }
+
+        constexpr size_t WEIGHT_TABLE_SIZE = 64;
+    }
+
+    // Points of the next Loop level with the arithmetic of LoopT: smoothed parent vertices, then the
+    // edge points. Without updatePoints parent vertices stay and edge points are midpoints.
+    template <class Point, class Normal, typename Real = double>
+    void RefineLoopPoints(const HalfedgeTopology& parent, bool updatePoints, const std::vector<Point>& points, std::vector<Point>& refined) {
+
+        using OpenMesh::vector_cast;
+
+        const size_t V = parent.vertexCount, E = parent.EdgeCount();
+        const auto weights = Detail::ValenceWeights<Real>(Detail::WEIGHT_TABLE_SIZE, Detail::LoopWeight<Real>);
+        const Real oneOver8 = Real(1.0 / 8.0);
+        refined.resize(V + E);
+
+        Parallel::For(0, V, [&](size_t begin, size_t end) {
+
+            for (size_t v = begin; v < end; ++v) {
+
+                const int heh = parent.vertexHalfedge[v];
+                if (!updatePoints || heh < 0) {
+
+                    refined[v] = points[v];
+                    continue;
+                }
+
+                Point pos(0.0, 0.0, 0.0);
+                if (Detail::IsBoundaryVertex(parent, v)) {
+
+                    // ( v_l + 6 v + v_r ) / 8
+                    pos = points[v];
+                    pos *= Real(6.0);
+                    pos += vector_cast<Normal>(points[parent.halfedgeVertex[heh]]);
+                    pos += vector_cast<Normal>(points[parent.halfedgeVertex[parent.halfedgePrev[heh] ^ 1]]);
+                    pos *= oneOver8;
+                }
+                else {
+
+                    size_t valence = 0;
+                    Detail::ForOutgoing(parent, v, [&](int h) {
+
+                        ++valence;
+                        pos += vector_cast<Normal>(points[parent.halfedgeVertex[h]]);
+                    });
+                    const std::pair<Real, Real> w = valence < weights.size() ? weights[valence] : Detail::LoopWeight<Real>(valence);
+                    pos *= w.second;
+                    pos += w.first * vector_cast<Normal>(points[v]);
+                }
+                refined[v] = pos;
+            }
+        }, 1024);
+
+        Parallel::For(0, E, [&](size_t begin, size_t end) {
+
+            for (size_t e = begin; e < end; ++e) {
+
+                const int heh = static_cast<int>(e) * 2;
+                Point pos(points[parent.halfedgeVertex[heh]]);
+                pos += vector_cast<Normal>(points[parent.halfedgeVertex[heh + 1]]);
+
+                if (!updatePoints || Detail::IsBoundaryEdge(parent, heh)) {
+
+                    pos *= static_cast<Real>(0.5);
+                }
+                else {
+
+                    pos *= Real(3.0);
+                    pos += vector_cast<Normal>(points[parent.halfedgeVertex[parent.halfedgeNext[heh]]]);
+                    pos += vector_cast<Normal>(points[parent.halfedgeVertex[parent.halfedgeNext[heh + 1]]]);
+                    pos *= oneOver8;
+                }
+                refined[V + e] = pos;
+            }
+        }, 1024);
+    }
+
+    // Points of the next Catmull-Clark level with the arithmetic of CatmullClarkT: parent vertices,
+    // edge points, face centroids.
+    template <class Point, typename Real = double>
+    void RefineCatmullClarkPoints(const HalfedgeTopology& parent, bool updatePoints, const std::vector<Point>& points,
+                                  std::vector<Point>& refined) {
+
+        using Scalar = typename OpenMesh::vector_traits<Point>::value_type;
+
+        const size_t V = parent.vertexCount, E = parent.EdgeCount(), F = parent.FaceCount();
+        refined.resize(V + E + F);
+        Point* edgePoints = refined.data() + V;
+        Point* facePoints = refined.data() + V + E;
+
+        Parallel::For(0, F, [&](size_t begin, size_t end) {
+
+            for (size_t f = begin; f < end; ++f) {
+
+                // calc_face_centroid
+                Point centroid(0, 0, 0);
+                Scalar valence = 0.0;
+                const int start = parent.faceHalfedge[f];
+                int h = start;
+                do {
+
+                    centroid += points[parent.halfedgeVertex[h]];
+                    valence += 1.0;
+                    h = parent.halfedgeNext[h];
+                } while (h != start);
+                centroid /= valence;
+                facePoints[f] = centroid;
+            }
+        }, 1024);
+
+        Parallel::For(0, E, [&](size_t begin, size_t end) {
+
+            for (size_t e = begin; e < end; ++e) {
+
+                const int heh = static_cast<int>(e) * 2;
+                Point pos(points[parent.halfedgeVertex[heh]]);
+                pos += points[parent.halfedgeVertex[heh + 1]];
+
+                if (Detail::IsBoundaryEdge(parent, heh) || !updatePoints) {
+
+                    pos *= static_cast<Real>(0.5);
+                }
+                else {
+
+                    pos += facePoints[parent.halfedgeFace[heh]];
+                    pos += facePoints[parent.halfedgeFace[heh + 1]];
+                    pos *= static_cast<Real>(0.25);
+                }
+                edgePoints[e] = pos;
+            }
+        }, 1024);
+
+        Parallel::For(0, V, [&](size_t begin, size_t end) {
+
+            for (size_t v = begin; v < end; ++v) {
+
+                if (!updatePoints) {
+
+                    refined[v] = points[v];
+                    continue;
+                }
+
+                Point pos(0.0, 0.0, 0.0);
+                if (Detail::IsBoundaryVertex(parent, v)) {
+
+                    pos = points[v];
+                    Detail::ForOutgoing(parent, v, [&](int h) {
+
+                        if (Detail::IsBoundaryEdge(parent, h)) pos += edgePoints[h >> 1];
+                    });
+                    pos /= static_cast<Scalar>(3.0);
+                }
+                else {
+
+                    Real valence(0.0);
+                    Detail::ForOutgoing(parent, v, [&](int h) {
+
+                        pos += points[parent.halfedgeVertex[h]];
+                        valence += 1.0;
+                    });
+                    pos /= valence * valence;
+
+                    Point Q(0, 0, 0);
+                    Detail::ForOutgoing(parent, v, [&](int h) {
+
+                        if (parent.halfedgeFace[h] >= 0) Q += facePoints[parent.halfedgeFace[h]];
+                    });
+                    Q /= valence * valence;
+
+                    pos += points[v] * (valence - Real(2.0)) / valence + Q;
+                }
+                refined[v] = pos;
+            }
+        }, 1024);
+    }
+
+    // Points of the next Sqrt3 level with the arithmetic of Sqrt3T in an even generation: relaxed
+    // interior vertices, boundary vertices kept, then the face centroids. Sqrt3T always relaxes.
+    template <class Point, typename Real = double>
+    void RefineSqrt3Points(const HalfedgeTopology& parent, const std::vector<Point>& points, std::vector<Point>& refined) {
+
+        const size_t V = parent.vertexCount, F = parent.FaceCount();
+        const auto weights = Detail::ValenceWeights<Real>(Detail::WEIGHT_TABLE_SIZE, Detail::Sqrt3Weight<Real>);
+        const Real oneOver3 = Real(1.0 / 3.0);
+        refined.resize(V + F);
+
+        Parallel::For(0, V, [&](size_t begin, size_t end) {
+
+            for (size_t v = begin; v < end; ++v) {
+
+                if (Detail::IsBoundaryVertex(parent, v)) {
+
+                    refined[v] = points[v];
+                    continue;
+                }
+
+                Point pos(0, 0, 0);
+                size_t valence = 0;
+                Detail::ForOutgoing(parent, v, [&](int h) {
+
+                    pos += points[parent.halfedgeVertex[h]];
+                    ++valence;
+                });
+                const std::pair<Real, Real> w = valence < weights.size() ? weights[valence] : Detail::Sqrt3Weight<Real>(valence);
+                pos *= w.second;
+                pos += w.first * points[v];
+                refined[v] = pos;
+            }
+        }, 1024);
+
+        Parallel::For(0, F, [&](size_t begin, size_t end) {
+
+            for (size_t f = begin; f < end; ++f) {
+
+                const int h0 = parent.faceHalfedge[f];
+                const int h1 = parent.halfedgeNext[h0];
+                Point pos = points[parent.halfedgeVertex[h0]];
+                pos += points[parent.halfedgeVertex[h1]];
+                pos += points[parent.halfedgeVertex[parent.halfedgeNext[h1]]];
+                pos *= oneOver3;
+                refined[V + f] = pos;
+            }
+        }, 1024);
+    }
+
+    // connectivity of a mesh in kernel layout, read in parallel
+    template <class Mesh>
+    HalfedgeTopology ReadHalfedgeTopology(const Mesh& mesh) {
+
+        HalfedgeTopology topology;
+        topology.vertexCount = mesh.n_vertices();
+        topology.halfedgeVertex.resize(mesh.n_halfedges());
+        topology.halfedgeFace.resize(mesh.n_halfedges());
+        topology.halfedgeNext.resize(mesh.n_halfedges());
+        topology.halfedgePrev.resize(mesh.n_halfedges());
+        topology.vertexHalfedge.resize(mesh.n_vertices());
+        topology.faceHalfedge.resize(mesh.n_faces());
+
+        Parallel::For(0, mesh.n_halfedges(), [&](size_t begin, size_t end) {
+
+            for (size_t h = begin; h < end; ++h) {
+
+                const OpenMesh::HalfedgeHandle heh(static_cast<int>(h));
+                topology.halfedgeVertex[h] = mesh.to_vertex_handle(heh).idx();
+                topology.halfedgeFace[h] = mesh.face_handle(heh).idx();
+                topology.halfedgeNext[h] = mesh.next_halfedge_handle(heh).idx();
+                topology.halfedgePrev[h] = mesh.prev_halfedge_handle(heh).idx();
+            }
+        });
+        Parallel::For(0, mesh.n_vertices(), [&](size_t begin, size_t end) {
+
+            for (size_t v = begin; v < end; ++v) topology.vertexHalfedge[v] = mesh.halfedge_handle(OpenMesh::VertexHandle(static_cast<int>(v))).idx();
+        });
+        Parallel::For(0, mesh.n_faces(), [&](size_t begin, size_t end) {
+
+            for (size_t f = begin; f < end; ++f) topology.faceHalfedge[f] = mesh.halfedge_handle(OpenMesh::FaceHandle(static_cast<int>(f))).idx();
+        });
+        return topology;
+    }
+
+    // Grow the mesh to the kernel's counts and overwrite its connectivity. Properties of existing
+    // elements are kept and new elements get default values, as with the mesh's own split calls.
+    template <class Mesh>
+    void WriteHalfedgeTopology(Mesh& mesh, const HalfedgeTopology& topology) {
+
+        mesh.resize(topology.vertexCount, topology.EdgeCount(), topology.FaceCount());
+
+        Parallel::For(0, topology.halfedgeVertex.size(), [&](size_t begin, size_t end) {
+
+            for (size_t h = begin; h < end; ++h) {
+
+                const OpenMesh::HalfedgeHandle heh(static_cast<int>(h));
+                mesh.set_vertex_handle(heh, OpenMesh::VertexHandle(topology.halfedgeVertex[h]));
+                mesh.set_face_handle(heh, OpenMesh::FaceHandle(topology.halfedgeFace[h]));
+                mesh.set_next_halfedge_handle(heh, OpenMesh::HalfedgeHandle(topology.halfedgeNext[h]));
+            }
+        });
+        Parallel::For(0, topology.vertexCount, [&](size_t begin, size_t end) {
+
+            for (size_t v = begin; v < end; ++v)
+                mesh.set_halfedge_handle(OpenMesh::VertexHandle(static_cast<int>(v)), OpenMesh::HalfedgeHandle(topology.vertexHalfedge[v]));
+        });
+        Parallel::For(0, topology.FaceCount(), [&](size_t begin, size_t end) {
+
+            for (size_t f = begin; f < end; ++f)
+                mesh.set_halfedge_handle(OpenMesh::FaceHandle(static_cast<int>(f)), OpenMesh::HalfedgeHandle(topology.faceHalfedge[f]));
+        });
+    }
+
+    namespace Detail {
+
+        template <class Mesh>
+        bool HasDeletedElements(const Mesh& mesh) {
+
+            bool deleted = false;
+            auto scan = [&](bool has, size_t count, auto handle) {
+
+                if (!has || deleted) return;
+                std::vector<char> found(Parallel::Concurrency(), 0);
+                Parallel::ForChunks(count, found.size(), [&](size_t chunk, size_t begin, size_t end) {
+
+                    for (size_t i = begin; i < end && !found[chunk]; ++i) found[chunk] = mesh.status(handle(static_cast<int>(i))).deleted();
+                });
+                for (char f : found) deleted = deleted || f;
+            };
+            scan(mesh.has_vertex_status(), mesh.n_vertices(), [](int i) { return OpenMesh::VertexHandle(i); });
+            scan(mesh.has_edge_status(), mesh.n_edges(), [](int i) { return OpenMesh::EdgeHandle(i); });
+            scan(mesh.has_face_status(), mesh.n_faces(), [](int i) { return OpenMesh::FaceHandle(i); });
+            return deleted;
+        }
+
+        // true if every face has `valence` corners, or any valence when it is 0
+        inline bool HasFaceValence(const HalfedgeTopology& topology, int valence) {
+
+            std::vector<char> other(Parallel::Concurrency(), 0);
+            Parallel::ForChunks(topology.FaceCount(), other.size(), [&](size_t chunk, size_t begin, size_t end) {
+
+                for (size_t f = begin; f < end && !other[chunk]; ++f) {
+
+                    const int h = topology.faceHalfedge[f];
+                    if (h < 0) other[chunk] = 1;
+                    else if (valence) other[chunk] = topology.halfedgeNext[topology.halfedgeNext[topology.halfedgeNext[h]]] != h;
+                }
+            });
+            for (char o : other)
+                if (o) return false;
+            return true;
+        }
+
+        inline bool HasBoundary(const HalfedgeTopology& topology) {
+
+            std::vector<char> open(Parallel::Concurrency(), 0);
+            Parallel::ForChunks(topology.halfedgeFace.size(), open.size(), [&](size_t chunk, size_t begin, size_t end) {
+
+                for (size_t h = begin; h < end && !open[chunk]; ++h) open[chunk] = topology.halfedgeFace[h] < 0;
+            });
+            for (char o : open)
+                if (o) return true;
+            return false;
+        }
+
+        // the OpenMesh subdivider itself, for input the parallel path does not cover
+        template <class Mesh, typename Real>
+        bool SubdivideSerial(Mesh& mesh, SubdivisionScheme scheme, size_t levels, bool updatePoints) {
+
+            namespace Uniform = OpenMesh::Subdivider::Uniform;
+
+            bool done = false;
+            if (scheme == SubdivisionScheme::CatmullClark) {
+
+                Uniform::CatmullClarkT<Mesh, Real> subdivider;
+                done = subdivider(mesh, levels, updatePoints);
+            }
+            else if constexpr (Mesh::IsTriMesh) {
+
+                if (scheme == SubdivisionScheme::Loop) {
+
+                    Uniform::LoopT<Mesh, Real> subdivider;
+                    done = subdivider(mesh, levels, updatePoints);
+                }
+                else {
+
+                    Uniform::Sqrt3T<Mesh, Real> subdivider;
+                    done = subdivider(mesh, levels, updatePoints);
+                }
+            }
+            else {
+
+                fprintf(stderr, "Subdivide: Loop and Sqrt3 subdivision need a triangle mesh\n");
+                return false;
+            }
+
+            if (levels) TouchTopology(mesh);
+            return done;
+        }
+    }
+
+    // Parallel replacement for running LoopT, CatmullClarkT or Sqrt3T `levels` times on a mesh, with
+    // the same result: vertex, edge, face and halfedge numbering, positions to the bit and the
+    // properties of old elements. Connectivity and points of all levels are generated in flat arrays
+    // and the mesh is resized once at the end. Meshes with deleted elements, Loop and Sqrt3 on faces
+    // that are not triangles and Sqrt3 beyond one level on open meshes (odd generations split the
+    // boundary) go through the OpenMesh subdivider. Catmull-Clark normals are refreshed with
+    // UpdateNormals, which sums vertex normals in face order and may differ from update_normals
+    // in the last bit.
+    template <class Mesh, typename Real = double>
+    bool Subdivide(Mesh& mesh, SubdivisionScheme scheme, size_t levels, bool updatePoints = true) {
+
+        using Point = typename Mesh::Point;
+
+        HalfedgeTopology topology = ReadHalfedgeTopology(mesh);
+
+        bool parallel = !Detail::HasDeletedElements(mesh);
+        if (parallel && scheme != SubdivisionScheme::CatmullClark) parallel = Detail::HasFaceValence(topology, 3);
+        else if (parallel) parallel = Detail::HasFaceValence(topology, 0);
+        if (parallel && scheme == SubdivisionScheme::Sqrt3 && levels > 1) parallel = !Detail::HasBoundary(topology);
+        if (!parallel) return Detail::SubdivideSerial<Mesh, Real>(mesh, scheme, levels, updatePoints);
+
+        std::vector<Point> points(mesh.points(), mesh.points() + mesh.n_vertices()), refined;
+        size_t taggedEdges = 0;
+        for (size_t level = 0; level < levels; ++level) {
+
+            switch (scheme) {
+
+            case SubdivisionScheme::Loop:
+                RefineLoopPoints<Point, typename Mesh::Normal, Real>(topology, updatePoints, points, refined);
+                break;
+            case SubdivisionScheme::CatmullClark:
+                RefineCatmullClarkPoints<Point, Real>(topology, updatePoints, points, refined);
+                break;
+            case SubdivisionScheme::Sqrt3:
+                RefineSqrt3Points<Point, Real>(topology, points, refined);
+                break;
+            }
+
+            taggedEdges = topology.EdgeCount();
+            topology = RefineTopology(topology, scheme);
+            points.swap(refined);
+        }
+
+        if (levels) {
+
+            WriteHalfedgeTopology(mesh, topology);
+            mesh.property(mesh.points_pph()).data_vector().swap(points);
+
+            // Sqrt3T tags the old edges of every level and leaves the tags set
+            if (scheme == SubdivisionScheme::Sqrt3 && mesh.has_edge_status()) {
+
+                Parallel::For(0, taggedEdges, [&](size_t begin, size_t end) {
+
+                    for (size_t e = begin; e < end; ++e) mesh.status(OpenMesh::EdgeHandle(static_cast<int>(e))).set_tagged(true);
+                });
+            }
+            TouchTopology(mesh);
+        }
+
+        // quads on a TriMesh do not fit the triangle corner layout of the normal topology
+        if (scheme == SubdivisionScheme::CatmullClark) {
+
+            if constexpr (Mesh::IsTriMesh) mesh.update_normals();
+            else UpdateNormals(mesh);
+        }
+        return true;
+    }
+}
+
+#endif // !SUBDIVISION_H
@@ -0,0 +1,328 @@
+#include "subdivision_stencils.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <utility>
+
+#include "../utils/parallel.h"
+
+namespace {
+
+    using MeshTools::HalfedgeTopology;
+    using MeshTools::SubdivisionScheme;
+    namespace Detail = MeshTools::Detail;
+
+    using Matrix = Eigen::SparseMatrix<float, Eigen::RowMajor, int>;
+    using Entry = std::pair<int, double>;   // parent vertex, weight
+    using Lane = MeshTools::SubdivisionStencils::Lane;
+
+    template <typename Func>
+    void ForFaceVertices(const HalfedgeTopology& parent, int f, Func&& func) {
+
+        const int start = parent.faceHalfedge[f];
+        int h = start;
+        do {
+
+            func(parent.halfedgeVertex[h]);
+            h = parent.halfedgeNext[h];
+        } while (h != start);
+    }
+
+    void AddFacePoint(const HalfedgeTopology& parent, int f, double weight, std::vector<Entry>& row) {
+
+        int valence = 0;
+        ForFaceVertices(parent, f, [&](int) { ++valence; });
+        ForFaceVertices(parent, f, [&](int v) { row.push_back({ v, weight / valence }); });
+    }
+
+    // the rules of RefineLoopPoints with updatePoints
+    void LoopRow(const HalfedgeTopology& parent, const std::vector<std::pair<double, double>>& weights, size_t r,
+                 std::vector<Entry>& row) {
+
+        const size_t V = parent.vertexCount;
+        if (r < V) {
+
+            const int v = static_cast<int>(r);
+            const int heh = parent.vertexHalfedge[v];
+            if (heh < 0) {
+
+                row.push_back({ v, 1.0 });
+            }
+            else if (Detail::IsBoundaryVertex(parent, v)) {
+
+                row.push_back({ v, 6.0 / 8.0 });
+                row.push_back({ parent.halfedgeVertex[heh], 1.0 / 8.0 });
+                row.push_back({ parent.halfedgeVertex[parent.halfedgePrev[heh] ^ 1], 1.0 / 8.0 });
+            }
+            else {
+
+                size_t valence = 0;
+                Detail::ForOutgoing(parent, v, [&](int) { ++valence; });
+                const std::pair<double, double> w = valence < weights.size() ? weights[valence] : Detail::LoopWeight<double>(valence);
+                row.push_back({ v, w.first });
+                Detail::ForOutgoing(parent, v, [&](int h) { row.push_back({ parent.halfedgeVertex[h], w.second }); });
+            }
+            return;
+        }
+
+        const int heh = static_cast<int>(r - V) * 2;
+        if (Detail::IsBoundaryEdge(parent, heh)) {
+
+            row.push_back({ parent.halfedgeVertex[heh], 0.5 });
+            row.push_back({ parent.halfedgeVertex[heh + 1], 0.5 });
+        }
+        else {
+
+            row.push_back({ parent.halfedgeVertex[heh], 3.0 / 8.0 });
+            row.push_back({ parent.halfedgeVertex[heh + 1], 3.0 / 8.0 });
+            row.push_back({ parent.halfedgeVertex[parent.halfedgeNext[heh]], 1.0 / 8.0 });
+            row.push_back({ parent.halfedgeVertex[parent.halfedgeNext[heh + 1]], 1.0 / 8.0 });
+        }
+    }
+
+    // the rules of RefineCatmullClarkPoints with updatePoints, face points expanded to their corners
+    void CatmullClarkRow(const HalfedgeTopology& parent, size_t r, std::vector<Entry>& row) {
+
+        const size_t V = parent.vertexCount, E = parent.EdgeCount();
+        if (r < V) {
+
+            const int v = static_cast<int>(r);
+            if (Detail::IsBoundaryVertex(parent, v)) {
+
+                // (v + boundary edge midpoints) / 3
+                row.push_back({ v, 1.0 / 3.0 });
+                Detail::ForOutgoing(parent, v, [&](int h) {
+
+                    if (!Detail::IsBoundaryEdge(parent, h)) return;
+                    row.push_back({ v, 1.0 / 6.0 });
+                    row.push_back({ parent.halfedgeVertex[h], 1.0 / 6.0 });
+                });
+                return;
+            }
+
+            double valence = 0.0;
+            Detail::ForOutgoing(parent, v, [&](int) { valence += 1.0; });
+            const double ring = 1.0 / (valence * valence);
+            row.push_back({ v, (valence - 2.0) / valence });
+            Detail::ForOutgoing(parent, v, [&](int h) {
+
+                row.push_back({ parent.halfedgeVertex[h], ring });
+                if (parent.halfedgeFace[h] >= 0) AddFacePoint(parent, parent.halfedgeFace[h], ring, row);
+            });
+            return;
+        }
+
+        if (r < V + E) {
+
+            const int heh = static_cast<int>(r - V) * 2;
+            if (Detail::IsBoundaryEdge(parent, heh)) {
+
+                row.push_back({ parent.halfedgeVertex[heh], 0.5 });
+                row.push_back({ parent.halfedgeVertex[heh + 1], 0.5 });
+            }
+            else {
+
+                row.push_back({ parent.halfedgeVertex[heh], 0.25 });
+                row.push_back({ parent.halfedgeVertex[heh + 1], 0.25 });
+                AddFacePoint(parent, parent.halfedgeFace[heh], 0.25, row);
+                AddFacePoint(parent, parent.halfedgeFace[heh + 1], 0.25, row);
+            }
+            return;
+        }
+
+        AddFacePoint(parent, static_cast<int>(r - V - E), 1.0, row);
+    }
+
+    // the rules of RefineSqrt3Points
+    void Sqrt3Row(const HalfedgeTopology& parent, const std::vector<std::pair<double, double>>& weights, size_t r,
+                  std::vector<Entry>& row) {
+
+        const size_t V = parent.vertexCount;
+        if (r >= V) {
+
+            AddFacePoint(parent, static_cast<int>(r - V), 1.0, row);
+            return;
+        }
+
+        const int v = static_cast<int>(r);
+        if (Detail::IsBoundaryVertex(parent, v)) {
+
+            row.push_back({ v, 1.0 });
+            return;
+        }
+
+        size_t valence = 0;
+        Detail::ForOutgoing(parent, v, [&](int) { ++valence; });
+        const std::pair<double, double> w = valence < weights.size() ? weights[valence] : Detail::Sqrt3Weight<double>(valence);
+        row.push_back({ v, w.first });
+        Detail::ForOutgoing(parent, v, [&](int h) { row.push_back({ parent.halfedgeVertex[h], w.second }); });
+    }
+
+    // sorted by parent vertex, repeated vertices summed
+    void MergeRow(std::vector<Entry>& row) {
+
+        std::sort(row.begin(), row.end(), [](const Entry& a, const Entry& b) { return a.first < b.first; });
+        size_t n = 0;
+        for (size_t i = 0; i < row.size(); ++i) {
+
+            if (n && row[n - 1].first == row[i].first) row[n - 1].second += row[i].second;
+            else row[n++] = row[i];
+        }
+        row.resize(n);
+    }
+
+    // one CSR row per refined vertex: sizes in a first pass, then the weights straight into the matrix
+    template <typename RowFunc>
+    Matrix BuildLevel(size_t rows, size_t columns, RowFunc&& rowFunc) {
+
+        std::vector<int> offsets(rows + 1, 0);
+        Parallel::For(0, rows, [&](size_t begin, size_t end) {
+
+            std::vector<Entry> row;
+            for (size_t r = begin; r < end; ++r) {
+
+                row.clear();
+                rowFunc(r, row);
+                MergeRow(row);
+                offsets[r] = static_cast<int>(row.size());
+            }
+        }, 1024);
+        const int nonZeros = Parallel::ExclusiveScan(offsets);
+
+        Matrix matrix(static_cast<Eigen::Index>(rows), static_cast<Eigen::Index>(columns));
+        matrix.resizeNonZeros(nonZeros);
+        std::copy(offsets.begin(), offsets.end(), matrix.outerIndexPtr());
+        int* inner = matrix.innerIndexPtr();
+        float* values = matrix.valuePtr();
+        Parallel::For(0, rows, [&](size_t begin, size_t end) {
+
+            std::vector<Entry> row;
+            for (size_t r = begin; r < end; ++r) {
+
+                row.clear();
+                rowFunc(r, row);
+                MergeRow(row);
+                for (size_t i = 0; i < row.size(); ++i) {
+
+                    inner[offsets[r] + i] = row[i].first;
+                    values[offsets[r] + i] = static_cast<float>(row[i].second);
+                }
+            }
+        }, 1024);
+        return matrix;
+    }
+
+    // one weighted sum per row with xyz in a SIMD packet, a multiply-add per weight instead of three
+    inline Lane Row(const int* outer, const int* inner, const float* values, size_t r, const Lane* src) {
+
+        Lane sum = Lane::Zero();
+        for (int i = outer[r]; i < outer[r + 1]; ++i) sum += values[i] * src[inner[i]];
+        return sum;
+    }
+
+    // dst = matrix * src, intermediate levels stay in packets
+    void Apply(const Matrix& matrix, const Lane* src, Lane* dst) {
+
+        const int* outer = matrix.outerIndexPtr();
+        const int* inner = matrix.innerIndexPtr();
+        const float* values = matrix.valuePtr();
+        Parallel::For(0, static_cast<size_t>(matrix.rows()), [&](size_t begin, size_t end) {
+
+            for (size_t r = begin; r < end; ++r) dst[r] = Row(outer, inner, values, r, src);
+        }, 8192);
+    }
+
+    // same for the last level, written as xyz points
+    void Apply(const Matrix& matrix, const Lane* src, float* dst) {
+
+        const int* outer = matrix.outerIndexPtr();
+        const int* inner = matrix.innerIndexPtr();
+        const float* values = matrix.valuePtr();
+        Parallel::For(0, static_cast<size_t>(matrix.rows()), [&](size_t begin, size_t end) {
+
+            for (size_t r = begin; r < end; ++r) {
+
+                const Lane p = Row(outer, inner, values, r, src);
+                dst[r * 3] = p[0];
+                dst[r * 3 + 1] = p[1];
+                dst[r * 3 + 2] = p[2];
+            }
+        }, 8192);
+    }
+}
+
+namespace MeshTools {
+
+    bool SubdivisionStencils::Build(const HalfedgeTopology& cage, SubdivisionScheme scheme, size_t levelCount) {
+
+        bool supported = Detail::HasFaceValence(cage, scheme == SubdivisionScheme::CatmullClark ? 0 : 3);
+        if (supported && scheme == SubdivisionScheme::Sqrt3 && levelCount > 1) supported = !Detail::HasBoundary(cage);
+        if (!supported) {
+
+            fprintf(stderr, "SubdivisionStencils::Build: the scheme cannot refine this cage\n");
+            return false;
+        }
+
+        const auto loopWeights = Detail::ValenceWeights<double>(Detail::WEIGHT_TABLE_SIZE, Detail::LoopWeight<double>);
+        const auto sqrt3Weights = Detail::ValenceWeights<double>(Detail::WEIGHT_TABLE_SIZE, Detail::Sqrt3Weight<double>);
+
+        cageVertexCount = cage.vertexCount;
+        levels.clear();
+        topology = cage;
+        for (size_t level = 0; level < levelCount; ++level) {
+
+            HalfedgeTopology child = RefineTopology(topology, scheme);
+            levels.push_back(BuildLevel(child.vertexCount, topology.vertexCount, [&](size_t r, std::vector<Entry>& row) {
+
+                switch (scheme) {
+
+                case SubdivisionScheme::Loop:
+                    LoopRow(topology, loopWeights, r, row);
+                    break;
+                case SubdivisionScheme::CatmullClark:
+                    CatmullClarkRow(topology, r, row);
+                    break;
+                case SubdivisionScheme::Sqrt3:
+                    Sqrt3Row(topology, sqrt3Weights, r, row);
+                    break;
+                }
+            }));
+            topology = std::move(child);
+        }
+
+        // the cage and the intermediate levels alternate between two packet buffers, the last level goes to the output
+        size_t scratchVertices = cageVertexCount;
+        for (size_t level = 0; level + 1 < levels.size(); ++level) scratchVertices = std::max(scratchVertices, size_t(levels[level].rows()));
+        for (Lanes& buffer : scratch) buffer.assign(levels.empty() ? 0 : scratchVertices, Lane::Zero());
+        return true;
+    }
+
+    void SubdivisionStencils::Evaluate(const float* cage, float* refined) const {
+
+        if (levels.empty()) {
+
+            Parallel::Copy(refined, cage, cageVertexCount * 3 * sizeof(float));
+            return;
+        }
+
+        Lane* src = scratch[0].data();
+        Lane* dst = scratch[1].data();
+        Parallel::For(0, cageVertexCount, [&](size_t begin, size_t end) {
+
+            for (size_t v = begin; v < end; ++v) src[v] = Lane(cage[v * 3], cage[v * 3 + 1], cage[v * 3 + 2], 0.0f);
+        }, 8192);
+        for (size_t level = 0; level + 1 < levels.size(); ++level) {
+
+            Apply(levels[level], src, dst);
+            std::swap(src, dst);
+        }
+        Apply(levels.back(), src, refined);
+    }
+
+    size_t SubdivisionStencils::WeightCount() const {
+
+        size_t count = 0;
+        for (const Matrix& level : levels) count += static_cast<size_t>(level.nonZeros());
+        return count;
+    }
+}
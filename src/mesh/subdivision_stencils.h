@@ -0,0 +1,86 @@
+#ifndef SUBDIVISION_STENCILS_H
+#define SUBDIVISION_STENCILS_H
+
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+#include <Eigen/SparseCore>
+#include <Eigen/StdVector>
+
+#include "halfedge_builder.h"
+#include "subdivision.h"
+#include "../utils/parallel.h"
+
+namespace MeshTools {
+
+    // Subdivision of a fixed cage as sparse matrices: every refined vertex is a weighted sum of the
+    // vertices one level up, with the weights of the Subdivide point rules. The tables are built once
+    // per cage topology; moving the cage afterwards only needs Evaluate, one parallel sparse product
+    // per level, instead of a full subdivision. The levels are kept factorized, a table composed down to
+    // the cage would hold several times more weights for the same surface.
+    class SubdivisionStencils {
+
+        // main functions
+    public:
+        // false if Subdivide would not refine this cage on flat arrays: faces that are not triangles for
+        // Loop and Sqrt3, or Sqrt3 beyond one level on an open cage
+        bool Build(const HalfedgeTopology& cage, SubdivisionScheme scheme, size_t levels);
+
+        // xyz per vertex, refined holds VertexCount() points afterwards. The cage and intermediate levels
+        // go through buffers kept in the table, so one table evaluates one cage at a time.
+        void Evaluate(const float* cage, float* refined) const;
+
+        size_t CageVertexCount() const { return cageVertexCount; }
+        size_t VertexCount() const { return levels.empty() ? cageVertexCount : size_t(levels.back().rows()); }
+        size_t LevelCount() const { return levels.size(); }
+        size_t WeightCount() const;
+
+        // connectivity of the finest level, numbered like the mesh Subdivide leaves
+        const HalfedgeTopology& Topology() const { return topology; }
+
+        // xyz and a zero, one SIMD packet per point
+        using Lane = Eigen::Array4f;
+        using Lanes = std::vector<Lane, Eigen::aligned_allocator<Lane>>;
+
+        // variables
+    private:
+        using Matrix = Eigen::SparseMatrix<float, Eigen::RowMajor, int>;
+
+        size_t cageVertexCount = 0;
+        std::vector<Matrix> levels;
+        HalfedgeTopology topology;
+        mutable Lanes scratch[2];
+    };
+
+    // Refined points of a mesh that came out of Subdivide on the cage the stencils were built for.
+    // Normals are left alone, UpdateNormals with a kept NormalTopology refreshes them.
+    template <class Mesh>
+    void EvaluateStencils(const SubdivisionStencils& stencils, const Mesh& cage, Mesh& refined) {
+
+        using Point = typename Mesh::Point;
+
+        auto& points = refined.property(refined.points_pph()).data_vector();
+        points.resize(stencils.VertexCount());
+        if constexpr (std::is_same_v<Point, OpenMesh::Vec3f>) {
+
+            stencils.Evaluate(cage.points()->data(), points.data()->data());
+        }
+        else {
+
+            std::vector<float> in(cage.n_vertices() * 3), out(stencils.VertexCount() * 3);
+            Parallel::For(0, cage.n_vertices(), [&](size_t begin, size_t end) {
+
+                for (size_t v = begin; v < end; ++v)
+                    for (int k = 0; k < 3; ++k) in[v * 3 + k] = static_cast<float>(cage.points()[v][k]);
+            });
+            stencils.Evaluate(in.data(), out.data());
+            Parallel::For(0, points.size(), [&](size_t begin, size_t end) {
+
+                for (size_t v = begin; v < end; ++v) points[v] = Point(out[v * 3], out[v * 3 + 1], out[v * 3 + 2]);
+            });
+        }
+    }
+}
+
+#endif // !SUBDIVISION_STENCILS_H
@@ -0,0 +1,34 @@
+#ifndef TOPOLOGY_VERSION_H
+#define TOPOLOGY_VERSION_H
+
+#include <cstdint>
+
+#include <OpenMesh/Core/Utils/Property.hh>
+
+namespace MeshTools {
+
+    // Topology version kept as a mesh property. Code that changes connectivity calls TouchTopology so
+    // snapshots taken before can tell they are stale.
+    inline constexpr const char* TOPOLOGY_VERSION_PROPERTY = "<topology_version>";
+
+    template <class Mesh>
+    uint64_t TopologyVersion(const Mesh& mesh) {
+
+        OpenMesh::MPropHandleT<uint64_t> version;
+        return mesh.get_property_handle(version, TOPOLOGY_VERSION_PROPERTY) ? mesh.property(version) : 0;
+    }
+
+    template <class Mesh>
+    void TouchTopology(Mesh& mesh) {
+
+        OpenMesh::MPropHandleT<uint64_t> version;
+        if (!mesh.get_property_handle(version, TOPOLOGY_VERSION_PROPERTY)) {
+
+            mesh.add_property(version, TOPOLOGY_VERSION_PROPERTY);
+            mesh.property(version) = 0;
+        }
+        ++mesh.property(version);
+    }
+}
+
+#endif // !TOPOLOGY_VERSION_H
@@ -0,0 +1,322 @@
+#include "triangle_simplifier.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <utility>
+
+#include "quadric.h"
+#include "../utils/indexed_heap.h"
+#include "../utils/parallel.h"
+
+namespace {
+
+    using MeshTools::Quadric;
+
+    struct Vec {
+
+        double x, y, z;
+
+        Vec operator-(const Vec& o) const { return { x - o.x, y - o.y, z - o.z }; }
+        Vec Cross(const Vec& o) const { return { y * o.z - z * o.y, z * o.x - x * o.z, x * o.y - y * o.x }; }
+        double Dot(const Vec& o) const { return x * o.x + y * o.y + z * o.z; }
+    };
+
+    class Simplifier {
+
+    public:
+        Simplifier(const std::vector<float>& positions, std::vector<uint32_t>& indices, const std::vector<char>& locked)
+            : indices(indices) {
+
+            const size_t vertexCount = positions.size() / 3;
+            const size_t triangleCount = indices.size() / 3;
+
+            points.resize(vertexCount);
+            for (size_t v = 0; v < vertexCount; ++v) points[v] = { positions[v * 3], positions[v * 3 + 1], positions[v * 3 + 2] };
+
+            fixed.assign(vertexCount, 0);
+            for (size_t v = 0; v < std::min(vertexCount, locked.size()); ++v) fixed[v] = locked[v];
+            LockOpenEdges();
+
+            vertexTriangles.resize(vertexCount);
+            for (size_t t = 0; t < triangleCount; ++t)
+                for (int k = 0; k < 3; ++k) vertexTriangles[indices[t * 3 + k]].push_back(static_cast<uint32_t>(t));
+
+            // area weighted plane quadrics, as ModQuadricT
+            std::vector<Quadric> triangleQuadrics(triangleCount);
+            Parallel::For(0, triangleCount, [&](size_t begin, size_t end) {
+
+                for (size_t t = begin; t < end; ++t) {
+
+                    const Vec& p0 = points[indices[t * 3]];
+                    Vec n = (points[indices[t * 3 + 1]] - p0).Cross(points[indices[t * 3 + 2]] - p0);
+                    double area = std::sqrt(n.Dot(n));
+                    if (area > FLT_MIN) {
+
+                        n = { n.x / area, n.y / area, n.z / area };
+                        area *= 0.5;
+                    }
+                    triangleQuadrics[t] = Quadric::FromPlane(n.x, n.y, n.z, -p0.Dot(n), area);
+                }
+            }, 1024);
+            quadrics.resize(vertexCount);
+            Parallel::For(0, vertexCount, [&](size_t begin, size_t end) {
+
+                for (size_t v = begin; v < end; ++v)
+                    for (uint32_t t : vertexTriangles[v]) quadrics[v] += triangleQuadrics[t];
+            }, 1024);
+
+            removed.assign(triangleCount, 0);
+            mark.assign(vertexCount, 0);
+            targets.assign(vertexCount, 0);
+            liveTriangles = triangleCount;
+        }
+
+        size_t Run(size_t targetTriangles) {
+
+            heap.Reset(points.size());
+            for (uint32_t v = 0; v < points.size(); ++v) Evaluate(v);
+
+            std::vector<uint32_t> support;
+            while (!heap.Empty() && liveTriangles > targetTriangles) {
+
+                const uint32_t v0 = heap.Top();
+                heap.Pop();
+
+                const uint32_t v1 = targets[v0];
+                Neighbours(v0, neighbours);
+                if (!IsLegal(v0, v1)) continue;
+
+                support = neighbours;
+                Collapse(v0, v1);
+                for (uint32_t v : support) Evaluate(v);
+            }
+            return liveTriangles;
+        }
+
+        // drop removed triangles and unused vertices
+        void Compact(std::vector<float>& positions) {
+
+            std::vector<uint32_t> remap(points.size(), UINT32_MAX);
+            std::vector<float> compactPositions;
+            std::vector<uint32_t> compactIndices;
+            compactIndices.reserve(liveTriangles * 3);
+            for (size_t t = 0; t < removed.size(); ++t) {
+
+                if (removed[t]) continue;
+                for (int k = 0; k < 3; ++k) {
+
+                    const uint32_t v = indices[t * 3 + k];
+                    if (remap[v] == UINT32_MAX) {
+
+                        remap[v] = static_cast<uint32_t>(compactPositions.size() / 3);
+                        compactPositions.insert(compactPositions.end(), positions.begin() + v * 3, positions.begin() + v * 3 + 3);
+                    }
+                    compactIndices.push_back(remap[v]);
+                }
+            }
+            positions.swap(compactPositions);
+            indices.swap(compactIndices);
+        }
+
+    private:
+        // vertices on edges without exactly two consistently oriented triangles stay where they are
+        void LockOpenEdges() {
+
+            struct Edge {
+
+                uint32_t a, b;
+                bool forward;
+
+                bool operator<(const Edge& o) const { return a != o.a ? a < o.a : b < o.b; }
+            };
+
+            std::vector<Edge> edges(indices.size());
+            for (size_t t = 0; t < indices.size() / 3; ++t) {
+
+                for (int k = 0; k < 3; ++k) {
+
+                    const uint32_t from = indices[t * 3 + k], to = indices[t * 3 + (k + 1) % 3];
+                    edges[t * 3 + k] = { std::min(from, to), std::max(from, to), from < to };
+                }
+            }
+            std::sort(edges.begin(), edges.end());
+
+            for (size_t i = 0; i < edges.size();) {
+
+                size_t j = i + 1;
+                while (j < edges.size() && edges[j].a == edges[i].a && edges[j].b == edges[i].b) ++j;
+                if (j - i != 2 || edges[i].forward == edges[i + 1].forward) fixed[edges[i].a] = fixed[edges[i].b] = 1;
+                i = j;
+            }
+        }
+
+        void Neighbours(uint32_t v, std::vector<uint32_t>& out) const {
+
+            out.clear();
+            for (uint32_t t : vertexTriangles[v])
+                for (int k = 0; k < 3; ++k)
+                    if (indices[t * 3 + k] != v) out.push_back(indices[t * 3 + k]);
+            std::sort(out.begin(), out.end());
+            out.erase(std::unique(out.begin(), out.end()), out.end());
+        }
+
+        bool HasVertex(uint32_t t, uint32_t v) const {
+
+            return indices[t * 3] == v || indices[t * 3 + 1] == v || indices[t * 3 + 2] == v;
+        }
+
+        // same rules as BaseDecimaterT::is_collapse_legal and ModNormalFlippingT, v0 neighbours are in `neighbours`
+        bool IsLegal(uint32_t v0, uint32_t v1) {
+
+            if (fixed[v0] || vertexTriangles[v0].empty()) return false;
+            if (!std::binary_search(neighbours.begin(), neighbours.end(), v1)) return false;
+
+            // link condition: the edge has two triangles and its ends share exactly their opposite vertices
+            ++stamp;
+            for (uint32_t n : neighbours) mark[n] = stamp;
+            common.clear();
+            for (uint32_t t : vertexTriangles[v1]) {
+
+                for (int k = 0; k < 3; ++k) {
+
+                    const uint32_t w = indices[t * 3 + k];
+                    if (w == v1 || mark[w] != stamp) continue;
+                    mark[w] = 0;
+                    common.push_back(w);
+                }
+            }
+            if (common.size() != 2) return false;
+
+            // moving onto a fixed vertex must not join it to another fixed one, they may already share an
+            // edge through triangles this mesh does not have (the other side of a hole or of a cell border)
+            if (fixed[v1]) {
+
+                for (uint32_t n : neighbours)
+                    if (fixed[n] && n != v1 && n != common[0] && n != common[1]) return false;
+            }
+
+            // both opposite vertices of valence three and connected, the collapse would fold a tetrahedron
+            if (vertexTriangles[common[0]].size() == 3 && vertexTriangles[common[1]].size() == 3) {
+
+                Neighbours(common[0], scratch);
+                if (scratch.size() == 3 && std::binary_search(scratch.begin(), scratch.end(), common[1])) return false;
+            }
+
+            // no triangle may flip or degenerate when v0 moves onto v1
+            const Vec& p0 = points[v0];
+            const Vec& p1 = points[v1];
+            for (uint32_t t : vertexTriangles[v0]) {
+
+                if (HasVertex(t, v1)) continue;
+
+                Vec before[3], after[3];
+                for (int k = 0; k < 3; ++k) {
+
+                    const uint32_t v = indices[t * 3 + k];
+                    before[k] = v == v0 ? p0 : points[v];
+                    after[k] = v == v0 ? p1 : points[v];
+                }
+                const Vec n0 = (before[1] - before[0]).Cross(before[2] - before[0]);
+                const Vec n1 = (after[1] - after[0]).Cross(after[2] - after[0]);
+                if (n0.Dot(n1) <= 0.0) return false;
+            }
+            return true;
+        }
+
+        // cheapest legal collapse of v into a neighbour
+        void Evaluate(uint32_t v) {
+
+            if (fixed[v] || vertexTriangles[v].empty()) {
+
+                heap.Remove(v);
+                return;
+            }
+
+            // costs first, the legality tests only until the cheapest legal neighbour is found
+            Neighbours(v, neighbours);
+            candidates.clear();
+            for (uint32_t n : neighbours) {
+
+                const Vec& p = points[n];
+                candidates.push_back({ Quadric::SumError(quadrics[v], quadrics[n], p.x, p.y, p.z), n });
+            }
+            std::sort(candidates.begin(), candidates.end());
+
+            double best = 0.0;
+            uint32_t target = UINT32_MAX;
+            for (const auto& [err, n] : candidates) {
+
+                if (!IsLegal(v, n)) continue;
+
+                best = err;
+                target = n;
+                break;
+            }
+
+            if (target == UINT32_MAX) {
+
+                heap.Remove(v);
+                return;
+            }
+            targets[v] = target;
+            heap.Push(v, static_cast<float>(std::max(best, 0.0)));
+        }
+
+        void Collapse(uint32_t v0, uint32_t v1) {
+
+            for (uint32_t t : vertexTriangles[v0]) {
+
+                if (HasVertex(t, v1)) {
+
+                    // the two triangles on the edge disappear
+                    removed[t] = 1;
+                    --liveTriangles;
+                    for (int k = 0; k < 3; ++k) {
+
+                        const uint32_t v = indices[t * 3 + k];
+                        if (v == v0) continue;
+                        std::vector<uint32_t>& list = vertexTriangles[v];
+                        list.erase(std::find(list.begin(), list.end(), t));
+                    }
+                    continue;
+                }
+
+                for (int k = 0; k < 3; ++k)
+                    if (indices[t * 3 + k] == v0) indices[t * 3 + k] = v1;
+                vertexTriangles[v1].push_back(t);
+            }
+
+            std::vector<uint32_t>().swap(vertexTriangles[v0]);
+            quadrics[v1] += quadrics[v0];
+            heap.Remove(v0);
+        }
+
+        std::vector<uint32_t>& indices;
+        std::vector<Vec> points;
+        std::vector<Quadric> quadrics;
+        std::vector<std::vector<uint32_t>> vertexTriangles;
+        std::vector<char> fixed;
+        std::vector<char> removed;
+        std::vector<uint32_t> targets;
+        size_t liveTriangles = 0;
+        IndexedHeap heap;
+
+        std::vector<uint32_t> neighbours, scratch, common;
+        std::vector<uint32_t> mark;
+        uint32_t stamp = 0;
+        std::vector<std::pair<double, uint32_t>> candidates;
+    };
+}
+
+namespace MeshTools {
+
+    size_t SimplifyTriangles(std::vector<float>& positions, std::vector<uint32_t>& indices, size_t targetTriangles,
+                             const std::vector<char>& locked) {
+
+        Simplifier simplifier(positions, indices, locked);
+        const size_t triangles = simplifier.Run(targetTriangles);
+        simplifier.Compact(positions);
+        return triangles;
+    }
+}
@@ -0,0 +1,22 @@
+#ifndef TRIANGLE_SIMPLIFIER_H
+#define TRIANGLE_SIMPLIFIER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace MeshTools {
+
+    // Quadric error edge collapse on an indexed triangle mesh in flat arrays, without building an
+    // OpenMesh mesh. Collapses follow DecimaterT with ModQuadricT and ModNormalFlippingT: every vertex
+    // keeps its cheapest collapse into a neighbour in an IndexedHeap, vertices move onto the neighbour,
+    // and collapses that would flip a triangle or make an edge non-manifold are skipped.
+    //
+    // Vertices marked in `locked` never move and neither do vertices on open or non-manifold edges, so
+    // the boundary of the input is kept exactly. On return positions and indices hold the simplified
+    // mesh with unused vertices removed. Returns the number of triangles left.
+    size_t SimplifyTriangles(std::vector<float>& positions, std::vector<uint32_t>& indices, size_t targetTriangles,
+                             const std::vector<char>& locked = {});
+}
+
+#endif // !TRIANGLE_SIMPLIFIER_H
@@ -0,0 +1,338 @@
+#include "async_loader.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <string_view>
+
+#include "compressed_mesh.h"
+#include "obj_reader.h"
+#include "ply_reader.h"
+#include "stl_reader.h"
+#include "../utils/mapped_file.h"
+#include "../utils/parallel.h"
+
+namespace {
+
+    constexpr size_t PREVIEW_POINTS = 1 << 16;
+
+    std::string Extension(const std::string& path) {
+
+        const size_t dot = path.find_last_of('.');
+        if (dot == std::string::npos || path.find_first_of("/\\", dot) != std::string::npos) return {};
+
+        std::string ext = path.substr(dot);
+        for (char& c : ext) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        return ext;
+    }
+
+    // the binary readers report ascii files as errors, check before handing them over
+    bool IsBinaryPlyHeader(const char* data, size_t size) {
+
+        const std::string_view head(data, std::min<size_t>(size, 512));
+        return head.substr(0, 3) == "ply" && head.find("format binary_") != std::string_view::npos;
+    }
+
+    // corners of evenly spaced triangles, read in place from the mapping
+    void SampleStl(const char* data, size_t maxPoints, std::vector<float>& points) {
+
+        uint32_t triangleCount;
+        std::memcpy(&triangleCount, data + 80, sizeof(triangleCount));
+
+        const size_t corners = size_t(triangleCount) * 3;
+        const size_t n = std::min(maxPoints, corners);
+        points.resize(n * 3);
+        Parallel::For(0, n, [&](size_t begin, size_t end) {
+
+            for (size_t i = begin; i < end; ++i) {
+
+                const size_t c = corners * i / n;
+                std::memcpy(&points[i * 3], data + 84 + (c / 3) * 50 + 12 + (c % 3) * 12, 3 * sizeof(float));
+            }
+        }, 1024);
+    }
+
+    // OBJ has no index to jump into: probe evenly spaced offsets, keep the vertex lines that start right
+    // after them. Probes landing among faces find nothing, so there are more probes than points.
+    void SampleObj(const char* data, size_t size, size_t maxPoints, std::vector<float>& points) {
+
+        const size_t probes = std::min(size / 32 + 1, maxPoints * 4);
+        const size_t chunks = Parallel::Concurrency();
+        std::vector<std::vector<float>> found(chunks);
+        Parallel::ForChunks(probes, chunks, [&](size_t chunk, size_t begin, size_t end) {
+
+            for (size_t i = begin; i < end; ++i) {
+
+                const char* p = static_cast<const char*>(std::memchr(data + size * i / probes, '\n', size - size * i / probes));
+                if (p == nullptr || size_t(data + size - p) < 4 || p[1] != 'v' || p[2] != ' ') continue;
+
+                const char* cursor = p + 3;
+                const char* last = data + size;
+                float xyz[3];
+                int k = 0;
+                for (; k < 3; ++k) {
+
+                    while (cursor < last && (*cursor == ' ' || *cursor == '\t')) ++cursor;
+                    const auto result = std::from_chars(cursor, last, xyz[k]);
+                    if (result.ec != std::errc()) break;
+                    cursor = result.ptr;
+                }
+                if (k == 3) found[chunk].insert(found[chunk].end(), xyz, xyz + 3);
+            }
+        });
+
+        points.clear();
+        for (const auto& chunk : found) points.insert(points.end(), chunk.begin(), chunk.end());
+        points.resize(std::min(points.size(), maxPoints * 3));
+    }
+}
+
+namespace MeshIO {
+
+    bool ReadMeshFile(const std::string& path, MeshBuffer& mesh) {
+
+        const std::string ext = Extension(path);
+        if (ext == ".obj") return ReadObj(path, mesh);
+        if (ext == ".omz") return ReadCompressedMesh(path, mesh);
+        if (ext != ".stl" && ext != ".ply") return false;
+
+        MappedFile file;
+        if (!file.Open(path)) return false;
+        if (ext == ".stl") return IsBinaryStl(file.Data(), file.Size()) && ReadBinaryStl(path, mesh);
+        return IsBinaryPlyHeader(file.Data(), file.Size()) && ReadBinaryPly(path, mesh);
+    }
+
+    bool SamplePoints(const std::string& path, size_t maxPoints, std::vector<float>& points) {
+
+        points.clear();
+        const std::string ext = Extension(path);
+        if (ext != ".stl" && ext != ".obj" && ext != ".ply" && ext != ".omz") return false;
+
+        MappedFile file;
+        if (!file.Open(path)) return false;
+
+        if (ext == ".stl") {
+
+            if (!IsBinaryStl(file.Data(), file.Size())) return false;
+            SampleStl(file.Data(), maxPoints, points);
+        }
+        else if (ext == ".ply") {
+
+            if (!IsBinaryPlyHeader(file.Data(), file.Size())) return false;
+            SampleBinaryPly(file.Data(), file.Size(), maxPoints, points);
+        }
+        else if (ext == ".omz") {
+
+            SampleCompressedMesh(reinterpret_cast<const uint8_t*>(file.Data()), file.Size(), maxPoints, points);
+        }
+        else {
+
+            SampleObj(file.Data(), file.Size(), maxPoints, points);
+        }
+        return !points.empty();
+    }
+
+    void SamplePoints(const MeshBuffer& mesh, size_t maxPoints, std::vector<float>& points) {
+
+        const size_t vertexCount = mesh.VertexCount();
+        const size_t n = std::min(maxPoints, vertexCount);
+        points.resize(n * 3);
+        Parallel::For(0, n, [&](size_t begin, size_t end) {
+
+            for (size_t i = begin; i < end; ++i) std::memcpy(&points[i * 3], &mesh.positions[vertexCount * i / n * 3], 3 * sizeof(float));
+        });
+    }
+
+    void PrepareLoadedMesh(LoadedMesh& loaded) {
+
+        const MeshBuffer& buffer = loaded.buffer;
+        const size_t vertexCount = buffer.VertexCount();
+        const size_t faceCount = buffer.FaceCount();
+
+        // fan triangulation, offsets first so faces are written in parallel
+        std::vector<size_t> offsets(faceCount + 1, 0);
+        Parallel::For(0, faceCount, [&](size_t begin, size_t end) {
+
+            for (size_t f = begin; f < end; ++f) {
+
+                const size_t corners = buffer.FaceEnd(f) - buffer.FaceBegin(f);
+                offsets[f] = corners >= 3 ? (corners - 2) * 3 : 0;
+            }
+        });
+        loaded.triangles.resize(Parallel::ExclusiveScan(offsets));
+        Parallel::For(0, faceCount, [&](size_t begin, size_t end) {
+
+            for (size_t f = begin; f < end; ++f) {
+
+                const size_t first = buffer.FaceBegin(f);
+                uint32_t* out = loaded.triangles.data() + offsets[f];
+                for (size_t c = first + 2; c < buffer.FaceEnd(f); ++c) {
+
+                    *out++ = buffer.indices[first];
+                    *out++ = buffer.indices[c - 1];
+                    *out++ = buffer.indices[c];
+                }
+            }
+        });
+
+        // area weighted normals: face normals first, then gathered per vertex through a vertex to
+        // triangle table, so no two workers write to the same vertex
+        if (buffer.vertexNormals.size() == vertexCount * 3) {
+
+            loaded.normals = buffer.vertexNormals;
+        }
+        else {
+
+            const std::vector<uint32_t>& triangles = loaded.triangles;
+            const size_t triangleCount = triangles.size() / 3;
+            std::vector<float> faceNormals(triangleCount * 3);
+            Parallel::For(0, triangleCount, [&](size_t begin, size_t end) {
+
+                for (size_t t = begin; t < end; ++t) {
+
+                    const float* a = &buffer.positions[size_t(triangles[t * 3]) * 3];
+                    const float* b = &buffer.positions[size_t(triangles[t * 3 + 1]) * 3];
+                    const float* c = &buffer.positions[size_t(triangles[t * 3 + 2]) * 3];
+                    const float e0[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+                    const float e1[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+                    faceNormals[t * 3] = e0[1] * e1[2] - e0[2] * e1[1];
+                    faceNormals[t * 3 + 1] = e0[2] * e1[0] - e0[0] * e1[2];
+                    faceNormals[t * 3 + 2] = e0[0] * e1[1] - e0[1] * e1[0];
+                }
+            });
+
+            std::vector<uint32_t> vertexOffsets(vertexCount + 1, 0);
+            for (uint32_t v : triangles) ++vertexOffsets[v];
+            Parallel::ExclusiveScan(vertexOffsets);
+            std::vector<uint32_t> incident(triangles.size());
+            std::vector<uint32_t> cursor(vertexOffsets.begin(), vertexOffsets.end() - 1);
+            for (size_t c = 0; c < triangles.size(); ++c) incident[cursor[triangles[c]]++] = static_cast<uint32_t>(c / 3);
+
+            loaded.normals.resize(vertexCount * 3);
+            Parallel::For(0, vertexCount, [&](size_t begin, size_t end) {
+
+                for (size_t v = begin; v < end; ++v) {
+
+                    float n[3] = { 0.0f, 0.0f, 0.0f };
+                    for (uint32_t i = vertexOffsets[v]; i < vertexOffsets[v + 1]; ++i)
+                        for (int k = 0; k < 3; ++k) n[k] += faceNormals[size_t(incident[i]) * 3 + k];
+
+                    const float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+                    for (int k = 0; k < 3; ++k) loaded.normals[v * 3 + k] = length > 0.0f ? n[k] / length : 0.0f;
+                }
+            });
+        }
+
+        struct Bounds { float min[3], max[3]; };
+        const Bounds empty = { { INFINITY, INFINITY, INFINITY }, { -INFINITY, -INFINITY, -INFINITY } };
+        const Bounds bounds = Tasks::ParallelReduce(0, vertexCount, 65536, empty, [&](size_t begin, size_t end) {
+
+            Bounds b = empty;
+            for (size_t v = begin; v < end; ++v) {
+
+                for (int k = 0; k < 3; ++k) {
+
+                    b.min[k] = std::min(b.min[k], buffer.positions[v * 3 + k]);
+                    b.max[k] = std::max(b.max[k], buffer.positions[v * 3 + k]);
+                }
+            }
+            return b;
+        }, [](Bounds a, const Bounds& b) {
+
+            for (int k = 0; k < 3; ++k) {
+
+                a.min[k] = std::min(a.min[k], b.min[k]);
+                a.max[k] = std::max(a.max[k], b.max[k]);
+            }
+            return a;
+        });
+        for (int k = 0; k < 3; ++k) {
+
+            loaded.boundsMin[k] = vertexCount ? bounds.min[k] : 0.0f;
+            loaded.boundsMax[k] = vertexCount ? bounds.max[k] : 0.0f;
+        }
+    }
+
+    AsyncMeshLoader::~AsyncMeshLoader() {
+
+        // the readers may hold references into their caller, nothing may outlive the loader
+        Cancel();
+        group.Wait();
+    }
+
+    void AsyncMeshLoader::Start(const std::string& file, Reader reader) {
+
+        Cancel();
+
+        token = Tasks::CancellationToken();
+        stage = LoadStage::Parsing;
+        path = file;
+        startTime = std::chrono::steady_clock::now();
+        preview.clear();
+        previewSent = false;
+        mesh.reset();
+
+        const Tasks::CancellationToken current = token;
+        group.Run([this, current, file]() {
+
+            auto points = std::make_shared<std::vector<float>>();
+            if (current.IsCancelled() || !SamplePoints(file, PREVIEW_POINTS, *points)) return;
+
+            Tasks::PostToMain([this, current, points]() {
+
+                // the parse may have won the race
+                if (current.IsCancelled() || stage != LoadStage::Parsing) return;
+                preview = std::move(*points);
+                previewSent = true;
+            });
+        }, Tasks::Priority::High);
+
+        group.Run([this, current, file, reader = std::move(reader)]() {
+
+            auto loaded = std::make_shared<LoadedMesh>();
+            const bool ok = reader(file, loaded->buffer);
+            if (current.IsCancelled()) return;
+
+            auto points = std::make_shared<std::vector<float>>();
+            if (ok) {
+
+                SamplePoints(loaded->buffer, PREVIEW_POINTS, *points);
+                PrepareLoadedMesh(*loaded);
+            }
+            Tasks::PostToMain([this, current, ok, loaded, points]() {
+
+                if (current.IsCancelled()) return;
+
+                endTime = std::chrono::steady_clock::now();
+                stage = ok ? LoadStage::Ready : LoadStage::Failed;
+                if (ok) {
+
+                    if (!previewSent) preview = std::move(*points);
+                    previewSent = true;
+                    mesh = loaded;
+                }
+            });
+        });
+    }
+
+    void AsyncMeshLoader::Cancel() {
+
+        // a parse in flight, or a parsed mesh the caller may still be uploading
+        token.Cancel();
+        if (stage == LoadStage::Parsing || stage == LoadStage::Ready) {
+
+            stage = LoadStage::Cancelled;
+            endTime = std::chrono::steady_clock::now();
+            preview.clear();
+            mesh.reset();
+        }
+    }
+
+    double AsyncMeshLoader::Seconds() const {
+
+        const auto end = stage == LoadStage::Parsing ? std::chrono::steady_clock::now() : endTime;
+        return std::chrono::duration<double>(end - startTime).count();
+    }
+}
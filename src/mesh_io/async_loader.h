@@ -0,0 +1,133 @@
+#ifndef ASYNC_LOADER_H
+#define ASYNC_LOADER_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <OpenMesh/Core/IO/MeshIO.hh>
+
+#include "mesh_buffer.h"
+#include "mesh_import.h"
+#include "../utils/task_system.h"
+
+namespace MeshIO {
+
+    // what a finished load hands to the render thread
+    struct LoadedMesh {
+
+        MeshBuffer buffer;
+        std::vector<float> normals;         // xyz per vertex, the file's or area weighted
+        std::vector<uint32_t> triangles;    // faces fanned into triangles
+        float boundsMin[3] = { 0.0f, 0.0f, 0.0f };
+        float boundsMax[3] = { 0.0f, 0.0f, 0.0f };
+    };
+
+    enum class LoadStage { Idle, Parsing, Ready, Failed, Cancelled };
+
+    // the fast readers by extension (obj, binary stl, binary ply, omz), false for anything they do not take
+    bool ReadMeshFile(const std::string& path, MeshBuffer& mesh);
+
+    // up to maxPoints xyz positions picked from the file without parsing all of it, for binary STL, OBJ,
+    // binary PLY and omz; false for formats that have no cheap way in
+    bool SamplePoints(const std::string& path, size_t maxPoints, std::vector<float>& points);
+    void SamplePoints(const MeshBuffer& mesh, size_t maxPoints, std::vector<float>& points);
+
+    // normals, triangles and bounds for drawing, run on the worker after parsing
+    void PrepareLoadedMesh(LoadedMesh& loaded);
+
+    // Loads one file at a time off the render thread. A point sampled preview is taken first at high
+    // priority, so something can be drawn long before the parse is over; the parsed mesh follows. Both
+    // arrive through Tasks::RunMainThreadTasks, so the loader is only touched by the render thread.
+    // Readers cannot be interrupted: cancelling drops the load at once, the worker finishes the read
+    // in the background and throws it away.
+    class AsyncMeshLoader {
+
+        // constructor
+    public:
+        using Reader = std::function<bool(const std::string& path, MeshBuffer& mesh)>;
+
+        AsyncMeshLoader() = default;
+        ~AsyncMeshLoader();
+
+        AsyncMeshLoader(const AsyncMeshLoader&) = delete;
+        AsyncMeshLoader& operator=(const AsyncMeshLoader&) = delete;
+
+        // main functions
+    public:
+        // cancels the load in flight; Cancel also marks a finished load as cancelled, e.g. during its upload
+        void Start(const std::string& path, Reader reader = ReadMeshFile);
+        void Cancel();
+
+        LoadStage Stage() const { return stage; }
+        const std::string& Path() const { return path; }
+        double Seconds() const;
+
+        // handed over once, empty afterwards
+        bool HasPreview() const { return !preview.empty(); }
+        std::vector<float> TakePreview() { return std::move(preview); }
+        std::shared_ptr<LoadedMesh> TakeMesh() { return std::move(mesh); }
+
+        // variables
+    private:
+        LoadStage stage = LoadStage::Idle;
+        std::string path;
+        std::chrono::steady_clock::time_point startTime, endTime;
+
+        std::vector<float> preview;
+        bool previewSent = false;
+        std::shared_ptr<LoadedMesh> mesh;
+
+        Tasks::CancellationToken token;
+        Tasks::TaskGroup group;
+    };
+
+    // Reader for AsyncMeshLoader that also builds `mesh` on the worker: fast readers first, then the
+    // OpenMesh IOManager for everything else. `opt` asks for attributes like read_mesh does and holds
+    // what was read afterwards; both have to outlive the load.
+    template <class Mesh>
+    AsyncMeshLoader::Reader OpenMeshReader(Mesh& mesh, OpenMesh::IO::Options& opt) {
+
+        return [&mesh, &opt](const std::string& path, MeshBuffer& buffer) {
+
+            if (ReadMeshFile(path, buffer)) return Import(buffer, mesh, opt);
+
+            mesh.clear();
+            if (!OpenMesh::IO::read_mesh(mesh, path, opt)) return false;
+
+            // flat copy for drawing, polygons stay polygons
+            buffer.Clear();
+            buffer.positions.resize(mesh.n_vertices() * 3);
+            Parallel::For(0, mesh.n_vertices(), [&](size_t begin, size_t end) {
+
+                for (size_t v = begin; v < end; ++v) {
+
+                    const auto& p = mesh.point(OpenMesh::VertexHandle(static_cast<int>(v)));
+                    for (int k = 0; k < 3; ++k) buffer.positions[v * 3 + k] = static_cast<float>(p[k]);
+                }
+            });
+
+            bool triangles = true;
+            for (const auto fh : mesh.faces()) {
+
+                const size_t first = buffer.indices.size();
+                for (const auto vh : mesh.fv_range(fh)) buffer.indices.push_back(static_cast<uint32_t>(vh.idx()));
+                if (buffer.indices.size() - first != 3 && triangles) {
+
+                    // switch to explicit offsets, every face so far was a triangle
+                    triangles = false;
+                    for (size_t c = 0; c < first; c += 3) buffer.faceOffsets.push_back(static_cast<uint32_t>(c));
+                }
+                if (!triangles) buffer.faceOffsets.push_back(static_cast<uint32_t>(first));
+            }
+            if (!triangles) buffer.faceOffsets.push_back(static_cast<uint32_t>(buffer.indices.size()));
+            return true;
+        };
+    }
+}
+
+#endif // !ASYNC_LOADER_H
@@ -0,0 +1,1314 @@
+#include "compressed_mesh.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+#include "../mesh/halfedge_builder.h"
+#include "../utils/entropy_coder.h"
+#include "../utils/mapped_file.h"
+#include "../utils/parallel.h"
+
+namespace {
+
+    using MeshIO::CompressedMeshChunkEntry;
+    using MeshIO::CompressedMeshHeader;
+
+    constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+    constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+    // gate symbols: nothing left behind the front edge, else the valence of the face across minus two
+    constexpr uint8_t GATE_BOUNDARY = 0;
+    constexpr uint8_t GATE_ESCAPE = 255;    // valence follows as an index value
+
+    // how a corner of a new face is coded
+    constexpr uint8_t CORNER_NEW = 0;
+    constexpr uint8_t CORNER_LEFT = 1;      // start of the front edge left of the gate
+    constexpr uint8_t CORNER_RIGHT = 2;     // end of the front edge right of the gate
+    constexpr uint8_t CORNER_INDEX = 3;     // back reference to an earlier vertex
+
+    constexpr int MORTON_BITS = 10;
+
+    // chunks SampleCompressedMesh decodes at most
+    constexpr size_t SAMPLED_CHUNKS = 16;
+
+    // Bound on the vertices, faces or corners a chunk codes per byte, checked before anything is allocated.
+    // Even a regular grid, the best case for the prediction, stays below 20 corners a byte.
+    constexpr uint64_t MAX_ITEMS_PER_BYTE = 128;
+
+    // value predicted as a + b - c from earlier vertices of the chunk, the middle of the range without any
+    struct Prediction {
+
+        uint32_t a = NONE, b = NONE, c = NONE;
+    };
+
+    inline uint32_t Predict(const uint32_t* values, size_t stride, size_t k, const Prediction& p, uint32_t maxValue) {
+
+        if (p.a == NONE) return maxValue / 2 + 1;
+        const int64_t v = int64_t(values[p.a * stride + k]) + values[p.b * stride + k] - values[p.c * stride + k];
+        return static_cast<uint32_t>(std::clamp<int64_t>(v, 0, maxValue));
+    }
+
+    inline uint32_t Parent(const uint32_t* values, size_t stride, size_t k, const Prediction& p, uint32_t maxValue) {
+
+        return p.a == NONE ? maxValue / 2 + 1 : values[p.a * stride + k];
+    }
+
+    inline uint32_t Quantize(float value, float min, float step, uint32_t maxValue) {
+
+        const double q = step > 0.0f ? std::round((double(value) - min) / step) : 0.0;
+        return q >= 0.0 ? static_cast<uint32_t>(std::min(q, double(maxValue))) : 0;
+    }
+
+    inline uint32_t MaxValue(uint32_t bits) { return static_cast<uint32_t>((uint64_t(1) << bits) - 1); }
+
+    // octahedral map of the unit sphere onto the square
+    void EncodeOctahedral(const float* n, uint32_t maxValue, uint32_t* q) {
+
+        const float l1 = std::fabs(n[0]) + std::fabs(n[1]) + std::fabs(n[2]);
+        float u = l1 > 0.0f ? n[0] / l1 : 0.0f;
+        float v = l1 > 0.0f ? n[1] / l1 : 0.0f;
+        if (l1 > 0.0f && n[2] < 0.0f) {
+
+            const float fu = (1.0f - std::fabs(v)) * (u >= 0.0f ? 1.0f : -1.0f);
+            const float fv = (1.0f - std::fabs(u)) * (v >= 0.0f ? 1.0f : -1.0f);
+            u = fu;
+            v = fv;
+        }
+        q[0] = Quantize(u, -1.0f, 2.0f / maxValue, maxValue);
+        q[1] = Quantize(v, -1.0f, 2.0f / maxValue, maxValue);
+    }
+
+    void DecodeOctahedral(const uint32_t* q, uint32_t maxValue, float* n) {
+
+        float u = float(q[0]) / maxValue * 2.0f - 1.0f;
+        float v = float(q[1]) / maxValue * 2.0f - 1.0f;
+        const float z = 1.0f - std::fabs(u) - std::fabs(v);
+        if (z < 0.0f) {
+
+            const float fu = (1.0f - std::fabs(v)) * (u >= 0.0f ? 1.0f : -1.0f);
+            const float fv = (1.0f - std::fabs(u)) * (v >= 0.0f ? 1.0f : -1.0f);
+            u = fu;
+            v = fv;
+        }
+
+        const float length = std::sqrt(u * u + v * v + z * z);
+        n[0] = u / length;
+        n[1] = v / length;
+        n[2] = z / length;
+    }
+
+    inline uint32_t SpreadBits(uint32_t x) {
+
+        x &= 0x3ff;
+        x = (x | (x << 16)) & 0x030000ff;
+        x = (x | (x << 8)) & 0x0300f00f;
+        x = (x | (x << 4)) & 0x030c30c3;
+        x = (x | (x << 2)) & 0x09249249;
+        return x;
+    }
+
+    inline uint32_t MortonKey(const uint32_t* q, uint32_t bits) {
+
+        uint32_t key = 0;
+        for (int k = 0; k < 3; ++k) {
+
+            const uint32_t top = bits > MORTON_BITS ? q[k] >> (bits - MORTON_BITS) : q[k] << (MORTON_BITS - bits);
+            key |= SpreadBits(top) << k;
+        }
+        return key;
+    }
+
+    template <size_t N>
+    void ComputeBounds(const float* values, size_t count, float* min, float* max) {
+
+        using Bounds = std::array<float, N * 2>;
+        Bounds empty;
+        for (size_t k = 0; k < N; ++k) {
+
+            empty[k] = INFINITY;
+            empty[N + k] = -INFINITY;
+        }
+
+        const Bounds bounds = Tasks::ParallelReduce(0, count, 65536, empty, [&](size_t begin, size_t end) {
+
+            Bounds b = empty;
+            for (size_t i = begin; i < end; ++i) {
+
+                for (size_t k = 0; k < N; ++k) {
+
+                    const float x = values[i * N + k];
+                    if (!std::isfinite(x)) continue;
+                    b[k] = std::min(b[k], x);
+                    b[N + k] = std::max(b[N + k], x);
+                }
+            }
+            return b;
+        }, [](Bounds a, const Bounds& b) {
+
+            for (size_t k = 0; k < N; ++k) {
+
+                a[k] = std::min(a[k], b[k]);
+                a[N + k] = std::max(a[N + k], b[N + k]);
+            }
+            return a;
+        });
+
+        for (size_t k = 0; k < N; ++k) {
+
+            min[k] = bounds[k] <= bounds[N + k] ? bounds[k] : 0.0f;
+            max[k] = bounds[k] <= bounds[N + k] ? bounds[N + k] : 0.0f;
+        }
+    }
+
+    // Edges between the coded faces and the rest, kept as loops. An edge runs from -> to with its coded
+    // face on the left; after and before are the corners next to it in that face, for prediction.
+    // Encoder and decoder make the same calls, so both see the same front.
+    class Front {
+
+        // main functions
+    public:
+        struct Edge {
+
+            uint32_t from, to, after, before;
+            uint32_t prev, next;
+            int halfedge;
+            bool open;
+        };
+
+        // next edge still waiting for its face, false once all are done
+        bool Pop(uint32_t& e) {
+
+            while (head < queue.size()) {
+
+                e = queue[head++];
+                if (edges[e].open) return true;
+            }
+            return false;
+        }
+
+        // a seed face starts a loop of its own
+        void AddLoop(const uint32_t* cycle, const int* halfedges, size_t n) {
+
+            const uint32_t first = static_cast<uint32_t>(edges.size());
+            for (size_t j = 0; j < n; ++j) Add(cycle, halfedges, n, j);
+            for (size_t j = 0; j < n; ++j) Link(first + static_cast<uint32_t>(j), first + static_cast<uint32_t>((j + 1) % n));
+        }
+
+        // the face cycle[0..n) = (to, from, new corners...) is coded across e, its other edges take e's place
+        void Replace(uint32_t e, const uint32_t* cycle, const int* halfedges, size_t n) {
+
+            const uint32_t prev = edges[e].prev, next = edges[e].next;
+            edges[e].open = false;
+
+            const uint32_t first = static_cast<uint32_t>(edges.size());
+            for (size_t j = 1; j < n; ++j) Add(cycle, halfedges, n, j);
+            const uint32_t last = static_cast<uint32_t>(edges.size() - 1);
+            for (uint32_t i = first; i < last; ++i) Link(i, i + 1);
+
+            if (prev == e) {
+
+                Link(last, first);
+                return;
+            }
+            Link(prev, first);
+            Link(last, next);
+            Glue(prev, first);
+            if (edges[last].open) Glue(last, edges[last].next);
+        }
+
+        // nothing behind e
+        void Remove(uint32_t e) {
+
+            const uint32_t prev = edges[e].prev, next = edges[e].next;
+            edges[e].open = false;
+            if (prev == e) return;
+
+            Link(prev, next);
+            Glue(prev, next);
+        }
+
+        uint32_t Forward(uint32_t e, size_t steps) const {
+
+            for (size_t i = 0; i < steps; ++i) e = edges[e].next;
+            return e;
+        }
+
+        // sub functions
+    private:
+        void Add(const uint32_t* cycle, const int* halfedges, size_t n, size_t j) {
+
+            Edge edge;
+            edge.from = cycle[j];
+            edge.to = cycle[(j + 1) % n];
+            edge.after = cycle[(j + 2) % n];
+            edge.before = cycle[(j + n - 1) % n];
+            edge.prev = edge.next = NONE;
+            edge.halfedge = halfedges ? halfedges[j] : -1;
+            edge.open = true;
+
+            queue.push_back(static_cast<uint32_t>(edges.size()));
+            edges.push_back(edge);
+        }
+
+        void Link(uint32_t a, uint32_t b) {
+
+            edges[a].next = b;
+            edges[b].prev = a;
+        }
+
+        // neighbouring edges that run both ways between the same vertices have coded faces on both sides
+        void Glue(uint32_t x, uint32_t y) {
+
+            while (x != y && edges[x].open && edges[y].open && edges[x].next == y &&
+                   edges[x].from == edges[y].to && edges[x].to == edges[y].from) {
+
+                const uint32_t prev = edges[x].prev, next = edges[y].next;
+                edges[x].open = edges[y].open = false;
+                if (prev == y) return;
+
+                Link(prev, next);
+                x = prev;
+                y = next;
+            }
+        }
+
+        // variables
+    public:
+        std::vector<Edge> edges;
+
+    private:
+        std::vector<uint32_t> queue;
+        size_t head = 0;
+    };
+
+    // quantized attributes of the whole mesh, by vertex and by corner
+    struct QuantizedMesh {
+
+        uint32_t flags = 0;
+        uint32_t positionMax = 0, normalMax = 0, texcoordMax = 0;
+        uint32_t positionBits = 0;
+
+        std::vector<uint32_t> positions;    // 3 per vertex
+        std::vector<uint32_t> normals;      // 2 per vertex
+        std::vector<uint8_t> colors;        // 3 per vertex
+        std::vector<uint32_t> texcoords;    // 2 per corner
+    };
+
+    // one chunk in coding order: vertices as they are created, corners face by face
+    struct ChunkData {
+
+        std::vector<Prediction> predictions;
+        std::vector<uint32_t> corners;      // chunk vertex per corner
+        std::vector<uint32_t> faceOffsets;  // first corner per face plus the end
+
+        std::vector<uint32_t> positions, normals, texcoords;
+        std::vector<uint8_t> colors;
+    };
+
+    struct ChunkCode {
+
+        std::vector<uint8_t> bytes;
+        std::vector<uint32_t> vertices;     // mesh vertex per chunk vertex
+        uint32_t faceCount = 0, cornerCount = 0, ownedCount = 0;
+    };
+
+    void EncodeAttributes(const ChunkData& chunk, uint32_t flags, const QuantizedMesh& quantized, std::vector<uint8_t>& out) {
+
+        const size_t vertexCount = chunk.predictions.size();
+
+        Entropy::ValueWriter positions;
+        for (size_t v = 0; v < vertexCount; ++v)
+            for (size_t k = 0; k < 3; ++k)
+                positions.PutSigned(int32_t(chunk.positions[v * 3 + k] - Predict(chunk.positions.data(), 3, k, chunk.predictions[v], quantized.positionMax)));
+        positions.Write(out);
+
+        if (flags & MeshIO::COMPRESSED_MESH_VERTEX_NORMALS) {
+
+            Entropy::ValueWriter normals;
+            for (size_t v = 0; v < vertexCount; ++v)
+                for (size_t k = 0; k < 2; ++k)
+                    normals.PutSigned(int32_t(chunk.normals[v * 2 + k] - Parent(chunk.normals.data(), 2, k, chunk.predictions[v], quantized.normalMax)));
+            normals.Write(out);
+        }
+
+        if (flags & MeshIO::COMPRESSED_MESH_VERTEX_COLORS) {
+
+            std::vector<uint8_t> residuals(vertexCount * 3);
+            for (size_t v = 0; v < vertexCount; ++v) {
+
+                const uint32_t parent = chunk.predictions[v].a;
+                for (size_t k = 0; k < 3; ++k)
+                    residuals[v * 3 + k] = static_cast<uint8_t>(chunk.colors[v * 3 + k] - (parent == NONE ? 0 : chunk.colors[parent * 3 + k]));
+            }
+            Entropy::EncodeSymbols(residuals.data(), residuals.size(), out);
+        }
+
+        // corners of a vertex mostly share coordinates, seams jump
+        if (flags & MeshIO::COMPRESSED_MESH_TEXCOORDS) {
+
+            Entropy::ValueWriter texcoords;
+            std::vector<uint32_t> lastCorner(vertexCount, NONE);
+            for (size_t c = 0; c < chunk.corners.size(); ++c) {
+
+                const uint32_t from = lastCorner[chunk.corners[c]] != NONE ? lastCorner[chunk.corners[c]] : (c ? uint32_t(c - 1) : NONE);
+                const Prediction p = { from, from, from };
+                for (size_t k = 0; k < 2; ++k)
+                    texcoords.PutSigned(int32_t(chunk.texcoords[c * 2 + k] - Predict(chunk.texcoords.data(), 2, k, p, quantized.texcoordMax)));
+                lastCorner[chunk.corners[c]] = static_cast<uint32_t>(c);
+            }
+            texcoords.Write(out);
+        }
+    }
+
+    bool DecodeAttributes(const uint8_t*& data, const uint8_t* end, uint32_t flags, const CompressedMeshHeader& header, ChunkData& chunk) {
+
+        const size_t vertexCount = chunk.predictions.size();
+        const size_t cornerCount = chunk.corners.size();
+        const uint32_t positionMax = MaxValue(header.positionBits);
+        const uint32_t normalMax = MaxValue(header.normalBits);
+        const uint32_t texcoordMax = MaxValue(header.texcoordBits);
+
+        Entropy::ValueReader values;
+        if (!values.Read(data, end, vertexCount * 3)) return false;
+        chunk.positions.resize(vertexCount * 3);
+        for (size_t v = 0; v < vertexCount; ++v)
+            for (size_t k = 0; k < 3; ++k)
+                chunk.positions[v * 3 + k] = (Predict(chunk.positions.data(), 3, k, chunk.predictions[v], positionMax) + values.GetSigned()) & positionMax;
+        if (!values.Ok() || !values.AtEnd()) return false;
+
+        if (flags & MeshIO::COMPRESSED_MESH_VERTEX_NORMALS) {
+
+            if (!values.Read(data, end, vertexCount * 2)) return false;
+            chunk.normals.resize(vertexCount * 2);
+            for (size_t v = 0; v < vertexCount; ++v)
+                for (size_t k = 0; k < 2; ++k)
+                    chunk.normals[v * 2 + k] = (Parent(chunk.normals.data(), 2, k, chunk.predictions[v], normalMax) + values.GetSigned()) & normalMax;
+            if (!values.Ok() || !values.AtEnd()) return false;
+        }
+
+        if (flags & MeshIO::COMPRESSED_MESH_VERTEX_COLORS) {
+
+            if (!Entropy::DecodeSymbols(data, end, vertexCount * 3, chunk.colors) || chunk.colors.size() != vertexCount * 3) return false;
+            for (size_t v = 0; v < vertexCount; ++v) {
+
+                const uint32_t parent = chunk.predictions[v].a;
+                if (parent == NONE) continue;
+                for (size_t k = 0; k < 3; ++k) chunk.colors[v * 3 + k] = static_cast<uint8_t>(chunk.colors[v * 3 + k] + chunk.colors[parent * 3 + k]);
+            }
+        }
+
+        if (flags & MeshIO::COMPRESSED_MESH_TEXCOORDS) {
+
+            if (!values.Read(data, end, cornerCount * 2)) return false;
+            chunk.texcoords.resize(cornerCount * 2);
+            std::vector<uint32_t> lastCorner(vertexCount, NONE);
+            for (size_t c = 0; c < cornerCount; ++c) {
+
+                const uint32_t from = lastCorner[chunk.corners[c]] != NONE ? lastCorner[chunk.corners[c]] : (c ? uint32_t(c - 1) : NONE);
+                const Prediction p = { from, from, from };
+                for (size_t k = 0; k < 2; ++k)
+                    chunk.texcoords[c * 2 + k] = (Predict(chunk.texcoords.data(), 2, k, p, texcoordMax) + values.GetSigned()) & texcoordMax;
+                lastCorner[chunk.corners[c]] = static_cast<uint32_t>(c);
+            }
+            if (!values.Ok() || !values.AtEnd()) return false;
+        }
+        return true;
+    }
+
+    // faces (or loose points when points is set) of one chunk; the border vertex table is added later
+    void EncodeChunk(const MeshBuffer& mesh, const QuantizedMesh& quantized, const uint32_t* items, size_t itemCount, bool points, ChunkCode& code) {
+
+        ChunkData chunk;
+        std::vector<uint32_t> vertices;         // mesh vertex per local vertex
+        std::vector<uint32_t> local;            // local vertex per chunk corner, faces in input order
+        std::vector<uint32_t> sourceCorners;    // mesh corner per chunk corner
+        std::vector<uint32_t> offsets(1, 0);
+
+        if (points) {
+
+            vertices.assign(items, items + itemCount);
+            local.resize(itemCount);
+            for (size_t i = 0; i < itemCount; ++i) local[i] = static_cast<uint32_t>(i);
+        }
+        else {
+
+            for (size_t i = 0; i < itemCount; ++i) {
+
+                for (size_t c = mesh.FaceBegin(items[i]); c < mesh.FaceEnd(items[i]); ++c) sourceCorners.push_back(static_cast<uint32_t>(c));
+                offsets.push_back(static_cast<uint32_t>(sourceCorners.size()));
+            }
+
+            local.resize(sourceCorners.size());
+            for (size_t c = 0; c < sourceCorners.size(); ++c) local[c] = mesh.indices[sourceCorners[c]];
+            vertices = local;
+            std::sort(vertices.begin(), vertices.end());
+            vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+            for (uint32_t& v : local) v = static_cast<uint32_t>(std::lower_bound(vertices.begin(), vertices.end(), v) - vertices.begin());
+        }
+
+        std::vector<uint32_t> codeIndex(vertices.size(), NONE);
+        std::vector<uint32_t> order;            // local vertex per chunk vertex
+        std::vector<uint32_t> cornerOrder;      // chunk corner per coded corner
+        std::vector<uint8_t> gates, corners;
+        Entropy::ValueWriter indices;
+
+        auto last = [&order] { return order.empty() ? NONE : static_cast<uint32_t>(order.size() - 1); };
+        auto create = [&](uint32_t v, const Prediction& p) {
+
+            codeIndex[v] = static_cast<uint32_t>(order.size());
+            order.push_back(v);
+            chunk.predictions.push_back(p);
+            return codeIndex[v];
+        };
+        auto reference = [&](uint32_t id) {
+
+            corners.push_back(CORNER_INDEX);
+            indices.Put(static_cast<uint32_t>(order.size() - 1 - id));
+        };
+        auto valence = [&](size_t n) {
+
+            if (n - 2 < GATE_ESCAPE) {
+
+                gates.push_back(static_cast<uint8_t>(n - 2));
+                return;
+            }
+            gates.push_back(GATE_ESCAPE);
+            indices.Put(static_cast<uint32_t>(n));
+        };
+
+        size_t looseCount = 0;
+        if (!points && itemCount) {
+
+            const MeshTools::HalfedgeTopology topology = MeshTools::BuildHalfedgeTopology(vertices.size(), local.data(),
+                offsets.data(), itemCount);
+
+            std::vector<uint32_t> halfedgeCorner(topology.halfedgeVertex.size(), NONE);
+            for (size_t c = 0; c < topology.cornerHalfedge.size(); ++c)
+                if (topology.cornerHalfedge[c] >= 0) halfedgeCorner[topology.cornerHalfedge[c]] = static_cast<uint32_t>(c);
+
+            // region growing over the manifold part
+            const size_t builtCount = topology.FaceCount();
+            std::vector<uint8_t> faceDone(builtCount, 0);
+            std::vector<int> halfedges;
+            std::vector<uint32_t> cycle;
+            auto collect = [&](int first) {
+
+                halfedges.clear();
+                int h = first;
+                do {
+
+                    halfedges.push_back(h);
+                    h = topology.halfedgeNext[h];
+                } while (h != first);
+            };
+
+            Front front;
+            size_t seed = 0, done = 0;
+            while (done < builtCount) {
+
+                uint32_t e;
+                if (!front.Pop(e)) {
+
+                    while (faceDone[seed]) ++seed;
+                    collect(topology.faceHalfedge[seed]);
+                    valence(halfedges.size());
+
+                    cycle.clear();
+                    for (int h : halfedges) {
+
+                        const uint32_t v = static_cast<uint32_t>(topology.halfedgeVertex[topology.halfedgePrev[h]]);
+                        if (codeIndex[v] == NONE) {
+
+                            const uint32_t previous = last();
+                            corners.push_back(CORNER_NEW);
+                            create(v, { previous, previous, previous });
+                        }
+                        else {
+
+                            reference(codeIndex[v]);
+                        }
+                        cycle.push_back(codeIndex[v]);
+                        cornerOrder.push_back(halfedgeCorner[h]);
+                    }
+                    front.AddLoop(cycle.data(), halfedges.data(), halfedges.size());
+                    faceDone[seed] = 1;
+                    ++done;
+                    continue;
+                }
+
+                const Front::Edge edge = front.edges[e];
+                const int opposite = edge.halfedge ^ 1;
+                const int face = topology.halfedgeFace[opposite];
+                if (face < 0 || faceDone[face]) {
+
+                    gates.push_back(GATE_BOUNDARY);
+                    front.Remove(e);
+                    continue;
+                }
+
+                collect(opposite);
+                const size_t n = halfedges.size();
+                valence(n);
+
+                // the face is (to, from, c1, ..., cn-2) with halfedges[i] leaving cycle[i]
+                cycle.assign({ edge.to, edge.from });
+                uint32_t left = edge.prev;
+                for (size_t i = 2; i < n; ++i) {
+
+                    const uint32_t v = static_cast<uint32_t>(topology.halfedgeVertex[halfedges[i - 1]]);
+                    const uint32_t id = codeIndex[v];
+                    if (id != NONE && front.edges[left].from == id) {
+
+                        corners.push_back(CORNER_LEFT);
+                        left = front.edges[left].prev;
+                    }
+                    else if (id != NONE && front.edges[front.Forward(e, n - i)].to == id) {
+
+                        corners.push_back(CORNER_RIGHT);
+                    }
+                    else if (id != NONE) {
+
+                        reference(id);
+                    }
+                    else {
+
+                        corners.push_back(CORNER_NEW);
+                        if (n == 3) create(v, { edge.from, edge.to, edge.after });
+                        else if (i == 2) create(v, { edge.from, edge.from, edge.before });
+                        else create(v, { cycle[i - 1], edge.to, edge.from });
+                    }
+                    cycle.push_back(codeIndex[v]);
+                }
+
+                for (int h : halfedges) cornerOrder.push_back(halfedgeCorner[h]);
+                front.Replace(e, cycle.data(), halfedges.data(), n);
+                faceDone[face] = 1;
+                ++done;
+            }
+
+            // faces left out of the halfedge structure go by index, in input order
+            std::vector<uint32_t> loose(topology.invalidFaces);
+            loose.insert(loose.end(), topology.rejectedFaces.begin(), topology.rejectedFaces.end());
+            std::sort(loose.begin(), loose.end());
+            looseCount = loose.size();
+            for (uint32_t f : loose) {
+
+                indices.Put(offsets[f + 1] - offsets[f]);
+                for (uint32_t c = offsets[f]; c < offsets[f + 1]; ++c) {
+
+                    if (codeIndex[local[c]] == NONE) {
+
+                        const uint32_t previous = last();
+                        corners.push_back(CORNER_NEW);
+                        create(local[c], { previous, previous, previous });
+                    }
+                    else {
+
+                        reference(codeIndex[local[c]]);
+                    }
+                    cornerOrder.push_back(c);
+                }
+            }
+        }
+        else if (points) {
+
+            for (uint32_t v = 0; v < vertices.size(); ++v) {
+
+                const uint32_t previous = last();
+                create(v, { previous, previous, previous });
+            }
+        }
+
+        // attributes in coding order
+        const size_t vertexCount = order.size();
+        code.vertices.resize(vertexCount);
+        chunk.positions.resize(vertexCount * 3);
+        if (quantized.flags & MeshIO::COMPRESSED_MESH_VERTEX_NORMALS) chunk.normals.resize(vertexCount * 2);
+        if (quantized.flags & MeshIO::COMPRESSED_MESH_VERTEX_COLORS) chunk.colors.resize(vertexCount * 3);
+        for (size_t v = 0; v < vertexCount; ++v) {
+
+            const uint32_t g = vertices[order[v]];
+            code.vertices[v] = g;
+            std::copy_n(&quantized.positions[size_t(g) * 3], 3, &chunk.positions[v * 3]);
+            if (!chunk.normals.empty()) std::copy_n(&quantized.normals[size_t(g) * 2], 2, &chunk.normals[v * 2]);
+            if (!chunk.colors.empty()) std::copy_n(&quantized.colors[size_t(g) * 3], 3, &chunk.colors[v * 3]);
+        }
+
+        chunk.corners.resize(cornerOrder.size());
+        if (quantized.flags & MeshIO::COMPRESSED_MESH_TEXCOORDS) chunk.texcoords.resize(cornerOrder.size() * 2);
+        for (size_t c = 0; c < cornerOrder.size(); ++c) {
+
+            chunk.corners[c] = codeIndex[local[cornerOrder[c]]];
+            if (!chunk.texcoords.empty()) std::copy_n(&quantized.texcoords[size_t(sourceCorners[cornerOrder[c]]) * 2], 2, &chunk.texcoords[c * 2]);
+        }
+
+        code.faceCount = points ? 0 : static_cast<uint32_t>(itemCount);
+        code.cornerCount = static_cast<uint32_t>(cornerOrder.size());
+
+        Entropy::PutVarint(code.bytes, looseCount);
+        Entropy::PutVarint(code.bytes, points ? itemCount : 0);
+        Entropy::EncodeSymbols(gates.data(), gates.size(), code.bytes);
+        Entropy::EncodeSymbols(corners.data(), corners.size(), code.bytes);
+        indices.Write(code.bytes);
+        EncodeAttributes(chunk, quantized.flags, quantized, code.bytes);
+    }
+
+    // everything but the border vertex table, false on malformed input
+    bool DecodeChunk(const uint8_t*& data, const uint8_t* end, const CompressedMeshHeader& header, const CompressedMeshChunkEntry& entry, ChunkData& chunk) {
+
+        uint64_t looseCount, pointCount;
+        if (!Entropy::GetVarint(data, end, looseCount) || looseCount > entry.faceCount) return false;
+        if (!Entropy::GetVarint(data, end, pointCount) || pointCount > entry.vertexCount) return false;
+
+        const size_t cornerCount = entry.cornerCount;
+        const size_t vertexCount = entry.vertexCount;
+        std::vector<uint8_t> gates, corners;
+        Entropy::ValueReader indices;
+        if (!Entropy::DecodeSymbols(data, end, size_t(entry.faceCount) + cornerCount + 1, gates)) return false;
+        if (!Entropy::DecodeSymbols(data, end, cornerCount, corners)) return false;
+        if (!indices.Read(data, end, size_t(entry.faceCount) + cornerCount)) return false;
+
+        size_t nextGate = 0, nextCorner = 0;
+        bool ok = true;
+        auto gate = [&]() -> uint8_t {
+
+            if (nextGate == gates.size()) {
+
+                ok = false;
+                return GATE_BOUNDARY;
+            }
+            return gates[nextGate++];
+        };
+        auto corner = [&]() -> uint8_t {
+
+            if (nextCorner == corners.size()) {
+
+                ok = false;
+                return CORNER_INDEX;
+            }
+            return corners[nextCorner++];
+        };
+        auto valence = [&](uint8_t symbol) -> size_t {
+
+            const size_t n = symbol == GATE_ESCAPE ? indices.Get() : size_t(symbol) + 2;
+            return n >= 3 && chunk.corners.size() + n <= cornerCount ? n : 0;
+        };
+
+        auto last = [&chunk] { return chunk.predictions.empty() ? NONE : static_cast<uint32_t>(chunk.predictions.size() - 1); };
+        auto create = [&](const Prediction& p) {
+
+            if (chunk.predictions.size() == vertexCount) {
+
+                ok = false;
+                return uint32_t(0);
+            }
+            chunk.predictions.push_back(p);
+            return static_cast<uint32_t>(chunk.predictions.size() - 1);
+        };
+        auto reference = [&]() {
+
+            const uint32_t back = indices.Get();
+            if (back >= chunk.predictions.size()) {
+
+                ok = false;
+                return uint32_t(0);
+            }
+            return static_cast<uint32_t>(chunk.predictions.size() - 1 - back);
+        };
+        auto endFace = [&] { chunk.faceOffsets.push_back(static_cast<uint32_t>(chunk.corners.size())); };
+
+        chunk.faceOffsets.assign(1, 0);
+        chunk.corners.reserve(cornerCount);
+
+        const size_t builtCount = entry.faceCount - looseCount;
+        Front front;
+        std::vector<uint32_t> cycle;
+        size_t done = 0;
+        while (done < builtCount && ok) {
+
+            uint32_t e;
+            if (!front.Pop(e)) {
+
+                const size_t n = valence(gate());
+                if (n == 0) return false;
+
+                cycle.clear();
+                for (size_t i = 0; i < n; ++i) {
+
+                    const uint8_t symbol = corner();
+                    if (symbol == CORNER_NEW) {
+
+                        const uint32_t previous = last();
+                        cycle.push_back(create({ previous, previous, previous }));
+                    }
+                    else if (symbol == CORNER_INDEX) {
+
+                        cycle.push_back(reference());
+                    }
+                    else {
+
+                        return false;
+                    }
+                }
+                chunk.corners.insert(chunk.corners.end(), cycle.begin(), cycle.end());
+                endFace();
+                front.AddLoop(cycle.data(), nullptr, n);
+                ++done;
+                continue;
+            }
+
+            const uint8_t symbol = gate();
+            if (symbol == GATE_BOUNDARY) {
+
+                front.Remove(e);
+                continue;
+            }
+
+            const size_t n = valence(symbol);
+            if (n == 0) return false;
+
+            const Front::Edge edge = front.edges[e];
+            cycle.assign({ edge.to, edge.from });
+            uint32_t left = edge.prev;
+            for (size_t i = 2; i < n; ++i) {
+
+                switch (corner()) {
+
+                case CORNER_LEFT:
+                    cycle.push_back(front.edges[left].from);
+                    left = front.edges[left].prev;
+                    break;
+                case CORNER_RIGHT:
+                    cycle.push_back(front.edges[front.Forward(e, n - i)].to);
+                    break;
+                case CORNER_INDEX:
+                    cycle.push_back(reference());
+                    break;
+                default:
+                    if (n == 3) cycle.push_back(create({ edge.from, edge.to, edge.after }));
+                    else if (i == 2) cycle.push_back(create({ edge.from, edge.from, edge.before }));
+                    else cycle.push_back(create({ cycle[i - 1], edge.to, edge.from }));
+                    break;
+                }
+            }
+
+            chunk.corners.insert(chunk.corners.end(), cycle.begin(), cycle.end());
+            endFace();
+            front.Replace(e, cycle.data(), nullptr, n);
+            ++done;
+        }
+
+        for (size_t f = 0; f < looseCount && ok; ++f) {
+
+            const size_t n = indices.Get();
+            if (chunk.corners.size() + n > cornerCount) return false;
+            for (size_t i = 0; i < n; ++i) {
+
+                const uint8_t symbol = corner();
+                if (symbol == CORNER_NEW) {
+
+                    const uint32_t previous = last();
+                    chunk.corners.push_back(create({ previous, previous, previous }));
+                }
+                else if (symbol == CORNER_INDEX) {
+
+                    chunk.corners.push_back(reference());
+                }
+                else {
+
+                    return false;
+                }
+            }
+            endFace();
+        }
+
+        for (size_t p = 0; p < pointCount && ok; ++p) {
+
+            const uint32_t previous = last();
+            create({ previous, previous, previous });
+        }
+
+        if (!ok || !indices.Ok() || !indices.AtEnd() || nextGate != gates.size() || nextCorner != corners.size()) return false;
+        if (chunk.predictions.size() != vertexCount || chunk.corners.size() != cornerCount) return false;
+        return DecodeAttributes(data, end, header.flags, header, chunk);
+    }
+
+    bool Fail(const char* message) {
+
+        fprintf(stderr, "DecodeCompressedMesh: %s\n", message);
+        return false;
+    }
+
+    // header and chunk table checked against the file size, nullptr or what is wrong
+    const char* ReadChunkTable(const uint8_t* data, size_t size, CompressedMeshHeader& header, std::vector<CompressedMeshChunkEntry>& entries) {
+
+        if (!MeshIO::IsCompressedMesh(reinterpret_cast<const char*>(data), size)) return "not a compressed mesh";
+
+        std::memcpy(&header, data, sizeof(header));
+        if (header.version != MeshIO::COMPRESSED_MESH_VERSION) return "unsupported version";
+        if (header.byteOrder != BYTE_ORDER_MARK) return "written with a different byte order";
+        if (header.positionBits < 1 || header.positionBits > 30 || header.normalBits < 2 || header.normalBits > 30 ||
+            header.texcoordBits < 1 || header.texcoordBits > 30 || header.vertexCount >= NONE || header.cornerCount >= NONE)
+            return "corrupt header";
+
+        // counts the file is too small to hold
+        const uint64_t maxItems = uint64_t(size) * MAX_ITEMS_PER_BYTE;
+        if (header.vertexCount > maxItems || header.faceCount > maxItems || header.cornerCount > maxItems) return "corrupt header";
+
+        const size_t chunkCount = header.chunkCount;
+        if (chunkCount > (size - sizeof(header)) / sizeof(CompressedMeshChunkEntry)) return "truncated chunk table";
+        entries.resize(chunkCount);
+        if (chunkCount) std::memcpy(entries.data(), data + sizeof(header), chunkCount * sizeof(CompressedMeshChunkEntry));
+
+        for (const CompressedMeshChunkEntry& entry : entries) {
+
+            if (entry.offset > size || entry.size > size - entry.offset || entry.ownedCount > entry.vertexCount) return "corrupt chunk table";
+            const uint64_t maxChunkItems = entry.size * MAX_ITEMS_PER_BYTE;
+            if (entry.vertexCount > maxChunkItems || entry.faceCount > maxChunkItems || entry.cornerCount > maxChunkItems) return "corrupt header";
+        }
+        return nullptr;
+    }
+}
+
+namespace MeshIO {
+
+    bool EncodeCompressedMesh(const MeshBuffer& mesh, std::vector<uint8_t>& out, const CompressionOptions& options) {
+
+        out.clear();
+        if (options.positionBits < 1 || options.positionBits > 30 || options.normalBits < 2 || options.normalBits > 30 ||
+            options.texcoordBits < 1 || options.texcoordBits > 30 || options.chunkSize == 0) {
+
+            fprintf(stderr, "EncodeCompressedMesh: invalid options\n");
+            return false;
+        }
+
+        const size_t vertexCount = mesh.VertexCount();
+        const size_t faceCount = mesh.FaceCount();
+        const size_t cornerCount = mesh.indices.size();
+        if (vertexCount >= NONE || cornerCount >= NONE) {
+
+            fprintf(stderr, "EncodeCompressedMesh: mesh is too large\n");
+            return false;
+        }
+
+        const size_t outOfRange = Tasks::ParallelReduce(0, cornerCount, 65536, size_t(0), [&](size_t begin, size_t end) {
+
+            return static_cast<size_t>(std::count_if(mesh.indices.begin() + begin, mesh.indices.begin() + end,
+                                                     [vertexCount](uint32_t v) { return v >= vertexCount; }));
+        }, [](size_t a, size_t b) { return a + b; });
+        if (outOfRange) {
+
+            fprintf(stderr, "EncodeCompressedMesh: vertex index out of range\n");
+            return false;
+        }
+
+        CompressedMeshHeader header = {};
+        std::memcpy(header.magic, COMPRESSED_MESH_MAGIC, sizeof(header.magic));
+        header.version = COMPRESSED_MESH_VERSION;
+        header.vertexCount = vertexCount;
+        header.faceCount = faceCount;
+        header.cornerCount = cornerCount;
+        header.byteOrder = BYTE_ORDER_MARK;
+        header.positionBits = static_cast<uint32_t>(options.positionBits);
+        header.normalBits = static_cast<uint32_t>(options.normalBits);
+        header.texcoordBits = static_cast<uint32_t>(options.texcoordBits);
+
+        bool triangles = cornerCount == faceCount * 3;
+        for (size_t f = 0; f < faceCount && triangles && !mesh.IsTriangleMesh(); ++f) triangles = mesh.FaceEnd(f) - mesh.FaceBegin(f) == 3;
+        if (triangles) header.flags |= COMPRESSED_MESH_TRIANGLES;
+        if (options.vertexNormals && vertexCount && mesh.vertexNormals.size() == vertexCount * 3) header.flags |= COMPRESSED_MESH_VERTEX_NORMALS;
+        if (options.vertexColors && vertexCount && mesh.vertexColors.size() == vertexCount * 3) header.flags |= COMPRESSED_MESH_VERTEX_COLORS;
+        if (options.texcoords && cornerCount && mesh.texcoords.size() == cornerCount * 2) header.flags |= COMPRESSED_MESH_TEXCOORDS;
+
+        // quantize against the bounding cube (square for texcoords) so the aspect is kept
+        QuantizedMesh quantized;
+        quantized.flags = header.flags;
+        quantized.positionBits = header.positionBits;
+        quantized.positionMax = MaxValue(header.positionBits);
+        quantized.normalMax = MaxValue(header.normalBits);
+        quantized.texcoordMax = MaxValue(header.texcoordBits);
+
+        float min[3], max[3];
+        ComputeBounds<3>(mesh.positions.data(), vertexCount, min, max);
+        const float extent = std::max({ max[0] - min[0], max[1] - min[1], max[2] - min[2] });
+        std::copy_n(min, 3, header.positionMin);
+        header.positionStep = extent / quantized.positionMax;
+
+        quantized.positions.resize(vertexCount * 3);
+        if (header.flags & COMPRESSED_MESH_VERTEX_NORMALS) quantized.normals.resize(vertexCount * 2);
+        if (header.flags & COMPRESSED_MESH_VERTEX_COLORS) quantized.colors.resize(vertexCount * 3);
+        Parallel::For(0, vertexCount, [&](size_t begin, size_t end) {
+
+            for (size_t v = begin; v < end; ++v) {
+
+                for (size_t k = 0; k < 3; ++k)
+                    quantized.positions[v * 3 + k] = Quantize(mesh.positions[v * 3 + k], header.positionMin[k], header.positionStep, quantized.positionMax);
+                if (!quantized.normals.empty()) EncodeOctahedral(&mesh.vertexNormals[v * 3], quantized.normalMax, &quantized.normals[v * 2]);
+                if (!quantized.colors.empty())
+                    for (size_t k = 0; k < 3; ++k)
+                        quantized.colors[v * 3 + k] = static_cast<uint8_t>(std::lround(std::clamp(mesh.vertexColors[v * 3 + k], 0.0f, 1.0f) * 255.0f));
+            }
+        });
+
+        if (header.flags & COMPRESSED_MESH_TEXCOORDS) {
+
+            float uvMin[2], uvMax[2];
+            ComputeBounds<2>(mesh.texcoords.data(), cornerCount, uvMin, uvMax);
+            std::copy_n(uvMin, 2, header.texcoordMin);
+            header.texcoordStep = std::max(uvMax[0] - uvMin[0], uvMax[1] - uvMin[1]) / quantized.texcoordMax;
+
+            quantized.texcoords.resize(cornerCount * 2);
+            Parallel::For(0, cornerCount, [&](size_t begin, size_t end) {
+
+                for (size_t c = begin; c < end; ++c)
+                    for (size_t k = 0; k < 2; ++k)
+                        quantized.texcoords[c * 2 + k] = Quantize(mesh.texcoords[c * 2 + k], header.texcoordMin[k], header.texcoordStep, quantized.texcoordMax);
+            });
+        }
+
+        // faces in Morton order of their centroids, cut into chunks
+        std::vector<uint64_t> faceKeys(faceCount);
+        Parallel::For(0, faceCount, [&](size_t begin, size_t end) {
+
+            for (size_t f = begin; f < end; ++f) {
+
+                uint64_t sum[3] = { 0, 0, 0 };
+                const size_t first = mesh.FaceBegin(f), n = mesh.FaceEnd(f) - first;
+                for (size_t c = first; c < first + n; ++c)
+                    for (size_t k = 0; k < 3; ++k) sum[k] += quantized.positions[size_t(mesh.indices[c]) * 3 + k];
+
+                uint32_t centroid[3] = { 0, 0, 0 };
+                for (size_t k = 0; k < 3 && n; ++k) centroid[k] = static_cast<uint32_t>(sum[k] / n);
+                faceKeys[f] = uint64_t(MortonKey(centroid, quantized.positionBits)) << 32 | f;
+            }
+        });
+        if (faceCount > options.chunkSize) std::sort(faceKeys.begin(), faceKeys.end());
+
+        std::vector<uint32_t> items(faceCount);
+        for (size_t f = 0; f < faceCount; ++f) items[f] = static_cast<uint32_t>(faceKeys[f]);
+        faceKeys = {};
+
+        // every vertex belongs to the first chunk that uses it, unused ones to the point chunks at the end
+        const size_t faceChunks = (faceCount + options.chunkSize - 1) / options.chunkSize;
+        std::vector<uint32_t> owner(vertexCount, NONE);
+        for (size_t i = 0; i < faceCount; ++i) {
+
+            const uint32_t chunk = static_cast<uint32_t>(i / options.chunkSize);
+            for (size_t c = mesh.FaceBegin(items[i]); c < mesh.FaceEnd(items[i]); ++c)
+                if (owner[mesh.indices[c]] == NONE) owner[mesh.indices[c]] = chunk;
+        }
+
+        std::vector<uint64_t> pointKeys;
+        for (size_t v = 0; v < vertexCount; ++v)
+            if (owner[v] == NONE) pointKeys.push_back(uint64_t(MortonKey(&quantized.positions[v * 3], quantized.positionBits)) << 32 | v);
+        std::sort(pointKeys.begin(), pointKeys.end());
+
+        const size_t pointCount = pointKeys.size();
+        const size_t chunkCount = faceChunks + (pointCount + options.chunkSize - 1) / options.chunkSize;
+        items.resize(faceCount + pointCount);
+        for (size_t i = 0; i < pointCount; ++i) {
+
+            const uint32_t v = static_cast<uint32_t>(pointKeys[i]);
+            items[faceCount + i] = v;
+            owner[v] = static_cast<uint32_t>(faceChunks + i / options.chunkSize);
+        }
+        pointKeys = {};
+
+        auto chunkItems = [&](size_t chunk, size_t& first, size_t& count) {
+
+            const bool points = chunk >= faceChunks;
+            const size_t base = points ? faceCount : 0, total = points ? pointCount : faceCount;
+            first = base + (chunk - (points ? faceChunks : 0)) * options.chunkSize;
+            count = std::min(options.chunkSize, base + total - first);
+            return points;
+        };
+
+        std::vector<ChunkCode> codes(chunkCount);
+        Tasks::ParallelFor(0, chunkCount, 1, [&](size_t begin, size_t end) {
+
+            for (size_t chunk = begin; chunk < end; ++chunk) {
+
+                size_t first, count;
+                const bool points = chunkItems(chunk, first, count);
+                EncodeChunk(mesh, quantized, &items[first], count, points, codes[chunk]);
+            }
+        });
+
+        // border vertices point back at their first copy
+        std::vector<uint32_t> ownerIndex(vertexCount, NONE);
+        Tasks::ParallelFor(0, chunkCount, 1, [&](size_t begin, size_t end) {
+
+            for (size_t chunk = begin; chunk < end; ++chunk)
+                for (size_t v = 0; v < codes[chunk].vertices.size(); ++v)
+                    if (owner[codes[chunk].vertices[v]] == chunk) ownerIndex[codes[chunk].vertices[v]] = static_cast<uint32_t>(v);
+        });
+        Tasks::ParallelFor(0, chunkCount, 1, [&](size_t begin, size_t end) {
+
+            for (size_t chunk = begin; chunk < end; ++chunk) {
+
+                ChunkCode& code = codes[chunk];
+                Entropy::ValueWriter copies;
+                uint32_t previous = NONE, previousOwner = 0;
+                for (size_t v = 0; v < code.vertices.size(); ++v) {
+
+                    const uint32_t g = code.vertices[v];
+                    if (owner[g] == chunk) continue;
+
+                    copies.Put(static_cast<uint32_t>(v - (previous == NONE ? 0 : previous + 1)));
+                    copies.Put(static_cast<uint32_t>(chunk - owner[g] - 1));
+                    copies.PutSigned(static_cast<int32_t>(ownerIndex[g] - previousOwner));
+                    previous = static_cast<uint32_t>(v);
+                    previousOwner = ownerIndex[g];
+                }
+                code.ownedCount = static_cast<uint32_t>(code.vertices.size() - copies.Count() / 3);
+                copies.Write(code.bytes);
+            }
+        });
+
+        header.chunkCount = static_cast<uint32_t>(chunkCount);
+        std::vector<CompressedMeshChunkEntry> entries(chunkCount);
+        uint64_t offset = sizeof(header) + chunkCount * sizeof(CompressedMeshChunkEntry);
+        for (size_t chunk = 0; chunk < chunkCount; ++chunk) {
+
+            const ChunkCode& code = codes[chunk];
+            entries[chunk] = { offset, code.bytes.size(), code.faceCount, code.cornerCount, static_cast<uint32_t>(code.vertices.size()), code.ownedCount };
+            offset += code.bytes.size();
+        }
+
+        out.resize(offset);
+        std::memcpy(out.data(), &header, sizeof(header));
+        if (chunkCount) std::memcpy(out.data() + sizeof(header), entries.data(), chunkCount * sizeof(CompressedMeshChunkEntry));
+        Tasks::ParallelFor(0, chunkCount, 1, [&](size_t begin, size_t end) {
+
+            for (size_t chunk = begin; chunk < end; ++chunk)
+                if (!codes[chunk].bytes.empty()) std::memcpy(out.data() + entries[chunk].offset, codes[chunk].bytes.data(), codes[chunk].bytes.size());
+        });
+        return true;
+    }
+
+    bool IsCompressedMesh(const char* data, size_t size) {
+
+        return size >= sizeof(CompressedMeshHeader) && std::memcmp(data, COMPRESSED_MESH_MAGIC, sizeof(COMPRESSED_MESH_MAGIC)) == 0;
+    }
+
+    bool DecodeCompressedMesh(const uint8_t* data, size_t size, MeshBuffer& mesh) {
+
+        mesh.Clear();
+
+        CompressedMeshHeader header;
+        std::vector<CompressedMeshChunkEntry> entries;
+        if (const char* error = ReadChunkTable(data, size, header, entries)) return Fail(error);
+        const size_t chunkCount = entries.size();
+
+        // where every chunk's owned vertices, faces and corners go
+        std::vector<uint64_t> vertexBase(chunkCount + 1, 0), faceBase(chunkCount + 1, 0), cornerBase(chunkCount + 1, 0);
+        for (size_t chunk = 0; chunk < chunkCount; ++chunk) {
+
+            const CompressedMeshChunkEntry& entry = entries[chunk];
+            vertexBase[chunk + 1] = vertexBase[chunk] + entry.ownedCount;
+            faceBase[chunk + 1] = faceBase[chunk] + entry.faceCount;
+            cornerBase[chunk + 1] = cornerBase[chunk] + entry.cornerCount;
+        }
+        if (vertexBase[chunkCount] != header.vertexCount || faceBase[chunkCount] != header.faceCount || cornerBase[chunkCount] != header.cornerCount)
+            return Fail("chunk table does not match the header");
+
+        const bool triangles = header.flags & COMPRESSED_MESH_TRIANGLES;
+        if (triangles && header.cornerCount != header.faceCount * 3) return Fail("corrupt header");
+
+        const size_t vertexCount = header.vertexCount;
+        const size_t cornerCount = header.cornerCount;
+        const uint32_t normalMax = MaxValue(header.normalBits);
+        mesh.positions.resize(vertexCount * 3);
+        if (header.flags & COMPRESSED_MESH_VERTEX_NORMALS) mesh.vertexNormals.resize(vertexCount * 3);
+        if (header.flags & COMPRESSED_MESH_VERTEX_COLORS) mesh.vertexColors.resize(vertexCount * 3);
+        mesh.indices.resize(cornerCount);
+        if (!triangles) mesh.faceOffsets.resize(header.faceCount + 1, static_cast<uint32_t>(cornerCount));
+        if (header.flags & COMPRESSED_MESH_TEXCOORDS) mesh.texcoords.resize(cornerCount * 2);
+
+        // chunks decode on their own, owned vertices get their place in the mesh right away
+        std::vector<ChunkData> chunks(chunkCount);
+        std::vector<std::vector<uint32_t>> meshVertex(chunkCount), copies(chunkCount);
+        std::atomic<bool> ok = true;
+        Tasks::ParallelFor(0, chunkCount, 1, [&](size_t begin, size_t end) {
+
+            for (size_t c = begin; c < end && ok; ++c) {
+
+                const CompressedMeshChunkEntry& entry = entries[c];
+                ChunkData& chunk = chunks[c];
+                const uint8_t* in = data + entry.offset;
+                const uint8_t* inEnd = in + entry.size;
+
+                Entropy::ValueReader table;
+                if (!DecodeChunk(in, inEnd, header, entry, chunk) || !table.Read(in, inEnd, size_t(entry.vertexCount) * 3) || in != inEnd) {
+
+                    ok = false;
+                    return;
+                }
+
+                // (vertex, owner chunk, owner vertex) per border copy, vertices ascending
+                std::vector<uint32_t>& map = meshVertex[c];
+                map.assign(entry.vertexCount, 0);
+                uint32_t previous = NONE, ownerVertex = 0;
+                while (!table.AtEnd() && table.Ok()) {
+
+                    const uint64_t v = (previous == NONE ? 0 : uint64_t(previous) + 1) + table.Get();
+                    const uint64_t ownerChunk = uint64_t(c) - 1 - table.Get();
+                    ownerVertex += static_cast<uint32_t>(table.GetSigned());
+                    if (v >= entry.vertexCount || ownerChunk >= c) {
+
+                        ok = false;
+                        return;
+                    }
+                    map[v] = NONE;
+                    copies[c].insert(copies[c].end(), { static_cast<uint32_t>(v), static_cast<uint32_t>(ownerChunk), ownerVertex });
+                    previous = static_cast<uint32_t>(v);
+                }
+                if (!table.Ok() || entry.vertexCount - copies[c].size() / 3 != entry.ownedCount) {
+
+                    ok = false;
+                    return;
+                }
+
+                uint64_t next = vertexBase[c];
+                for (size_t v = 0; v < entry.vertexCount; ++v) {
+
+                    if (map[v] == NONE) continue;
+                    map[v] = static_cast<uint32_t>(next);
+                    for (size_t k = 0; k < 3; ++k)
+                        mesh.positions[next * 3 + k] = static_cast<float>(header.positionMin[k] + double(chunk.positions[v * 3 + k]) * header.positionStep);
+                    if (!mesh.vertexNormals.empty()) DecodeOctahedral(&chunk.normals[v * 2], normalMax, &mesh.vertexNormals[next * 3]);
+                    if (!mesh.vertexColors.empty())
+                        for (size_t k = 0; k < 3; ++k) mesh.vertexColors[next * 3 + k] = chunk.colors[v * 3 + k] / 255.0f;
+                    ++next;
+                }
+
+                const size_t firstCorner = cornerBase[c];
+                if (!mesh.texcoords.empty())
+                    for (size_t i = 0; i < chunk.corners.size() * 2; ++i)
+                        mesh.texcoords[firstCorner * 2 + i] = static_cast<float>(header.texcoordMin[i % 2] + double(chunk.texcoords[i]) * header.texcoordStep);
+                for (size_t f = 0; f < entry.faceCount; ++f) {
+
+                    if (triangles && chunk.faceOffsets[f + 1] - chunk.faceOffsets[f] != 3) {
+
+                        ok = false;
+                        return;
+                    }
+                    if (!triangles) mesh.faceOffsets[faceBase[c] + f] = static_cast<uint32_t>(firstCorner + chunk.faceOffsets[f]);
+                }
+                chunk.positions = {};
+                chunk.normals = {};
+                chunk.colors = {};
+                chunk.texcoords = {};
+            }
+        });
+        if (!ok) {
+
+            mesh.Clear();
+            return Fail("corrupt chunk");
+        }
+
+        // then copies take the place of their owner's vertex
+        Tasks::ParallelFor(0, chunkCount, 1, [&](size_t begin, size_t end) {
+
+            for (size_t c = begin; c < end && ok; ++c) {
+
+                std::vector<uint32_t> map = meshVertex[c];
+                for (size_t i = 0; i < copies[c].size(); i += 3) {
+
+                    const std::vector<uint32_t>& owner = meshVertex[copies[c][i + 1]];
+                    const uint32_t ownerVertex = copies[c][i + 2];
+                    if (ownerVertex >= owner.size() || owner[ownerVertex] == NONE) {
+
+                        ok = false;
+                        return;
+                    }
+                    map[copies[c][i]] = owner[ownerVertex];
+                }
+
+                const std::vector<uint32_t>& corners = chunks[c].corners;
+                for (size_t i = 0; i < corners.size(); ++i) mesh.indices[cornerBase[c] + i] = map[corners[i]];
+            }
+        });
+        if (!ok) {
+
+            mesh.Clear();
+            return Fail("corrupt border vertex table");
+        }
+        return true;
+    }
+
+    bool SampleCompressedMesh(const uint8_t* data, size_t size, size_t maxPoints, std::vector<float>& points) {
+
+        points.clear();
+
+        CompressedMeshHeader header;
+        std::vector<CompressedMeshChunkEntry> entries;
+        if (ReadChunkTable(data, size, header, entries) || entries.empty() || maxPoints == 0) return false;
+
+        // chunks are spatially compact and in Morton order, so evenly spaced ones spread over the mesh
+        const size_t chunkCount = std::min(entries.size(), SAMPLED_CHUNKS);
+        const size_t perChunk = (maxPoints + chunkCount - 1) / chunkCount;
+        std::vector<std::vector<float>> found(chunkCount);
+        Tasks::ParallelFor(0, chunkCount, 1, [&](size_t begin, size_t end) {
+
+            for (size_t i = begin; i < end; ++i) {
+
+                const CompressedMeshChunkEntry& entry = entries[entries.size() * i / chunkCount];
+                const uint8_t* in = data + entry.offset;
+                ChunkData chunk;
+                if (!DecodeChunk(in, in + entry.size, header, entry, chunk)) continue;
+
+                const size_t vertexCount = chunk.positions.size() / 3;
+                const size_t n = std::min(perChunk, vertexCount);
+                found[i].resize(n * 3);
+                for (size_t p = 0; p < n; ++p) {
+
+                    const size_t v = vertexCount * p / n;
+                    for (size_t k = 0; k < 3; ++k)
+                        found[i][p * 3 + k] = static_cast<float>(header.positionMin[k] + double(chunk.positions[v * 3 + k]) * header.positionStep);
+                }
+            }
+        });
+
+        for (const auto& chunk : found) points.insert(points.end(), chunk.begin(), chunk.end());
+        points.resize(std::min(points.size(), maxPoints * 3));
+        return !points.empty();
+    }
+
+    bool WriteCompressedMesh(const std::string& path, const MeshBuffer& mesh, const CompressionOptions& options) {
+
+        std::vector<uint8_t> bytes;
+        if (!EncodeCompressedMesh(mesh, bytes, options)) return false;
+
+        FILE* file = fopen(path.c_str(), "wb");
+        if (!file) {
+
+            fprintf(stderr, "WriteCompressedMesh: cannot open %s\n", path.c_str());
+            return false;
+        }
+
+        const bool ok = fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+        if (fclose(file) != 0 || !ok) {
+
+            fprintf(stderr, "WriteCompressedMesh: failed to write %s\n", path.c_str());
+            std::remove(path.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    bool ReadCompressedMesh(const std::string& path, MeshBuffer& mesh) {
+
+        mesh.Clear();
+
+        MappedFile file;
+        if (!file.Open(path)) return false;
+        return DecodeCompressedMesh(reinterpret_cast<const uint8_t*>(file.Data()), file.Size(), mesh);
+    }
+}
@@ -0,0 +1,90 @@
+#ifndef COMPRESSED_MESH_H
+#define COMPRESSED_MESH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "mesh_buffer.h"
+
+// Compressed mesh container (.omz).
+// Positions, normals, colors and texture coordinates are quantized; connectivity is coded by a
+// front-based region growing traversal in the spirit of Edgebreaker: every face is reached across an
+// edge of the front, and its new corners are coded as a fresh vertex, a front neighbour to the left or
+// right, or an explicit back reference. New vertices are predicted by the parallelogram rule from the
+// face across the gate. All symbols go through the built-in rANS coder (utils/entropy_coder.h).
+// The mesh is cut into spatially compact chunks that are coded independently: vertices on a chunk
+// border are repeated in every chunk that uses them and tied to their first copy by a short table, so
+// encoding and decoding run a chunk per worker. Vertex and face order are not kept, nor the first
+// corner of a face; faces that are not manifold are coded by index and survive unchanged.
+namespace MeshIO {
+
+    constexpr char COMPRESSED_MESH_MAGIC[8] = { 'O', 'M', 'Z', 'M', 'E', 'S', 'H', '\0' };
+    constexpr uint32_t COMPRESSED_MESH_VERSION = 1;
+
+    // CompressedMeshHeader::flags
+    constexpr uint32_t COMPRESSED_MESH_TRIANGLES = 1;
+    constexpr uint32_t COMPRESSED_MESH_VERTEX_NORMALS = 2;
+    constexpr uint32_t COMPRESSED_MESH_VERTEX_COLORS = 4;
+    constexpr uint32_t COMPRESSED_MESH_TEXCOORDS = 8;
+
+    struct CompressionOptions {
+
+        int positionBits = 14;              // per axis over the bounding cube, 1 to 30
+        int normalBits = 10;                // per octahedral coordinate, 2 to 30
+        int texcoordBits = 12;              // per axis over the bounding square, 1 to 30
+        size_t chunkSize = size_t(1) << 16; // faces (or loose points) per chunk
+
+        // attributes of the buffer that are kept when present
+        bool vertexNormals = true;
+        bool vertexColors = true;
+        bool texcoords = true;
+    };
+
+    struct CompressedMeshHeader {
+
+        char magic[8];
+        uint32_t version;
+        uint32_t flags;
+        uint64_t vertexCount;
+        uint64_t faceCount;
+        uint64_t cornerCount;
+        uint32_t chunkCount;
+        uint32_t byteOrder;
+        uint32_t positionBits;
+        uint32_t normalBits;
+        uint32_t texcoordBits;
+        uint32_t reserved;
+        float positionMin[3];
+        float positionStep;                 // position = min + quantized * step
+        float texcoordMin[2];
+        float texcoordStep;
+        float reserved2;
+    };
+
+    // chunk payloads follow the table back to back
+    struct CompressedMeshChunkEntry {
+
+        uint64_t offset;
+        uint64_t size;
+        uint32_t faceCount;
+        uint32_t cornerCount;
+        uint32_t vertexCount;               // including copies of border vertices
+        uint32_t ownedCount;                // vertices first coded in this chunk
+    };
+
+    bool EncodeCompressedMesh(const MeshBuffer& mesh, std::vector<uint8_t>& out, const CompressionOptions& options = {});
+    bool DecodeCompressedMesh(const uint8_t* data, size_t size, MeshBuffer& mesh);
+
+    // Up to maxPoints positions for a preview, taken from a few evenly spaced chunks decoded on their own
+    // instead of the whole mesh.
+    bool SampleCompressedMesh(const uint8_t* data, size_t size, size_t maxPoints, std::vector<float>& points);
+
+    bool WriteCompressedMesh(const std::string& path, const MeshBuffer& mesh, const CompressionOptions& options = {});
+    bool ReadCompressedMesh(const std::string& path, MeshBuffer& mesh);
+
+    bool IsCompressedMesh(const char* data, size_t size);
+}
+
+#endif // !COMPRESSED_MESH_H
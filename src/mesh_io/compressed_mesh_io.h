@@ -0,0 +1,103 @@
+#ifndef COMPRESSED_MESH_IO_H
+#define COMPRESSED_MESH_IO_H
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <istream>
+#include <iterator>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <OpenMesh/Core/IO/IOManager.hh>
+#include <OpenMesh/Core/IO/reader/BaseReader.hh>
+#include <OpenMesh/Core/IO/writer/BaseWriter.hh>
+
+#include "compressed_mesh.h"
+#include "mesh_export.h"
+#include "mesh_import.h"
+
+// IOManager modules for the compressed mesh format, so read_mesh and write_mesh take .omz files like
+// any built-in format once RegisterCompressedMeshFormat has run. Both go through a MeshBuffer: the
+// reader decodes and hands it to Import, the writer fills it with Export and encodes it.
+namespace MeshIO {
+
+    namespace Detail {
+
+        // a file name ending in .omz, or the bare extension as IOManager passes it when filtering
+        inline bool IsCompressedMeshName(const std::string& name) {
+
+            std::string ext = name.substr(name.find_last_of('.') == std::string::npos ? 0 : name.find_last_of('.') + 1);
+            std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+            return ext == "omz";
+        }
+    }
+
+    class CompressedMeshReader : public OpenMesh::IO::BaseReader {
+
+        // main functions
+    public:
+        std::string get_description() const override { return "Compressed mesh"; }
+        std::string get_extensions() const override { return "omz"; }
+        bool can_u_read(const std::string& filename) const override { return Detail::IsCompressedMeshName(filename); }
+
+        bool read(const std::string& filename, OpenMesh::IO::BaseImporter& importer, OpenMesh::IO::Options& opt) override {
+
+            MeshBuffer buffer;
+            return ReadCompressedMesh(filename, buffer) && Import(buffer, importer, opt);
+        }
+
+        bool read(std::istream& is, OpenMesh::IO::BaseImporter& importer, OpenMesh::IO::Options& opt) override {
+
+            const std::vector<uint8_t> bytes{ std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>() };
+            MeshBuffer buffer;
+            return DecodeCompressedMesh(bytes.data(), bytes.size(), buffer) && Import(buffer, importer, opt);
+        }
+    };
+
+    class CompressedMeshWriter : public OpenMesh::IO::BaseWriter {
+
+        // main functions
+    public:
+        std::string get_description() const override { return "Compressed mesh"; }
+        std::string get_extensions() const override { return "omz"; }
+        bool can_u_write(const std::string& filename) const override { return Detail::IsCompressedMeshName(filename); }
+
+        // the precision of the ascii writers has no meaning here, quantization is set by `options`
+        bool write(const std::string& filename, OpenMesh::IO::BaseExporter& exporter, OpenMesh::IO::Options opt,
+                   std::streamsize = 6) const override {
+
+            MeshBuffer buffer;
+            Export(exporter, opt, buffer);
+            return WriteCompressedMesh(filename, buffer, options);
+        }
+
+        bool write(std::ostream& os, OpenMesh::IO::BaseExporter& exporter, OpenMesh::IO::Options opt,
+                   std::streamsize = 6) const override {
+
+            MeshBuffer buffer;
+            std::vector<uint8_t> bytes;
+            Export(exporter, opt, buffer);
+            if (!EncodeCompressedMesh(buffer, bytes, options)) return false;
+            return static_cast<bool>(os.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size())));
+        }
+
+        // variables
+    public:
+        CompressionOptions options;
+    };
+
+    // The registered writer, for changing its quantization. The first call registers both modules with
+    // OpenMesh::IO::IOManager(); later calls only return the writer.
+    inline CompressedMeshWriter& RegisterCompressedMeshFormat() {
+
+        static CompressedMeshReader reader;
+        static CompressedMeshWriter writer;
+        static const bool registered = OpenMesh::IO::IOManager().register_module(&reader) && OpenMesh::IO::IOManager().register_module(&writer);
+        (void)registered;
+        return writer;
+    }
+}
+
+#endif // !COMPRESSED_MESH_IO_H
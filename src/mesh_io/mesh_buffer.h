@@ -0,0 +1,46 @@
+#ifndef MESH_BUFFER_H
+#define MESH_BUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct MeshMaterial {
+
+    std::string name;
+    float diffuse[3] = { 0.0f, 0.0f, 0.0f };
+    bool hasDiffuse = false;
+    float alpha = 1.0f;
+    std::string diffuseTexture;
+};
+
+// flat polygon mesh as produced by the fast readers
+struct MeshBuffer {
+
+    std::vector<float> positions;       // xyz per vertex
+    std::vector<float> vertexNormals;   // xyz per vertex, may be empty
+    std::vector<float> vertexColors;    // rgb per vertex in [0, 1], may be empty
+
+    std::vector<uint32_t> indices;      // vertex index per face corner
+    std::vector<uint32_t> faceOffsets;  // first corner of every face plus the end, empty if all faces are triangles
+    std::vector<float> faceNormals;     // xyz per face, may be empty
+    std::vector<float> texcoords;       // uv per face corner, may be empty
+
+    std::vector<int> faceMaterials;     // index into materials per face (-1 for none), may be empty
+    std::vector<MeshMaterial> materials;
+
+    size_t VertexCount() const { return positions.size() / 3; }
+    size_t FaceCount() const { return faceOffsets.empty() ? indices.size() / 3 : faceOffsets.size() - 1; }
+    bool IsTriangleMesh() const { return faceOffsets.empty(); }
+
+    size_t FaceBegin(size_t f) const { return faceOffsets.empty() ? f * 3 : faceOffsets[f]; }
+    size_t FaceEnd(size_t f) const { return faceOffsets.empty() ? f * 3 + 3 : faceOffsets[f + 1]; }
+
+    void Clear() {
+
+        *this = MeshBuffer();
+    }
+};
+
+#endif // !MESH_BUFFER_H
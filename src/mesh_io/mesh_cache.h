@@ -0,0 +1,307 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <OpenMesh/Core/Mesh/Handles.hh>
+
+#include "../mesh/topology_version.h"
+#include "../utils/file_hash.h"
+#include "../utils/mapped_file.h"
+#include "../utils/parallel.h"
+
+// Native mesh cache.
+// The file holds the raw ArrayKernel vertex/edge/face arrays and the standard property arrays
+// as 64-byte aligned blocks, so loading is a resize plus one memcpy per block out of a memory
+// mapping; handles are indices and need no fixup beyond a range check. The cache is tied to the
+// hash of the source file it was built from and to the kernel item sizes of the mesh type.
+namespace MeshIO {
+
+    constexpr char MESH_CACHE_MAGIC[8] = { 'O', 'M', 'C', 'A', 'C', 'H', 'E', '\0' };
+    constexpr uint32_t MESH_CACHE_VERSION = 1;
+    constexpr uint64_t MESH_CACHE_ALIGNMENT = 64;
+
+    enum class MeshCacheBlock : uint32_t {
+
+        Vertices, Edges, Faces,
+        Points, VertexNormals, VertexColors, VertexTexCoords2D, VertexStatus,
+        HalfedgeTexCoords2D, HalfedgeStatus,
+        EdgeStatus,
+        FaceNormals, FaceColors, FaceTextureIndex, FaceStatus
+    };
+
+    struct MeshCacheHeader {
+
+        char magic[8];
+        uint32_t version;
+        uint32_t blockCount;
+        uint64_t sourceHash;
+        uint64_t vertexCount;
+        uint64_t edgeCount;
+        uint64_t faceCount;
+        uint32_t vertexSize;
+        uint32_t halfedgeSize;
+        uint32_t faceSize;
+        uint32_t byteOrder;
+    };
+
+    struct MeshCacheBlockEntry {
+
+        uint32_t id;
+        uint32_t elementSize;
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    namespace Detail {
+
+        constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+        struct CacheSource {
+
+            MeshCacheBlock id;
+            uint32_t elementSize;
+            const void* data;
+            uint64_t size;
+        };
+
+        // visit every standard property array of the mesh that is present (or requested when reading)
+        template <class Mesh, class Visitor>
+        void ForEachCacheProperty(Mesh& mesh, Visitor&& visit) {
+
+            visit(MeshCacheBlock::Points, mesh.points_pph(), [] { return true; }, [] {});
+            visit(MeshCacheBlock::VertexNormals, mesh.vertex_normals_pph(), [&] { return mesh.has_vertex_normals(); }, [&] { mesh.request_vertex_normals(); });
+            visit(MeshCacheBlock::VertexColors, mesh.vertex_colors_pph(), [&] { return mesh.has_vertex_colors(); }, [&] { mesh.request_vertex_colors(); });
+            visit(MeshCacheBlock::VertexTexCoords2D, mesh.vertex_texcoords2D_pph(), [&] { return mesh.has_vertex_texcoords2D(); }, [&] { mesh.request_vertex_texcoords2D(); });
+            visit(MeshCacheBlock::VertexStatus, mesh.vertex_status_pph(), [&] { return mesh.has_vertex_status(); }, [&] { mesh.request_vertex_status(); });
+            visit(MeshCacheBlock::HalfedgeTexCoords2D, mesh.halfedge_texcoords2D_pph(), [&] { return mesh.has_halfedge_texcoords2D(); }, [&] { mesh.request_halfedge_texcoords2D(); });
+            visit(MeshCacheBlock::HalfedgeStatus, mesh.halfedge_status_pph(), [&] { return mesh.has_halfedge_status(); }, [&] { mesh.request_halfedge_status(); });
+            visit(MeshCacheBlock::EdgeStatus, mesh.edge_status_pph(), [&] { return mesh.has_edge_status(); }, [&] { mesh.request_edge_status(); });
+            visit(MeshCacheBlock::FaceNormals, mesh.face_normals_pph(), [&] { return mesh.has_face_normals(); }, [&] { mesh.request_face_normals(); });
+            visit(MeshCacheBlock::FaceColors, mesh.face_colors_pph(), [&] { return mesh.has_face_colors(); }, [&] { mesh.request_face_colors(); });
+            visit(MeshCacheBlock::FaceTextureIndex, mesh.face_texture_index_pph(), [&] { return mesh.has_face_texture_index(); }, [&] { mesh.request_face_texture_index(); });
+            visit(MeshCacheBlock::FaceStatus, mesh.face_status_pph(), [&] { return mesh.has_face_status(); }, [&] { mesh.request_face_status(); });
+        }
+
+        // every stored handle has to point inside the mesh, a corrupt cache must not crash later
+        template <class Mesh>
+        bool CheckConnectivity(const Mesh& mesh) {
+
+            const int nv = static_cast<int>(mesh.n_vertices());
+            const int nh = static_cast<int>(mesh.n_halfedges());
+            const int nf = static_cast<int>(mesh.n_faces());
+            auto inRange = [](int idx, int n) { return idx >= -1 && idx < n; };
+
+            const size_t chunks = Parallel::Concurrency();
+            std::vector<char> valid(chunks, 1);
+            Parallel::ForChunks(size_t(nh), chunks, [&](size_t chunk, size_t begin, size_t end) {
+
+                for (size_t h = begin; h < end; ++h) {
+
+                    const OpenMesh::HalfedgeHandle heh(static_cast<int>(h));
+                    if (!inRange(mesh.to_vertex_handle(heh).idx(), nv) || !inRange(mesh.face_handle(heh).idx(), nf) ||
+                        !inRange(mesh.next_halfedge_handle(heh).idx(), nh)) valid[chunk] = 0;
+                }
+            });
+            Parallel::ForChunks(size_t(nv), chunks, [&](size_t chunk, size_t begin, size_t end) {
+
+                for (size_t v = begin; v < end; ++v)
+                    if (!inRange(mesh.halfedge_handle(OpenMesh::VertexHandle(static_cast<int>(v))).idx(), nh)) valid[chunk] = 0;
+            });
+            Parallel::ForChunks(size_t(nf), chunks, [&](size_t chunk, size_t begin, size_t end) {
+
+                for (size_t f = begin; f < end; ++f)
+                    if (!inRange(mesh.halfedge_handle(OpenMesh::FaceHandle(static_cast<int>(f))).idx(), nh)) valid[chunk] = 0;
+            });
+
+            for (char v : valid)
+                if (!v) return false;
+            return true;
+        }
+    }
+
+    template <class Mesh>
+    bool WriteMeshCache(const std::string& path, Mesh& mesh, uint64_t sourceHash) {
+
+        using Detail::CacheSource;
+
+        const size_t nv = mesh.n_vertices(), ne = mesh.n_edges(), nf = mesh.n_faces();
+
+        std::vector<CacheSource> sources;
+        sources.push_back({ MeshCacheBlock::Vertices, sizeof(typename Mesh::Vertex), nv ? &mesh.vertex(OpenMesh::VertexHandle(0)) : nullptr, nv * sizeof(typename Mesh::Vertex) });
+        sources.push_back({ MeshCacheBlock::Edges, sizeof(typename Mesh::Edge), ne ? &mesh.edge(OpenMesh::EdgeHandle(0)) : nullptr, ne * sizeof(typename Mesh::Edge) });
+        sources.push_back({ MeshCacheBlock::Faces, sizeof(typename Mesh::Face), nf ? &mesh.face(OpenMesh::FaceHandle(0)) : nullptr, nf * sizeof(typename Mesh::Face) });
+
+        Detail::ForEachCacheProperty(mesh, [&](MeshCacheBlock id, auto pph, auto has, auto) {
+
+            if (!has()) return;
+
+            const auto& values = mesh.property(pph).data_vector();
+            using T = typename std::decay_t<decltype(values)>::value_type;
+            sources.push_back({ id, sizeof(T), values.data(), values.size() * sizeof(T) });
+        });
+
+        MeshCacheHeader header{};
+        std::memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic));
+        header.version = MESH_CACHE_VERSION;
+        header.blockCount = static_cast<uint32_t>(sources.size());
+        header.sourceHash = sourceHash;
+        header.vertexCount = nv;
+        header.edgeCount = ne;
+        header.faceCount = nf;
+        header.vertexSize = sizeof(typename Mesh::Vertex);
+        header.halfedgeSize = sizeof(typename Mesh::Halfedge);
+        header.faceSize = sizeof(typename Mesh::Face);
+        header.byteOrder = Detail::BYTE_ORDER_MARK;
+
+        auto align = [](uint64_t offset) { return (offset + MESH_CACHE_ALIGNMENT - 1) / MESH_CACHE_ALIGNMENT * MESH_CACHE_ALIGNMENT; };
+
+        std::vector<MeshCacheBlockEntry> entries(sources.size());
+        uint64_t offset = align(sizeof(MeshCacheHeader) + entries.size() * sizeof(MeshCacheBlockEntry));
+        for (size_t i = 0; i < sources.size(); ++i) {
+
+            entries[i] = { static_cast<uint32_t>(sources[i].id), sources[i].elementSize, offset, sources[i].size };
+            offset = align(offset + sources[i].size);
+        }
+
+        FILE* file = fopen(path.c_str(), "wb");
+        if (file == nullptr) {
+
+            fprintf(stderr, "WriteMeshCache: cannot open %s\n", path.c_str());
+            return false;
+        }
+
+        bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+        ok = ok && fwrite(entries.data(), sizeof(MeshCacheBlockEntry), entries.size(), file) == entries.size();
+
+        const char padding[MESH_CACHE_ALIGNMENT] = {};
+        uint64_t written = sizeof(MeshCacheHeader) + entries.size() * sizeof(MeshCacheBlockEntry);
+        for (size_t i = 0; i < sources.size() && ok; ++i) {
+
+            ok = fwrite(padding, 1, entries[i].offset - written, file) == entries[i].offset - written;
+            if (sources[i].size) ok = ok && fwrite(sources[i].data, 1, sources[i].size, file) == sources[i].size;
+            written = entries[i].offset + sources[i].size;
+        }
+
+        ok = fclose(file) == 0 && ok;
+        if (!ok) {
+
+            fprintf(stderr, "WriteMeshCache: failed to write %s\n", path.c_str());
+            std::remove(path.c_str());
+        }
+        return ok;
+    }
+
+    // Load a cache written by WriteMeshCache. Fails (leaving the mesh empty) if the cache is
+    // missing, was written by another version or mesh type, or was built from another source.
+    template <class Mesh>
+    bool ReadMeshCache(const std::string& path, Mesh& mesh, uint64_t sourceHash) {
+
+        MappedFile file;
+        if (!file.Open(path) || file.Size() < sizeof(MeshCacheHeader)) return false;
+
+        MeshCacheHeader header;
+        std::memcpy(&header, file.Data(), sizeof(header));
+
+        const bool compatible = std::memcmp(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic)) == 0 &&
+            header.version == MESH_CACHE_VERSION && header.byteOrder == Detail::BYTE_ORDER_MARK &&
+            header.vertexSize == sizeof(typename Mesh::Vertex) && header.halfedgeSize == sizeof(typename Mesh::Halfedge) &&
+            header.faceSize == sizeof(typename Mesh::Face);
+        if (!compatible || header.sourceHash != sourceHash) return false;
+
+        const uint64_t tableEnd = sizeof(MeshCacheHeader) + uint64_t(header.blockCount) * sizeof(MeshCacheBlockEntry);
+        if (tableEnd > file.Size()) return false;
+
+        std::vector<MeshCacheBlockEntry> entries(header.blockCount);
+        std::memcpy(entries.data(), file.Data() + sizeof(MeshCacheHeader), entries.size() * sizeof(MeshCacheBlockEntry));
+
+        // every block has to lie in the file and the counts have to fit it before anything is allocated
+        const uint64_t fileSize = file.Size();
+        auto fits = [fileSize](uint64_t count, uint64_t elementSize) { return count <= fileSize / elementSize; };
+        bool ok = fits(header.vertexCount, sizeof(typename Mesh::Vertex)) && fits(header.edgeCount, sizeof(typename Mesh::Edge)) &&
+                  fits(header.faceCount, sizeof(typename Mesh::Face));
+        for (const MeshCacheBlockEntry& entry : entries) ok = ok && entry.offset <= fileSize && entry.size <= fileSize - entry.offset;
+        if (!ok) {
+
+            fprintf(stderr, "ReadMeshCache: %s is corrupt\n", path.c_str());
+            return false;
+        }
+
+        mesh.clear();
+        mesh.resize(header.vertexCount, header.edgeCount, header.faceCount);
+
+        auto copyBlock = [&](const MeshCacheBlockEntry& entry, void* dst, size_t elementSize, size_t bytes) {
+
+            if (entry.elementSize != elementSize || entry.size != bytes) {
+
+                ok = false;
+                return;
+            }
+            if (bytes) Parallel::Copy(dst, file.Data() + entry.offset, bytes);
+        };
+
+        for (const MeshCacheBlockEntry& entry : entries) {
+
+            switch (static_cast<MeshCacheBlock>(entry.id)) {
+
+            case MeshCacheBlock::Vertices:
+                copyBlock(entry, header.vertexCount ? &mesh.vertex(OpenMesh::VertexHandle(0)) : nullptr,
+                          sizeof(typename Mesh::Vertex), header.vertexCount * sizeof(typename Mesh::Vertex));
+                break;
+            case MeshCacheBlock::Edges:
+                copyBlock(entry, header.edgeCount ? &mesh.edge(OpenMesh::EdgeHandle(0)) : nullptr,
+                          sizeof(typename Mesh::Edge), header.edgeCount * sizeof(typename Mesh::Edge));
+                break;
+            case MeshCacheBlock::Faces:
+                copyBlock(entry, header.faceCount ? &mesh.face(OpenMesh::FaceHandle(0)) : nullptr,
+                          sizeof(typename Mesh::Face), header.faceCount * sizeof(typename Mesh::Face));
+                break;
+            default:
+                Detail::ForEachCacheProperty(mesh, [&](MeshCacheBlock id, auto pph, auto has, auto request) {
+
+                    if (static_cast<uint32_t>(id) != entry.id) return;
+                    if (!has()) request();
+
+                    auto& values = mesh.property(pph).data_vector();
+                    using T = typename std::decay_t<decltype(values)>::value_type;
+                    copyBlock(entry, values.data(), sizeof(T), values.size() * sizeof(T));
+                });
+                break;
+            }
+            if (!ok) break;
+        }
+
+        if (!ok || !Detail::CheckConnectivity(mesh)) {
+
+            fprintf(stderr, "ReadMeshCache: %s is corrupt\n", path.c_str());
+            mesh.clear();
+            return false;
+        }
+
+        // the connectivity was replaced wholesale, whatever was derived from the old one is stale
+        MeshTools::TouchTopology(mesh);
+        return true;
+    }
+
+    // Load `source` through the cache at `cachePath`: the cache is used when it was built from the
+    // same source file contents, otherwise load(mesh) runs and the cache is rebuilt from its result.
+    template <class Mesh, class Loader>
+    bool LoadWithCache(const std::string& source, const std::string& cachePath, Mesh& mesh, Loader&& load) {
+
+        uint64_t sourceHash = 0;
+        if (!Hash::File(source, sourceHash)) return false;
+
+        if (ReadMeshCache(cachePath, mesh, sourceHash)) return true;
+        if (!load(mesh)) return false;
+
+        WriteMeshCache(cachePath, mesh, sourceHash);
+        return true;
+    }
+}
+
+#endif // !MESH_CACHE_H
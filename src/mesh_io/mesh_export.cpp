@@ -0,0 +1,88 @@
+#include "mesh_export.h"
+
+#include <vector>
+
+#include "../utils/parallel.h"
+
+namespace {
+
+    // BaseExporter has no has_face_texcoords in this OpenMesh version, the mesh is asked for the halfedge
+    // texcoords itself; kernel() is a plain getter that was never made const
+    bool HasFaceTexcoords(const OpenMesh::IO::BaseExporter& exporter) {
+
+        const OpenMesh::BaseKernel* kernel = const_cast<OpenMesh::IO::BaseExporter&>(exporter).kernel();
+        return kernel && kernel->_get_hprop("h:texcoords2D") != nullptr;
+    }
+}
+
+namespace MeshIO {
+
+    void Export(const OpenMesh::IO::BaseExporter& exporter, const OpenMesh::IO::Options& opt, MeshBuffer& buffer) {
+
+        buffer.Clear();
+
+        const size_t vertexCount = exporter.n_vertices();
+        const size_t faceCount = exporter.n_faces();
+        const bool normals = opt.vertex_has_normal() && exporter.has_vertex_normals();
+        const bool colors = opt.vertex_has_color() && exporter.has_vertex_colors();
+        const bool faceTexcoords = opt.face_has_texcoord() && HasFaceTexcoords(exporter);
+        const bool vertexTexcoords = !faceTexcoords && opt.vertex_has_texcoord() && exporter.has_vertex_texcoords();
+
+        buffer.positions.resize(vertexCount * 3);
+        if (normals) buffer.vertexNormals.resize(vertexCount * 3);
+        if (colors) buffer.vertexColors.resize(vertexCount * 3);
+        Parallel::For(0, vertexCount, [&](size_t begin, size_t end) {
+
+            for (size_t v = begin; v < end; ++v) {
+
+                const OpenMesh::VertexHandle vh(static_cast<int>(v));
+                const OpenMesh::Vec3f p = exporter.point(vh);
+                for (int k = 0; k < 3; ++k) buffer.positions[v * 3 + k] = p[k];
+                if (normals) {
+
+                    const OpenMesh::Vec3f n = exporter.normal(vh);
+                    for (int k = 0; k < 3; ++k) buffer.vertexNormals[v * 3 + k] = n[k];
+                }
+                if (colors) {
+
+                    const OpenMesh::Vec3f c = exporter.colorf(vh);
+                    for (int k = 0; k < 3; ++k) buffer.vertexColors[v * 3 + k] = c[k];
+                }
+            }
+        });
+
+        // valences first, then the corners at their scanned offsets
+        std::vector<uint32_t> offsets(faceCount + 1, 0);
+        Parallel::For(0, faceCount, [&](size_t begin, size_t end) {
+
+            std::vector<OpenMesh::VertexHandle> vhandles;
+            for (size_t f = begin; f < end; ++f) offsets[f] = exporter.get_vhandles(OpenMesh::FaceHandle(static_cast<int>(f)), vhandles);
+        });
+        buffer.indices.resize(Parallel::ExclusiveScan(offsets));
+        if (faceTexcoords || vertexTexcoords) buffer.texcoords.resize(buffer.indices.size() * 2);
+
+        bool triangles = true;
+        Parallel::For(0, faceCount, [&](size_t begin, size_t end) {
+
+            std::vector<OpenMesh::VertexHandle> vhandles;
+            for (size_t f = begin; f < end; ++f) {
+
+                const OpenMesh::FaceHandle fh(static_cast<int>(f));
+                exporter.get_vhandles(fh, vhandles);
+                for (size_t i = 0; i < vhandles.size(); ++i) {
+
+                    const size_t c = offsets[f] + i;
+                    buffer.indices[c] = static_cast<uint32_t>(vhandles[i].idx());
+                    if (faceTexcoords || vertexTexcoords) {
+
+                        const OpenMesh::Vec2f uv = faceTexcoords ? exporter.texcoord(exporter.getHeh(fh, vhandles[i])) : exporter.texcoord(vhandles[i]);
+                        buffer.texcoords[c * 2] = uv[0];
+                        buffer.texcoords[c * 2 + 1] = uv[1];
+                    }
+                }
+            }
+        });
+        for (size_t f = 0; f < faceCount && triangles; ++f) triangles = offsets[f + 1] - offsets[f] == 3;
+        if (!triangles) buffer.faceOffsets = std::move(offsets);
+    }
+}
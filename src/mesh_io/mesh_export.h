@@ -0,0 +1,17 @@
+#ifndef MESH_EXPORT_H
+#define MESH_EXPORT_H
+
+#include <OpenMesh/Core/IO/Options.hh>
+#include <OpenMesh/Core/IO/exporter/BaseExporter.hh>
+
+#include "mesh_buffer.h"
+
+namespace MeshIO {
+
+    // Flatten a mesh behind an OpenMesh exporter, the interface the IOManager writers read from; the
+    // counterpart of Import. Attributes are only taken when `opt` asks for them and the mesh has them,
+    // face texcoords win over vertex texcoords. Vertices and faces are gathered on the workers.
+    void Export(const OpenMesh::IO::BaseExporter& exporter, const OpenMesh::IO::Options& opt, MeshBuffer& buffer);
+}
+
+#endif // !MESH_EXPORT_H
@@ -0,0 +1,146 @@
+#include "mesh_import.h"
+
+#include <map>
+
+namespace MeshIO {
+
+    namespace Detail {
+
+        ImportAttributes::ImportAttributes(const MeshBuffer& buffer, const OpenMesh::IO::Options& opt) {
+
+            const size_t vertexCount = buffer.VertexCount();
+            const size_t faceCount = buffer.FaceCount();
+            const size_t cornerCount = buffer.indices.size();
+
+            // only transfer what the file had and the caller asked for
+            vertexNormals = opt.vertex_has_normal() && buffer.vertexNormals.size() == vertexCount * 3;
+            vertexColors = opt.vertex_has_color() && buffer.vertexColors.size() == vertexCount * 3;
+            faceNormals = opt.face_has_normal() && buffer.faceNormals.size() == faceCount * 3;
+            const bool hasTexcoords = buffer.texcoords.size() == cornerCount * 2 && cornerCount > 0;
+            vertexTexcoords = opt.vertex_has_texcoord() && hasTexcoords;
+            faceTexcoords = opt.face_has_texcoord() && hasTexcoords;
+            hasMaterials = buffer.faceMaterials.size() == faceCount && !buffer.materials.empty();
+            faceColors = opt.face_has_color() && hasMaterials;
+        }
+
+        OpenMesh::IO::Options ImportAttributes::Transferred() const {
+
+            using OpenMesh::IO::Options;
+
+            Options opt;
+            if (vertexNormals) opt += Options::VertexNormal;
+            if (vertexColors) opt += Options::VertexColor;
+            if (vertexTexcoords) opt += Options::VertexTexCoord;
+            if (faceNormals) opt += Options::FaceNormal;
+            if (faceTexcoords) opt += Options::FaceTexCoord;
+            if (faceColors) opt += Options::FaceColor;
+            return opt;
+        }
+
+        void ImportFaceAttributes(const MeshBuffer& buffer, OpenMesh::IO::BaseImporter& importer, const ImportAttributes& attributes,
+                                  const std::vector<OpenMesh::VertexHandle>& vhandles, const std::vector<OpenMesh::FaceHandle>& fhandles) {
+
+            // textures get ids from 1 in order of first use, 0 means untextured
+            std::vector<int> textureIds(buffer.materials.size(), 0);
+            if (attributes.hasMaterials && attributes.faceTexcoords) {
+
+                std::map<std::string, int> textures;
+                for (size_t m = 0; m < buffer.materials.size(); ++m) {
+
+                    const std::string& name = buffer.materials[m].diffuseTexture;
+                    if (name.empty()) continue;
+
+                    auto it = textures.find(name);
+                    if (it == textures.end()) {
+
+                        it = textures.emplace(name, static_cast<int>(textures.size()) + 1).first;
+                        importer.add_texture_information(it->second, name);
+                    }
+                    textureIds[m] = it->second;
+                }
+            }
+
+            std::vector<OpenMesh::Vec2f> faceUVs;
+            for (size_t f = 0; f < buffer.FaceCount(); ++f) {
+
+                const size_t begin = buffer.FaceBegin(f);
+                const size_t end = buffer.FaceEnd(f);
+
+                if (attributes.vertexTexcoords) {
+
+                    for (size_t c = begin; c < end; ++c)
+                        importer.set_texcoord(vhandles[buffer.indices[c]], OpenMesh::Vec2f(buffer.texcoords[c * 2], buffer.texcoords[c * 2 + 1]));
+                }
+
+                const OpenMesh::FaceHandle fh = fhandles[f];
+                if (!fh.is_valid()) continue;
+
+                if (attributes.faceNormals) {
+
+                    const float* n = &buffer.faceNormals[f * 3];
+                    importer.set_normal(fh, OpenMesh::Vec3f(n[0], n[1], n[2]));
+                }
+                if (attributes.faceTexcoords) {
+
+                    faceUVs.resize(end - begin);
+                    for (size_t c = begin; c < end; ++c)
+                        faceUVs[c - begin] = OpenMesh::Vec2f(buffer.texcoords[c * 2], buffer.texcoords[c * 2 + 1]);
+                    importer.add_face_texcoords(fh, vhandles[buffer.indices[begin]], faceUVs);
+                }
+                if (attributes.hasMaterials && buffer.faceMaterials[f] >= 0) {
+
+                    const MeshMaterial& material = buffer.materials[buffer.faceMaterials[f]];
+                    if (attributes.faceColors && material.hasDiffuse)
+                        importer.set_color(fh, OpenMesh::Vec3f(material.diffuse[0], material.diffuse[1], material.diffuse[2]));
+                    if (attributes.faceTexcoords)
+                        importer.set_face_texindex(fh, textureIds[buffer.faceMaterials[f]]);
+                }
+            }
+        }
+    }
+
+    bool Import(const MeshBuffer& buffer, OpenMesh::IO::BaseImporter& importer, OpenMesh::IO::Options& opt) {
+
+        const size_t vertexCount = buffer.VertexCount();
+        const size_t faceCount = buffer.FaceCount();
+        const Detail::ImportAttributes attributes(buffer, opt);
+
+        importer.prepare();
+        importer.reserve(static_cast<unsigned int>(vertexCount),
+                         static_cast<unsigned int>(vertexCount + faceCount),
+                         static_cast<unsigned int>(faceCount));
+
+        std::vector<OpenMesh::VertexHandle> vhandles(vertexCount);
+        for (size_t v = 0; v < vertexCount; ++v) {
+
+            const float* p = &buffer.positions[v * 3];
+            vhandles[v] = importer.add_vertex(OpenMesh::Vec3f(p[0], p[1], p[2]));
+
+            if (attributes.vertexNormals) {
+
+                const float* n = &buffer.vertexNormals[v * 3];
+                importer.set_normal(vhandles[v], OpenMesh::Vec3f(n[0], n[1], n[2]));
+            }
+            if (attributes.vertexColors) {
+
+                const float* c = &buffer.vertexColors[v * 3];
+                importer.set_color(vhandles[v], OpenMesh::Vec3f(c[0], c[1], c[2]));
+            }
+        }
+
+        OpenMesh::IO::BaseImporter::VHandles face;
+        std::vector<OpenMesh::FaceHandle> fhandles(faceCount);
+        for (size_t f = 0; f < faceCount; ++f) {
+
+            face.clear();
+            for (size_t c = buffer.FaceBegin(f); c < buffer.FaceEnd(f); ++c) face.push_back(vhandles[buffer.indices[c]]);
+            fhandles[f] = importer.add_face(face);
+        }
+
+        Detail::ImportFaceAttributes(buffer, importer, attributes, vhandles, fhandles);
+        importer.finish();
+
+        opt = attributes.Transferred();
+        return true;
+    }
+}
@@ -0,0 +1,133 @@
+#ifndef MESH_IMPORT_H
+#define MESH_IMPORT_H
+
+#include <cstring>
+#include <type_traits>
+
+#include <OpenMesh/Core/IO/Options.hh>
+#include <OpenMesh/Core/IO/importer/ImporterT.hh>
+#include <OpenMesh/Core/Utils/color_cast.hh>
+
+#include "mesh_buffer.h"
+#include "../mesh/mesh_builder.h"
+#include "../utils/parallel.h"
+
+namespace MeshIO {
+
+    namespace Detail {
+
+        // which attributes of a buffer get transferred for the requested options
+        struct ImportAttributes {
+
+            bool vertexNormals, vertexColors, faceNormals, vertexTexcoords, faceTexcoords, hasMaterials, faceColors;
+
+            ImportAttributes(const MeshBuffer& buffer, const OpenMesh::IO::Options& opt);
+            OpenMesh::IO::Options Transferred() const;
+        };
+
+        // texcoords, face normals, colors and texture ids once all faces exist, fhandles is invalid for dropped faces
+        void ImportFaceAttributes(const MeshBuffer& buffer, OpenMesh::IO::BaseImporter& importer, const ImportAttributes& attributes,
+                                  const std::vector<OpenMesh::VertexHandle>& vhandles, const std::vector<OpenMesh::FaceHandle>& fhandles);
+
+        template <class Mesh>
+        void CopyVertexAttributes(const MeshBuffer& buffer, Mesh& mesh, bool vertexNormals, bool vertexColors) {
+
+            using Normal = typename Mesh::Normal;
+            using Color = typename Mesh::Color;
+
+            const size_t vertexCount = buffer.VertexCount();
+            if (vertexNormals) {
+
+                mesh.request_vertex_normals();
+                std::vector<Normal>& normals = mesh.property(mesh.vertex_normals_pph()).data_vector();
+                Parallel::For(0, vertexCount, [&](size_t begin, size_t end) {
+
+                    for (size_t v = begin; v < end; ++v) {
+
+                        const float* n = &buffer.vertexNormals[v * 3];
+                        normals[v] = Normal(n[0], n[1], n[2]);
+                    }
+                });
+            }
+
+            if (vertexColors) {
+
+                mesh.request_vertex_colors();
+                std::vector<Color>& colors = mesh.property(mesh.vertex_colors_pph()).data_vector();
+                Parallel::For(0, vertexCount, [&](size_t begin, size_t end) {
+
+                    for (size_t v = begin; v < end; ++v) {
+
+                        const float* c = &buffer.vertexColors[v * 3];
+                        colors[v] = OpenMesh::color_cast<Color>(OpenMesh::Vec3f(c[0], c[1], c[2]));
+                    }
+                });
+            }
+        }
+    }
+
+    // Feed a flat mesh to an OpenMesh importer, the same interface the IOManager readers write to.
+    // Attributes are only transferred when the caller asked for them in `opt`, on return it holds what was read.
+    bool Import(const MeshBuffer& buffer, OpenMesh::IO::BaseImporter& importer, OpenMesh::IO::Options& opt);
+
+    // Point clouds skip the importer, vertex arrays are copied block-wise into the mesh property vectors.
+    template <class Mesh>
+    bool ImportPoints(const MeshBuffer& buffer, Mesh& mesh, OpenMesh::IO::Options& opt) {
+
+        using Point = typename Mesh::Point;
+
+        const size_t vertexCount = buffer.VertexCount();
+        const Detail::ImportAttributes attributes(buffer, opt);
+
+        mesh.clear();
+        mesh.resize(vertexCount, 0, 0);
+
+        std::vector<Point>& points = mesh.property(mesh.points_pph()).data_vector();
+        Parallel::For(0, vertexCount, [&](size_t begin, size_t end) {
+
+            if constexpr (std::is_same_v<Point, OpenMesh::Vec3f>) {
+
+                std::memcpy(points[begin].data(), &buffer.positions[begin * 3], (end - begin) * sizeof(Point));
+            }
+            else {
+
+                for (size_t v = begin; v < end; ++v) {
+
+                    const float* p = &buffer.positions[v * 3];
+                    points[v] = Point(p[0], p[1], p[2]);
+                }
+            }
+        });
+
+        Detail::CopyVertexAttributes(buffer, mesh, attributes.vertexNormals, attributes.vertexColors);
+        MeshTools::TouchTopology(mesh);
+
+        opt.clear();
+        if (attributes.vertexNormals) opt += OpenMesh::IO::Options::VertexNormal;
+        if (attributes.vertexColors) opt += OpenMesh::IO::Options::VertexColor;
+        return true;
+    }
+
+    // Meshes are built in bulk from the index arrays, attributes are then written through an ImporterT.
+    template <class Mesh>
+    bool Import(const MeshBuffer& buffer, Mesh& mesh, OpenMesh::IO::Options& opt) {
+
+        if (buffer.FaceCount() == 0) return ImportPoints(buffer, mesh, opt);
+
+        const Detail::ImportAttributes attributes(buffer, opt);
+        const MeshTools::MeshBuildResult built = MeshTools::BuildMesh(mesh, buffer);
+        Detail::CopyVertexAttributes(buffer, mesh, attributes.vertexNormals, attributes.vertexColors);
+
+        std::vector<OpenMesh::VertexHandle> vhandles(buffer.VertexCount());
+        for (size_t v = 0; v < vhandles.size(); ++v) vhandles[v] = OpenMesh::VertexHandle(static_cast<int>(v));
+        std::vector<OpenMesh::FaceHandle> fhandles(built.faceHandle.begin(), built.faceHandle.end());
+
+        OpenMesh::IO::ImporterT<Mesh> importer(mesh);
+        Detail::ImportFaceAttributes(buffer, importer, attributes, vhandles, fhandles);
+
+        opt = attributes.Transferred();
+        return true;
+    }
+}
+
+#endif // !MESH_IMPORT_H
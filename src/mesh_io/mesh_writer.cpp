@@ -0,0 +1,339 @@
+#include "mesh_writer.h"
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+
+#include "../utils/parallel.h"
+
+static_assert(std::endian::native == std::endian::little, "binary PLY and STL are written little endian");
+
+namespace {
+
+    // elements per chunk and chunks formatted before they are written, bounds the memory held in buffers
+    constexpr size_t CHUNK_SIZE = 1 << 15;
+    constexpr size_t CHUNKS_PER_CORE = 4;
+
+    // "%.{precision}g" of the float widened to double, what ostream << float prints. Precision is
+    // clamped to 100 digits, more than a float ever carries.
+    inline void AppendFloat(std::string& out, float value, int precision) {
+
+        char text[160];
+        precision = std::clamp(precision, 0, 100);
+        const auto result = std::to_chars(text, text + sizeof(text), value, std::chars_format::general, precision);
+        out.append(text, result.ptr);
+    }
+
+    inline void AppendInt(std::string& out, long long value) {
+
+        char text[24];
+        const auto result = std::to_chars(text, text + sizeof(text), value);
+        out.append(text, result.ptr);
+    }
+
+    inline void AppendFloats(std::string& out, const float* values, int count, int precision) {
+
+        for (int k = 0; k < count; ++k) {
+
+            if (k) out += ' ';
+            AppendFloat(out, values[k], precision);
+        }
+    }
+
+    template <typename T>
+    inline void AppendBinary(std::string& out, T value) {
+
+        out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    bool Write(FILE* file, const void* data, size_t bytes) {
+
+        return bytes == 0 || fwrite(data, 1, bytes, file) == bytes;
+    }
+
+    // format [0, count) chunk by chunk on the workers and append the chunks to the file in order
+    bool WriteChunks(FILE* file, size_t count, const std::function<void(size_t, size_t, std::string&)>& format) {
+
+        const size_t chunks = (count + CHUNK_SIZE - 1) / CHUNK_SIZE;
+        const size_t round = Parallel::Concurrency() * CHUNKS_PER_CORE;
+        std::vector<std::string> buffers(std::min(chunks, round));
+        for (size_t first = 0; first < chunks; first += round) {
+
+            const size_t n = std::min(round, chunks - first);
+            Parallel::For(0, n, [&](size_t begin, size_t end) {
+
+                for (size_t i = begin; i < end; ++i) {
+
+                    const size_t b = (first + i) * CHUNK_SIZE;
+                    buffers[i].clear();
+                    format(b, std::min(count, b + CHUNK_SIZE), buffers[i]);
+                }
+            }, 1);
+
+            for (size_t i = 0; i < n; ++i)
+                if (!Write(file, buffers[i].data(), buffers[i].size())) return false;
+        }
+        return true;
+    }
+
+    // ascii in text mode, line ends then match the ostream writers on every platform
+    FILE* OpenOutput(const char* writer, const std::string& path, bool binary) {
+
+        FILE* file = fopen(path.c_str(), binary ? "wb" : "w");
+        if (file == nullptr) fprintf(stderr, "%s: cannot open %s\n", writer, path.c_str());
+        return file;
+    }
+
+    bool CloseOutput(const char* writer, const std::string& path, FILE* file, bool ok) {
+
+        ok = fclose(file) == 0 && ok;
+        if (!ok) {
+
+            fprintf(stderr, "%s: failed to write %s\n", writer, path.c_str());
+            std::remove(path.c_str());
+        }
+        return ok;
+    }
+
+    // ((c - b) % (a - b)).normalize() in float, like _STLWriter_
+    void FaceNormal(const MeshIO::MeshWriteView& mesh, size_t f, float* n) {
+
+        if (mesh.faceNormals) {
+
+            std::memcpy(n, mesh.faceNormals + f * 3, 3 * sizeof(float));
+            return;
+        }
+
+        const size_t first = mesh.FaceBegin(f);
+        const float* a = mesh.positions + size_t(mesh.indices[first]) * 3;
+        const float* b = mesh.positions + size_t(mesh.indices[first + 1]) * 3;
+        const float* c = mesh.positions + size_t(mesh.indices[first + 2]) * 3;
+        const float u[3] = { c[0] - b[0], c[1] - b[1], c[2] - b[2] };
+        const float v[3] = { a[0] - b[0], a[1] - b[1], a[2] - b[2] };
+        n[0] = u[1] * v[2] - u[2] * v[1];
+        n[1] = u[2] * v[0] - u[0] * v[2];
+        n[2] = u[0] * v[1] - u[1] * v[0];
+
+        const float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        for (int k = 0; k < 3; ++k) n[k] /= length;
+    }
+}
+
+namespace MeshIO {
+
+    bool WriteObj(const std::string& path, const MeshWriteView& mesh, int precision) {
+
+        FILE* file = OpenOutput("WriteObj", path, false);
+        if (file == nullptr) return false;
+
+        std::string header = "# ";
+        AppendInt(header, static_cast<long long>(mesh.vertexCount));
+        header += " vertices, ";
+        AppendInt(header, static_cast<long long>(mesh.faceCount));
+        header += " faces\n";
+        bool ok = Write(file, header.data(), header.size());
+
+        ok = ok && WriteChunks(file, mesh.vertexCount, [&](size_t begin, size_t end, std::string& out) {
+
+            for (size_t v = begin; v < end; ++v) {
+
+                out += "v ";
+                AppendFloats(out, mesh.positions + v * 3, 3, precision);
+                out += '\n';
+                if (mesh.vertexNormals) {
+
+                    out += "vn ";
+                    AppendFloats(out, mesh.vertexNormals + v * 3, 3, precision);
+                    out += '\n';
+                }
+            }
+        });
+
+        // indices from 1, "i//i" when normals were written
+        ok = ok && WriteChunks(file, mesh.faceCount, [&](size_t begin, size_t end, std::string& out) {
+
+            for (size_t f = begin; f < end; ++f) {
+
+                out += 'f';
+                for (size_t c = mesh.FaceBegin(f); c < mesh.FaceEnd(f); ++c) {
+
+                    const long long idx = static_cast<long long>(mesh.indices[c]) + 1;
+                    out += ' ';
+                    AppendInt(out, idx);
+                    if (mesh.vertexNormals) {
+
+                        out += "//";
+                        AppendInt(out, idx);
+                    }
+                }
+                out += '\n';
+            }
+        });
+        return CloseOutput("WriteObj", path, file, ok);
+    }
+
+    bool WritePly(const std::string& path, const MeshWriteView& mesh, bool binary, int precision) {
+
+        FILE* file = OpenOutput("WritePly", path, binary);
+        if (file == nullptr) return false;
+
+        std::string header = "ply\n";
+        header += binary ? "format binary_little_endian 1.0\n" : "format ascii 1.0\n";
+        header += "element vertex ";
+        AppendInt(header, static_cast<long long>(mesh.vertexCount));
+        header += "\nproperty float x\nproperty float y\nproperty float z\n";
+        if (mesh.vertexNormals) header += "property float nx\nproperty float ny\nproperty float nz\n";
+        if (mesh.vertexTexcoords) header += "property float u\nproperty float v\n";
+        if (mesh.vertexColors) header += "property uchar red\nproperty uchar green\nproperty uchar blue\n";
+        header += "element face ";
+        AppendInt(header, static_cast<long long>(mesh.faceCount));
+        header += "\nproperty list uchar int vertex_indices\nend_header\n";
+        bool ok = Write(file, header.data(), header.size());
+
+        const bool positionsOnly = !mesh.vertexNormals && !mesh.vertexTexcoords && !mesh.vertexColors;
+        if (binary && positionsOnly) {
+
+            // the vertex records are the position array as it is
+            ok = ok && Write(file, mesh.positions, mesh.vertexCount * 3 * sizeof(float));
+        }
+        else if (binary) {
+
+            ok = ok && WriteChunks(file, mesh.vertexCount, [&](size_t begin, size_t end, std::string& out) {
+
+                for (size_t v = begin; v < end; ++v) {
+
+                    out.append(reinterpret_cast<const char*>(mesh.positions + v * 3), 3 * sizeof(float));
+                    if (mesh.vertexNormals) out.append(reinterpret_cast<const char*>(mesh.vertexNormals + v * 3), 3 * sizeof(float));
+                    if (mesh.vertexTexcoords) out.append(reinterpret_cast<const char*>(mesh.vertexTexcoords + v * 2), 2 * sizeof(float));
+                    if (mesh.vertexColors) out.append(reinterpret_cast<const char*>(mesh.vertexColors + v * 3), 3);
+                }
+            });
+        }
+        else {
+
+            ok = ok && WriteChunks(file, mesh.vertexCount, [&](size_t begin, size_t end, std::string& out) {
+
+                for (size_t v = begin; v < end; ++v) {
+
+                    AppendFloats(out, mesh.positions + v * 3, 3, precision);
+                    if (mesh.vertexNormals) {
+
+                        out += ' ';
+                        AppendFloats(out, mesh.vertexNormals + v * 3, 3, precision);
+                    }
+                    if (mesh.vertexTexcoords) {
+
+                        out += ' ';
+                        AppendFloats(out, mesh.vertexTexcoords + v * 2, 2, precision);
+                    }
+                    if (mesh.vertexColors) {
+
+                        for (int k = 0; k < 3; ++k) {
+
+                            out += ' ';
+                            AppendInt(out, mesh.vertexColors[v * 3 + k]);
+                        }
+                    }
+                    out += '\n';
+                }
+            });
+        }
+
+        ok = ok && WriteChunks(file, mesh.faceCount, [&](size_t begin, size_t end, std::string& out) {
+
+            for (size_t f = begin; f < end; ++f) {
+
+                const size_t first = mesh.FaceBegin(f), last = mesh.FaceEnd(f);
+                if (binary) {
+
+                    AppendBinary(out, static_cast<uint8_t>(last - first));
+                    for (size_t c = first; c < last; ++c) AppendBinary(out, static_cast<int32_t>(mesh.indices[c]));
+                }
+                else {
+
+                    AppendInt(out, static_cast<long long>(last - first));
+                    for (size_t c = first; c < last; ++c) {
+
+                        out += ' ';
+                        AppendInt(out, mesh.indices[c]);
+                    }
+                    out += '\n';
+                }
+            }
+        });
+        return CloseOutput("WritePly", path, file, ok);
+    }
+
+    bool WriteStl(const std::string& path, const MeshWriteView& mesh, bool binary, int precision) {
+
+        FILE* file = OpenOutput("WriteStl", path, binary);
+        if (file == nullptr) return false;
+
+        auto isTriangle = [&mesh](size_t f) { return mesh.FaceEnd(f) - mesh.FaceBegin(f) == 3; };
+
+        bool ok = true;
+        if (binary) {
+
+            size_t triangleCount = mesh.faceCount;
+            if (mesh.faceOffsets) {
+
+                triangleCount = 0;
+                for (size_t f = 0; f < mesh.faceCount; ++f) triangleCount += isTriangle(f);
+            }
+
+            char header[84];
+            std::memset(header, ' ', 80);
+            std::memcpy(header, "binary stl file", 15);
+            const uint32_t count = static_cast<uint32_t>(triangleCount);
+            std::memcpy(header + 80, &count, sizeof(count));
+            ok = Write(file, header, sizeof(header));
+
+            // normal, three corners, a zero attribute
+            ok = ok && WriteChunks(file, mesh.faceCount, [&](size_t begin, size_t end, std::string& out) {
+
+                for (size_t f = begin; f < end; ++f) {
+
+                    if (!isTriangle(f)) continue;
+
+                    float record[12];
+                    FaceNormal(mesh, f, record);
+                    for (int i = 0; i < 3; ++i)
+                        std::memcpy(record + 3 + i * 3, mesh.positions + size_t(mesh.indices[mesh.FaceBegin(f) + i]) * 3, 3 * sizeof(float));
+                    out.append(reinterpret_cast<const char*>(record), sizeof(record));
+                    AppendBinary(out, uint16_t(0));
+                }
+            });
+            return CloseOutput("WriteStl", path, file, ok);
+        }
+
+        ok = Write(file, "solid \n", 7);
+        ok = ok && WriteChunks(file, mesh.faceCount, [&](size_t begin, size_t end, std::string& out) {
+
+            for (size_t f = begin; f < end; ++f) {
+
+                // faces that are not triangles leave an empty facet, as _STLWriter_ does
+                if (isTriangle(f)) {
+
+                    float n[3];
+                    FaceNormal(mesh, f, n);
+                    out += "facet normal ";
+                    AppendFloats(out, n, 3, precision);
+                    out += "\nouter loop\n";
+                    for (int i = 0; i < 3; ++i) {
+
+                        out += "vertex ";
+                        AppendFloats(out, mesh.positions + size_t(mesh.indices[mesh.FaceBegin(f) + i]) * 3, 3, precision);
+                        out += '\n';
+                    }
+                }
+                out += "\nendloop\nendfacet\n";
+            }
+        });
+        ok = ok && Write(file, "endsolid\n", 9);
+        return CloseOutput("WriteStl", path, file, ok);
+    }
+}
@@ -0,0 +1,172 @@
+#ifndef MESH_WRITER_H
+#define MESH_WRITER_H
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <OpenMesh/Core/IO/MeshIO.hh>
+
+#include "../utils/parallel.h"
+
+namespace MeshIO {
+
+    // what the writers read, arrays may point straight into mesh properties
+    struct MeshWriteView {
+
+        const float* positions = nullptr;       // xyz per vertex
+        const float* vertexNormals = nullptr;   // xyz per vertex, may be null
+        const float* vertexTexcoords = nullptr; // uv per vertex, may be null
+        const uint8_t* vertexColors = nullptr;  // rgb per vertex, may be null
+        size_t vertexCount = 0;
+
+        const uint32_t* indices = nullptr;      // vertex index per face corner
+        const uint32_t* faceOffsets = nullptr;  // first corner of every face plus the end, null if all faces are triangles
+        const float* faceNormals = nullptr;     // xyz per face, may be null (STL computes them then)
+        size_t faceCount = 0;
+
+        size_t FaceBegin(size_t f) const { return faceOffsets ? faceOffsets[f] : f * 3; }
+        size_t FaceEnd(size_t f) const { return faceOffsets ? faceOffsets[f + 1] : f * 3 + 3; }
+    };
+
+    // Parallel writers laid out like _OBJWriter_, _PLYWriter_ and _STLWriter_. Chunks of elements are
+    // formatted on the workers with std::to_chars, as "%.{precision}g" like the ostream writers, and
+    // appended to the file in order in large blocks; ascii output is byte for byte what OpenMesh writes
+    // with the same precision. Binary PLY is little endian; binary STL skips faces that are not triangles.
+    bool WriteObj(const std::string& path, const MeshWriteView& mesh, int precision = 6);
+    bool WritePly(const std::string& path, const MeshWriteView& mesh, bool binary, int precision = 6);
+    bool WriteStl(const std::string& path, const MeshWriteView& mesh, bool binary, int precision = 6);
+
+    namespace Detail {
+
+        // the property array itself when it already holds floats, a converted copy otherwise
+        template <typename Vec>
+        const float* FloatArray(const std::vector<Vec>& values, std::vector<float>& storage) {
+
+            if (values.empty()) return nullptr;
+            if constexpr (std::is_same_v<typename Vec::value_type, float>) {
+
+                return values.data()->data();
+            }
+            else {
+
+                constexpr size_t N = Vec::size();
+                storage.resize(values.size() * N);
+                Parallel::For(0, values.size(), [&](size_t begin, size_t end) {
+
+                    for (size_t i = begin; i < end; ++i)
+                        for (size_t k = 0; k < N; ++k) storage[i * N + k] = static_cast<float>(values[i][k]);
+                });
+                return storage.data();
+            }
+        }
+
+        // corners in fv_iter order, starting at the face halfedge like ExporterT::get_vhandles
+        template <class Mesh>
+        void FaceCorners(const Mesh& mesh, std::vector<uint32_t>& indices, std::vector<uint32_t>& faceOffsets) {
+
+            const size_t faceCount = mesh.n_faces();
+            auto corner = [&mesh](OpenMesh::HalfedgeHandle heh) { return static_cast<uint32_t>(mesh.to_vertex_handle(heh).idx()); };
+
+            if constexpr (Mesh::IsTriMesh) {
+
+                faceOffsets.clear();
+                indices.resize(faceCount * 3);
+                Parallel::For(0, faceCount, [&](size_t begin, size_t end) {
+
+                    for (size_t f = begin; f < end; ++f) {
+
+                        const OpenMesh::HalfedgeHandle h0 = mesh.halfedge_handle(OpenMesh::FaceHandle(static_cast<int>(f)));
+                        const OpenMesh::HalfedgeHandle h1 = mesh.next_halfedge_handle(h0);
+                        indices[f * 3] = corner(h0);
+                        indices[f * 3 + 1] = corner(h1);
+                        indices[f * 3 + 2] = corner(mesh.next_halfedge_handle(h1));
+                    }
+                });
+                return;
+            }
+
+            faceOffsets.assign(faceCount + 1, 0);
+            Parallel::For(0, faceCount, [&](size_t begin, size_t end) {
+
+                for (size_t f = begin; f < end; ++f) faceOffsets[f] = static_cast<uint32_t>(mesh.valence(OpenMesh::FaceHandle(static_cast<int>(f))));
+            });
+            indices.resize(Parallel::ExclusiveScan(faceOffsets));
+            Parallel::For(0, faceCount, [&](size_t begin, size_t end) {
+
+                for (size_t f = begin; f < end; ++f) {
+
+                    const OpenMesh::HalfedgeHandle first = mesh.halfedge_handle(OpenMesh::FaceHandle(static_cast<int>(f)));
+                    OpenMesh::HalfedgeHandle heh = first;
+                    uint32_t c = faceOffsets[f];
+                    do {
+
+                        indices[c++] = corner(heh);
+                        heh = mesh.next_halfedge_handle(heh);
+                    } while (heh != first);
+                }
+            });
+        }
+    }
+
+    // Drop-in for OpenMesh::IO::write_mesh on obj, ply and stl files. Options the parallel writers do not
+    // cover (texture coordinates in OBJ, face or float colors, alpha, big endian, custom properties)
+    // and every other format go through write_mesh itself.
+    template <class Mesh>
+    bool WriteMesh(const Mesh& mesh, const std::string& path, OpenMesh::IO::Options opt = OpenMesh::IO::Options::Default,
+                   std::streamsize precision = 6) {
+
+        using OpenMesh::IO::Options;
+
+        std::string ext = path.substr(std::min(path.size(), path.find_last_of('.')));
+        for (char& c : ext) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        const bool isObj = ext == ".obj", isPly = ext == ".ply", isStl = ext == ".stl" || ext == ".stla" || ext == ".stlb";
+
+        // requested attributes have to exist, write_mesh fails on them the same way
+        bool supported = (isObj || isPly || isStl) && !opt.check(Options::FaceColor) && !opt.check(Options::FaceTexCoord) &&
+            !opt.check(Options::ColorAlpha) && !opt.check(Options::ColorFloat) && !opt.check(Options::Custom) && !opt.check(Options::MSB);
+        if (opt.check(Options::VertexNormal)) supported = supported && !isStl && mesh.has_vertex_normals();
+        if (opt.check(Options::VertexTexCoord)) supported = supported && isPly && mesh.has_vertex_texcoords2D();
+        if (opt.check(Options::VertexColor)) supported = supported && isPly && mesh.has_vertex_colors() &&
+            std::is_same_v<typename Mesh::Color, OpenMesh::Vec3uc>;
+        if (opt.check(Options::FaceNormal)) supported = supported && !isObj;
+        if (!supported) return OpenMesh::IO::write_mesh(mesh, path, opt, precision);
+
+        MeshWriteView view;
+        std::vector<float> positions, normals, texcoords, faceNormals;
+        std::vector<uint32_t> indices, faceOffsets;
+
+        view.vertexCount = mesh.n_vertices();
+        view.positions = Detail::FloatArray(mesh.property(mesh.points_pph()).data_vector(), positions);
+        if (opt.check(Options::VertexNormal))
+            view.vertexNormals = Detail::FloatArray(mesh.property(mesh.vertex_normals_pph()).data_vector(), normals);
+        if (opt.check(Options::VertexTexCoord))
+            view.vertexTexcoords = Detail::FloatArray(mesh.property(mesh.vertex_texcoords2D_pph()).data_vector(), texcoords);
+        if constexpr (std::is_same_v<typename Mesh::Color, OpenMesh::Vec3uc>) {
+
+            if (opt.check(Options::VertexColor) && view.vertexCount)
+                view.vertexColors = mesh.property(mesh.vertex_colors_pph()).data_vector().data()->data();
+        }
+
+        view.faceCount = mesh.n_faces();
+        Detail::FaceCorners(mesh, indices, faceOffsets);
+        view.indices = indices.data();
+        view.faceOffsets = faceOffsets.empty() ? nullptr : faceOffsets.data();
+
+        // the STL writer takes the face normals whenever the mesh has them
+        if (isStl && mesh.has_face_normals())
+            view.faceNormals = Detail::FloatArray(mesh.property(mesh.face_normals_pph()).data_vector(), faceNormals);
+
+        const int digits = static_cast<int>(precision);
+        if (isObj) return WriteObj(path, view, digits);
+        if (isPly) return WritePly(path, view, opt.check(Options::Binary), digits);
+        const bool binary = ext == ".stlb" || (ext != ".stla" && opt.check(Options::Binary));
+        return WriteStl(path, view, binary, digits);
+    }
+}
+
+#endif // !MESH_WRITER_H
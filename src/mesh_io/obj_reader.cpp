@@ -0,0 +1,470 @@
+#include "obj_reader.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <unordered_map>
+
+#include "../utils/mapped_file.h"
+#include "../utils/parallel.h"
+
+namespace {
+
+    // corner references are stored as int64: absolute indices are >= 0, relative ones are
+    // chunk-local and offset by RELATIVE_INDEX until the chunk's global offset is known
+    constexpr int64_t NO_INDEX = std::numeric_limits<int64_t>::min();
+    constexpr int64_t RELATIVE_INDEX = int64_t(1) << 40;
+
+    // faces seen before the first usemtl of a chunk continue the material of the previous chunk
+    constexpr int INHERIT_MATERIAL = -2;
+
+    struct ObjChunk {
+
+        std::vector<float> positions;
+        std::vector<float> colors;
+        std::vector<float> texcoords;
+        std::vector<float> normals;
+
+        std::vector<uint32_t> faceSizes;
+        std::vector<int64_t> corners;       // v, vt, vn per corner
+        std::vector<int> faceMaterials;     // index into materialNames
+
+        std::vector<std::string> materialNames;
+        std::vector<std::string> libraries;
+        int currentMaterial = INHERIT_MATERIAL;
+
+        bool hasColors = false;
+        bool failed = false;
+    };
+
+    inline bool IsSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+    inline const char* SkipSpace(const char* p, const char* end) {
+
+        while (p < end && IsSpace(*p)) ++p;
+        return p;
+    }
+
+    inline const char* TokenEnd(const char* p, const char* end) {
+
+        while (p < end && !IsSpace(*p)) ++p;
+        return p;
+    }
+
+    inline bool ParseFloat(const char*& p, const char* end, float& value) {
+
+        p = SkipSpace(p, end);
+        if (p < end && *p == '+') ++p;
+
+        const std::from_chars_result r = std::from_chars(p, end, value);
+        if (r.ec != std::errc()) return false;
+        p = r.ptr;
+        return true;
+    }
+
+    // parse up to `max` floats, returns how many were read
+    inline int ParseFloats(const char* p, const char* end, float* values, int max) {
+
+        int n = 0;
+        while (n < max && ParseFloat(p, end, values[n])) ++n;
+        return n;
+    }
+
+    inline int64_t EncodeIndex(int64_t index, size_t localCount) {
+
+        if (index > 0) return index - 1;
+        return static_cast<int64_t>(localCount) + index - RELATIVE_INDEX;
+    }
+
+    bool ParseFace(const char* p, const char* end, ObjChunk& chunk) {
+
+        const size_t cornerBegin = chunk.corners.size();
+        const size_t positionCount = chunk.positions.size() / 3;
+        const size_t texcoordCount = chunk.texcoords.size() / 2;
+        const size_t normalCount = chunk.normals.size() / 3;
+
+        while ((p = SkipSpace(p, end)) < end) {
+
+            const char* tokenEnd = TokenEnd(p, end);
+            int64_t ref[3] = { NO_INDEX, NO_INDEX, NO_INDEX };
+
+            for (int k = 0; k < 3 && p < tokenEnd; ++k) {
+
+                if (*p != '/') {
+
+                    int64_t index = 0;
+                    const std::from_chars_result r = std::from_chars(p, tokenEnd, index);
+                    if (r.ec != std::errc() || index == 0) return false;
+                    p = r.ptr;
+
+                    const size_t count = k == 0 ? positionCount : (k == 1 ? texcoordCount : normalCount);
+                    ref[k] = EncodeIndex(index, count);
+                }
+                if (p < tokenEnd && *p == '/') ++p;
+            }
+            if (ref[0] == NO_INDEX) return false;
+
+            chunk.corners.insert(chunk.corners.end(), ref, ref + 3);
+            p = tokenEnd;
+        }
+
+        const size_t size = (chunk.corners.size() - cornerBegin) / 3;
+        if (size < 3) {
+
+            // points and lines are not faces
+            chunk.corners.resize(cornerBegin);
+            return true;
+        }
+        chunk.faceSizes.push_back(static_cast<uint32_t>(size));
+        chunk.faceMaterials.push_back(chunk.currentMaterial);
+        return true;
+    }
+
+    void ParseChunk(const char* p, const char* end, ObjChunk& chunk) {
+
+        std::unordered_map<std::string, int> materialIds;
+
+        while (p < end) {
+
+            const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', end - p));
+            if (lineEnd == nullptr) lineEnd = end;
+
+            const char* s = SkipSpace(p, lineEnd);
+            const char* keyEnd = TokenEnd(s, lineEnd);
+            const size_t keyLength = keyEnd - s;
+
+            if (keyLength == 1 && s[0] == 'v') {
+
+                float v[6];
+                const int n = ParseFloats(keyEnd, lineEnd, v, 6);
+                if (n < 3) {
+
+                    chunk.failed = true;
+                    return;
+                }
+                chunk.positions.insert(chunk.positions.end(), v, v + 3);
+
+                if (n == 6 && !chunk.hasColors) {
+
+                    chunk.hasColors = true;
+                    chunk.colors.assign(chunk.positions.size() - 3, 1.0f);
+                }
+                if (chunk.hasColors) {
+
+                    if (n == 6) chunk.colors.insert(chunk.colors.end(), v + 3, v + 6);
+                    else chunk.colors.insert(chunk.colors.end(), 3, 1.0f);
+                }
+            }
+            else if (keyLength == 2 && s[0] == 'v' && s[1] == 't') {
+
+                float t[2] = { 0.0f, 0.0f };
+                if (ParseFloats(keyEnd, lineEnd, t, 2) < 1) {
+
+                    chunk.failed = true;
+                    return;
+                }
+                chunk.texcoords.insert(chunk.texcoords.end(), t, t + 2);
+            }
+            else if (keyLength == 2 && s[0] == 'v' && s[1] == 'n') {
+
+                float n[3];
+                if (ParseFloats(keyEnd, lineEnd, n, 3) < 3) {
+
+                    chunk.failed = true;
+                    return;
+                }
+                chunk.normals.insert(chunk.normals.end(), n, n + 3);
+            }
+            else if (keyLength == 1 && s[0] == 'f') {
+
+                if (!ParseFace(keyEnd, lineEnd, chunk)) {
+
+                    chunk.failed = true;
+                    return;
+                }
+            }
+            else if (keyLength == 6 && std::memcmp(s, "usemtl", 6) == 0) {
+
+                const char* name = SkipSpace(keyEnd, lineEnd);
+                std::string key(name, TokenEnd(name, lineEnd));
+
+                auto it = materialIds.find(key);
+                if (it == materialIds.end()) {
+
+                    it = materialIds.emplace(key, static_cast<int>(chunk.materialNames.size())).first;
+                    chunk.materialNames.push_back(key);
+                }
+                chunk.currentMaterial = it->second;
+            }
+            else if (keyLength == 6 && std::memcmp(s, "mtllib", 6) == 0) {
+
+                const char* name = SkipSpace(keyEnd, lineEnd);
+                const char* nameEnd = lineEnd;
+                while (nameEnd > name && IsSpace(nameEnd[-1])) --nameEnd;
+                chunk.libraries.emplace_back(name, nameEnd);
+            }
+
+            p = lineEnd + 1;
+        }
+    }
+
+    std::string DirectoryOf(const std::string& path) {
+
+        const size_t slash = path.find_last_of("/\\");
+        return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+    }
+
+    inline bool ResolveIndex(int64_t ref, size_t offset, size_t count, uint32_t& index) {
+
+        int64_t i = ref < 0 ? ref + RELATIVE_INDEX + static_cast<int64_t>(offset) : ref;
+        if (i < 0 || i >= static_cast<int64_t>(count)) return false;
+        index = static_cast<uint32_t>(i);
+        return true;
+    }
+}
+
+namespace MeshIO {
+
+    bool ReadMtl(const std::string& path, std::vector<MeshMaterial>& materials) {
+
+        std::ifstream in(path);
+        if (!in) {
+
+            fprintf(stderr, "ReadMtl: cannot open %s\n", path.c_str());
+            return false;
+        }
+
+        MeshMaterial* material = nullptr;
+        std::string line, key;
+        while (std::getline(in, line)) {
+
+            std::istringstream stream(line);
+            if (!(stream >> key)) continue;
+
+            if (key == "newmtl") {
+
+                materials.emplace_back();
+                material = &materials.back();
+                stream >> material->name;
+            }
+            else if (material == nullptr) {
+
+                continue;
+            }
+            else if (key == "Kd") {
+
+                stream >> material->diffuse[0] >> material->diffuse[1] >> material->diffuse[2];
+                material->hasDiffuse = !stream.fail();
+            }
+            else if (key == "d") {
+
+                stream >> material->alpha;
+            }
+            else if (key == "Tr") {
+
+                float transparency = 0.0f;
+                if (stream >> transparency) material->alpha = 1.0f - transparency;
+            }
+            else if (key == "map_Kd") {
+
+                // the file name is the last token, options may precede it
+                std::string token;
+                while (stream >> token) material->diffuseTexture = token;
+            }
+        }
+        return true;
+    }
+
+    bool ReadObj(const std::string& path, MeshBuffer& mesh) {
+
+        mesh.Clear();
+
+        MappedFile file;
+        if (!file.Open(path)) return false;
+
+        const char* data = file.Data();
+        const size_t size = file.Size();
+
+        // chunk boundaries are moved forward to the next line start
+        const size_t chunkCount = std::max<size_t>(1, std::min<size_t>(Parallel::Concurrency() * 4, size / (1 << 16)));
+        std::vector<size_t> bounds(chunkCount + 1, size);
+        bounds[0] = 0;
+        for (size_t i = 1; i < chunkCount; ++i) {
+
+            size_t b = std::max(bounds[i - 1], size * i / chunkCount);
+            const void* newline = b < size ? std::memchr(data + b, '\n', size - b) : nullptr;
+            bounds[i] = newline ? static_cast<const char*>(newline) - data + 1 : size;
+        }
+
+        std::vector<ObjChunk> chunks(chunkCount);
+        Parallel::ForChunks(chunkCount, chunkCount, [&](size_t, size_t begin, size_t end) {
+
+            for (size_t i = begin; i < end; ++i) ParseChunk(data + bounds[i], data + bounds[i + 1], chunks[i]);
+        });
+
+        for (const ObjChunk& chunk : chunks) {
+
+            if (chunk.failed) {
+
+                fprintf(stderr, "ReadObj: malformed line in %s\n", path.c_str());
+                return false;
+            }
+        }
+
+        // materials, in the order the libraries are referenced
+        std::unordered_map<std::string, int> materialIds;
+        for (const ObjChunk& chunk : chunks) {
+
+            for (const std::string& library : chunk.libraries) {
+
+                const size_t first = mesh.materials.size();
+                ReadMtl(DirectoryOf(path) + library, mesh.materials);
+                for (size_t m = first; m < mesh.materials.size(); ++m)
+                    materialIds.emplace(mesh.materials[m].name, static_cast<int>(m));
+            }
+        }
+
+        // running offsets of every element type
+        struct Offsets { size_t positions = 0, texcoords = 0, normals = 0, faces = 0, corners = 0; };
+        std::vector<Offsets> offsets(chunkCount + 1);
+        bool hasColors = false, allTriangles = true;
+        for (size_t i = 0; i < chunkCount; ++i) {
+
+            const ObjChunk& chunk = chunks[i];
+            offsets[i + 1].positions = offsets[i].positions + chunk.positions.size() / 3;
+            offsets[i + 1].texcoords = offsets[i].texcoords + chunk.texcoords.size() / 2;
+            offsets[i + 1].normals = offsets[i].normals + chunk.normals.size() / 3;
+            offsets[i + 1].faces = offsets[i].faces + chunk.faceSizes.size();
+            offsets[i + 1].corners = offsets[i].corners + chunk.corners.size() / 3;
+
+            hasColors |= chunk.hasColors;
+            allTriangles &= std::all_of(chunk.faceSizes.begin(), chunk.faceSizes.end(), [](uint32_t n) { return n == 3; });
+        }
+        const Offsets& total = offsets[chunkCount];
+
+        // material of every chunk's first faces is the last one of the chunk before
+        std::vector<int> chunkMaterials(chunkCount + 1, -1);
+        std::vector<std::vector<int>> localMaterials(chunkCount);
+        for (size_t i = 0; i < chunkCount; ++i) {
+
+            const ObjChunk& chunk = chunks[i];
+            for (const std::string& name : chunk.materialNames) {
+
+                auto it = materialIds.find(name);
+                localMaterials[i].push_back(it == materialIds.end() ? -1 : it->second);
+            }
+            chunkMaterials[i + 1] = chunk.currentMaterial == INHERIT_MATERIAL ? chunkMaterials[i] : localMaterials[i][chunk.currentMaterial];
+        }
+
+        // texcoords and normals are only kept when faces reference them
+        bool hasTexcoords = false, hasNormals = false;
+        for (const ObjChunk& chunk : chunks) {
+
+            for (size_t c = 0; c < chunk.corners.size(); c += 3) {
+
+                hasTexcoords |= chunk.corners[c + 1] != NO_INDEX;
+                hasNormals |= chunk.corners[c + 2] != NO_INDEX;
+            }
+        }
+
+        mesh.positions.resize(total.positions * 3);
+        if (hasColors) mesh.vertexColors.resize(total.positions * 3);
+        mesh.indices.resize(total.corners);
+        if (!allTriangles) mesh.faceOffsets.resize(total.faces + 1);
+        if (hasTexcoords) mesh.texcoords.assign(total.corners * 2, 0.0f);
+        if (!mesh.materials.empty()) mesh.faceMaterials.resize(total.faces);
+
+        std::vector<uint32_t> cornerNormals;
+        if (hasNormals) cornerNormals.assign(total.corners, std::numeric_limits<uint32_t>::max());
+
+        // texcoord values are needed while merging since faces may reference earlier chunks
+        std::vector<float> texcoordPool;
+        if (hasTexcoords) {
+
+            texcoordPool.resize(total.texcoords * 2);
+            for (size_t i = 0; i < chunkCount; ++i)
+                std::copy(chunks[i].texcoords.begin(), chunks[i].texcoords.end(), texcoordPool.begin() + offsets[i].texcoords * 2);
+        }
+
+        std::vector<char> chunkValid(chunkCount, 1);
+        Parallel::ForChunks(chunkCount, chunkCount, [&](size_t, size_t begin, size_t end) {
+
+            for (size_t i = begin; i < end; ++i) {
+
+                const ObjChunk& chunk = chunks[i];
+                const Offsets& o = offsets[i];
+
+                std::copy(chunk.positions.begin(), chunk.positions.end(), mesh.positions.begin() + o.positions * 3);
+                if (hasColors) {
+
+                    if (chunk.hasColors) std::copy(chunk.colors.begin(), chunk.colors.end(), mesh.vertexColors.begin() + o.positions * 3);
+                    else std::fill_n(mesh.vertexColors.begin() + o.positions * 3, chunk.positions.size(), 1.0f);
+                }
+
+                size_t corner = o.corners;
+                for (size_t f = 0; f < chunk.faceSizes.size(); ++f) {
+
+                    if (!allTriangles) mesh.faceOffsets[o.faces + f] = static_cast<uint32_t>(corner);
+                    if (!mesh.faceMaterials.empty()) {
+
+                        const int local = chunk.faceMaterials[f];
+                        mesh.faceMaterials[o.faces + f] = local == INHERIT_MATERIAL ? -1 : localMaterials[i][local];
+                    }
+
+                    for (uint32_t k = 0; k < chunk.faceSizes[f]; ++k, ++corner) {
+
+                        const int64_t* ref = &chunk.corners[(corner - o.corners) * 3];
+                        if (!ResolveIndex(ref[0], o.positions, total.positions, mesh.indices[corner])) chunkValid[i] = 0;
+
+                        uint32_t t;
+                        if (ref[1] != NO_INDEX) {
+
+                            if (ResolveIndex(ref[1], o.texcoords, total.texcoords, t)) std::copy_n(&texcoordPool[size_t(t) * 2], 2, &mesh.texcoords[corner * 2]);
+                            else chunkValid[i] = 0;
+                        }
+                        if (ref[2] != NO_INDEX && !ResolveIndex(ref[2], o.normals, total.normals, cornerNormals[corner])) chunkValid[i] = 0;
+                    }
+                }
+            }
+        });
+
+        if (std::find(chunkValid.begin(), chunkValid.end(), 0) != chunkValid.end()) {
+
+            fprintf(stderr, "ReadObj: invalid face index in %s\n", path.c_str());
+            mesh.Clear();
+            return false;
+        }
+        if (!allTriangles) mesh.faceOffsets[total.faces] = static_cast<uint32_t>(total.corners);
+
+        // first faces of a chunk inherit the material that was active at the chunk start
+        if (!mesh.faceMaterials.empty()) {
+
+            for (size_t i = 0; i < chunkCount; ++i) {
+
+                for (size_t f = 0; f < chunks[i].faceSizes.size() && chunks[i].faceMaterials[f] == INHERIT_MATERIAL; ++f)
+                    mesh.faceMaterials[offsets[i].faces + f] = chunkMaterials[i];
+            }
+        }
+
+        // vertex normals, the last corner referencing a vertex wins like in the stream reader
+        if (hasNormals) {
+
+            std::vector<float> pool(total.normals * 3);
+            for (size_t i = 0; i < chunkCount; ++i)
+                std::copy(chunks[i].normals.begin(), chunks[i].normals.end(), pool.begin() + offsets[i].normals * 3);
+
+            mesh.vertexNormals.assign(total.positions * 3, 0.0f);
+            for (size_t c = 0; c < total.corners; ++c) {
+
+                if (cornerNormals[c] == std::numeric_limits<uint32_t>::max()) continue;
+                std::copy_n(&pool[size_t(cornerNormals[c]) * 3], 3, &mesh.vertexNormals[size_t(mesh.indices[c]) * 3]);
+            }
+        }
+
+        return true;
+    }
+}
@@ -0,0 +1,20 @@
+#ifndef OBJ_READER_H
+#define OBJ_READER_H
+
+#include <string>
+
+#include "mesh_buffer.h"
+
+namespace MeshIO {
+
+    // Memory-mapped, multithreaded Wavefront OBJ reader.
+    // The file is split at line boundaries into one chunk per worker, numbers are parsed with
+    // std::from_chars and the per-chunk arrays are merged afterwards, resolving negative (relative)
+    // indices against the running element counts. Supports v (with optional rgb), vt, vn, f,
+    // mtllib and usemtl; materials come from the referenced MTL files (Kd, d/Tr, map_Kd).
+    bool ReadObj(const std::string& path, MeshBuffer& mesh);
+
+    bool ReadMtl(const std::string& path, std::vector<MeshMaterial>& materials);
+}
+
+#endif // !OBJ_READER_H
@@ -0,0 +1,504 @@
+#include "ply_reader.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+
+#include "../utils/mapped_file.h"
+#include "../utils/parallel.h"
+
+namespace {
+
+    enum class PlyType { Invalid, Int8, Uint8, Int16, Uint16, Int32, Uint32, Float32, Float64 };
+
+    struct PlyProperty {
+
+        std::string name;
+        PlyType type = PlyType::Invalid;
+        PlyType countType = PlyType::Invalid;   // only for lists
+        bool isList = false;
+        size_t offset = 0;                      // inside a fixed-stride record
+    };
+
+    struct PlyElement {
+
+        std::string name;
+        size_t count = 0;
+        size_t stride = 0;                      // 0 if the element has list properties
+        size_t minRecordSize = 0;               // stride, or the scalars and list counts of a record
+        std::vector<PlyProperty> properties;
+
+        const PlyProperty* Find(std::initializer_list<const char*> names) const {
+
+            for (const char* name : names) {
+
+                for (const PlyProperty& p : properties)
+                    if (p.name == name) return &p;
+            }
+            return nullptr;
+        }
+    };
+
+    struct PlyHeader {
+
+        bool binary = false;
+        bool bigEndian = false;
+        size_t dataOffset = 0;
+        std::vector<PlyElement> elements;
+    };
+
+    PlyType ParseType(const std::string& s) {
+
+        if (s == "char" || s == "int8") return PlyType::Int8;
+        if (s == "uchar" || s == "uint8") return PlyType::Uint8;
+        if (s == "short" || s == "int16") return PlyType::Int16;
+        if (s == "ushort" || s == "uint16") return PlyType::Uint16;
+        if (s == "int" || s == "int32") return PlyType::Int32;
+        if (s == "uint" || s == "uint32") return PlyType::Uint32;
+        if (s == "float" || s == "float32") return PlyType::Float32;
+        if (s == "double" || s == "float64") return PlyType::Float64;
+        return PlyType::Invalid;
+    }
+
+    size_t TypeSize(PlyType type) {
+
+        switch (type) {
+
+        case PlyType::Int8: case PlyType::Uint8: return 1;
+        case PlyType::Int16: case PlyType::Uint16: return 2;
+        case PlyType::Int32: case PlyType::Uint32: case PlyType::Float32: return 4;
+        case PlyType::Float64: return 8;
+        default: return 0;
+        }
+    }
+
+    bool ParseHeader(const char* data, size_t size, PlyHeader& header) {
+
+        const char* end = nullptr;
+        for (const char* p = data; p + 10 <= data + size; ++p) {
+
+            if (std::memcmp(p, "end_header", 10) == 0) {
+
+                end = p + 10;
+                break;
+            }
+        }
+        if (end == nullptr || size < 3 || std::memcmp(data, "ply", 3) != 0) return false;
+
+        // the binary body starts right after the line break that ends the header
+        while (end < data + size && *end != '\n') ++end;
+        header.dataOffset = (end - data) + 1;
+
+        std::istringstream in(std::string(data, end));
+        std::string line, key;
+        while (std::getline(in, line)) {
+
+            std::istringstream stream(line);
+            if (!(stream >> key)) continue;
+
+            if (key == "format") {
+
+                std::string format;
+                stream >> format;
+                header.binary = format != "ascii";
+                header.bigEndian = format == "binary_big_endian";
+            }
+            else if (key == "element") {
+
+                PlyElement element;
+                stream >> element.name >> element.count;
+                header.elements.push_back(element);
+            }
+            else if (key == "property" && !header.elements.empty()) {
+
+                PlyProperty property;
+                std::string type;
+                stream >> type;
+                if (type == "list") {
+
+                    std::string countType, itemType;
+                    stream >> countType >> itemType;
+                    property.isList = true;
+                    property.countType = ParseType(countType);
+                    property.type = ParseType(itemType);
+                }
+                else {
+
+                    property.type = ParseType(type);
+                }
+                stream >> property.name;
+
+                // list counts have to be integers
+                const bool integerCount = property.countType != PlyType::Invalid && property.countType != PlyType::Float32 &&
+                    property.countType != PlyType::Float64;
+                if (property.type == PlyType::Invalid || (property.isList && !integerCount)) return false;
+                header.elements.back().properties.push_back(property);
+            }
+        }
+
+        // fixed-stride record layout for elements without lists
+        for (PlyElement& element : header.elements) {
+
+            size_t offset = 0;
+            bool fixed = true;
+            for (PlyProperty& property : element.properties) {
+
+                if (property.isList) fixed = false;
+                property.offset = offset;
+                offset += TypeSize(property.type);
+                element.minRecordSize += TypeSize(property.isList ? property.countType : property.type);
+            }
+            element.stride = fixed ? offset : 0;
+        }
+        return true;
+    }
+
+    template <typename T>
+    inline T LoadValue(const char* p, bool swap) {
+
+        T value;
+        if (!swap) {
+
+            std::memcpy(&value, p, sizeof(T));
+            return value;
+        }
+
+        char bytes[sizeof(T)];
+        for (size_t i = 0; i < sizeof(T); ++i) bytes[i] = p[sizeof(T) - 1 - i];
+        std::memcpy(&value, bytes, sizeof(T));
+        return value;
+    }
+
+    template <typename T, bool Swap>
+    void ConvertBlock(const char* records, size_t stride, size_t begin, size_t end, float* dst, size_t dstStride, float scale) {
+
+        for (size_t i = begin; i < end; ++i)
+            dst[i * dstStride] = static_cast<float>(LoadValue<T>(records + i * stride, Swap)) * scale;
+    }
+
+    template <bool Swap>
+    void ConvertBlock(PlyType type, const char* records, size_t stride, size_t begin, size_t end, float* dst, size_t dstStride, float scale) {
+
+        switch (type) {
+
+        case PlyType::Int8: ConvertBlock<int8_t, Swap>(records, stride, begin, end, dst, dstStride, scale); break;
+        case PlyType::Uint8: ConvertBlock<uint8_t, Swap>(records, stride, begin, end, dst, dstStride, scale); break;
+        case PlyType::Int16: ConvertBlock<int16_t, Swap>(records, stride, begin, end, dst, dstStride, scale); break;
+        case PlyType::Uint16: ConvertBlock<uint16_t, Swap>(records, stride, begin, end, dst, dstStride, scale); break;
+        case PlyType::Int32: ConvertBlock<int32_t, Swap>(records, stride, begin, end, dst, dstStride, scale); break;
+        case PlyType::Uint32: ConvertBlock<uint32_t, Swap>(records, stride, begin, end, dst, dstStride, scale); break;
+        case PlyType::Float32: ConvertBlock<float, Swap>(records, stride, begin, end, dst, dstStride, scale); break;
+        case PlyType::Float64: ConvertBlock<double, Swap>(records, stride, begin, end, dst, dstStride, scale); break;
+        default: break;
+        }
+    }
+
+    // copy a vec3 attribute spread over three scalar properties into an xyz array
+    void CopyVec3(const PlyElement& element, const char* records, const PlyProperty* const fields[3], bool swap, float scale, std::vector<float>& out) {
+
+        out.resize(element.count * 3);
+
+        // identical layout, copy the block as is
+        const bool packed = !swap && element.stride == 3 * sizeof(float) && fields[0]->offset == 0 &&
+            fields[1]->offset == 4 && fields[2]->offset == 8 && scale == 1.0f &&
+            fields[0]->type == PlyType::Float32 && fields[1]->type == PlyType::Float32 && fields[2]->type == PlyType::Float32;
+        if (packed) {
+
+            Parallel::For(0, element.count, [&](size_t begin, size_t end) {
+
+                std::memcpy(&out[begin * 3], records + begin * element.stride, (end - begin) * element.stride);
+            }, 1 << 16);
+            return;
+        }
+
+        Parallel::For(0, element.count, [&](size_t begin, size_t end) {
+
+            for (int k = 0; k < 3; ++k) {
+
+                const char* base = records + fields[k]->offset;
+                if (swap) ConvertBlock<true>(fields[k]->type, base, element.stride, begin, end, out.data() + k, 3, scale);
+                else ConvertBlock<false>(fields[k]->type, base, element.stride, begin, end, out.data() + k, 3, scale);
+            }
+        }, 1 << 14);
+    }
+
+    // negative values give SIZE_MAX, which no size check lets through
+    inline size_t NonNegative(int64_t value) { return value < 0 ? SIZE_MAX : static_cast<size_t>(value); }
+
+    size_t LoadCount(PlyType type, const char* p, bool swap) {
+
+        switch (type) {
+
+        case PlyType::Int8: return NonNegative(LoadValue<int8_t>(p, swap));
+        case PlyType::Uint8: return LoadValue<uint8_t>(p, swap);
+        case PlyType::Int16: return NonNegative(LoadValue<int16_t>(p, swap));
+        case PlyType::Uint16: return LoadValue<uint16_t>(p, swap);
+        case PlyType::Int32: return NonNegative(LoadValue<int32_t>(p, swap));
+        case PlyType::Uint32: return LoadValue<uint32_t>(p, swap);
+        case PlyType::Float32: return static_cast<size_t>(LoadValue<float>(p, swap));
+        case PlyType::Float64: return static_cast<size_t>(LoadValue<double>(p, swap));
+        default: return 0;
+        }
+    }
+
+    // out of range values (negative, too large) map to an index that fails validation
+    inline uint32_t LoadIndex(PlyType type, const char* p, bool swap) {
+
+        const size_t index = LoadCount(type, p, swap);
+        return index > UINT32_MAX ? UINT32_MAX : static_cast<uint32_t>(index);
+    }
+
+    // walk records with lists one by one, returns the end of the element or nullptr if the file is truncated
+    const char* WalkElement(const PlyElement& element, const char* p, const char* end, bool swap,
+                            const PlyProperty* indexList, std::vector<uint32_t>* sizes, std::vector<uint32_t>* indices) {
+
+        for (size_t r = 0; r < element.count; ++r) {
+
+            for (const PlyProperty& property : element.properties) {
+
+                // sizes are compared against the bytes left, p never moves past end
+                if (!property.isList) {
+
+                    if (TypeSize(property.type) > static_cast<size_t>(end - p)) return nullptr;
+                    p += TypeSize(property.type);
+                    continue;
+                }
+
+                const size_t countSize = TypeSize(property.countType);
+                if (countSize > static_cast<size_t>(end - p)) return nullptr;
+                const size_t n = LoadCount(property.countType, p, swap);
+                p += countSize;
+
+                const size_t itemSize = TypeSize(property.type);
+                if (n > static_cast<size_t>(end - p) / itemSize) return nullptr;
+                if (&property == indexList) {
+
+                    sizes->push_back(static_cast<uint32_t>(n));
+                    for (size_t i = 0; i < n; ++i) indices->push_back(LoadIndex(property.type, p + i * itemSize, swap));
+                }
+                p += n * itemSize;
+            }
+        }
+        return p;
+    }
+
+    // all faces are triangles and the index list is the only property: records have a fixed stride
+    bool ReadTriangles(const PlyElement& element, const char* records, const char* end, bool swap, MeshBuffer& mesh) {
+
+        if (element.properties.size() != 1) return false;
+
+        const PlyProperty& list = element.properties[0];
+        const size_t countSize = TypeSize(list.countType);
+        const size_t itemSize = TypeSize(list.type);
+        const size_t stride = countSize + 3 * itemSize;
+        if (element.count > static_cast<size_t>(end - records) / stride) return false;
+
+        // every record has to announce three indices, otherwise the layout guess is wrong
+        const size_t chunks = static_cast<size_t>(Parallel::Concurrency()) * 4;
+        std::vector<char> triangles(chunks, 1);
+        Parallel::ForChunks(element.count, chunks, [&](size_t chunk, size_t begin, size_t e) {
+
+            for (size_t f = begin; f < e; ++f) {
+
+                if (LoadCount(list.countType, records + f * stride, swap) != 3) {
+
+                    triangles[chunk] = 0;
+                    return;
+                }
+            }
+        });
+        for (char t : triangles)
+            if (!t) return false;
+
+        mesh.indices.resize(element.count * 3);
+        Parallel::For(0, element.count, [&](size_t begin, size_t e) {
+
+            for (size_t f = begin; f < e; ++f) {
+
+                const char* p = records + f * stride + countSize;
+                for (int k = 0; k < 3; ++k) mesh.indices[f * 3 + k] = LoadIndex(list.type, p + k * itemSize, swap);
+            }
+        }, 1 << 14);
+        return true;
+    }
+}
+
+namespace MeshIO {
+
+    bool ReadBinaryPly(const std::string& path, MeshBuffer& mesh) {
+
+        mesh.Clear();
+
+        MappedFile file;
+        if (!file.Open(path)) return false;
+
+        PlyHeader header;
+        if (!ParseHeader(file.Data(), file.Size(), header)) {
+
+            fprintf(stderr, "ReadBinaryPly: %s has no valid PLY header\n", path.c_str());
+            return false;
+        }
+        if (!header.binary) {
+
+            fprintf(stderr, "ReadBinaryPly: %s is not a binary PLY file\n", path.c_str());
+            return false;
+        }
+
+        const bool swap = header.bigEndian != (std::endian::native == std::endian::big);
+        const char* p = file.Data() + header.dataOffset;
+        const char* end = file.Data() + file.Size();
+
+        for (const PlyElement& element : header.elements) {
+
+            // fixed-stride elements are addressed directly, and no record is smaller than its scalars and list counts
+            if (element.minRecordSize != 0 && element.count > static_cast<size_t>(end - p) / element.minRecordSize) {
+
+                fprintf(stderr, "ReadBinaryPly: %s is truncated\n", path.c_str());
+                return false;
+            }
+
+            if (element.name == "vertex") {
+
+                if (element.stride == 0) {
+
+                    fprintf(stderr, "ReadBinaryPly: list properties on vertices are not supported (%s)\n", path.c_str());
+                    return false;
+                }
+
+                const PlyProperty* position[3] = { element.Find({ "x" }), element.Find({ "y" }), element.Find({ "z" }) };
+                if (!position[0] || !position[1] || !position[2]) {
+
+                    fprintf(stderr, "ReadBinaryPly: %s has no vertex positions\n", path.c_str());
+                    return false;
+                }
+                CopyVec3(element, p, position, swap, 1.0f, mesh.positions);
+
+                const PlyProperty* normal[3] = { element.Find({ "nx" }), element.Find({ "ny" }), element.Find({ "nz" }) };
+                if (normal[0] && normal[1] && normal[2]) CopyVec3(element, p, normal, swap, 1.0f, mesh.vertexNormals);
+
+                const PlyProperty* color[3] = { element.Find({ "red", "diffuse_red" }),
+                                                element.Find({ "green", "diffuse_green" }),
+                                                element.Find({ "blue", "diffuse_blue" }) };
+                if (color[0] && color[1] && color[2]) {
+
+                    // integer colors are 0..255
+                    const bool integer = color[0]->type != PlyType::Float32 && color[0]->type != PlyType::Float64;
+                    CopyVec3(element, p, color, swap, integer ? 1.0f / 255.0f : 1.0f, mesh.vertexColors);
+                }
+
+                p += element.count * element.stride;
+            }
+            else if (element.name == "face") {
+
+                const PlyProperty* list = element.Find({ "vertex_indices", "vertex_index" });
+                if (list == nullptr || !list->isList) {
+
+                    fprintf(stderr, "ReadBinaryPly: %s has faces without vertex indices\n", path.c_str());
+                    return false;
+                }
+
+                const size_t listStride = TypeSize(list->countType) + 3 * TypeSize(list->type);
+                if (ReadTriangles(element, p, end, swap, mesh)) {
+
+                    p += element.count * listStride;
+                    continue;
+                }
+
+                // general polygons, one record after the other
+                std::vector<uint32_t> sizes;
+                std::vector<uint32_t> indices;
+                sizes.reserve(element.count);
+                indices.reserve(element.count * 4);
+                p = WalkElement(element, p, end, swap, list, &sizes, &indices);
+                if (p == nullptr) {
+
+                    fprintf(stderr, "ReadBinaryPly: %s is truncated\n", path.c_str());
+                    mesh.Clear();
+                    return false;
+                }
+
+                bool triangles = true;
+                for (uint32_t n : sizes) triangles &= n == 3;
+
+                mesh.indices = std::move(indices);
+                if (!triangles) {
+
+                    mesh.faceOffsets.resize(sizes.size() + 1);
+                    uint32_t offset = 0;
+                    for (size_t f = 0; f < sizes.size(); ++f) {
+
+                        mesh.faceOffsets[f] = offset;
+                        offset += sizes[f];
+                    }
+                    mesh.faceOffsets[sizes.size()] = offset;
+                }
+            }
+            else if (element.stride != 0) {
+
+                p += element.count * element.stride;
+            }
+            else if ((p = WalkElement(element, p, end, swap, nullptr, nullptr, nullptr)) == nullptr) {
+
+                fprintf(stderr, "ReadBinaryPly: %s is truncated\n", path.c_str());
+                mesh.Clear();
+                return false;
+            }
+        }
+
+        const size_t vertexCount = mesh.VertexCount();
+        for (uint32_t index : mesh.indices) {
+
+            if (index >= vertexCount) {
+
+                fprintf(stderr, "ReadBinaryPly: invalid face index in %s\n", path.c_str());
+                mesh.Clear();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool SampleBinaryPly(const char* data, size_t size, size_t maxPoints, std::vector<float>& points) {
+
+        points.clear();
+
+        PlyHeader header;
+        if (!ParseHeader(data, size, header) || !header.binary) return false;
+
+        const bool swap = header.bigEndian != (std::endian::native == std::endian::big);
+        const char* p = data + header.dataOffset;
+        const char* end = data + size;
+        for (const PlyElement& element : header.elements) {
+
+            // records before the vertices can only be skipped when they have a fixed stride
+            if (element.stride == 0 || element.count > static_cast<size_t>(end - p) / element.stride) return false;
+            if (element.name != "vertex") {
+
+                p += element.count * element.stride;
+                continue;
+            }
+
+            const PlyProperty* position[3] = { element.Find({ "x" }), element.Find({ "y" }), element.Find({ "z" }) };
+            if (!position[0] || !position[1] || !position[2] || element.count == 0 || maxPoints == 0) return false;
+
+            // every step-th record, as a block with a stride of step records
+            const size_t n = std::min(maxPoints, element.count);
+            const size_t stride = element.count / n * element.stride;
+            points.resize(n * 3);
+            Parallel::For(0, n, [&](size_t begin, size_t e) {
+
+                for (int k = 0; k < 3; ++k) {
+
+                    const char* base = p + position[k]->offset;
+                    if (swap) ConvertBlock<true>(position[k]->type, base, stride, begin, e, points.data() + k, 3, 1.0f);
+                    else ConvertBlock<false>(position[k]->type, base, stride, begin, e, points.data() + k, 3, 1.0f);
+                }
+            }, 1024);
+            return true;
+        }
+        return false;
+    }
+}
@@ -0,0 +1,23 @@
+#ifndef PLY_READER_H
+#define PLY_READER_H
+
+#include <string>
+#include <vector>
+
+#include "mesh_buffer.h"
+
+namespace MeshIO {
+
+    // Memory-mapped binary PLY reader.
+    // The header is compiled into a fixed-stride record layout per element, so scalar properties
+    // (position, normal, color) are converted block by block in parallel, byte swapping included.
+    // Face lists use a fixed-stride path when every face is a triangle and a sequential walk otherwise.
+    // Returns false for ASCII PLY, which is left to the OpenMesh reader.
+    bool ReadBinaryPly(const std::string& path, MeshBuffer& mesh);
+
+    // Up to maxPoints positions of evenly spaced vertices, read in place from the fixed-stride vertex
+    // block of a mapped binary PLY file. False if the vertex element has lists or follows one that has.
+    bool SampleBinaryPly(const char* data, size_t size, size_t maxPoints, std::vector<float>& points);
+}
+
+#endif // !PLY_READER_H
@@ -0,0 +1,101 @@
+#include "stl_reader.h"
+
+#include <bit>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+#include "vertex_weld.h"
+#include "../utils/mapped_file.h"
+#include "../utils/parallel.h"
+
+static_assert(std::endian::native == std::endian::little, "binary STL is little endian");
+
+namespace {
+
+    // 80 byte header, uint32 triangle count, then 50 bytes per triangle:
+    // float normal[3], float vertex[3][3], uint16 attribute
+    constexpr size_t STL_HEADER_SIZE = 84;
+    constexpr size_t STL_TRIANGLE_SIZE = 50;
+
+    inline uint32_t TriangleCount(const char* data) {
+
+        uint32_t n;
+        std::memcpy(&n, data + 80, sizeof(n));
+        return n;
+    }
+}
+
+namespace MeshIO {
+
+    bool IsBinaryStl(const char* data, size_t size) {
+
+        if (size < STL_HEADER_SIZE) return false;
+        return size == STL_HEADER_SIZE + size_t(TriangleCount(data)) * STL_TRIANGLE_SIZE;
+    }
+
+    bool ReadBinaryStl(const std::string& path, MeshBuffer& mesh, bool readFaceNormals) {
+
+        mesh.Clear();
+
+        MappedFile file;
+        if (!file.Open(path)) return false;
+
+        if (!IsBinaryStl(file.Data(), file.Size())) {
+
+            fprintf(stderr, "ReadBinaryStl: %s is not a binary STL file\n", path.c_str());
+            return false;
+        }
+
+        const size_t triangleCount = TriangleCount(file.Data());
+        const size_t cornerCount = triangleCount * 3;
+        if (cornerCount > std::numeric_limits<uint32_t>::max()) {
+
+            fprintf(stderr, "ReadBinaryStl: %s has too many triangles\n", path.c_str());
+            return false;
+        }
+
+        // positions are read in place from the mapping
+        const char* triangles = file.Data() + STL_HEADER_SIZE;
+        auto fetch = [triangles](size_t corner, float* p) {
+
+            std::memcpy(p, triangles + (corner / 3) * STL_TRIANGLE_SIZE + 12 + (corner % 3) * 12, 3 * sizeof(float));
+        };
+
+        std::vector<uint32_t> corners;
+        WeldCorners(cornerCount, fetch, corners, mesh.positions);
+
+        // drop triangles that collapsed while welding, add_face would reject them anyway
+        const size_t chunks = static_cast<size_t>(Parallel::Concurrency()) * 4;
+        std::vector<size_t> chunkFaces(chunks, 0);
+        auto valid = [&corners](size_t t) {
+
+            const uint32_t* c = &corners[t * 3];
+            return c[0] != c[1] && c[1] != c[2] && c[2] != c[0];
+        };
+        Parallel::ForChunks(triangleCount, chunks, [&](size_t chunk, size_t begin, size_t end) {
+
+            size_t n = 0;
+            for (size_t t = begin; t < end; ++t) n += valid(t);
+            chunkFaces[chunk] = n;
+        });
+        const size_t faceCount = Parallel::ExclusiveScan(chunkFaces);
+
+        mesh.indices.resize(faceCount * 3);
+        if (readFaceNormals) mesh.faceNormals.resize(faceCount * 3);
+        Parallel::ForChunks(triangleCount, chunks, [&](size_t chunk, size_t begin, size_t end) {
+
+            size_t f = chunkFaces[chunk];
+            for (size_t t = begin; t < end; ++t) {
+
+                if (!valid(t)) continue;
+
+                std::memcpy(&mesh.indices[f * 3], &corners[t * 3], 3 * sizeof(uint32_t));
+                if (readFaceNormals) std::memcpy(&mesh.faceNormals[f * 3], triangles + t * STL_TRIANGLE_SIZE, 3 * sizeof(float));
+                ++f;
+            }
+        });
+
+        return true;
+    }
+}
@@ -0,0 +1,19 @@
+#ifndef STL_READER_H
+#define STL_READER_H
+
+#include <string>
+
+#include "mesh_buffer.h"
+
+namespace MeshIO {
+
+    // Memory-mapped binary STL reader.
+    // Triangles are decoded straight from the mapping in parallel chunks and corners are welded by
+    // position (see WeldCorners), degenerate triangles are dropped. Returns false for ASCII STL,
+    // which is left to the OpenMesh reader.
+    bool ReadBinaryStl(const std::string& path, MeshBuffer& mesh, bool readFaceNormals = false);
+
+    bool IsBinaryStl(const char* data, size_t size);
+}
+
+#endif // !STL_READER_H
@@ -0,0 +1,157 @@
+#ifndef VERTEX_WELD_H
+#define VERTEX_WELD_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "../utils/parallel.h"
+
+namespace MeshIO {
+
+    // bit pattern of a coordinate, -0.0f is folded onto 0.0f so both weld together
+    inline uint32_t WeldBits(float f) {
+
+        if (f == 0.0f) f = 0.0f;
+        uint32_t u;
+        std::memcpy(&u, &f, sizeof(u));
+        return u;
+    }
+
+    struct WeldRecord {
+
+        uint32_t x, y, z;
+        uint32_t corner;
+
+        bool operator<(const WeldRecord& o) const {
+
+            if (x != o.x) return x < o.x;
+            if (y != o.y) return y < o.y;
+            if (z != o.z) return z < o.z;
+            return corner < o.corner;
+        }
+        bool SamePosition(const WeldRecord& o) const { return x == o.x && y == o.y && z == o.z; }
+    };
+
+    inline uint32_t WeldBucket(const WeldRecord& r, int bucketBits) {
+
+        uint64_t h = r.x * 0x9E3779B97F4A7C15ull;
+        h ^= r.y * 0xC2B2AE3D27D4EB4Full;
+        h ^= r.z * 0x165667B19E3779F9ull;
+        h ^= h >> 29;
+        h *= 0xBF58476D1CE4E5B9ull;
+        return static_cast<uint32_t>(h >> (64 - bucketBits));
+    }
+
+    // Merge corners with bit-identical positions.
+    // fetch(corner, float[3]) reads the position of a corner, it is called concurrently.
+    // On return indices[corner] is the welded vertex of each corner and positions holds xyz per vertex,
+    // vertices are numbered in order of their first corner, like a sequential map-based reader would do.
+    // Corners are partitioned by a position hash (parallel radix pass), then every bucket is sorted on its own.
+    template <typename Fetch>
+    void WeldCorners(size_t cornerCount, Fetch&& fetch, std::vector<uint32_t>& indices, std::vector<float>& positions) {
+
+        indices.assign(cornerCount, 0);
+        positions.clear();
+        if (cornerCount == 0) return;
+
+        const size_t chunks = static_cast<size_t>(Parallel::Concurrency()) * 4;
+        int bucketBits = 4;
+        while (bucketBits < 16 && (size_t(1) << bucketBits) < cornerCount / 1024) ++bucketBits;
+        const size_t buckets = size_t(1) << bucketBits;
+
+        auto makeRecord = [&](size_t c) {
+
+            float p[3];
+            fetch(c, p);
+            return WeldRecord{ WeldBits(p[0]), WeldBits(p[1]), WeldBits(p[2]), static_cast<uint32_t>(c) };
+        };
+
+        // histogram of buckets per chunk
+        std::vector<size_t> offsets(chunks * buckets, 0);
+        Parallel::ForChunks(cornerCount, chunks, [&](size_t chunk, size_t begin, size_t end) {
+
+            size_t* count = &offsets[chunk * buckets];
+            for (size_t c = begin; c < end; ++c) ++count[WeldBucket(makeRecord(c), bucketBits)];
+        });
+
+        // bucket-major offsets, chunks stay in order inside a bucket so corners remain ascending
+        std::vector<size_t> bucketBegin(buckets + 1, 0);
+        {
+            size_t sum = 0;
+            for (size_t b = 0; b < buckets; ++b) {
+
+                bucketBegin[b] = sum;
+                for (size_t chunk = 0; chunk < chunks; ++chunk) {
+
+                    const size_t n = offsets[chunk * buckets + b];
+                    offsets[chunk * buckets + b] = sum;
+                    sum += n;
+                }
+            }
+            bucketBegin[buckets] = sum;
+        }
+
+        std::vector<WeldRecord> records(cornerCount);
+        Parallel::ForChunks(cornerCount, chunks, [&](size_t chunk, size_t begin, size_t end) {
+
+            size_t* offset = &offsets[chunk * buckets];
+            for (size_t c = begin; c < end; ++c) {
+
+                const WeldRecord r = makeRecord(c);
+                records[offset[WeldBucket(r, bucketBits)]++] = r;
+            }
+        });
+
+        // sort every bucket, the first corner of a run of equal positions represents the run
+        std::vector<uint32_t> representative(cornerCount);
+        Parallel::For(0, buckets, [&](size_t bBegin, size_t bEnd) {
+
+            for (size_t b = bBegin; b < bEnd; ++b) {
+
+                WeldRecord* first = records.data() + bucketBegin[b];
+                WeldRecord* last = records.data() + bucketBegin[b + 1];
+                std::sort(first, last);
+
+                uint32_t rep = 0;
+                for (WeldRecord* r = first; r != last; ++r) {
+
+                    if (r == first || !r->SamePosition(r[-1])) rep = r->corner;
+                    representative[r->corner] = rep;
+                }
+            }
+        }, 1);
+        std::vector<WeldRecord>().swap(records);
+
+        // number the representatives in corner order
+        std::vector<uint32_t> chunkVertices(chunks, 0);
+        Parallel::ForChunks(cornerCount, chunks, [&](size_t chunk, size_t begin, size_t end) {
+
+            uint32_t n = 0;
+            for (size_t c = begin; c < end; ++c) n += representative[c] == c;
+            chunkVertices[chunk] = n;
+        });
+        const uint32_t vertexCount = Parallel::ExclusiveScan(chunkVertices);
+
+        positions.resize(size_t(vertexCount) * 3);
+        Parallel::ForChunks(cornerCount, chunks, [&](size_t chunk, size_t begin, size_t end) {
+
+            uint32_t id = chunkVertices[chunk];
+            for (size_t c = begin; c < end; ++c) {
+
+                if (representative[c] != c) continue;
+                fetch(c, &positions[size_t(id) * 3]);
+                indices[c] = id++;
+            }
+        });
+        Parallel::ForChunks(cornerCount, chunks, [&](size_t, size_t begin, size_t end) {
+
+            // representatives already hold their id and are read by other chunks here
+            for (size_t c = begin; c < end; ++c)
+                if (representative[c] != c) indices[c] = indices[representative[c]];
+        });
+    }
+}
+
+#endif // !VERTEX_WELD_H
@@ -0,0 +1,115 @@
+#ifndef BITSET_H
+#define BITSET_H
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "parallel.h"
+
+// Packed bits in 64-bit words. Set operations and counting run a word at a time (the word loops are
+// plain enough for the compiler to vectorize) and split over the workers for large sets. Bits past
+// Size() in the last word are always zero.
+class Bitset {
+
+public:
+    static constexpr size_t WORD_GRAIN = size_t(1) << 16;   // words per worker before splitting pays off
+
+    Bitset() = default;
+    explicit Bitset(size_t size, bool value = false) { Resize(size, value); }
+
+    size_t Size() const { return size; }
+    size_t WordCount() const { return words.size(); }
+    uint64_t* Words() { return words.data(); }
+    const uint64_t* Words() const { return words.data(); }
+
+    void Resize(size_t newSize, bool value = false) {
+
+        // new bits in the current last word
+        if (value && newSize > size && size % 64 != 0) words.back() |= ~uint64_t(0) << (size % 64);
+
+        words.resize((newSize + 63) / 64, value ? ~uint64_t(0) : 0);
+        size = newSize;
+        ClearTail();
+    }
+
+    bool Test(size_t i) const { return (words[i / 64] >> (i % 64)) & 1; }
+    void Set(size_t i) { words[i / 64] |= uint64_t(1) << (i % 64); }
+    void Reset(size_t i) { words[i / 64] &= ~(uint64_t(1) << (i % 64)); }
+    void Assign(size_t i, bool value) { value ? Set(i) : Reset(i); }
+
+    void SetAll() { std::fill(words.begin(), words.end(), ~uint64_t(0)); ClearTail(); }
+    void ResetAll() { std::fill(words.begin(), words.end(), uint64_t(0)); }
+
+    void Invert() {
+
+        ForWords([&](size_t w) { words[w] = ~words[w]; });
+        ClearTail();
+    }
+
+    // the operands must have the same size
+    Bitset& operator|=(const Bitset& o) { ForWords([&](size_t w) { words[w] |= o.words[w]; }); return *this; }
+    Bitset& operator&=(const Bitset& o) { ForWords([&](size_t w) { words[w] &= o.words[w]; }); return *this; }
+    Bitset& operator^=(const Bitset& o) { ForWords([&](size_t w) { words[w] ^= o.words[w]; }); return *this; }
+    Bitset& Subtract(const Bitset& o) { ForWords([&](size_t w) { words[w] &= ~o.words[w]; }); return *this; }
+
+    size_t Count() const {
+
+        std::vector<size_t> counts(std::min<size_t>(Parallel::Concurrency(), words.size() / WORD_GRAIN + 1), 0);
+        Parallel::ForChunks(words.size(), counts.size(), [&](size_t chunk, size_t begin, size_t end) {
+
+            size_t n = 0;
+            for (size_t w = begin; w < end; ++w) n += static_cast<size_t>(std::popcount(words[w]));
+            counts[chunk] = n;
+        });
+
+        size_t total = 0;
+        for (size_t n : counts) total += n;
+        return total;
+    }
+
+    bool Any() const { return std::any_of(words.begin(), words.end(), [](uint64_t w) { return w != 0; }); }
+
+    // func(index) for every set bit in increasing order, skipping empty words
+    template <typename Func>
+    void ForEach(Func&& func) const {
+
+        for (size_t w = 0; w < words.size(); ++w) {
+
+            for (uint64_t bits = words[w]; bits; bits &= bits - 1)
+                func(w * 64 + static_cast<size_t>(std::countr_zero(bits)));
+        }
+    }
+
+    std::vector<uint32_t> Indices() const {
+
+        std::vector<uint32_t> indices;
+        indices.reserve(Count());
+        ForEach([&](size_t i) { indices.push_back(static_cast<uint32_t>(i)); });
+        return indices;
+    }
+
+    bool operator==(const Bitset& o) const { return size == o.size && words == o.words; }
+
+private:
+    template <typename Func>
+    void ForWords(Func&& func) {
+
+        Parallel::For(0, words.size(), [&](size_t begin, size_t end) {
+
+            for (size_t w = begin; w < end; ++w) func(w);
+        }, WORD_GRAIN);
+    }
+
+    void ClearTail() {
+
+        if (size % 64 != 0) words.back() &= (uint64_t(1) << (size % 64)) - 1;
+    }
+
+    std::vector<uint64_t> words;
+    size_t size = 0;
+};
+
+#endif // !BITSET_H
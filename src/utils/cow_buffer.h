@@ -0,0 +1,92 @@
+#ifndef COW_BUFFER_H
+#define COW_BUFFER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "parallel.h"
+
+// Immutable array of fixed-size elements split into reference-counted chunks. A new version is made
+// from the previous one and the current contents, and every chunk whose bytes did not change is
+// shared instead of copied, so a version costs memory in proportion to what was edited since the
+// last one. Versions can be read from any thread while newer ones are being made.
+class CowBuffer {
+
+public:
+    static constexpr size_t CHUNK_ELEMENTS = 4096;
+
+    CowBuffer() = default;
+
+    // chunks equal to the same chunk of `previous` are shared, the rest are copied from data
+    static CowBuffer Update(const CowBuffer& previous, const void* data, size_t elementSize, size_t count) {
+
+        CowBuffer buffer;
+        buffer.elementSize = elementSize;
+        buffer.count = count;
+        buffer.chunks.resize((count + CHUNK_ELEMENTS - 1) / CHUNK_ELEMENTS);
+
+        const bool comparable = previous.elementSize == elementSize;
+        const char* bytes = static_cast<const char*>(data);
+        std::vector<char> copied(buffer.chunks.size(), 0);
+        Parallel::For(0, buffer.chunks.size(), [&](size_t begin, size_t end) {
+
+            for (size_t c = begin; c < end; ++c) {
+
+                const size_t chunkBytes = buffer.ChunkBytes(c);
+                const char* src = bytes + c * CHUNK_ELEMENTS * elementSize;
+                if (comparable && c < previous.chunks.size() && previous.ChunkBytes(c) == chunkBytes &&
+                    std::memcmp(previous.chunks[c].get(), src, chunkBytes) == 0) {
+
+                    buffer.chunks[c] = previous.chunks[c];
+                    continue;
+                }
+
+                std::shared_ptr<char[]> chunk(new char[chunkBytes]);
+                std::memcpy(chunk.get(), src, chunkBytes);
+                buffer.chunks[c] = std::move(chunk);
+                copied[c] = 1;
+            }
+        }, 16);
+
+        for (size_t c = 0; c < copied.size(); ++c)
+            if (copied[c]) buffer.copiedBytes += buffer.ChunkBytes(c);
+        return buffer;
+    }
+
+    size_t Size() const { return count; }
+    size_t ElementSize() const { return elementSize; }
+    size_t Bytes() const { return count * elementSize; }
+
+    // bytes this version did not share with the one it was made from
+    size_t CopiedBytes() const { return copiedBytes; }
+
+    size_t ChunkCount() const { return chunks.size(); }
+    const char* Chunk(size_t c) const { return chunks[c].get(); }
+    size_t ChunkBytes(size_t c) const { return (std::min(count, (c + 1) * CHUNK_ELEMENTS) - c * CHUNK_ELEMENTS) * elementSize; }
+
+    const void* Element(size_t i) const { return chunks[i / CHUNK_ELEMENTS].get() + (i % CHUNK_ELEMENTS) * elementSize; }
+
+    template <typename T>
+    const T& At(size_t i) const { return *static_cast<const T*>(Element(i)); }
+
+    // contiguous copy of all elements, dst holds Bytes()
+    void CopyTo(void* dst) const {
+
+        Parallel::For(0, chunks.size(), [&](size_t begin, size_t end) {
+
+            for (size_t c = begin; c < end; ++c)
+                std::memcpy(static_cast<char*>(dst) + c * CHUNK_ELEMENTS * elementSize, chunks[c].get(), ChunkBytes(c));
+        }, 16);
+    }
+
+private:
+    std::vector<std::shared_ptr<const char[]>> chunks;
+    size_t elementSize = 0;
+    size_t count = 0;
+    size_t copiedBytes = 0;
+};
+
+#endif // !COW_BUFFER_H
@@ -0,0 +1,246 @@
+#include "entropy_coder.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+
+namespace {
+
+    // 32-bit rANS state kept in [RANS_L, RANS_L << 8), renormalized a byte at a time
+    constexpr uint32_t RANS_L = uint32_t(1) << 23;
+    constexpr size_t MAX_ALPHABET = 256;
+
+    using FrequencyTable = std::array<uint32_t, MAX_ALPHABET>;
+
+    // scale the counts to sum to PROB_SCALE, every symbol that occurs keeps at least one slot
+    void NormalizeFrequencies(const std::array<uint64_t, MAX_ALPHABET>& counts, uint64_t total, FrequencyTable& freq) {
+
+        int64_t sum = 0;
+        for (size_t s = 0; s < MAX_ALPHABET; ++s) {
+
+            freq[s] = counts[s] ? static_cast<uint32_t>(std::max<uint64_t>(1, counts[s] * Entropy::PROB_SCALE / total)) : 0;
+            sum += freq[s];
+        }
+
+        // rounding error goes to the most frequent symbols, which notice it least
+        while (sum != Entropy::PROB_SCALE) {
+
+            size_t largest = 0;
+            for (size_t s = 1; s < MAX_ALPHABET; ++s)
+                if (freq[s] > freq[largest]) largest = s;
+
+            if (sum < Entropy::PROB_SCALE) {
+
+                freq[largest] += static_cast<uint32_t>(Entropy::PROB_SCALE - sum);
+                sum = Entropy::PROB_SCALE;
+            }
+            else {
+
+                const uint32_t take = static_cast<uint32_t>(std::min<int64_t>(sum - Entropy::PROB_SCALE, freq[largest] - 1));
+                freq[largest] -= take;
+                sum -= take;
+            }
+        }
+    }
+}
+
+namespace Entropy {
+
+    void PutVarint(std::vector<uint8_t>& out, uint64_t value) {
+
+        while (value >= 0x80) {
+
+            out.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    bool GetVarint(const uint8_t*& data, const uint8_t* end, uint64_t& value) {
+
+        value = 0;
+        for (uint32_t shift = 0; shift < 64; shift += 7) {
+
+            if (data == end) return false;
+            const uint8_t byte = *data++;
+            value |= uint64_t(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) return true;
+        }
+        return false;
+    }
+
+    void EncodeSymbols(const uint8_t* symbols, size_t count, std::vector<uint8_t>& out) {
+
+        PutVarint(out, count);
+        if (count == 0) return;
+
+        std::array<uint64_t, MAX_ALPHABET> counts{};
+        for (size_t i = 0; i < count; ++i) ++counts[symbols[i]];
+
+        FrequencyTable freq, start;
+        NormalizeFrequencies(counts, count, freq);
+
+        size_t alphabet = MAX_ALPHABET;
+        while (freq[alphabet - 1] == 0) --alphabet;
+        PutVarint(out, alphabet);
+        for (size_t s = 0; s < alphabet; ++s) PutVarint(out, freq[s]);
+
+        uint32_t cumulative = 0;
+        for (size_t s = 0; s < MAX_ALPHABET; ++s) {
+
+            start[s] = cumulative;
+            cumulative += freq[s];
+        }
+
+        // bytes come out last symbol first and are reversed at the end
+        std::vector<uint8_t> bytes;
+        bytes.reserve(count / 2 + 16);
+        uint32_t x = RANS_L;
+        for (size_t i = count; i-- > 0;) {
+
+            const uint32_t f = freq[symbols[i]];
+            const uint32_t xMax = ((RANS_L >> PROB_BITS) << 8) * f;
+            while (x >= xMax) {
+
+                bytes.push_back(static_cast<uint8_t>(x));
+                x >>= 8;
+            }
+            x = ((x / f) << PROB_BITS) + (x % f) + start[symbols[i]];
+        }
+        for (int shift = 24; shift >= 0; shift -= 8) bytes.push_back(static_cast<uint8_t>(x >> shift));
+        std::reverse(bytes.begin(), bytes.end());
+
+        PutVarint(out, bytes.size());
+        out.insert(out.end(), bytes.begin(), bytes.end());
+    }
+
+    bool DecodeSymbols(const uint8_t*& data, const uint8_t* end, size_t maxCount, std::vector<uint8_t>& symbols) {
+
+        uint64_t count, alphabet;
+        if (!GetVarint(data, end, count) || count > maxCount) return false;
+        symbols.resize(count);
+        if (count == 0) return true;
+
+        if (!GetVarint(data, end, alphabet) || alphabet == 0 || alphabet > MAX_ALPHABET) return false;
+
+        FrequencyTable freq{}, start{};
+        uint32_t cumulative = 0;
+        for (size_t s = 0; s < alphabet; ++s) {
+
+            uint64_t f;
+            if (!GetVarint(data, end, f) || f > PROB_SCALE - cumulative) return false;
+            freq[s] = static_cast<uint32_t>(f);
+            start[s] = cumulative;
+            cumulative += freq[s];
+        }
+        if (cumulative != PROB_SCALE) return false;
+
+        std::array<uint8_t, PROB_SCALE> slotSymbol;
+        for (size_t s = 0; s < alphabet; ++s)
+            std::fill_n(slotSymbol.begin() + start[s], freq[s], static_cast<uint8_t>(s));
+
+        uint64_t byteCount;
+        if (!GetVarint(data, end, byteCount) || byteCount < 4 || byteCount > static_cast<uint64_t>(end - data)) return false;
+        const uint8_t* in = data;
+        const uint8_t* inEnd = data + byteCount;
+        data = inEnd;
+
+        uint32_t x = uint32_t(in[0]) | uint32_t(in[1]) << 8 | uint32_t(in[2]) << 16 | uint32_t(in[3]) << 24;
+        in += 4;
+        for (size_t i = 0; i < count; ++i) {
+
+            const uint32_t slot = x & (PROB_SCALE - 1);
+            const uint8_t s = slotSymbol[slot];
+            symbols[i] = s;
+            x = freq[s] * (x >> PROB_BITS) + slot - start[s];
+            while (x < RANS_L) {
+
+                if (in == inEnd) return false;
+                x = (x << 8) | *in++;
+            }
+        }
+
+        // the encoder started from RANS_L, anything else is a damaged stream
+        return x == RANS_L && in == inEnd;
+    }
+
+    void BitWriter::Put(uint32_t value, uint32_t bits) {
+
+        if (bits == 0) return;
+        const uint64_t mask = (uint64_t(1) << bits) - 1;
+        buffer |= (uint64_t(value) & mask) << filled;
+        filled += bits;
+        while (filled >= 8) {
+
+            bytes.push_back(static_cast<uint8_t>(buffer));
+            buffer >>= 8;
+            filled -= 8;
+        }
+    }
+
+    void BitWriter::Flush(std::vector<uint8_t>& out) {
+
+        if (filled) bytes.push_back(static_cast<uint8_t>(buffer));
+        buffer = 0;
+        filled = 0;
+
+        PutVarint(out, bytes.size());
+        out.insert(out.end(), bytes.begin(), bytes.end());
+        bytes.clear();
+    }
+
+    uint32_t BitReader::Get(uint32_t bits) {
+
+        if (bits == 0) return 0;
+        while (filled < bits) {
+
+            if (position < size) buffer |= uint64_t(data[position++]) << filled;
+            else ok = false;
+            filled += 8;
+        }
+        const uint32_t value = static_cast<uint32_t>(buffer & ((uint64_t(1) << bits) - 1));
+        buffer >>= bits;
+        filled -= bits;
+        return value;
+    }
+
+    void ValueWriter::Put(uint32_t value) {
+
+        const uint32_t length = static_cast<uint32_t>(std::bit_width(value));
+        lengths.push_back(static_cast<uint8_t>(length));
+        if (length > 1) bits.Put(value, length - 1);
+    }
+
+    void ValueWriter::Write(std::vector<uint8_t>& out) {
+
+        EncodeSymbols(lengths.data(), lengths.size(), out);
+        bits.Flush(out);
+        lengths.clear();
+    }
+
+    bool ValueReader::Read(const uint8_t*& data, const uint8_t* end, size_t maxCount) {
+
+        next = 0;
+        ok = true;
+        if (!DecodeSymbols(data, end, maxCount, lengths)) return false;
+
+        uint64_t byteCount;
+        if (!GetVarint(data, end, byteCount) || byteCount > static_cast<uint64_t>(end - data)) return false;
+        bits = BitReader(data, static_cast<size_t>(byteCount));
+        data += byteCount;
+        return true;
+    }
+
+    uint32_t ValueReader::Get() {
+
+        if (next == lengths.size() || lengths[next] > 32) {
+
+            ok = false;
+            return 0;
+        }
+
+        const uint32_t length = lengths[next++];
+        if (length <= 1) return length;
+        return (uint32_t(1) << (length - 1)) | bits.Get(length - 1);
+    }
+}
@@ -0,0 +1,102 @@
+#ifndef ENTROPY_CODER_H
+#define ENTROPY_CODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Self-contained entropy coding for the compressed mesh format: a static-model rANS coder over byte
+// symbols, LEB128 varints and a raw bit stream. Integers are coded Elias-gamma style: the bit length
+// goes through rANS, the bits below the leading one are stored raw.
+namespace Entropy {
+
+    constexpr uint32_t PROB_BITS = 12;
+    constexpr uint32_t PROB_SCALE = uint32_t(1) << PROB_BITS;
+
+    void PutVarint(std::vector<uint8_t>& out, uint64_t value);
+    bool GetVarint(const uint8_t*& data, const uint8_t* end, uint64_t& value);
+
+    // Appends the symbol count, the normalized frequency table and the coded bytes. Symbols are coded
+    // back to front so the decoder reads them in order.
+    void EncodeSymbols(const uint8_t* symbols, size_t count, std::vector<uint8_t>& out);
+
+    // false for a malformed stream or more than maxCount symbols, data is moved past the stream
+    bool DecodeSymbols(const uint8_t*& data, const uint8_t* end, size_t maxCount, std::vector<uint8_t>& symbols);
+
+    class BitWriter {
+
+        // main functions
+    public:
+        // up to 32 bits, low bits first
+        void Put(uint32_t value, uint32_t bits);
+        void Flush(std::vector<uint8_t>& out);
+
+        // variables
+    private:
+        std::vector<uint8_t> bytes;
+        uint64_t buffer = 0;
+        uint32_t filled = 0;
+    };
+
+    class BitReader {
+
+        // constructor
+    public:
+        BitReader() = default;
+        BitReader(const uint8_t* data, size_t size) : data(data), size(size) {}
+
+        // main functions
+    public:
+        // reads past the end give zero bits and clear Ok()
+        uint32_t Get(uint32_t bits);
+        bool Ok() const { return ok; }
+
+        // variables
+    private:
+        const uint8_t* data = nullptr;
+        size_t size = 0;
+        size_t position = 0;
+        uint64_t buffer = 0;
+        uint32_t filled = 0;
+        bool ok = true;
+    };
+
+    // unsigned integers as bit length symbols plus raw mantissa bits
+    class ValueWriter {
+
+        // main functions
+    public:
+        void Put(uint32_t value);
+        void PutSigned(int32_t value) { Put((static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31)); }
+        size_t Count() const { return lengths.size(); }
+
+        void Write(std::vector<uint8_t>& out);
+
+        // variables
+    private:
+        std::vector<uint8_t> lengths;
+        BitWriter bits;
+    };
+
+    class ValueReader {
+
+        // main functions
+    public:
+        bool Read(const uint8_t*& data, const uint8_t* end, size_t maxCount);
+
+        // past the end gives zero and clears Ok()
+        uint32_t Get();
+        int32_t GetSigned() { const uint32_t v = Get(); return static_cast<int32_t>(v >> 1) ^ -static_cast<int32_t>(v & 1); }
+        bool Ok() const { return ok && bits.Ok(); }
+        bool AtEnd() const { return next == lengths.size(); }
+
+        // variables
+    private:
+        std::vector<uint8_t> lengths;
+        size_t next = 0;
+        BitReader bits;
+        bool ok = true;
+    };
+}
+
+#endif // !ENTROPY_CODER_H
@@ -0,0 +1,71 @@
+#include "file_hash.h"
+
+#include <bit>
+#include <cstring>
+#include <vector>
+
+#include "mapped_file.h"
+#include "parallel.h"
+
+namespace {
+
+    constexpr uint64_t PRIME_1 = 0x9E3779B185EBCA87ull;
+    constexpr uint64_t PRIME_2 = 0xC2B2AE3D27D4EB4Full;
+    constexpr size_t FILE_BLOCK_SIZE = size_t(8) << 20;
+
+    inline uint64_t Mix(uint64_t h, uint64_t word) {
+
+        h ^= word * PRIME_2;
+        h = std::rotl(h, 31);
+        return h * PRIME_1;
+    }
+}
+
+namespace Hash {
+
+    uint64_t Bytes(const void* data, size_t size, uint64_t seed) {
+
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        uint64_t h = seed ^ (size * PRIME_1);
+
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8) {
+
+            uint64_t word;
+            std::memcpy(&word, p + i, 8);
+            h = Mix(h, word);
+        }
+        if (i < size) {
+
+            uint64_t word = 0;
+            std::memcpy(&word, p + i, size - i);
+            h = Mix(h, word);
+        }
+
+        // final avalanche
+        h ^= h >> 33;
+        h *= PRIME_2;
+        h ^= h >> 29;
+        return h;
+    }
+
+    bool File(const std::string& path, uint64_t& hash) {
+
+        MappedFile file;
+        if (!file.Open(path)) return false;
+
+        const size_t blocks = (file.Size() + FILE_BLOCK_SIZE - 1) / FILE_BLOCK_SIZE;
+        std::vector<uint64_t> blockHashes(blocks);
+        Parallel::For(0, blocks, [&](size_t begin, size_t end) {
+
+            for (size_t b = begin; b < end; ++b) {
+
+                const size_t offset = b * FILE_BLOCK_SIZE;
+                blockHashes[b] = Bytes(file.Data() + offset, std::min(FILE_BLOCK_SIZE, file.Size() - offset), b);
+            }
+        }, 1);
+
+        hash = Bytes(blockHashes.data(), blockHashes.size() * sizeof(uint64_t), file.Size());
+        return true;
+    }
+}
@@ -0,0 +1,17 @@
+#ifndef FILE_HASH_H
+#define FILE_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Hash {
+
+    // fast non-cryptographic 64-bit hash
+    uint64_t Bytes(const void* data, size_t size, uint64_t seed = 0);
+
+    // hash of a whole file, computed over fixed-size blocks in parallel (independent of the thread count)
+    bool File(const std::string& path, uint64_t& hash);
+}
+
+#endif // !FILE_HASH_H
@@ -0,0 +1,126 @@
+#ifndef INDEXED_HEAP_H
+#define INDEXED_HEAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Min-heap of ids in [0, capacity) with float keys, four children per node. Keys are stored next to
+// the ids in one array, so sifting compares neighbouring memory instead of looking priorities up
+// through the ids, and the shallower tree halves the levels a sift walks. Positions of ids are kept
+// in a flat array for O(log n) update and remove.
+class IndexedHeap {
+
+public:
+    static constexpr uint32_t NOT_STORED = 0xffffffffu;
+
+    IndexedHeap() = default;
+    explicit IndexedHeap(size_t capacity) { Reset(capacity); }
+
+    // empty heap for ids below capacity
+    void Reset(size_t capacity) {
+
+        nodes.clear();
+        nodes.reserve(capacity);
+        positions.assign(capacity, NOT_STORED);
+    }
+
+    bool Empty() const { return nodes.empty(); }
+    size_t Size() const { return nodes.size(); }
+    bool Contains(uint32_t id) const { return positions[id] != NOT_STORED; }
+
+    uint32_t Top() const { return nodes[0].id; }
+    float TopKey() const { return nodes[0].key; }
+    float Key(uint32_t id) const { return nodes[positions[id]].key; }
+
+    // insert id, or move it to its new key when stored already
+    void Push(uint32_t id, float key) {
+
+        uint32_t pos = positions[id];
+        if (pos == NOT_STORED) {
+
+            pos = static_cast<uint32_t>(nodes.size());
+            nodes.push_back({ key, id });
+            SiftUp(pos);
+            return;
+        }
+
+        const float old = nodes[pos].key;
+        nodes[pos].key = key;
+        if (key < old) SiftUp(pos);
+        else SiftDown(pos);
+    }
+
+    void Pop() { RemoveAt(0); }
+
+    void Remove(uint32_t id) {
+
+        if (positions[id] != NOT_STORED) RemoveAt(positions[id]);
+    }
+
+private:
+    struct Node {
+
+        float key;
+        uint32_t id;
+    };
+
+    void Place(uint32_t pos, const Node& node) {
+
+        nodes[pos] = node;
+        positions[node.id] = pos;
+    }
+
+    void SiftUp(uint32_t pos) {
+
+        const Node node = nodes[pos];
+        while (pos > 0) {
+
+            const uint32_t parent = (pos - 1) / 4;
+            if (!(node.key < nodes[parent].key)) break;
+            Place(pos, nodes[parent]);
+            pos = parent;
+        }
+        Place(pos, node);
+    }
+
+    void SiftDown(uint32_t pos) {
+
+        const Node node = nodes[pos];
+        const size_t count = nodes.size();
+        for (;;) {
+
+            const size_t first = size_t(pos) * 4 + 1;
+            if (first >= count) break;
+
+            // smallest of up to four children, all in one or two cache lines
+            size_t best = first;
+            const size_t last = first + 4 < count ? first + 4 : count;
+            for (size_t child = first + 1; child < last; ++child)
+                if (nodes[child].key < nodes[best].key) best = child;
+
+            if (!(nodes[best].key < node.key)) break;
+            Place(pos, nodes[best]);
+            pos = static_cast<uint32_t>(best);
+        }
+        Place(pos, node);
+    }
+
+    void RemoveAt(uint32_t pos) {
+
+        positions[nodes[pos].id] = NOT_STORED;
+        const Node last = nodes.back();
+        nodes.pop_back();
+        if (pos == nodes.size()) return;
+
+        nodes[pos] = last;
+        positions[last.id] = pos;
+        if (pos > 0 && last.key < nodes[(pos - 1) / 4].key) SiftUp(pos);
+        else SiftDown(pos);
+    }
+
+    std::vector<Node> nodes;
+    std::vector<uint32_t> positions;
+};
+
+#endif // !INDEXED_HEAP_H
@@ -0,0 +1,151 @@
+#include "mapped_file.h"
+
+#include <cstdio>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(MappedFile&& other) noexcept {
+
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+
+    if (this != &other) {
+
+        Close();
+        data = std::exchange(other.data, nullptr);
+        size = std::exchange(other.size, 0);
+        isOpen = std::exchange(other.isOpen, false);
+#ifdef _WIN32
+        fileHandle = std::exchange(other.fileHandle, nullptr);
+        mappingHandle = std::exchange(other.mappingHandle, nullptr);
+#endif
+    }
+    return *this;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const std::string& path) {
+
+    Close();
+
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+
+        fprintf(stderr, "MappedFile: cannot open %s\n", path.c_str());
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize)) {
+
+        CloseHandle(file);
+        return false;
+    }
+
+    fileHandle = file;
+    size = static_cast<size_t>(fileSize.QuadPart);
+    isOpen = true;
+
+    // an empty file cannot be mapped
+    if (size == 0) return true;
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+
+        fprintf(stderr, "MappedFile: cannot map %s\n", path.c_str());
+        Close();
+        return false;
+    }
+    mappingHandle = mapping;
+
+    data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (data == nullptr) {
+
+        fprintf(stderr, "MappedFile: cannot map %s\n", path.c_str());
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::Close() {
+
+    if (data) UnmapViewOfFile(data);
+    if (mappingHandle) CloseHandle(mappingHandle);
+    if (fileHandle) CloseHandle(fileHandle);
+
+    data = nullptr;
+    mappingHandle = nullptr;
+    fileHandle = nullptr;
+    size = 0;
+    isOpen = false;
+}
+
+#else
+
+bool MappedFile::Open(const std::string& path) {
+
+    Close();
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+
+        fprintf(stderr, "MappedFile: cannot open %s\n", path.c_str());
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+
+        close(fd);
+        return false;
+    }
+
+    size = static_cast<size_t>(st.st_size);
+    isOpen = true;
+
+    // an empty file cannot be mapped
+    if (size == 0) {
+
+        close(fd);
+        return true;
+    }
+
+    void* ptr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED) {
+
+        fprintf(stderr, "MappedFile: cannot map %s\n", path.c_str());
+        size = 0;
+        isOpen = false;
+        return false;
+    }
+    madvise(ptr, size, MADV_SEQUENTIAL);
+
+    data = static_cast<const char*>(ptr);
+    return true;
+}
+
+void MappedFile::Close() {
+
+    if (data) munmap(const_cast<char*>(data), size);
+
+    data = nullptr;
+    size = 0;
+    isOpen = false;
+}
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+// read-only memory mapping of a whole file
+class MappedFile {
+
+    // constructor
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string& path) { Open(path); }
+    ~MappedFile() { Close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    // main functions
+public:
+    bool Open(const std::string& path);
+    void Close();
+
+    bool IsOpen() const { return isOpen; }
+    const char* Data() const { return data; }
+    size_t Size() const { return size; }
+
+    // variables
+private:
+    const char* data = nullptr;
+    size_t size = 0;
+    bool isOpen = false;
+
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+};
+
+#endif // !MAPPED_FILE_H
@@ -0,0 +1,81 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "task_system.h"
+
+namespace Parallel {
+
+    inline unsigned int Concurrency() {
+
+        const unsigned int n = std::thread::hardware_concurrency();
+        return n == 0 ? 1 : n;
+    }
+
+    // split [0, count) into `chunks` contiguous pieces and run func(chunk, begin, end) for each one.
+    // chunk boundaries only depend on (count, chunks), so per-chunk outputs can be merged in order.
+    template <typename Func>
+    void ForChunks(size_t count, size_t chunks, Func&& func) {
+
+        chunks = std::max<size_t>(1, std::min(chunks, count));
+        if (count == 0) return;
+
+        const size_t step = (count + chunks - 1) / chunks;
+        if (chunks == 1) {
+
+            func(size_t(0), size_t(0), count);
+            return;
+        }
+
+        // one pool task per chunk, so loops nested in a chunk share the workers instead of adding threads
+        Tasks::ParallelFor(0, chunks, 1, [&](size_t first, size_t last) {
+
+            for (size_t c = first; c < last; ++c) {
+
+                const size_t b = std::min(count, c * step);
+                func(c, b, std::min(count, b + step));
+            }
+        });
+    }
+
+    // run func(begin, end) over sub-ranges of [begin, end), no sub-range smaller than `grain`
+    template <typename Func>
+    void For(size_t begin, size_t end, Func&& func, size_t grain = 4096) {
+
+        if (end <= begin) return;
+
+        const size_t count = end - begin;
+        const size_t chunks = std::min<size_t>(Concurrency(), (count + grain - 1) / grain);
+        ForChunks(count, chunks, [&](size_t, size_t b, size_t e) { func(begin + b, begin + e); });
+    }
+
+    // memcpy split over the workers, for large blocks
+    inline void Copy(void* dst, const void* src, size_t bytes) {
+
+        Parallel::For(0, bytes, [dst, src](size_t begin, size_t end) {
+
+            std::memcpy(static_cast<char*>(dst) + begin, static_cast<const char*>(src) + begin, end - begin);
+        }, size_t(1) << 20);
+    }
+
+    // in-place exclusive prefix sum, returns the total
+    template <typename T>
+    T ExclusiveScan(std::vector<T>& values) {
+
+        T sum = 0;
+        for (T& v : values) {
+
+            const T x = v;
+            v = sum;
+            sum += x;
+        }
+        return sum;
+    }
+}
+
+#endif // !PARALLEL_H
@@ -0,0 +1,162 @@
+#include "property_arena.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <new>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+namespace {
+
+    constexpr size_t COLUMN_ALIGNMENT = 64;
+    constexpr size_t MIN_CAPACITY = 1024;
+    constexpr size_t HUGE_PAGE_SIZE = size_t(2) << 20;
+    constexpr size_t PAGE_SIZE = size_t(4) << 10;
+    constexpr size_t NO_REGION = std::numeric_limits<size_t>::max();
+
+    size_t RoundUp(size_t value, size_t multiple) {
+
+        return (value + multiple - 1) / multiple * multiple;
+    }
+
+    // zeroed pages straight from the OS, huge pages when asked for and available
+    char* AllocatePages(size_t& bytes, bool hugePages, bool& hugeBacked) {
+
+        hugeBacked = false;
+#ifdef _WIN32
+        if (hugePages) {
+
+            // needs the lock pages in memory privilege, fall back to normal pages without it
+            const size_t large = GetLargePageMinimum();
+            if (large != 0) {
+
+                const size_t rounded = RoundUp(bytes, large);
+                void* p = VirtualAlloc(nullptr, rounded, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+                if (p) {
+
+                    bytes = rounded;
+                    hugeBacked = true;
+                    return static_cast<char*>(p);
+                }
+            }
+        }
+        bytes = RoundUp(bytes, PAGE_SIZE);
+        return static_cast<char*>(VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+#else
+        bytes = RoundUp(bytes, hugePages ? HUGE_PAGE_SIZE : PAGE_SIZE);
+        void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) return nullptr;
+#ifdef MADV_HUGEPAGE
+        if (hugePages) hugeBacked = madvise(p, bytes, MADV_HUGEPAGE) == 0;
+#endif
+        return static_cast<char*>(p);
+#endif
+    }
+
+    void FreePages(char* p, size_t bytes) {
+
+        if (!p) return;
+#ifdef _WIN32
+        (void)bytes;
+        VirtualFree(p, 0, MEM_RELEASE);
+#else
+        munmap(p, bytes);
+#endif
+    }
+}
+
+PropertyArena::~PropertyArena() {
+
+    FreePages(block, blockBytes);
+}
+
+size_t PropertyArena::RegionBytes(size_t width, size_t elements) const {
+
+    return RoundUp(width * elements, COLUMN_ALIGNMENT);
+}
+
+int PropertyArena::AddColumn(size_t bytesPerElement) {
+
+    // a released column of the same width already has its region
+    for (size_t c = 0; c < columns.size(); ++c) {
+
+        Column& column = columns[c];
+        if (column.live || column.width != bytesPerElement) continue;
+
+        column.live = true;
+        std::memset(block + column.offset, 0, column.width * count);
+        return static_cast<int>(c);
+    }
+
+    if (capacity == 0) capacity = MIN_CAPACITY;
+    const size_t region = RegionBytes(bytesPerElement, capacity);
+    if (usedBytes + region > blockBytes) {
+
+        // room for this column and as many more again
+        columns.push_back({ bytesPerElement, NO_REGION, true });
+        Relayout(capacity, std::max(blockBytes * 2, (usedBytes + region) * 2));
+    }
+    else {
+
+        columns.push_back({ bytesPerElement, usedBytes, true });
+        usedBytes += region;
+    }
+    return static_cast<int>(columns.size() - 1);
+}
+
+void PropertyArena::RemoveColumn(int column) {
+
+    columns[column].live = false;
+}
+
+void PropertyArena::Resize(size_t newCount) {
+
+    if (newCount > capacity) {
+
+        // all columns move to a new block at once, sized for the grown capacity plus headroom
+        const size_t newCapacity = std::max({ newCount, capacity * 2, MIN_CAPACITY });
+        size_t bytes = 0;
+        for (const Column& column : columns) bytes += RegionBytes(column.width, newCapacity);
+        Relayout(newCapacity, bytes + bytes / 4);
+    }
+    else if (newCount > count) {
+
+        for (const Column& column : columns) {
+
+            if (column.live) std::memset(block + column.offset + column.width * count, 0, column.width * (newCount - count));
+        }
+    }
+    count = newCount;
+}
+
+void PropertyArena::Relayout(size_t newCapacity, size_t newBlockBytes) {
+
+    size_t bytes = newBlockBytes;
+    bool huge = false;
+    char* newBlock = AllocatePages(bytes, hugePages, huge);
+    if (!newBlock) throw std::bad_alloc();
+
+    // the new block is zeroed, only live elements are copied
+    size_t offset = 0;
+    for (Column& column : columns) {
+
+        if (column.live && column.offset != NO_REGION)
+            std::memcpy(newBlock + offset, block + column.offset, column.width * count);
+        column.offset = offset;
+        offset += RegionBytes(column.width, newCapacity);
+    }
+
+    FreePages(block, blockBytes);
+    block = newBlock;
+    blockBytes = bytes;
+    usedBytes = offset;
+    capacity = newCapacity;
+    hugeBacked = huge;
+}
@@ -0,0 +1,101 @@
+#ifndef PROPERTY_ARENA_H
+#define PROPERTY_ARENA_H
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// One memory block holding many per-element columns of the same length, the storage for temporary
+// properties of mesh tools. Columns grow together when the element count grows, and released columns
+// are reused by the next column of the same width, so adding and removing scratch properties does not
+// allocate. The block comes straight from the OS and can be backed by huge pages.
+class PropertyArena {
+
+    // constructor
+public:
+    explicit PropertyArena(bool hugePages = false) : hugePages(hugePages) {}
+    ~PropertyArena();
+
+    PropertyArena(const PropertyArena&) = delete;
+    PropertyArena& operator=(const PropertyArena&) = delete;
+
+    // main functions
+public:
+    // zero-filled column of bytesPerElement per element, the id stays valid until RemoveColumn
+    int AddColumn(size_t bytesPerElement);
+    void RemoveColumn(int column);
+
+    // every column holds count elements afterwards, new elements are zero
+    void Resize(size_t count);
+
+    void* Data(int column) { return block + columns[column].offset; }
+    const void* Data(int column) const { return block + columns[column].offset; }
+
+    size_t Size() const { return count; }
+    size_t Capacity() const { return capacity; }
+    size_t ReservedBytes() const { return blockBytes; }
+    bool HugePages() const { return hugeBacked; }
+
+    // variables
+private:
+    struct Column {
+
+        size_t width;
+        size_t offset;
+        bool live;
+    };
+
+    size_t RegionBytes(size_t width, size_t elements) const;
+    void Relayout(size_t newCapacity, size_t newBlockBytes);
+
+    char* block = nullptr;
+    size_t blockBytes = 0;
+    size_t usedBytes = 0;
+    size_t capacity = 0;
+    size_t count = 0;
+    std::vector<Column> columns;
+
+    bool hugePages = false;
+    bool hugeBacked = false;
+};
+
+// typed column of an arena, released on destruction
+template <typename T>
+class ArenaProperty {
+
+    static_assert(std::is_trivially_copyable_v<T>, "arena columns are moved with memcpy");
+    static_assert(alignof(T) <= 64, "arena columns are 64-byte aligned");
+
+public:
+    ArenaProperty() = default;
+    explicit ArenaProperty(PropertyArena& arena) : arena(&arena), column(arena.AddColumn(sizeof(T))) {}
+    ~ArenaProperty() { if (arena) arena->RemoveColumn(column); }
+
+    ArenaProperty(const ArenaProperty&) = delete;
+    ArenaProperty& operator=(const ArenaProperty&) = delete;
+    ArenaProperty(ArenaProperty&& other) noexcept : arena(std::exchange(other.arena, nullptr)), column(other.column) {}
+    ArenaProperty& operator=(ArenaProperty&& other) noexcept {
+
+        if (this != &other) {
+
+            if (arena) arena->RemoveColumn(column);
+            arena = std::exchange(other.arena, nullptr);
+            column = other.column;
+        }
+        return *this;
+    }
+
+    // the pointer changes when the arena grows
+    T* Data() { return static_cast<T*>(arena->Data(column)); }
+    const T* Data() const { return static_cast<const T*>(arena->Data(column)); }
+    T& operator[](size_t i) { return Data()[i]; }
+    const T& operator[](size_t i) const { return Data()[i]; }
+    size_t Size() const { return arena->Size(); }
+
+private:
+    PropertyArena* arena = nullptr;
+    int column = -1;
+};
+
+#endif // !PROPERTY_ARENA_H
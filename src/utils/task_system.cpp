@@ -0,0 +1,206 @@
+#include "task_system.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+#include <unsupported/Eigen/CXX11/ThreadPool>
+
+#include "parallel.h"
+
+namespace {
+
+    constexpr size_t PRIORITY_COUNT = 3;
+
+    // Eigen's pool has no priorities: submitted tasks wait in one queue per priority and every
+    // submission schedules a token on the pool that runs the most urgent task waiting at that time
+    struct Scheduler {
+
+        std::mutex pendingMutex;
+        std::deque<std::function<void()>> pending[PRIORITY_COUNT];
+
+        std::mutex mainMutex;
+        std::vector<std::function<void()>> mainTasks;
+
+        // declared last so the workers are joined before the queues go away
+        Eigen::ThreadPool pool;
+
+        Scheduler() : pool(static_cast<int>(std::max(1u, Parallel::Concurrency() - 1))) {}
+    };
+
+    Scheduler& Instance() {
+
+        static Scheduler scheduler;
+        return scheduler;
+    }
+
+    // shared with the helpers, which may start after the loop is over
+    struct LoopState {
+
+        size_t begin = 0, end = 0, grain = 1, pieces = 0;
+        const std::function<void(size_t, size_t)>* func = nullptr;
+        const Tasks::CancellationToken* token = nullptr;
+
+        std::atomic<size_t> next{ 0 };
+        std::atomic<size_t> done{ 0 };
+        std::atomic<bool> cancelled{ false };
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+
+    void RunPieces(LoopState& state) {
+
+        size_t ran = 0;
+        for (size_t p = state.next.fetch_add(1); p < state.pieces; p = state.next.fetch_add(1)) {
+
+            if (state.token && state.token->IsCancelled()) state.cancelled.store(true, std::memory_order_relaxed);
+            if (!state.cancelled.load(std::memory_order_relaxed)) {
+
+                const size_t b = state.begin + p * state.grain;
+                (*state.func)(b, std::min(state.end, b + state.grain));
+            }
+            ++ran;
+        }
+        if (ran && state.done.fetch_add(ran) + ran == state.pieces) {
+
+            std::lock_guard<std::mutex> lock(state.mutex);
+            state.finished.notify_all();
+        }
+    }
+}
+
+namespace Tasks {
+
+    size_t WorkerCount() {
+
+        return static_cast<size_t>(Instance().pool.NumThreads());
+    }
+
+    bool IsWorkerThread() {
+
+        return Instance().pool.CurrentThreadId() >= 0;
+    }
+
+    void Submit(std::function<void()> task, Priority priority) {
+
+        Scheduler& scheduler = Instance();
+        {
+            std::lock_guard<std::mutex> lock(scheduler.pendingMutex);
+            scheduler.pending[static_cast<size_t>(priority)].push_back(std::move(task));
+        }
+        scheduler.pool.Schedule([]() { RunPending(); });
+    }
+
+    bool RunPending() {
+
+        Scheduler& scheduler = Instance();
+        std::function<void()> task;
+        {
+            std::lock_guard<std::mutex> lock(scheduler.pendingMutex);
+            for (auto& queue : scheduler.pending) {
+
+                if (queue.empty()) continue;
+                task = std::move(queue.front());
+                queue.pop_front();
+                break;
+            }
+        }
+        if (!task) return false;
+
+        task();
+        return true;
+    }
+
+    void PostToMain(std::function<void()> task) {
+
+        Scheduler& scheduler = Instance();
+        std::lock_guard<std::mutex> lock(scheduler.mainMutex);
+        scheduler.mainTasks.push_back(std::move(task));
+    }
+
+    size_t RunMainThreadTasks() {
+
+        Scheduler& scheduler = Instance();
+        std::vector<std::function<void()>> tasks;
+        {
+            std::lock_guard<std::mutex> lock(scheduler.mainMutex);
+            tasks.swap(scheduler.mainTasks);
+        }
+
+        // callbacks posted from here on run next frame
+        for (auto& task : tasks) task();
+        return tasks.size();
+    }
+
+    struct TaskGroup::State {
+
+        std::atomic<size_t> pending{ 0 };
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+
+    TaskGroup::TaskGroup(CancellationToken token) : state(std::make_shared<State>()), token(std::move(token)) {}
+
+    void TaskGroup::Run(std::function<void()> task, Priority priority) {
+
+        state->pending.fetch_add(1);
+        Submit([state = state, token = token, task = std::move(task)]() {
+
+            if (!token.IsCancelled()) task();
+            if (state->pending.fetch_sub(1) == 1) {
+
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->finished.notify_all();
+            }
+        }, priority);
+    }
+
+    void TaskGroup::Wait() {
+
+        while (state->pending.load() != 0) {
+
+            // help instead of blocking a worker; the wait is bounded since tasks the group
+            // spawns from inside its own tasks can arrive after the queues were found empty
+            if (RunPending()) continue;
+
+            std::unique_lock<std::mutex> lock(state->mutex);
+            state->finished.wait_for(lock, std::chrono::milliseconds(1), [this]() { return state->pending.load() == 0; });
+        }
+    }
+
+    bool ParallelFor(size_t begin, size_t end, size_t grain, const std::function<void(size_t, size_t)>& func,
+                     const CancellationToken* token) {
+
+        if (end <= begin) return true;
+        if (token && token->IsCancelled()) return false;
+
+        grain = std::max<size_t>(1, grain);
+        const size_t pieces = (end - begin + grain - 1) / grain;
+        if (pieces == 1) {
+
+            func(begin, end);
+            return true;
+        }
+
+        auto state = std::make_shared<LoopState>();
+        state->begin = begin;
+        state->end = end;
+        state->grain = grain;
+        state->pieces = pieces;
+        state->func = &func;
+        state->token = token;
+
+        // helpers pushed from a worker land on its own queue, idle workers steal them from there
+        Eigen::ThreadPool& pool = Instance().pool;
+        const size_t helpers = std::min(pieces - 1, static_cast<size_t>(pool.NumThreads()));
+        for (size_t i = 0; i < helpers; ++i) pool.Schedule([state]() { RunPieces(*state); });
+        RunPieces(*state);
+
+        // every piece is claimed by now, only the ones still running are waited for
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->finished.wait(lock, [&]() { return state->done.load() == pieces; });
+        return !state->cancelled.load();
+    }
+}
@@ -0,0 +1,134 @@
+#ifndef TASK_SYSTEM_H
+#define TASK_SYSTEM_H
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// One process-wide pool of workers for everything that runs off the render thread: mesh IO, decimation,
+// normals, subdivision. Built on Eigen's non-blocking thread pool, every worker owns a queue and idle
+// workers steal from the others, so nested parallel loops spread without oversubscribing the cores.
+namespace Tasks {
+
+    // submitted tasks are started high first, running tasks are never preempted
+    enum class Priority { High, Normal, Low };
+
+    // cooperative cancellation, copies share the flag
+    class CancellationToken {
+
+        // main functions
+    public:
+        CancellationToken() : flag(std::make_shared<std::atomic<bool>>(false)) {}
+
+        void Cancel() const { flag->store(true, std::memory_order_relaxed); }
+        bool IsCancelled() const { return flag->load(std::memory_order_relaxed); }
+
+        // variables
+    private:
+        std::shared_ptr<std::atomic<bool>> flag;
+    };
+
+    size_t WorkerCount();
+    bool IsWorkerThread();
+
+    // fire and forget, nothing on the caller's stack may be captured by reference
+    void Submit(std::function<void()> task, Priority priority = Priority::Normal);
+
+    // run one submitted task on the calling thread, false if none was waiting
+    bool RunPending();
+
+    // callbacks for the render thread, MainWindow::Run drains them once per frame
+    void PostToMain(std::function<void()> task);
+    size_t RunMainThreadTasks();
+
+    // tasks that are waited for together. Wait runs submitted tasks while it blocks, so a group can be
+    // waited for from inside another task.
+    class TaskGroup {
+
+        // constructor
+    public:
+        explicit TaskGroup(CancellationToken token = {});
+        ~TaskGroup() { Wait(); }
+
+        TaskGroup(const TaskGroup&) = delete;
+        TaskGroup& operator=(const TaskGroup&) = delete;
+
+        // main functions
+    public:
+        // tasks that have not started when the token is cancelled are dropped
+        void Run(std::function<void()> task, Priority priority = Priority::Normal);
+        void Wait();
+
+        const CancellationToken& Token() const { return token; }
+
+        // variables
+    private:
+        struct State;
+
+        std::shared_ptr<State> state;
+        CancellationToken token;
+    };
+
+    // func(begin, end) over grain-sized pieces of [begin, end). The caller works on pieces too and only
+    // waits for pieces already being run, so this nests inside tasks. Once the token is cancelled no
+    // more pieces start; false then.
+    bool ParallelFor(size_t begin, size_t end, size_t grain, const std::function<void(size_t, size_t)>& func,
+                     const CancellationToken* token = nullptr);
+
+    // map(begin, end) per piece, folded with reduce in piece order so the result does not depend on timing
+    template <typename T, typename Map, typename Reduce>
+    T ParallelReduce(size_t begin, size_t end, size_t grain, T identity, Map&& map, Reduce&& reduce) {
+
+        if (end <= begin) return identity;
+
+        grain = grain == 0 ? 1 : grain;
+        const size_t pieces = (end - begin + grain - 1) / grain;
+        std::vector<T> partial(pieces, identity);
+        ParallelFor(0, pieces, 1, [&](size_t first, size_t last) {
+
+            for (size_t p = first; p < last; ++p) {
+
+                const size_t b = begin + p * grain;
+                partial[p] = map(b, b + grain < end ? b + grain : end);
+            }
+        });
+
+        T result = std::move(identity);
+        for (T& value : partial) result = reduce(std::move(result), std::move(value));
+        return result;
+    }
+
+    // work() on a worker, then done(result) on the render thread. Nothing runs once the token is
+    // cancelled, done included, so a cancelled job never touches the state it was started for.
+    template <typename Work, typename Done>
+    void Async(Work work, Done done, Priority priority = Priority::Normal, CancellationToken token = {}) {
+
+        Submit([work = std::move(work), done = std::move(done), token]() mutable {
+
+            if (token.IsCancelled()) return;
+            if constexpr (std::is_void_v<std::invoke_result_t<Work&>>) {
+
+                work();
+                PostToMain([done = std::move(done), token]() mutable {
+
+                    if (!token.IsCancelled()) done();
+                });
+            }
+            else {
+
+                // shared so move-only results still fit in a std::function
+                auto result = std::make_shared<std::invoke_result_t<Work&>>(work());
+                PostToMain([done = std::move(done), result, token]() mutable {
+
+                    if (!token.IsCancelled()) done(std::move(*result));
+                });
+            }
+        }, priority);
+    }
+}
+
+#endif // !TASK_SYSTEM_H